@@ -74,10 +74,18 @@ typedef struct {
  *
  */
 typedef struct {
-	uint64_t total;    /**< Total physical memory (bytes) */
-	uint64_t unavail;  /**< Unavailable (reserved, firmware) bytes */
-	uint64_t used;     /**< Allocated physical memory (bytes) */
-	uint64_t free;     /**< Free physical memory (bytes) */
+	uint64_t total;         /**< Total physical memory (bytes) */
+	uint64_t unavail;       /**< Unavailable (reserved, firmware) bytes */
+	uint64_t used;          /**< Allocated physical memory (bytes) */
+	uint64_t free;          /**< Free physical memory (bytes) */
+	uint64_t cached;        /**< Used bytes kept in per-CPU frame caches */
+	uint64_t cache_hits;    /**< Allocations served by frame caches */
+	uint64_t cache_misses;  /**< Allocations which missed frame caches */
+	uint64_t zeroed;        /**< Used bytes kept pre-zeroed in zero pools */
+	uint64_t zero_hits;     /**< Zeroed frames taken from zero pools */
+	uint64_t zero_misses;   /**< Zeroed frames cleared on demand */
+	uint64_t large_pages;   /**< Live large page mappings */
+	uint64_t large_mapped;  /**< Bytes mapped by large pages */
 } stats_physmem_t;
 
 /** IPC statistics
@@ -40,6 +40,11 @@ void ipi_broadcast_arch(int ipi)
 {
 }
 
+bool ipi_unicast_arch(unsigned int cpu_id, int ipi)
+{
+	return false;
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
@@ -161,6 +161,14 @@
 #define PTE_EXECUTABLE_ARCH(p) \
 	((p)->no_execute == 0)
 
+/* Large pages of 2 MiB are mapped by PTL2 entries with the page size bit. */
+#define LARGE_PAGE_WIDTH_ARCH  21
+
+#define PTE_LARGE_ARCH(p) \
+	((p)->page_size != 0)
+#define SET_PTE_LARGE_ARCH(p, x) \
+	((p)->page_size = ((x) != 0))
+
 #ifndef __ASSEMBLER__
 
 #include <mm/mm.h>
@@ -197,7 +205,7 @@ typedef struct {
 	unsigned int page_cache_disable : 1;
 	unsigned int accessed : 1;
 	unsigned int dirty : 1;
-	unsigned int unused : 1;
+	unsigned int page_size : 1;  /**< Maps a large page (PTL2 entries only). */
 	unsigned int global : 1;
 	unsigned int soft_valid : 1;  /**< Valid content even if present bit is cleared. */
 	unsigned int avl : 2;
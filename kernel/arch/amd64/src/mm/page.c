@@ -57,6 +57,7 @@ void page_arch_init(void)
 	    PAGE_GLOBAL | PAGE_CACHEABLE | PAGE_EXEC | PAGE_WRITE | PAGE_READ;
 
 	page_mapping_operations = &pt_mapping_operations;
+	large_page_size = LARGE_PAGE_SIZE;
 
 	page_table_lock(AS_KERNEL, true);
 
@@ -85,6 +85,7 @@ GEN_READ_REG(cr0);
 GEN_READ_REG(cr2);
 GEN_READ_REG(cr3);
 GEN_WRITE_REG(cr3);
+GEN_READ_REG(cr4);
 
 GEN_WRITE_REG(cr0);
 
@@ -141,6 +141,18 @@
 	((p)->writeable != 0)
 #define PTE_EXECUTABLE_ARCH(p)  1
 
+/*
+ * Large pages are mapped by page directory entries, in which bit 7 (PAT in
+ * page table entries) is the page size bit. They require the page size
+ * extension, which is enabled during boot when the processor supports it.
+ */
+#define LARGE_PAGE_WIDTH_ARCH  22
+
+#define PTE_LARGE_ARCH(p) \
+	((p)->pat != 0)
+#define SET_PTE_LARGE_ARCH(p, x) \
+	((p)->pat = ((x) != 0))
+
 #ifndef __ASSEMBLER__
 
 #include <mm/mm.h>
@@ -44,6 +44,7 @@
 #include <halt.h>
 #include <arch/interrupt.h>
 #include <arch/asm.h>
+#include <arch/cpu.h>
 #include <debug.h>
 #include <interrupt.h>
 #include <macros.h>
@@ -62,6 +63,10 @@ void page_arch_init(void)
 
 	page_mapping_operations = &pt_mapping_operations;
 
+	/* The boot code enables PSE if the processor supports it. */
+	if (read_cr4() & CR4_PSE)
+		large_page_size = LARGE_PAGE_SIZE;
+
 	/*
 	 * PA2KA(identity) mapping for all low-memory frames.
 	 */
@@ -35,6 +35,7 @@
 #ifdef CONFIG_SMP
 
 #include <smp/ipi.h>
+#include <cpu.h>
 #include <arch/smp/apic.h>
 
 void ipi_broadcast_arch(int ipi)
@@ -42,6 +43,12 @@ void ipi_broadcast_arch(int ipi)
 	(void) l_apic_broadcast_custom_ipi((uint8_t) ipi);
 }
 
+bool ipi_unicast_arch(unsigned int cpu_id, int ipi)
+{
+	return l_apic_send_custom_ipi((uint8_t) cpus[cpu_id].arch.id,
+	    (uint8_t) ipi) != 0;
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
@@ -41,6 +41,11 @@ void ipi_broadcast_arch(int ipi)
 {
 }
 
+bool ipi_unicast_arch(unsigned int cpu_id, int ipi)
+{
+	return false;
+}
+
 void smp_init(void)
 {
 }
@@ -45,6 +45,11 @@ void ipi_broadcast_arch(int ipi)
 	*((volatile uint32_t *) MSIM_DORDER_ADDRESS) = 0x7fffffff;
 }
 
+bool ipi_unicast_arch(unsigned int cpu_id, int ipi)
+{
+	return false;
+}
+
 #endif
 
 uint32_t dorder_cpuid(void)
@@ -172,5 +172,31 @@ void ipi_broadcast_arch(int ipi)
 	}
 }
 
+/** Deliver IPI to one processor.
+ *
+ * We assume that interrupts are disabled.
+ *
+ * @param cpu_id Logical ID of the target processor.
+ * @param ipi    IPI number.
+ *
+ * @return True if the IPI was sent.
+ */
+bool ipi_unicast_arch(unsigned int cpu_id, int ipi)
+{
+	void (*func)(void);
+
+	switch (ipi) {
+	case IPI_TLB_SHOOTDOWN:
+		func = tlb_shootdown_ipi_recv;
+		break;
+	default:
+		panic("Unknown IPI (%d).\n", ipi);
+		break;
+	}
+
+	cross_call(cpus[cpu_id].arch.mid, func);
+	return true;
+}
+
 /** @}
  */
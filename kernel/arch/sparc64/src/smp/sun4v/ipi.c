@@ -121,5 +121,30 @@ void ipi_broadcast_arch(int ipi)
 	ipi_brodcast_to(func, ipi_cpu_list[CPU->arch.id], idx);
 }
 
+/** Deliver IPI to one processor.
+ *
+ * We assume that interrupts are disabled.
+ *
+ * @param cpu_id Logical ID of the target processor.
+ * @param ipi    IPI number.
+ *
+ * @return True if the IPI was sent.
+ */
+bool ipi_unicast_arch(unsigned int cpu_id, int ipi)
+{
+	void (*func)(void);
+
+	switch (ipi) {
+	case IPI_TLB_SHOOTDOWN:
+		func = tlb_shootdown_ipi_recv;
+		break;
+	default:
+		panic("Unknown IPI (%d).\n", ipi);
+		break;
+	}
+
+	return ipi_unicast_to(func, (uint16_t) cpus[cpu_id].id) == HV_EOK;
+}
+
 /** @}
  */
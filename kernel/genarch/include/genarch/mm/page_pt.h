@@ -139,6 +139,16 @@
 #define PTE_WRITABLE(p)    PTE_WRITABLE_ARCH((p))
 #define PTE_EXECUTABLE(p)  PTE_EXECUTABLE_ARCH((p))
 
+/*
+ * Macros for the entries which point to PTL3 or map a large page instead.
+ *
+ */
+#ifdef LARGE_PAGE_WIDTH_ARCH
+#define LARGE_PAGE_SIZE      ((uintptr_t) 1 << LARGE_PAGE_WIDTH_ARCH)
+#define PTE_LARGE(p)         PTE_LARGE_ARCH((p))
+#define SET_PTE_LARGE(p, x)  SET_PTE_LARGE_ARCH((p), (x))
+#endif
+
 extern as_operations_t as_pt_operations;
 extern page_mapping_operations_t pt_mapping_operations;
 
@@ -95,8 +95,7 @@ void ht_destroy(pte_t *page_table)
 
 /** Lock page table.
  *
- * Lock address space.
- * Interrupts must be disabled.
+ * Lock the page table and optionally the address space.
  *
  * @param as   Address space.
  * @param lock If false, do not attempt to lock the address space.
@@ -106,12 +105,13 @@ void ht_lock(as_t *as, bool lock)
 {
 	if (lock)
 		mutex_lock(&as->lock);
+
+	mutex_lock(&as->mapping_lock);
 }
 
 /** Unlock page table.
  *
- * Unlock address space.
- * Interrupts must be disabled.
+ * Unlock the page table and optionally the address space.
  *
  * @param as     Address space.
  * @param unlock If false, do not attempt to lock the address space.
@@ -119,6 +119,8 @@ void ht_lock(as_t *as, bool lock)
  */
 void ht_unlock(as_t *as, bool unlock)
 {
+	mutex_unlock(&as->mapping_lock);
+
 	if (unlock)
 		mutex_unlock(&as->lock);
 }
@@ -132,7 +134,7 @@ void ht_unlock(as_t *as, bool unlock)
  */
 bool ht_locked(as_t *as)
 {
-	return mutex_locked(&as->lock);
+	return mutex_locked(&as->mapping_lock);
 }
 
 /** @}
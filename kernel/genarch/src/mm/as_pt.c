@@ -116,8 +116,7 @@ void ptl0_destroy(pte_t *page_table)
 
 /** Lock page tables.
  *
- * Lock only the address space.
- * Interrupts must be disabled.
+ * Lock the page tables and optionally the address space.
  *
  * @param as   Address space.
  * @param lock If false, do not attempt to lock the address space.
@@ -127,12 +126,13 @@ void pt_lock(as_t *as, bool lock)
 {
 	if (lock)
 		mutex_lock(&as->lock);
+
+	mutex_lock(&as->mapping_lock);
 }
 
 /** Unlock page tables.
  *
- * Unlock the address space.
- * Interrupts must be disabled.
+ * Unlock the page tables and optionally the address space.
  *
  * @param as     Address space.
  * @param unlock If false, do not attempt to unlock the address space.
@@ -140,6 +140,8 @@ void pt_lock(as_t *as, bool lock)
  */
 void pt_unlock(as_t *as, bool unlock)
 {
+	mutex_unlock(&as->mapping_lock);
+
 	if (unlock)
 		mutex_unlock(&as->lock);
 }
@@ -153,7 +155,7 @@ void pt_unlock(as_t *as, bool unlock)
  */
 bool pt_locked(as_t *as)
 {
-	return mutex_locked(&as->lock);
+	return mutex_locked(&as->mapping_lock);
 }
 
 /** @}
@@ -60,6 +60,7 @@
 #include <mm/asid.h>
 #include <mm/as.h>
 #include <mm/tlb.h>
+#include <cpu/cpu_mask.h>
 #include <arch/mm/asid.h>
 #include <synch/spinlock.h>
 #include <synch/mutex.h>
@@ -128,6 +129,14 @@ asid_t asid_get(void)
 		ipl_t ipl = tlb_shootdown_start(TLB_INVL_ASID, asid, 0, 0);
 		tlb_invalidate_asid(asid);
 		tlb_shootdown_finalize(ipl);
+
+		/*
+		 * No processor caches translations of the address space
+		 * from which the ASID was stolen any more.
+		 */
+		spinlock_lock(&as->cpus_lock);
+		cpu_mask_none(as->cpus);
+		spinlock_unlock(&as->cpus_lock);
 	} else {
 
 		/*
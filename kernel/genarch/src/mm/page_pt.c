@@ -57,32 +57,60 @@ static bool pt_mapping_find(as_t *, uintptr_t, bool, pte_t *pte);
 static void pt_mapping_update(as_t *, uintptr_t, bool, pte_t *pte);
 static void pt_mapping_make_global(uintptr_t, size_t);
 
+#ifdef LARGE_PAGE_WIDTH_ARCH
+
+/*
+ * Large pages are mapped by the entries which would otherwise point to PTL3.
+ * With 2-level page tables, these are the PTL0 entries.
+ */
+#if (PTL1_ENTRIES == 0) && (PTL2_ENTRIES == 0)
+#define LARGE_PTL0
+#define LARGE_INDEX(page)            PTL0_INDEX(page)
+#define GET_LARGE_FLAGS(pt, i)       GET_PTL1_FLAGS(pt, i)
+#define SET_LARGE_ADDRESS(pt, i, a)  SET_PTL1_ADDRESS(pt, i, a)
+#define SET_LARGE_FLAGS(pt, i, x)    SET_PTL1_FLAGS(pt, i, x)
+#define SET_LARGE_PRESENT(pt, i)     SET_PTL1_PRESENT(pt, i)
+#elif (PTL2_ENTRIES != 0)
+#define LARGE_PTL2
+#define LARGE_INDEX(page)            PTL2_INDEX(page)
+#define GET_LARGE_FLAGS(pt, i)       GET_PTL3_FLAGS(pt, i)
+#define SET_LARGE_ADDRESS(pt, i, a)  SET_PTL3_ADDRESS(pt, i, a)
+#define SET_LARGE_FLAGS(pt, i, x)    SET_PTL3_FLAGS(pt, i, x)
+#define SET_LARGE_PRESENT(pt, i)     SET_PTL3_PRESENT(pt, i)
+#else
+#error "Large pages are not supported with 3-level page tables."
+#endif
+
+static bool pt_mapping_insert_large(as_t *, uintptr_t, uintptr_t,
+    unsigned int);
+static bool pt_mapping_demote(as_t *, uintptr_t);
+
+#endif /* LARGE_PAGE_WIDTH_ARCH */
+
 page_mapping_operations_t pt_mapping_operations = {
 	.mapping_insert = pt_mapping_insert,
 	.mapping_remove = pt_mapping_remove,
 	.mapping_find = pt_mapping_find,
 	.mapping_update = pt_mapping_update,
-	.mapping_make_global = pt_mapping_make_global
+	.mapping_make_global = pt_mapping_make_global,
+#ifdef LARGE_PAGE_WIDTH_ARCH
+	.mapping_insert_large = pt_mapping_insert_large,
+	.mapping_demote = pt_mapping_demote
+#endif
 };
 
-/** Map page to frame using hierarchical page tables.
+/** Get PTL2, allocating PTL1 and PTL2 if they are missing.
  *
- * Map virtual address page to physical address frame
- * using flags.
+ * @param as   Address space to wich page belongs.
+ * @param page Virtual address of the page.
  *
- * @param as    Address space to wich page belongs.
- * @param page  Virtual address of the page to be mapped.
- * @param frame Physical address of memory frame to which the mapping is done.
- * @param flags Flags to be used for mapping.
+ * @return Kernel address of PTL2 for page.
  *
  */
-void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
-    unsigned int flags)
+static pte_t *pt_ptl2_get(as_t *as, uintptr_t page)
 {
 	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
 
-	assert(page_table_locked(as));
-
 	if (GET_PTL1_FLAGS(ptl0, PTL0_INDEX(page)) & PAGE_NOT_PRESENT) {
 		pte_t *newpt = (pte_t *)
 		    PA2KA(frame_alloc(PTL1_FRAMES, FRAME_LOWMEM, PTL1_SIZE - 1));
@@ -100,6 +128,11 @@ void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
 		SET_PTL1_PRESENT(ptl0, PTL0_INDEX(page));
 	}
 
+#ifdef LARGE_PTL0
+	/* Large pages must be demoted before regular pages are mapped. */
+	assert(!PTE_LARGE(&ptl0[PTL0_INDEX(page)]));
+#endif
+
 	pte_t *ptl1 = (pte_t *) PA2KA(GET_PTL1_ADDRESS(ptl0, PTL0_INDEX(page)));
 
 	if (GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT) {
@@ -117,7 +150,31 @@ void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
 		SET_PTL2_PRESENT(ptl1, PTL1_INDEX(page));
 	}
 
-	pte_t *ptl2 = (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+	return (pte_t *) PA2KA(GET_PTL2_ADDRESS(ptl1, PTL1_INDEX(page)));
+}
+
+/** Map page to frame using hierarchical page tables.
+ *
+ * Map virtual address page to physical address frame
+ * using flags.
+ *
+ * @param as    Address space to wich page belongs.
+ * @param page  Virtual address of the page to be mapped.
+ * @param frame Physical address of memory frame to which the mapping is done.
+ * @param flags Flags to be used for mapping.
+ *
+ */
+void pt_mapping_insert(as_t *as, uintptr_t page, uintptr_t frame,
+    unsigned int flags)
+{
+	assert(page_table_locked(as));
+
+	pte_t *ptl2 = pt_ptl2_get(as, page);
+
+#ifdef LARGE_PTL2
+	/* Large pages must be demoted before regular pages are mapped. */
+	assert(!PTE_LARGE(&ptl2[PTL2_INDEX(page)]));
+#endif
 
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT) {
 		pte_t *newpt = (pte_t *)
@@ -169,6 +226,11 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 	if (GET_PTL1_FLAGS(ptl0, PTL0_INDEX(page)) & PAGE_NOT_PRESENT)
 		return;
 
+#ifdef LARGE_PTL0
+	/* Large pages must be demoted before their pages are removed. */
+	assert(!PTE_LARGE(&ptl0[PTL0_INDEX(page)]));
+#endif
+
 	pte_t *ptl1 = (pte_t *) PA2KA(GET_PTL1_ADDRESS(ptl0, PTL0_INDEX(page)));
 	if (GET_PTL2_FLAGS(ptl1, PTL1_INDEX(page)) & PAGE_NOT_PRESENT)
 		return;
@@ -177,6 +239,11 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
 		return;
 
+#ifdef LARGE_PTL2
+	/* Large pages must be demoted before their pages are removed. */
+	assert(!PTE_LARGE(&ptl2[PTL2_INDEX(page)]));
+#endif
+
 	pte_t *ptl3 = (pte_t *) PA2KA(GET_PTL3_ADDRESS(ptl2, PTL2_INDEX(page)));
 
 	/*
@@ -291,14 +358,24 @@ void pt_mapping_remove(as_t *as, uintptr_t page)
 #endif /* PTL1_ENTRIES != 0 */
 }
 
-static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
+static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock,
+    bool *large)
 {
 	assert(nolock || page_table_locked(as));
 
+	*large = false;
+
 	pte_t *ptl0 = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
 	if (GET_PTL1_FLAGS(ptl0, PTL0_INDEX(page)) & PAGE_NOT_PRESENT)
 		return NULL;
 
+#ifdef LARGE_PTL0
+	if (PTE_LARGE(&ptl0[PTL0_INDEX(page)])) {
+		*large = true;
+		return &ptl0[PTL0_INDEX(page)];
+	}
+#endif
+
 	read_barrier();
 
 	pte_t *ptl1 = (pte_t *) PA2KA(GET_PTL1_ADDRESS(ptl0, PTL0_INDEX(page)));
@@ -316,6 +393,13 @@ static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
 	if (GET_PTL3_FLAGS(ptl2, PTL2_INDEX(page)) & PAGE_NOT_PRESENT)
 		return NULL;
 
+#ifdef LARGE_PTL2
+	if (PTE_LARGE(&ptl2[PTL2_INDEX(page)])) {
+		*large = true;
+		return &ptl2[PTL2_INDEX(page)];
+	}
+#endif
+
 #if (PTL2_ENTRIES != 0)
 	/*
 	 * Always read ptl3 only after we are sure it is present.
@@ -329,6 +413,9 @@ static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
 }
 
 /** Find mapping for virtual page in hierarchical page tables.
+ *
+ * A page mapped by a large page is described by a PTE as if it was
+ * mapped on its own.
  *
  * @param as       Address space to which page belongs.
  * @param page     Virtual page.
@@ -339,10 +426,22 @@ static pte_t *pt_mapping_find_internal(as_t *as, uintptr_t page, bool nolock)
  */
 bool pt_mapping_find(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
 {
-	pte_t *t = pt_mapping_find_internal(as, page, nolock);
-	if (t)
-		*pte = *t;
-	return t != NULL;
+	bool large;
+	pte_t *t = pt_mapping_find_internal(as, page, nolock, &large);
+	if (!t)
+		return false;
+
+	*pte = *t;
+
+#ifdef LARGE_PAGE_WIDTH_ARCH
+	if (large) {
+		SET_PTE_LARGE(pte, 0);
+		SET_FRAME_ADDRESS(pte, 0,
+		    PTE_GET_FRAME(t) + (page & (LARGE_PAGE_SIZE - 1)));
+	}
+#endif
+
+	return true;
 }
 
 /** Update mapping for virtual page in hierarchical page tables.
@@ -354,10 +453,13 @@ bool pt_mapping_find(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
  */
 void pt_mapping_update(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
 {
-	pte_t *t = pt_mapping_find_internal(as, page, nolock);
+	bool large;
+	pte_t *t = pt_mapping_find_internal(as, page, nolock, &large);
 	if (!t)
 		panic("Updating non-existent PTE");
 
+	assert(!large);
+
 	assert(PTE_VALID(t) == PTE_VALID(pte));
 	assert(PTE_PRESENT(t) == PTE_PRESENT(pte));
 	assert(PTE_GET_FRAME(t) == PTE_GET_FRAME(pte));
@@ -367,6 +469,100 @@ void pt_mapping_update(as_t *as, uintptr_t page, bool nolock, pte_t *pte)
 	*t = *pte;
 }
 
+#ifdef LARGE_PAGE_WIDTH_ARCH
+
+/** Map a large page to a block of frames using hierarchical page tables.
+ *
+ * The large page is mapped only if no page within its range is mapped
+ * already.
+ *
+ * @param as    Address space to wich page belongs.
+ * @param page  Virtual address of the large page.
+ * @param frame Physical address of the first frame of the block.
+ * @param flags Flags to be used for mapping.
+ *
+ * @return True if the large page was mapped, false otherwise.
+ *
+ */
+bool pt_mapping_insert_large(as_t *as, uintptr_t page, uintptr_t frame,
+    unsigned int flags)
+{
+	assert(page_table_locked(as));
+	assert(IS_ALIGNED(page, LARGE_PAGE_SIZE));
+	assert(IS_ALIGNED(frame, LARGE_PAGE_SIZE));
+
+#ifdef LARGE_PTL0
+	pte_t *pt = (pte_t *) PA2KA((uintptr_t) as->genarch.page_table);
+#else
+	pte_t *pt = pt_ptl2_get(as, page);
+#endif
+
+	/* There is a PTL3 or another large page in the way. */
+	if (PTE_VALID(&pt[LARGE_INDEX(page)]))
+		return false;
+
+	SET_LARGE_ADDRESS(pt, LARGE_INDEX(page), frame);
+	SET_LARGE_FLAGS(pt, LARGE_INDEX(page), flags | PAGE_NOT_PRESENT);
+	SET_PTE_LARGE(&pt[LARGE_INDEX(page)], 1);
+	/*
+	 * Make the new mapping visible only after it is fully initialized.
+	 */
+	write_barrier();
+	SET_LARGE_PRESENT(pt, LARGE_INDEX(page));
+
+	return true;
+}
+
+/** Replace a large page mapping by a PTL3 mapping the same frames.
+ *
+ * The flags of the large page are preserved for all the pages. TLB
+ * shootdown should follow in order to replace the large page in the TLBs.
+ *
+ * @param as   Address space to wich page belongs.
+ * @param page Virtual address of the large page.
+ *
+ * @return True if a large page was demoted, false if there was none.
+ *
+ */
+bool pt_mapping_demote(as_t *as, uintptr_t page)
+{
+	bool large;
+
+	assert(page_table_locked(as));
+
+	pte_t *t = pt_mapping_find_internal(as, page, false, &large);
+	if (!t || !large)
+		return false;
+
+	uintptr_t frame = PTE_GET_FRAME(t);
+	unsigned int flags = GET_LARGE_FLAGS(t, 0);
+
+	pte_t *ptl3 = (pte_t *)
+	    PA2KA(frame_alloc(PTL3_FRAMES, FRAME_LOWMEM, PTL3_SIZE - 1));
+	memsetb(ptl3, PTL3_SIZE, 0);
+
+	for (size_t i = 0; i < PTL3_ENTRIES; i++) {
+		SET_FRAME_ADDRESS(ptl3, i, frame + FRAMES2SIZE(i));
+		SET_FRAME_FLAGS(ptl3, i, flags);
+	}
+
+	pte_t entry;
+	memsetb(&entry, sizeof(entry), 0);
+	SET_LARGE_ADDRESS(&entry, 0, KA2PA(ptl3));
+	SET_LARGE_FLAGS(&entry, 0,
+	    PAGE_USER | PAGE_EXEC | PAGE_CACHEABLE | PAGE_WRITE);
+
+	/*
+	 * Make the new PTL3 visible only after it is fully initialized.
+	 */
+	write_barrier();
+	*t = entry;
+
+	return true;
+}
+
+#endif /* LARGE_PAGE_WIDTH_ARCH */
+
 /** Return the size of the region mapped by a single PTL0 entry.
  *
  * @return Size of the region mapped by a single PTL0 entry.
@@ -98,6 +98,17 @@ _NO_TRACE static inline uint8_t fnzb64(uint64_t arg)
 	return n + fnzb32((uint32_t) arg);
 }
 
+/** Return position of first non-zero bit from right (32b variant).
+ *
+ * @return 0 (if the number is zero) or the index of the least
+ *         significant non-zero bit.
+ *
+ */
+_NO_TRACE static inline uint8_t fnzb32_right(uint32_t arg)
+{
+	return fnzb32(arg & (~arg + 1));
+}
+
 #endif
 
 /** @}
@@ -36,6 +36,8 @@
 #define KERN_CPU_H_
 
 #include <mm/tlb.h>
+#include <mm/frame.h>
+#include <mm/zero.h>
 #include <synch/spinlock.h>
 #include <proc/scheduler.h>
 #include <arch/cpu.h>
@@ -45,6 +47,13 @@
 
 #define CPU                  CURRENT->cpu
 
+/** Number of bits of a deadline resolved by one level of the timeout wheel. */
+#define TIMEOUT_WHEEL_BITS    6
+/** Number of slots on one level of the timeout wheel. */
+#define TIMEOUT_WHEEL_SLOTS   (1 << TIMEOUT_WHEEL_BITS)
+/** Number of levels of the timeout wheel. */
+#define TIMEOUT_WHEEL_LEVELS  4
+
 /** CPU structure.
  *
  * There is one structure like this for every processor.
@@ -57,12 +66,37 @@ typedef struct cpu {
 
 	context_t saved_context;
 
+	/** Cache of free frames to avoid the global zones lock. */
+	frame_cache_t frame_cache;
+
+	/** Pool of frames cleared while the processor is idle. */
+	zero_pool_t zero_pool;
+
 	atomic_t nrdy;
 	runq_t rq[RQ_COUNT];
+
+	/**
+	 * Bitmap of non-empty run queues. Bit i is set if and only if
+	 * rq[i].n is non-zero and it is only modified while holding
+	 * rq[i].lock. Reading it does not require any lock.
+	 */
+	atomic_uint rq_bitmap;
+
 	volatile size_t needs_relink;
 
 	IRQ_SPINLOCK_DECLARE(timeoutlock);
-	list_t timeout_active_list;
+
+	/** Number of clock ticks processed by the timeout wheel. */
+	uint64_t timeout_now;
+
+	/**
+	 * Hierarchical timing wheel of active timeouts. Slot j on level i
+	 * holds timeouts whose deadline is between
+	 * TIMEOUT_WHEEL_SLOTS ^ i and TIMEOUT_WHEEL_SLOTS ^ (i + 1) ticks
+	 * away and whose i-th group of TIMEOUT_WHEEL_BITS deadline bits
+	 * equals j.
+	 */
+	list_t timeout_wheel[TIMEOUT_WHEEL_LEVELS][TIMEOUT_WHEEL_SLOTS];
 
 	/**
 	 * When system clock loses a tick, it is
@@ -89,6 +123,12 @@ typedef struct cpu {
 	bool active;
 	volatile bool tlb_active;
 
+	/**
+	 * Targeted by the TLB shootdown in progress. Written with both
+	 * tlblock and lock held.
+	 */
+	volatile bool tlb_targeted;
+
 	uint16_t frequency_mhz;
 	uint32_t delay_loop_const;
 
@@ -82,6 +82,13 @@
 /** The page fault was not resolved by as_page_fault(). Non-verbose version. */
 #define AS_PF_SILENT 3
 
+/**
+ * Number of pages in the naturally aligned window around a faulting page
+ * in which the backends map additional pages in advance. Must not exceed
+ * the number of bits in the mask returned by as_fault_around().
+ */
+#define AS_FAULT_AROUND_PAGES  16
+
 /** Address space structure.
  *
  * as_t contains the list of as_areas of userspace accessible
@@ -109,11 +116,31 @@ typedef struct as {
 	 */
 	asid_t asid;
 
+	/** Protects @c cpus. */
+	SPINLOCK_DECLARE(cpus_lock);
+
+	/** Processors which may cache translations of this address space.
+	 *
+	 * Used to direct TLB shootdowns only to processors that need them.
+	 * NULL for the kernel address space, which is cached everywhere.
+	 *
+	 */
+	struct cpu_mask *cpus;
+
 	/** Number of references (i.e. tasks that reference this as). */
 	atomic_refcount_t refcount;
 
 	mutex_t lock;
 
+	/** Protects the page tables.
+	 *
+	 * Nests inside @c lock and the address space area locks, so that
+	 * page faults in different areas only serialize on the actual
+	 * page table updates.
+	 *
+	 */
+	mutex_t mapping_lock;
+
 	/** Address space areas in this address space by base address.
 	 *
 	 * Members are of type as_area_t.
@@ -330,6 +357,7 @@ extern void as_pagemap_remove(as_page_mapping_t *);
 
 extern unsigned int as_area_get_flags(as_area_t *);
 extern bool as_area_check_access(as_area_t *, pf_access_t);
+extern uint32_t as_fault_around(as_area_t *, uintptr_t, uintptr_t *);
 extern size_t as_area_get_size(uintptr_t);
 extern used_space_ival_t *used_space_first(used_space_t *);
 extern used_space_ival_t *used_space_next(used_space_ival_t *);
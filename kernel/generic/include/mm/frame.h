@@ -36,6 +36,7 @@
 #ifndef KERN_FRAME_H_
 #define KERN_FRAME_H_
 
+#include <stdint.h>
 #include <typedefs.h>
 #include <trace.h>
 #include <adt/bitmap.h>
@@ -89,9 +90,41 @@ typedef uint8_t zone_flags_t;
 	(((((zf) & ZONE_EF_MASK)) == ((f) & ZONE_EF_MASK)) && \
 	    (((zf) & ~ZONE_EF_MASK) & (f)))
 
-typedef struct {
-	size_t refcount;  /**< Tracking of shared frames */
-	void *parent;     /**< If allocated by slab, this points there */
+/** Number of block orders in the free area index of a zone. */
+#define ZONE_BUDDY_ORDERS  32
+
+/** Order of a frame which does not start a free block. */
+#define ZONE_BUDDY_NONE  UINT8_MAX
+
+/** Index terminating a free block list. */
+#define ZONE_BUDDY_NIL  UINT32_MAX
+
+/** Free block list of blocks starting in high priority memory. */
+#define ZONE_BUDDY_HIGHPRIO  0
+/** Free block list of blocks starting in low priority memory. */
+#define ZONE_BUDDY_LOWPRIO   1
+
+/** Block order the zone fragmentation index is computed for. */
+#define ZONE_FRAG_ORDER  9
+
+/** Frame structure.
+ *
+ * The reference count and the parent are only valid while the frame is
+ * allocated. While it is free (its bit in the zone bitmap is clear), the
+ * same space holds the free area index links, so that the index does not
+ * make frame_t any larger.
+ */
+typedef union {
+	struct {
+		size_t refcount;  /**< Tracking of shared frames */
+		void *parent;     /**< If allocated by slab, this points there */
+	};
+
+	/** Links of the first frame of a free block */
+	struct {
+		uint32_t prev;
+		uint32_t next;
+	} buddy;
 } frame_t;
 
 typedef struct {
@@ -115,8 +148,67 @@ typedef struct {
 
 	/** Array of frame_t structures in this zone */
 	frame_t *frames;
+
+	/**
+	 * Free area index kept alongside the bitmap. Free frames are
+	 * grouped into naturally aligned blocks of 2^order frames which
+	 * are linked into per-order lists. Each frame starting a free
+	 * block has its order recorded in buddy_order, all other frames
+	 * have ZONE_BUDDY_NONE there.
+	 */
+	uint8_t *buddy_order;
+
+	/** Heads of the free block lists indexed by priority and order */
+	uint32_t buddy_head[2][ZONE_BUDDY_ORDERS];
+
+	/** Number of free blocks of each order */
+	size_t buddy_free[ZONE_BUDDY_ORDERS];
 } zone_t;
 
+/** Number of block orders kept in the per-CPU frame caches. */
+#define FRAME_CACHE_ORDERS  4
+
+/** Maximum number of blocks of one order in a per-CPU frame cache. */
+#define FRAME_CACHE_SIZE    32
+
+/** Number of blocks moved between a frame cache and the zones at once. */
+#define FRAME_CACHE_BATCH   8
+
+/** Frame cache list holding low memory blocks. */
+#define FRAME_CACHE_LOWMEM   0
+/** Frame cache list holding blocks which need not be identity-mapped. */
+#define FRAME_CACHE_HIGHMEM  1
+
+/** List of free blocks of 2^order naturally aligned frames. */
+typedef struct {
+	/** Number of blocks in the list */
+	size_t count;
+
+	/** First frame numbers of the blocks */
+	pfn_t blocks[FRAME_CACHE_SIZE];
+} frame_cache_list_t;
+
+/** Per-CPU cache of free frames
+ *
+ * The cached frames are allocated in their zones (with reference count 1),
+ * so that they can be handed out and taken back without touching the zones.
+ * The lock is normally taken only by the owning CPU, other CPUs take it
+ * solely to drain the cache when the zones run out of memory.
+ *
+ */
+typedef struct {
+	IRQ_SPINLOCK_DECLARE(lock);
+
+	/** Lists indexed by FRAME_CACHE_LOWMEM/HIGHMEM and block order */
+	frame_cache_list_t lists[2][FRAME_CACHE_ORDERS];
+
+	/** Number of allocations satisfied from the cache */
+	uint64_t hits;
+
+	/** Number of allocations which had to refill the cache */
+	uint64_t misses;
+} frame_cache_t;
+
 /*
  * The zoneinfo.lock must be locked when accessing zoneinfo structure.
  * Some of the attributes in zone_t structures are 'read-only'
@@ -138,6 +230,9 @@ extern void frame_free_generic(uintptr_t, size_t, frame_flags_t);
 extern void frame_free(uintptr_t, size_t);
 extern void frame_free_noreserve(uintptr_t, size_t);
 extern void frame_reference_add(pfn_t);
+extern void frame_cache_initialize(frame_cache_t *);
+extern size_t frame_cache_drain_all(void);
+extern void frame_cache_stats(uint64_t *, uint64_t *, uint64_t *);
 extern size_t frame_total_free_get(void);
 
 extern size_t find_zone(pfn_t, size_t, size_t);
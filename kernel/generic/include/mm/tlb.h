@@ -44,6 +44,14 @@
  */
 #define TLB_MESSAGE_QUEUE_LEN	10
 
+/**
+ * Largest page range invalidated page by page. Larger ranges are invalidated by
+ * flushing the whole address space, which is cheaper than walking every page.
+ */
+#define TLB_INVL_PAGES_MAX	64
+
+struct as;
+
 /** Type of TLB shootdown message. */
 typedef enum {
 	/** Invalid type. */
@@ -65,14 +73,18 @@ typedef struct {
 } tlb_shootdown_msg_t;
 
 extern void tlb_init(void);
+extern void tlb_invalidate_range(asid_t, uintptr_t, size_t);
 
 #ifdef CONFIG_SMP
 extern ipl_t tlb_shootdown_start(tlb_invalidate_type_t, asid_t, uintptr_t,
     size_t);
+extern ipl_t tlb_shootdown_as_start(struct as *, tlb_invalidate_type_t,
+    uintptr_t, size_t);
 extern void tlb_shootdown_finalize(ipl_t);
 extern void tlb_shootdown_ipi_recv(void);
 #else
 #define tlb_shootdown_start(w, x, y, z)	interrupts_disable()
+#define tlb_shootdown_as_start(w, x, y, z)	interrupts_disable()
 #define tlb_shootdown_finalize(i)	(interrupts_restore(i));
 #define tlb_shootdown_ipi_recv()
 #endif /* CONFIG_SMP */
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup kernel_generic_mm
+ * @{
+ */
+/** @file
+ */
+
+#ifndef KERN_ZERO_H_
+#define KERN_ZERO_H_
+
+#include <synch/spinlock.h>
+#include <typedefs.h>
+
+/** Maximum number of pre-zeroed frames in a per-CPU zero pool. */
+#define ZERO_POOL_SIZE  64
+
+/** Period in microseconds in which kzero checks whether to refill its pool. */
+#define ZERO_POOL_INTERVAL  100000
+
+/** Per-CPU pool of pre-zeroed frames
+ *
+ * The frames are allocated and reserved on behalf of the pool. They are
+ * zeroed by the kzero thread of the owning CPU while the CPU has nothing
+ * else to run and are drained back when memory runs out.
+ *
+ */
+typedef struct {
+	IRQ_SPINLOCK_DECLARE(lock);
+
+	/** Number of frames in the pool */
+	size_t count;
+
+	/** Physical addresses of the pre-zeroed frames */
+	uintptr_t frames[ZERO_POOL_SIZE];
+
+	/** Number of zeroed frames taken from the pool */
+	uint64_t hits;
+
+	/** Number of zeroed frames which had to be cleared on demand */
+	uint64_t misses;
+} zero_pool_t;
+
+extern void zero_pool_initialize(zero_pool_t *);
+extern uintptr_t zero_frame_alloc(void);
+extern size_t zero_pool_drain_all(void);
+extern void zero_pool_stats(uint64_t *, uint64_t *, uint64_t *);
+extern void kzero(void *);
+
+#endif
+
+/** @}
+ */
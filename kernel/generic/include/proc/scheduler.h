@@ -44,6 +44,9 @@
 #define RQ_COUNT          16
 #define NEEDS_RELINK_MAX  (HZ)
 
+/** Bit representing run queue rq[i] in cpu_t::rq_bitmap. */
+#define RQ_BIT(i)  (1U << (i))
+
 /** Scheduler run queue structure. */
 typedef struct {
 	IRQ_SPINLOCK_DECLARE(lock);
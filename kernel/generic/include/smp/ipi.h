@@ -37,8 +37,12 @@
 
 #ifdef CONFIG_SMP
 
+#include <stdbool.h>
+
 extern void ipi_broadcast(int);
 extern void ipi_broadcast_arch(int);
+extern bool ipi_unicast(unsigned int, int);
+extern bool ipi_unicast_arch(unsigned int, int);
 
 #else
 
@@ -41,6 +41,7 @@
 #include <stdlib.h>
 #include <mm/page.h>
 #include <mm/frame.h>
+#include <mm/zero.h>
 #include <typedefs.h>
 #include <config.h>
 #include <panic.h>
@@ -83,6 +84,8 @@ void cpu_init(void)
 			cpus[i].id = i;
 
 			irq_spinlock_initialize(&cpus[i].lock, "cpus[].lock");
+			frame_cache_initialize(&cpus[i].frame_cache);
+			zero_pool_initialize(&cpus[i].zero_pool);
 
 			for (unsigned int j = 0; j < RQ_COUNT; j++) {
 				irq_spinlock_initialize(&cpus[i].rq[j].lock, "cpus[].rq[].lock");
@@ -432,7 +432,15 @@ _NO_TRACE static errno_t dmamem_map_anonymous(size_t size, uintptr_t constraint,
 		return EINVAL;
 
 	// FIXME: probably need to ensure that the memory is suitable for DMA
-	*phys = frame_alloc(frames, FRAME_ATOMIC, constraint);
+	*phys = 0;
+	if ((map_flags & AS_AREA_LARGE_PAGES) && (large_page_size != 0) &&
+	    (size >= large_page_size)) {
+		/* Prefer memory which can be mapped by large pages. */
+		*phys = frame_alloc(frames, FRAME_ATOMIC | FRAME_NO_RECLAIM,
+		    constraint | (large_page_size - 1));
+	}
+	if (*phys == 0)
+		*phys = frame_alloc(frames, FRAME_ATOMIC, constraint);
 	if (*phys == 0)
 		return ENOMEM;
 
@@ -58,6 +58,7 @@
 #include <mm/as.h>
 #include <mm/frame.h>
 #include <mm/km.h>
+#include <mm/zero.h>
 #include <stdio.h>
 #include <log.h>
 #include <mem.h>
@@ -151,6 +152,20 @@ void kinit(void *arg)
 	 */
 	ARCH_OP(post_smp_init);
 
+	/*
+	 * For each CPU, create the thread clearing frames for its zero pool.
+	 */
+	for (unsigned int i = 0; i < config.cpu_count; i++) {
+		thread = thread_create(kzero, NULL, TASK,
+		    THREAD_FLAG_UNCOUNTED, "kzero");
+		if (thread != NULL) {
+			thread_wire(thread, &cpus[i]);
+			thread_ready(thread);
+		} else
+			log(LF_OTHER, LVL_ERROR,
+			    "Unable to create kzero thread for cpu%u", i);
+	}
+
 	/* Start thread computing system load */
 	thread = thread_create(kload, NULL, TASK, THREAD_FLAG_NONE,
 	    "kload");
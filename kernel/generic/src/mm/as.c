@@ -53,6 +53,7 @@
 #include <mm/frame.h>
 #include <mm/slab.h>
 #include <mm/tlb.h>
+#include <cpu/cpu_mask.h>
 #include <arch/mm/page.h>
 #include <genarch/mm/page_pt.h>
 #include <genarch/mm/page_ht.h>
@@ -132,6 +133,8 @@ _NO_TRACE static errno_t as_constructor(void *obj, unsigned int flags)
 
 	link_initialize(&as->inactive_as_with_asid_link);
 	mutex_initialize(&as->lock, MUTEX_PASSIVE);
+	mutex_initialize(&as->mapping_lock, MUTEX_PASSIVE);
+	spinlock_initialize(&as->cpus_lock, "as_cpus_lock");
 
 	return as_constructor_arch(as, flags);
 }
@@ -172,6 +175,17 @@ as_t *as_create(unsigned int flags)
 	if (!as)
 		return NULL;
 
+	if (flags & FLAG_AS_KERNEL) {
+		as->cpus = NULL;
+	} else {
+		as->cpus = malloc(cpu_mask_size());
+		if (!as->cpus) {
+			slab_free(as_cache, as);
+			return NULL;
+		}
+		cpu_mask_none(as->cpus);
+	}
+
 	(void) as_create_arch(as, 0);
 
 	odict_initialize(&as->as_areas, as_areas_getkey, as_areas_cmp);
@@ -269,6 +283,7 @@ retry:
 	page_table_destroy(NULL);
 #endif
 
+	free(as->cpus);
 	slab_free(as_cache, as);
 }
 
@@ -761,11 +776,23 @@ as_area_t *as_area_create(as_t *as, unsigned int flags, size_t size,
 	mutex_lock(&as->lock);
 
 	if (*base == (uintptr_t) AS_AREA_ANY) {
-		*base = as_get_unmapped_area(as, bound, size, guarded);
+		/*
+		 * Leave room for aligning areas which can be mapped by large
+		 * pages to the large page size.
+		 */
+		size_t slack = 0;
+		if ((flags & AS_AREA_LARGE_PAGES) && (large_page_size != 0) &&
+		    (size >= large_page_size))
+			slack = large_page_size - PAGE_SIZE;
+
+		*base = as_get_unmapped_area(as, bound, size + slack, guarded);
 		if (*base == (uintptr_t) -1) {
 			mutex_unlock(&as->lock);
 			return NULL;
 		}
+
+		if (slack != 0)
+			*base = ALIGN_UP(*base, large_page_size);
 	}
 
 	if (overflows_into_positive(*base, size)) {
@@ -880,6 +907,37 @@ _NO_TRACE static as_area_t *find_area_and_lock(as_t *as, uintptr_t va)
 	return NULL;
 }
 
+/** Demote large pages mapped within a range of an address space area.
+ *
+ * The code removing mappings of an area operates on pages of PAGE_SIZE.
+ * Demotion may need to allocate a page table, so it must be done before
+ * TLB shootdown is started.
+ *
+ * The page tables must be already locked.
+ *
+ * @param area  Address space area.
+ * @param page  First page of the range.
+ * @param count Number of pages in the range.
+ *
+ */
+_NO_TRACE static void as_area_demote(as_area_t *area, uintptr_t page,
+    size_t count)
+{
+	assert(page_table_locked(area->as));
+
+	if (!(area->flags & AS_AREA_LARGE_PAGES) || (large_page_size == 0) ||
+	    (count == 0))
+		return;
+
+	uintptr_t last = ALIGN_DOWN(page + P2SZ(count) - 1, large_page_size);
+	for (uintptr_t cur = ALIGN_DOWN(page, large_page_size); ;
+	    cur += large_page_size) {
+		page_mapping_demote(area->as, cur);
+		if (cur == last)
+			break;
+	}
+}
+
 /** Find address space area and change it.
  *
  * @param as      Address space.
@@ -949,13 +1007,14 @@ errno_t as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int fl
 		 */
 
 		page_table_lock(as, false);
+		as_area_demote(area, start_free, area->pages - pages);
 
 		/*
 		 * Start TLB shootdown sequence.
 		 */
 
-		ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES,
-		    as->asid, area->base + P2SZ(pages),
+		ipl_t ipl = tlb_shootdown_as_start(as,
+		    TLB_INVL_PAGES, area->base + P2SZ(pages),
 		    area->pages - pages);
 
 		/*
@@ -1030,7 +1089,7 @@ errno_t as_area_resize(as_t *as, uintptr_t address, size_t size, unsigned int fl
 		 * Finish TLB shootdown sequence.
 		 */
 
-		tlb_invalidate_pages(as->asid,
+		tlb_invalidate_range(as->asid,
 		    area->base + P2SZ(pages),
 		    area->pages - pages);
 
@@ -1101,10 +1160,12 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 		area->backend->destroy(area);
 
 	page_table_lock(as, false);
+	as_area_demote(area, area->base, area->pages);
+
 	/*
 	 * Start TLB shootdown sequence.
 	 */
-	ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base,
+	ipl_t ipl = tlb_shootdown_as_start(as, TLB_INVL_PAGES, area->base,
 	    area->pages);
 
 	/*
@@ -1142,7 +1203,7 @@ errno_t as_area_destroy(as_t *as, uintptr_t address)
 	 * Finish TLB shootdown sequence.
 	 */
 
-	tlb_invalidate_pages(as->asid, area->base, area->pages);
+	tlb_invalidate_range(as->asid, area->base, area->pages);
 
 	/*
 	 * Invalidate potential software translation caches
@@ -1320,6 +1381,56 @@ _NO_TRACE bool as_area_check_access(as_area_t *area, pf_access_t access)
 	return true;
 }
 
+/** Find pages around a faulting page which are not mapped yet.
+ *
+ * The page fault backends use this to map several adjacent pages on one
+ * fault. The window is AS_FAULT_AROUND_PAGES long, naturally aligned and
+ * clipped to the address space area.
+ *
+ * @param area  Address space area. Must be locked.
+ * @param page  Faulting page.
+ * @param start Place to store the address of the first page of the window.
+ *
+ * @return Bit mask of the unmapped pages in the window, bit 0 standing
+ *         for @a start. The faulting page itself is never included.
+ *
+ */
+uint32_t as_fault_around(as_area_t *area, uintptr_t page, uintptr_t *start)
+{
+	assert(mutex_locked(&area->lock));
+
+	uintptr_t first = ALIGN_DOWN(page, P2SZ(AS_FAULT_AROUND_PAGES));
+	size_t count = AS_FAULT_AROUND_PAGES;
+
+	if (first < area->base) {
+		count -= (area->base - first) >> PAGE_WIDTH;
+		first = area->base;
+	}
+
+	size_t left = area->pages - ((first - area->base) >> PAGE_WIDTH);
+	count = min(count, left);
+
+	uint32_t mask = 0;
+
+	page_table_lock(area->as, false);
+	for (size_t i = 0; i < count; i++) {
+		uintptr_t cur = first + P2SZ(i);
+		if (cur == page)
+			continue;
+
+		pte_t pte;
+		bool found = page_mapping_find(area->as, cur, false, &pte);
+		if (found && PTE_VALID(&pte))
+			continue;
+
+		mask |= 1U << i;
+	}
+	page_table_unlock(area->as, false);
+
+	*start = first;
+	return mask;
+}
+
 /** Convert address space area flags to page flags.
  *
  * @param aflags Flags of some address space area.
@@ -1400,11 +1511,12 @@ errno_t as_area_change_flags(as_t *as, unsigned int flags, uintptr_t address)
 	}
 
 	page_table_lock(as, false);
+	as_area_demote(area, area->base, area->pages);
 
 	/*
 	 * Start TLB shootdown sequence.
 	 */
-	ipl_t ipl = tlb_shootdown_start(TLB_INVL_PAGES, as->asid, area->base,
+	ipl_t ipl = tlb_shootdown_as_start(as, TLB_INVL_PAGES, area->base,
 	    area->pages);
 
 	/*
@@ -1441,7 +1553,7 @@ errno_t as_area_change_flags(as_t *as, unsigned int flags, uintptr_t address)
 	 * Finish TLB shootdown sequence.
 	 */
 
-	tlb_invalidate_pages(as->asid, area->base, area->pages);
+	tlb_invalidate_range(as->asid, area->base, area->pages);
 
 	/*
 	 * Invalidate potential software translation caches
@@ -1531,13 +1643,20 @@ int as_page_fault(uintptr_t address, pf_access_t access, istate_t *istate)
 		goto page_fault;
 	}
 
+	/*
+	 * The area cannot be destroyed, resized or have its flags changed
+	 * while we hold its lock, so the address space lock is no longer
+	 * needed. Dropping it lets faults in other areas of the address
+	 * space proceed in parallel.
+	 */
+	mutex_unlock(&AS->lock);
+
 	if (area->attributes & AS_AREA_ATTR_PARTIAL) {
 		/*
 		 * The address space area is not fully initialized.
 		 * Avoid possible race by returning error.
 		 */
 		mutex_unlock(&area->lock);
-		mutex_unlock(&AS->lock);
 		goto page_fault;
 	}
 
@@ -1547,25 +1666,24 @@ int as_page_fault(uintptr_t address, pf_access_t access, istate_t *istate)
 		 * or the backend cannot handle page faults.
 		 */
 		mutex_unlock(&area->lock);
-		mutex_unlock(&AS->lock);
 		goto page_fault;
 	}
 
-	page_table_lock(AS, false);
-
 	/*
 	 * To avoid race condition between two page faults on the same address,
 	 * we need to make sure the mapping has not been already inserted.
+	 * Both faults hold the area lock, so the mapping cannot appear after
+	 * this check.
 	 */
+	page_table_lock(AS, false);
 	pte_t pte;
 	bool found = page_mapping_find(AS, page, false, &pte);
+	page_table_unlock(AS, false);
 	if (found && PTE_PRESENT(&pte)) {
 		if (((access == PF_ACCESS_READ) && PTE_READABLE(&pte)) ||
 		    (access == PF_ACCESS_WRITE && PTE_WRITABLE(&pte)) ||
 		    (access == PF_ACCESS_EXEC && PTE_EXECUTABLE(&pte))) {
-			page_table_unlock(AS, false);
 			mutex_unlock(&area->lock);
-			mutex_unlock(&AS->lock);
 			return AS_PF_OK;
 		}
 	}
@@ -1574,16 +1692,10 @@ int as_page_fault(uintptr_t address, pf_access_t access, istate_t *istate)
 	 * Resort to the backend page fault handler.
 	 */
 	rc = area->backend->page_fault(area, page, access);
-	if (rc != AS_PF_OK) {
-		page_table_unlock(AS, false);
-		mutex_unlock(&area->lock);
-		mutex_unlock(&AS->lock);
+	mutex_unlock(&area->lock);
+	if (rc != AS_PF_OK)
 		goto page_fault;
-	}
 
-	page_table_unlock(AS, false);
-	mutex_unlock(&area->lock);
-	mutex_unlock(&AS->lock);
 	return AS_PF_OK;
 
 page_fault:
@@ -1675,6 +1787,16 @@ retry:
 			new_as->asid = asid_get();
 	}
 
+	/*
+	 * From now on, TLB shootdowns in the new address space must reach
+	 * this processor.
+	 */
+	if (new_as->cpus) {
+		spinlock_lock(&new_as->cpus_lock);
+		cpu_mask_set(new_as->cpus, CPU->id);
+		spinlock_unlock(&new_as->cpus_lock);
+	}
+
 #ifdef AS_PAGE_TABLE
 	SET_PTL0_ADDRESS(new_as->genarch.page_table);
 #endif
@@ -1685,6 +1807,19 @@ retry:
 	 */
 	as_install_arch(new_as);
 
+#ifndef CONFIG_ASID
+	/*
+	 * Without ASIDs, the translations of the old address space did not
+	 * survive the switch and this processor needs no more shootdowns
+	 * for it.
+	 */
+	if ((old_as) && (old_as->cpus)) {
+		spinlock_lock(&old_as->cpus_lock);
+		cpu_mask_reset(old_as->cpus, CPU->id);
+		spinlock_unlock(&old_as->cpus_lock);
+	}
+#endif
+
 	spinlock_unlock(&asidlock);
 
 	AS = new_as;
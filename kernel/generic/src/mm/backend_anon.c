@@ -45,6 +45,7 @@
 #include <mm/frame.h>
 #include <mm/slab.h>
 #include <mm/km.h>
+#include <mm/zero.h>
 #include <synch/mutex.h>
 #include <adt/list.h>
 #include <errno.h>
@@ -170,9 +171,69 @@ bool anon_is_shareable(as_area_t *area)
 	return !(area->flags & AS_AREA_LATE_RESERVE);
 }
 
+/** Map a large page of zeroed frames in a private anonymous area.
+ *
+ * This is possible only if the whole large page containing upage lies
+ * within the area, no page of it is mapped yet and the memory of the area
+ * is reserved up front.
+ *
+ * The address space area must be already locked.
+ *
+ * @param area Pointer to the address space area.
+ * @param upage Faulting virtual page.
+ *
+ * @return True if the large page was mapped, false if the caller needs to
+ *     map a page of PAGE_SIZE.
+ */
+static bool anon_map_large(as_area_t *area, uintptr_t upage)
+{
+	if (!(area->flags & AS_AREA_LARGE_PAGES) ||
+	    (area->flags & AS_AREA_LATE_RESERVE) || (large_page_size == 0))
+		return false;
+
+	uintptr_t lpage = ALIGN_DOWN(upage, large_page_size);
+	if ((lpage < area->base) ||
+	    (lpage - area->base + large_page_size > P2SZ(area->pages)))
+		return false;
+
+	/* Do not bother allocating the frames if some page is mapped. */
+	used_space_ival_t *ival = used_space_find_gteq(&area->used_space,
+	    lpage);
+	if ((ival != NULL) && (ival->page < lpage + large_page_size))
+		return false;
+
+	size_t count = SIZE2FRAMES(large_page_size);
+	uintptr_t frame = frame_alloc(count, FRAME_LOWMEM | FRAME_ATOMIC |
+	    FRAME_NO_RECLAIM | FRAME_NO_RESERVE, large_page_size - 1);
+	if (frame == 0)
+		return false;
+
+	memsetb((void *) PA2KA(frame), large_page_size, 0);
+
+	page_table_lock(AS, false);
+	bool mapped = page_mapping_insert_large(AS, lpage, frame,
+	    as_area_get_flags(area));
+	page_table_unlock(AS, false);
+
+	if (!mapped) {
+		frame_free_noreserve(frame, count);
+		return false;
+	}
+
+	if (!used_space_insert(&area->used_space, lpage, count))
+		panic("Cannot insert used space.");
+
+	return true;
+}
+
 /** Service a page fault in the anonymous memory address space area.
  *
- * The address space area and page tables must be already locked.
+ * The address space area must be already locked.
+ *
+ * Adjacent unmapped pages are mapped as well if they are already present in
+ * the pagemap of a shared area or, for a private area whose memory has been
+ * reserved up front, if they follow the faulting page. Such private areas
+ * created with AS_AREA_LARGE_PAGES are mapped by large pages if possible.
  *
  * @param area Pointer to the address space area.
  * @param upage Faulting virtual page.
@@ -183,16 +244,19 @@ bool anon_is_shareable(as_area_t *area)
  */
 int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 {
-	uintptr_t kpage;
 	uintptr_t frame;
+	uintptr_t frames[AS_FAULT_AROUND_PAGES];
+	uintptr_t start;
+	size_t i;
 
-	assert(page_table_locked(AS));
 	assert(mutex_locked(&area->lock));
 	assert(IS_ALIGNED(upage, PAGE_SIZE));
 
 	if (!as_area_check_access(area, access))
 		return AS_PF_FAULT;
 
+	uint32_t around = as_fault_around(area, upage, &start);
+
 	mutex_lock(&area->sh_info->lock);
 	if (area->sh_info->shared) {
 		/*
@@ -206,10 +270,7 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 		    upage - area->base, &frame);
 		if (rc != EOK) {
 			/* Need to allocate the frame */
-			kpage = km_temporary_page_get(&frame,
-			    FRAME_NO_RESERVE);
-			memsetb((void *) kpage, PAGE_SIZE, 0);
-			km_temporary_page_put(kpage);
+			frame = zero_frame_alloc();
 
 			/*
 			 * Insert the address of the newly allocated
@@ -219,6 +280,24 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 			    upage - area->base, frame);
 		}
 		frame_reference_add(ADDR2PFN(frame));
+
+		/*
+		 * Map also the adjacent pages which some other sharer has
+		 * already brought in.
+		 */
+		for (i = 0; i < AS_FAULT_AROUND_PAGES; i++) {
+			if (!(around & (1U << i)))
+				continue;
+
+			rc = as_pagemap_find(&area->sh_info->pagemap,
+			    start + P2SZ(i) - area->base, &frames[i]);
+			if (rc != EOK) {
+				around &= ~(1U << i);
+				continue;
+			}
+
+			frame_reference_add(ADDR2PFN(frames[i]));
+		}
 	} else {
 
 		/*
@@ -236,6 +315,11 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 		 *   the different causes
 		 */
 
+		if (anon_map_large(area, upage)) {
+			mutex_unlock(&area->sh_info->lock);
+			return AS_PF_OK;
+		}
+
 		if (area->flags & AS_AREA_LATE_RESERVE) {
 			/*
 			 * Reserve the memory for this page now.
@@ -244,11 +328,25 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 				mutex_unlock(&area->sh_info->lock);
 				return AS_PF_SILENT;
 			}
+
+			/* Do not reserve memory the task may never touch. */
+			around = 0;
+		} else {
+			/*
+			 * The memory of the whole area is already reserved.
+			 * Populate the unmapped pages following the faulting
+			 * one, which a growing heap or buffer is about to
+			 * touch next.
+			 */
+			around &= ~((2U << ((upage - start) >> PAGE_WIDTH)) - 1);
 		}
 
-		kpage = km_temporary_page_get(&frame, FRAME_NO_RESERVE);
-		memsetb((void *) kpage, PAGE_SIZE, 0);
-		km_temporary_page_put(kpage);
+		frame = zero_frame_alloc();
+
+		for (i = 0; i < AS_FAULT_AROUND_PAGES; i++) {
+			if (around & (1U << i))
+				frames[i] = zero_frame_alloc();
+		}
 	}
 	mutex_unlock(&area->sh_info->lock);
 
@@ -257,9 +355,23 @@ int anon_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	 * Note that TLB shootdown is not attempted as only new information is
 	 * being inserted into page tables.
 	 */
+	page_table_lock(AS, false);
 	page_mapping_insert(AS, upage, frame, as_area_get_flags(area));
+	for (i = 0; i < AS_FAULT_AROUND_PAGES; i++) {
+		if (around & (1U << i)) {
+			page_mapping_insert(AS, start + P2SZ(i), frames[i],
+			    as_area_get_flags(area));
+		}
+	}
+	page_table_unlock(AS, false);
+
 	if (!used_space_insert(&area->used_space, upage, 1))
 		panic("Cannot insert used space.");
+	for (i = 0; i < AS_FAULT_AROUND_PAGES; i++) {
+		if ((around & (1U << i)) &&
+		    (!used_space_insert(&area->used_space, start + P2SZ(i), 1)))
+			panic("Cannot insert used space.");
+	}
 
 	return AS_PF_OK;
 }
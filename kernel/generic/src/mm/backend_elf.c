@@ -44,6 +44,7 @@
 #include <mm/page.h>
 #include <mm/reserve.h>
 #include <mm/km.h>
+#include <mm/zero.h>
 #include <genarch/mm/page_pt.h>
 #include <genarch/mm/page_ht.h>
 #include <align.h>
@@ -243,9 +244,114 @@ bool elf_is_shareable(as_area_t *area)
 	return true;
 }
 
+/** Find adjacent pages which can be mapped without copying or allocation.
+ *
+ * These are the pages already present in the pagemap of a shared area and
+ * the read-only pages backed directly by the ELF image.
+ *
+ * The address space area and its share info must be already locked.
+ *
+ * @param area		Address space area.
+ * @param start		First page of the fault-around window.
+ * @param around	Mask of the unmapped pages in the window.
+ * @param frames	Array to store the frames of the pages.
+ *
+ * @return		Mask of the pages which can be mapped.
+ */
+static uint32_t elf_fault_around(as_area_t *area, uintptr_t start,
+    uint32_t around, uintptr_t *frames)
+{
+	elf_header_t *elf = area->backend_data.elf;
+	elf_segment_header_t *entry = area->backend_data.segment;
+	uintptr_t start_anon = entry->p_vaddr + entry->p_filesz;
+	uintptr_t base = (uintptr_t)
+	    (((void *) elf) + ALIGN_DOWN(entry->p_offset, PAGE_SIZE));
+
+	for (size_t i = 0; i < AS_FAULT_AROUND_PAGES; i++) {
+		if (!(around & (1U << i)))
+			continue;
+
+		uintptr_t upage = start + P2SZ(i);
+		uintptr_t elfpage = elf_orig_page(area, upage);
+
+		if ((elfpage < ALIGN_DOWN(entry->p_vaddr, PAGE_SIZE)) ||
+		    (elfpage >= entry->p_vaddr + entry->p_memsz)) {
+			around &= ~(1U << i);
+			continue;
+		}
+
+		if ((area->sh_info->shared) &&
+		    (as_pagemap_find(&area->sh_info->pagemap,
+		    upage - area->base, &frames[i]) == EOK)) {
+			frame_reference_add(ADDR2PFN(frames[i]));
+			continue;
+		}
+
+		if ((entry->p_flags & PF_W) || (elfpage < entry->p_vaddr) ||
+		    (elfpage + PAGE_SIZE > start_anon)) {
+			around &= ~(1U << i);
+			continue;
+		}
+
+		size_t j = (elfpage - ALIGN_DOWN(entry->p_vaddr, PAGE_SIZE)) >>
+		    PAGE_WIDTH;
+		pte_t pte;
+		bool found = page_mapping_find(AS_KERNEL,
+		    base + j * FRAME_SIZE, true, &pte);
+
+		(void) found;
+		assert(found);
+		assert(PTE_PRESENT(&pte));
+
+		frames[i] = PTE_GET_FRAME(&pte);
+	}
+
+	return around;
+}
+
+/** Map the faulting page and the fault-around pages.
+ *
+ * The address space area must be already locked.
+ *
+ * @param area		Address space area.
+ * @param upage		Faulting virtual page.
+ * @param frame		Frame of the faulting page.
+ * @param start		First page of the fault-around window.
+ * @param around	Mask of the fault-around pages to map.
+ * @param frames	Frames of the fault-around pages.
+ */
+static void elf_map(as_area_t *area, uintptr_t upage, uintptr_t frame,
+    uintptr_t start, uint32_t around, uintptr_t *frames)
+{
+	size_t i;
+
+	/*
+	 * Note that TLB shootdown is not attempted as only new information is
+	 * being inserted into page tables.
+	 */
+	page_table_lock(AS, false);
+	page_mapping_insert(AS, upage, frame, as_area_get_flags(area));
+	for (i = 0; i < AS_FAULT_AROUND_PAGES; i++) {
+		if (around & (1U << i)) {
+			page_mapping_insert(AS, start + P2SZ(i), frames[i],
+			    as_area_get_flags(area));
+		}
+	}
+	page_table_unlock(AS, false);
+
+	if (!used_space_insert(&area->used_space, upage, 1))
+		panic("Cannot insert used space.");
+	for (i = 0; i < AS_FAULT_AROUND_PAGES; i++) {
+		if ((around & (1U << i)) &&
+		    (!used_space_insert(&area->used_space, start + P2SZ(i), 1)))
+			panic("Cannot insert used space.");
+	}
+}
+
 /** Service a page fault in the ELF backend address space area.
  *
- * The address space area and page tables must be already locked.
+ * The address space area must be already locked. Adjacent pages which are
+ * available without copying are mapped as well.
  *
  * @param area		Pointer to the address space area.
  * @param upage		Faulting virtual page.
@@ -265,9 +371,11 @@ int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	uintptr_t start_anon;
 	uintptr_t elfpage;
 	size_t i;
+	uintptr_t frames[AS_FAULT_AROUND_PAGES];
+	uintptr_t start;
+	uint32_t around;
 	bool dirty = false;
 
-	assert(page_table_locked(AS));
 	assert(mutex_locked(&area->lock));
 	assert(IS_ALIGNED(upage, PAGE_SIZE));
 
@@ -290,6 +398,8 @@ int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	/* Virtual address of the end of initialized part of segment */
 	start_anon = entry->p_vaddr + entry->p_filesz;
 
+	around = as_fault_around(area, upage, &start);
+
 	mutex_lock(&area->sh_info->lock);
 	if (area->sh_info->shared) {
 		/*
@@ -300,11 +410,9 @@ int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 		    upage - area->base, &frame);
 		if (rc == EOK) {
 			frame_reference_add(ADDR2PFN(frame));
-			page_mapping_insert(AS, upage, frame,
-			    as_area_get_flags(area));
-			if (!used_space_insert(&area->used_space, upage, 1))
-				panic("Cannot insert used space.");
+			around = elf_fault_around(area, start, around, frames);
 			mutex_unlock(&area->sh_info->lock);
+			elf_map(area, upage, frame, start, around, frames);
 			return AS_PF_OK;
 		}
 	}
@@ -351,9 +459,7 @@ int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 		 * To resolve the situation, a frame must be allocated
 		 * and cleared.
 		 */
-		kpage = km_temporary_page_get(&frame, FRAME_NO_RESERVE);
-		memsetb((void *) kpage, PAGE_SIZE, 0);
-		km_temporary_page_put(kpage);
+		frame = zero_frame_alloc();
 		dirty = true;
 	} else {
 		size_t pad_lo, pad_hi;
@@ -394,12 +500,10 @@ int elf_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 		    frame);
 	}
 
+	around = elf_fault_around(area, start, around, frames);
 	mutex_unlock(&area->sh_info->lock);
 
-	page_mapping_insert(AS, upage, frame, as_area_get_flags(area));
-	if (!used_space_insert(&area->used_space, upage, 1))
-		panic("Cannot insert used space.");
-
+	elf_map(area, upage, frame, start, around, frames);
 	return AS_PF_OK;
 }
 
@@ -118,7 +118,7 @@ bool phys_is_shareable(as_area_t *area)
 
 /** Service a page fault in the address space area backed by physical memory.
  *
- * The address space area and page tables must be already locked.
+ * The address space area must be already locked.
  *
  * @param area Pointer to the address space area.
  * @param upage Faulting virtual page.
@@ -131,7 +131,6 @@ int phys_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 {
 	uintptr_t base = area->backend_data.base;
 
-	assert(page_table_locked(AS));
 	assert(mutex_locked(&area->lock));
 	assert(IS_ALIGNED(upage, PAGE_SIZE));
 
@@ -139,8 +138,39 @@ int phys_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 		return AS_PF_FAULT;
 
 	assert(upage - area->base < area->backend_data.frames * FRAME_SIZE);
+
+	if ((area->flags & AS_AREA_LARGE_PAGES) && (large_page_size != 0)) {
+		/*
+		 * Map the whole large page containing upage if it lies within
+		 * the area and the physical memory is aligned accordingly.
+		 */
+		uintptr_t lpage = ALIGN_DOWN(upage, large_page_size);
+		uintptr_t lframe = base + (lpage - area->base);
+		size_t size = min(P2SZ(area->pages),
+		    FRAMES2SIZE(area->backend_data.frames));
+
+		if ((lpage >= area->base) &&
+		    (lpage - area->base + large_page_size <= size) &&
+		    IS_ALIGNED(lframe, large_page_size)) {
+			page_table_lock(AS, false);
+			bool mapped = page_mapping_insert_large(AS, lpage,
+			    lframe, as_area_get_flags(area));
+			page_table_unlock(AS, false);
+
+			if (mapped) {
+				if (!used_space_insert(&area->used_space, lpage,
+				    SIZE2FRAMES(large_page_size)))
+					panic("Cannot insert used space.");
+
+				return AS_PF_OK;
+			}
+		}
+	}
+
+	page_table_lock(AS, false);
 	page_mapping_insert(AS, upage, base + (upage - area->base),
 	    as_area_get_flags(area));
+	page_table_unlock(AS, false);
 
 	if (!used_space_insert(&area->used_space, upage, 1))
 		panic("Cannot insert used space.");
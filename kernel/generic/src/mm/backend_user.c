@@ -39,6 +39,7 @@
 #include <mm/as.h>
 #include <mm/page.h>
 #include <mm/frame.h>
+#include <mm/km.h>
 #include <abi/mm/as.h>
 #include <abi/ipc/methods.h>
 #include <ipc/sysipc.h>
@@ -48,6 +49,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <log.h>
+#include <mem.h>
 #include <str.h>
 
 static bool user_create(as_area_t *);
@@ -97,7 +99,7 @@ bool user_is_shareable(as_area_t *area)
 
 /** Service a page fault in the user-paged address space area.
  *
- * The address space area and page tables must be already locked.
+ * The address space area must be already locked.
  *
  * @param area Pointer to the address space area.
  * @param upage Faulting virtual page.
@@ -108,7 +110,6 @@ bool user_is_shareable(as_area_t *area)
  */
 int user_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 {
-	assert(page_table_locked(AS));
 	assert(mutex_locked(&area->lock));
 	assert(IS_ALIGNED(upage, PAGE_SIZE));
 
@@ -145,7 +146,29 @@ int user_page_fault(as_area_t *area, uintptr_t upage, pf_access_t access)
 	 */
 
 	uintptr_t frame = IPC_GET_ARG1(data);
+
+	if (area->flags & AS_AREA_WRITE) {
+		/*
+		 * The pager may keep the frame in its page cache and hand it
+		 * out to other tasks, so a writable area gets a private copy.
+		 */
+		uintptr_t copy;
+		uintptr_t kpage = km_temporary_page_get(&copy, FRAME_NONE);
+		uintptr_t src = km_map(frame, PAGE_SIZE, PAGE_SIZE,
+		    PAGE_READ | PAGE_CACHEABLE);
+		memcpy((void *) kpage, (void *) src, PAGE_SIZE);
+		km_unmap(src, PAGE_SIZE);
+		km_temporary_page_put(kpage);
+
+		page_table_lock(AS, false);
+		user_frame_free(area, upage, frame);
+		page_table_unlock(AS, false);
+		frame = copy;
+	}
+
+	page_table_lock(AS, false);
 	page_mapping_insert(AS, upage, frame, as_area_get_flags(area));
+	page_table_unlock(AS, false);
 	if (!used_space_insert(&area->used_space, upage, 1))
 		panic("Cannot insert used space.");
 
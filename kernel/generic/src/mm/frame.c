@@ -43,6 +43,7 @@
 
 #include <typedefs.h>
 #include <mm/frame.h>
+#include <mm/zero.h>
 #include <mm/reserve.h>
 #include <mm/as.h>
 #include <panic.h>
@@ -51,6 +52,7 @@
 #include <synch/mutex.h>
 #include <synch/condvar.h>
 #include <arch/asm.h>
+#include <barrier.h>
 #include <arch.h>
 #include <stdio.h>
 #include <log.h>
@@ -60,7 +62,9 @@
 #include <macros.h>
 #include <config.h>
 #include <str.h>
+#include <mem.h>
 #include <proc/thread.h> /* THREAD */
+#include <cpu.h>
 
 zones_t zones;
 
@@ -209,18 +213,359 @@ _NO_TRACE size_t find_zone(pfn_t frame, size_t count, size_t hint)
 	return (size_t) -1;
 }
 
+/** Check if frame range  priority memory
+ *
+ * @param pfn   Starting frame.
+ * @param count Number of frames.
+ *
+ * @return True if the range contains only priority memory.
+ *
+ */
+_NO_TRACE static bool is_high_priority(pfn_t base, size_t count)
+{
+	return (base + count <= FRAME_LOWPRIO);
+}
+
+/************************/
+/* Zone free area index */
+/************************/
+
+/** Return the smallest block order which can hold a number of frames. */
+_NO_TRACE static unsigned int zone_buddy_order(size_t count)
+{
+	unsigned int order = fnzb(count);
+
+	if (count > ((size_t) 1 << order))
+		order++;
+
+	return order;
+}
+
+/** Return the free block list class of a block.
+ *
+ * The block is high priority only if all of its frames are.
+ *
+ * @param zone  Zone.
+ * @param index Index of the first frame of the block.
+ * @param order Order of the block.
+ *
+ */
+_NO_TRACE static unsigned int zone_buddy_prio(zone_t *zone, size_t index,
+    unsigned int order)
+{
+	return is_high_priority(zone->base + index, (size_t) 1 << order) ?
+	    ZONE_BUDDY_HIGHPRIO : ZONE_BUDDY_LOWPRIO;
+}
+
+/** Insert a free block into the free area index.
+ *
+ * @param zone  Zone.
+ * @param index Index of the first frame of the block.
+ * @param order Order of the block.
+ *
+ */
+_NO_TRACE static void zone_buddy_push(zone_t *zone, size_t index,
+    unsigned int order)
+{
+	uint32_t *head =
+	    &zone->buddy_head[zone_buddy_prio(zone, index, order)][order];
+	frame_t *frame = &zone->frames[index];
+
+	frame->buddy.prev = ZONE_BUDDY_NIL;
+	frame->buddy.next = *head;
+
+	if (*head != ZONE_BUDDY_NIL)
+		zone->frames[*head].buddy.prev = index;
+
+	*head = index;
+	zone->buddy_order[index] = order;
+	zone->buddy_free[order]++;
+}
+
+/** Remove a free block from the free area index.
+ *
+ * @param zone  Zone.
+ * @param index Index of the first frame of the block.
+ *
+ * @return Order of the removed block.
+ *
+ */
+_NO_TRACE static unsigned int zone_buddy_remove(zone_t *zone, size_t index)
+{
+	unsigned int order = zone->buddy_order[index];
+	assert(order != ZONE_BUDDY_NONE);
+
+	frame_t *frame = &zone->frames[index];
+
+	if (frame->buddy.prev != ZONE_BUDDY_NIL)
+		zone->frames[frame->buddy.prev].buddy.next = frame->buddy.next;
+	else
+		zone->buddy_head[zone_buddy_prio(zone, index, order)][order] =
+		    frame->buddy.next;
+
+	if (frame->buddy.next != ZONE_BUDDY_NIL)
+		zone->frames[frame->buddy.next].buddy.prev = frame->buddy.prev;
+
+	zone->buddy_order[index] = ZONE_BUDDY_NONE;
+	zone->buddy_free[order]--;
+
+	return order;
+}
+
+/** Insert a range of free frames into the free area index.
+ *
+ * The range is split into the largest naturally aligned blocks.
+ * The frames around the range must not be free.
+ *
+ * @param zone  Zone.
+ * @param index Index of the first frame of the range.
+ * @param count Number of frames in the range.
+ *
+ */
+_NO_TRACE static void zone_buddy_push_range(zone_t *zone, size_t index,
+    size_t count)
+{
+	while (count > 0) {
+		pfn_t pfn = zone->base + index;
+		unsigned int order = 0;
+
+		while ((order + 1 < ZONE_BUDDY_ORDERS) &&
+		    ((pfn & (((pfn_t) 2 << order) - 1)) == 0) &&
+		    (((size_t) 2 << order) <= count))
+			order++;
+
+		zone_buddy_push(zone, index, order);
+
+		index += (size_t) 1 << order;
+		count -= (size_t) 1 << order;
+	}
+}
+
+/** Rebuild the free area index of a zone from its bitmap.
+ *
+ * @param zone Zone with a valid bitmap.
+ *
+ */
+_NO_TRACE static void zone_buddy_rebuild(zone_t *zone)
+{
+	for (unsigned int prio = 0; prio < 2; prio++) {
+		for (unsigned int order = 0; order < ZONE_BUDDY_ORDERS; order++)
+			zone->buddy_head[prio][order] = ZONE_BUDDY_NIL;
+	}
+
+	for (unsigned int order = 0; order < ZONE_BUDDY_ORDERS; order++)
+		zone->buddy_free[order] = 0;
+
+	if (zone->buddy_order == NULL)
+		return;
+
+	memsetb(zone->buddy_order, zone->count, ZONE_BUDDY_NONE);
+
+	size_t index = 0;
+	while (index < zone->count) {
+		if (bitmap_get(&zone->bitmap, index)) {
+			index++;
+			continue;
+		}
+
+		size_t run = 1;
+		while ((index + run < zone->count) &&
+		    (!bitmap_get(&zone->bitmap, index + run)))
+			run++;
+
+		zone_buddy_push_range(zone, index, run);
+		index += run;
+	}
+}
+
+/** Find a free block satisfying an allocation request.
+ *
+ * Blocks in low priority memory are preferred. If the constraint only
+ * demands alignment, the first block on the first non-empty list of a
+ * sufficient order is suitable, so the search takes O(log n) steps.
+ *
+ * @param zone       Zone.
+ * @param count      Number of frames to allocate.
+ * @param constraint Indication of bits that cannot be set in the
+ *                   physical frame number of the first allocated frame.
+ * @param index      Place to store the index of the first frame of the
+ *                   found block.
+ *
+ * @return True if a suitable block was found.
+ *
+ */
+_NO_TRACE static bool zone_buddy_find(zone_t *zone, size_t count,
+    pfn_t constraint, size_t *index)
+{
+	unsigned int order = zone_buddy_order(count);
+	if (order >= ZONE_BUDDY_ORDERS)
+		return false;
+
+	const unsigned int prios[] = { ZONE_BUDDY_LOWPRIO, ZONE_BUDDY_HIGHPRIO };
+
+	for (unsigned int i = 0; i < 2; i++) {
+		for (unsigned int k = order; k < ZONE_BUDDY_ORDERS; k++) {
+			uint32_t cur = zone->buddy_head[prios[i]][k];
+
+			while (cur != ZONE_BUDDY_NIL) {
+				if (((zone->base + cur) & constraint) == 0) {
+					*index = cur;
+					return true;
+				}
+
+				cur = zone->frames[cur].buddy.next;
+			}
+		}
+	}
+
+	return false;
+}
+
+/** Remove a single free frame from the free area index.
+ *
+ * The free block containing the frame is split and all of its parts
+ * except the frame itself are returned to the index.
+ *
+ * @param zone  Zone.
+ * @param index Index of the frame.
+ *
+ */
+_NO_TRACE static void zone_buddy_carve(zone_t *zone, size_t index)
+{
+	pfn_t pfn = zone->base + index;
+
+	for (unsigned int order = 0; order < ZONE_BUDDY_ORDERS; order++) {
+		pfn_t head = pfn & ~(((pfn_t) 1 << order) - 1);
+		if (head < zone->base)
+			break;
+
+		size_t hindex = head - zone->base;
+		if (zone->buddy_order[hindex] != order)
+			continue;
+
+		(void) zone_buddy_remove(zone, hindex);
+
+		while (order > 0) {
+			order--;
+			size_t half = (size_t) 1 << order;
+
+			if (index >= hindex + half) {
+				zone_buddy_push(zone, hindex, order);
+				hindex += half;
+			} else
+				zone_buddy_push(zone, hindex + half, order);
+		}
+
+		return;
+	}
+}
+
+/** Allocate frames using the free area index.
+ *
+ * Assume the block has been found by zone_buddy_find(). The block is split
+ * down to the requested size and the unused tail is returned to the index.
+ *
+ * @param zone  Zone.
+ * @param index Index of the first frame of the found block.
+ * @param count Number of frames to allocate.
+ *
+ */
+_NO_TRACE static void zone_buddy_alloc(zone_t *zone, size_t index,
+    size_t count)
+{
+	unsigned int order = zone_buddy_order(count);
+	unsigned int k = zone_buddy_remove(zone, index);
+
+	assert(k >= order);
+
+	while (k > order) {
+		k--;
+		zone_buddy_push(zone, index + ((size_t) 1 << k), k);
+	}
+
+	if (count < ((size_t) 1 << order))
+		zone_buddy_push_range(zone, index + count,
+		    ((size_t) 1 << order) - count);
+
+	bitmap_set_range(&zone->bitmap, index, count);
+}
+
+/** Return a single frame into the free area index.
+ *
+ * The frame is coalesced with its free buddies.
+ *
+ * @param zone  Zone.
+ * @param index Index of the frame.
+ *
+ */
+_NO_TRACE static void zone_buddy_free(zone_t *zone, size_t index)
+{
+	pfn_t pfn = zone->base + index;
+	unsigned int order = 0;
+
+	while (order + 1 < ZONE_BUDDY_ORDERS) {
+		pfn_t buddy = pfn ^ ((pfn_t) 1 << order);
+
+		if ((buddy < zone->base) ||
+		    (buddy + ((pfn_t) 1 << order) > zone->base + zone->count))
+			break;
+
+		if (zone->buddy_order[buddy - zone->base] != order)
+			break;
+
+		(void) zone_buddy_remove(zone, buddy - zone->base);
+
+		pfn = min(pfn, buddy);
+		order++;
+	}
+
+	zone_buddy_push(zone, pfn - zone->base, order);
+}
+
+/** Compute the fragmentation index of free memory.
+ *
+ * @param free Numbers of free blocks of each order.
+ *
+ * @return Percentage of free frames which are not part of a free block
+ *         of at least ZONE_FRAG_ORDER.
+ *
+ */
+_NO_TRACE static size_t zone_frag_index(const size_t *free)
+{
+	uint64_t total = 0;
+	uint64_t usable = 0;
+
+	for (unsigned int order = 0; order < ZONE_BUDDY_ORDERS; order++) {
+		total += (uint64_t) free[order] << order;
+
+		if (order >= ZONE_FRAG_ORDER)
+			usable += (uint64_t) free[order] << order;
+	}
+
+	if (total == 0)
+		return 0;
+
+	return (size_t) ((total - usable) * 100 / total);
+}
+
 /** @return True if zone can allocate specified number of frames */
 _NO_TRACE static bool zone_can_alloc(zone_t *zone, size_t count,
     pfn_t constraint)
 {
+	if (!(zone->flags & ZONE_AVAILABLE))
+		return false;
+
+	size_t index;
+	if (zone_buddy_find(zone, count, constraint, &index))
+		return true;
+
 	/*
 	 * The function bitmap_allocate_range() does not modify
 	 * the bitmap if the last argument is NULL.
 	 */
 
-	return ((zone->flags & ZONE_AVAILABLE) &&
-	    bitmap_allocate_range(&zone->bitmap, count, zone->base,
-	    FRAME_LOWPRIO, constraint, NULL));
+	return bitmap_allocate_range(&zone->bitmap, count, zone->base,
+	    FRAME_LOWPRIO, constraint, NULL);
 }
 
 /** Find a zone that can allocate specified number of frames
@@ -256,19 +601,6 @@ _NO_TRACE static size_t find_free_zone_all(size_t count, zone_flags_t flags,
 	return (size_t) -1;
 }
 
-/** Check if frame range  priority memory
- *
- * @param pfn   Starting frame.
- * @param count Number of frames.
- *
- * @return True if the range contains only priority memory.
- *
- */
-_NO_TRACE static bool is_high_priority(pfn_t base, size_t count)
-{
-	return (base + count <= FRAME_LOWPRIO);
-}
-
 /** Find a zone that can allocate specified number of frames
  *
  * This function ignores zones that contain only high-priority
@@ -372,18 +704,30 @@ _NO_TRACE static size_t zone_frame_alloc(zone_t *zone, size_t count,
 
 	/* Allocate frames from zone */
 	size_t index = (size_t) -1;
-	int avail = bitmap_allocate_range(&zone->bitmap, count, zone->base,
-	    FRAME_LOWPRIO, constraint, &index);
+	if (zone_buddy_find(zone, count, constraint, &index)) {
+		zone_buddy_alloc(zone, index, count);
+	} else {
+		/*
+		 * No block of sufficient order is available, but the
+		 * frames may still be found unaligned in the bitmap.
+		 */
+		int avail = bitmap_allocate_range(&zone->bitmap, count,
+		    zone->base, FRAME_LOWPRIO, constraint, &index);
+
+		(void) avail;
+		assert(avail);
+
+		for (size_t i = 0; i < count; i++)
+			zone_buddy_carve(zone, index + i);
+	}
 
-	(void) avail;
-	assert(avail);
 	assert(index != (size_t) -1);
 
 	/* Update frame reference count */
 	for (size_t i = 0; i < count; i++) {
 		frame_t *frame = zone_get_frame(zone, index + i);
 
-		assert(frame->refcount == 0);
+		/* The free area index links are no longer needed. */
 		frame->refcount = 1;
 	}
 
@@ -414,6 +758,7 @@ _NO_TRACE static size_t zone_frame_free(zone_t *zone, size_t index)
 
 	if (!--frame->refcount) {
 		bitmap_set(&zone->bitmap, index, 0);
+		zone_buddy_free(zone, index);
 
 		/* Update zone information. */
 		zone->free_count++;
@@ -430,12 +775,13 @@ _NO_TRACE static void zone_mark_unavailable(zone_t *zone, size_t index)
 {
 	assert(zone->flags & ZONE_AVAILABLE);
 
-	frame_t *frame = zone_get_frame(zone, index);
-	if (frame->refcount > 0)
+	if (bitmap_get(&zone->bitmap, index))
 		return;
 
-	frame->refcount = 1;
+	/* Unlink the frame before its reference count overwrites the links. */
 	bitmap_set_range(&zone->bitmap, index, 1);
+	zone_buddy_carve(zone, index);
+	zone_get_frame(zone, index)->refcount = 1;
 
 	zone->free_count--;
 	reserve_force_alloc(1);
@@ -474,6 +820,8 @@ _NO_TRACE static void zone_merge_internal(size_t z1, size_t z2, zone_t *old_z1,
 	bitmap_clear_range(&zones.info[z1].bitmap, 0, zones.info[z1].count);
 
 	zones.info[z1].frames = (frame_t *) confdata;
+	zones.info[z1].buddy_order = confdata + (sizeof(frame_t) *
+	    zones.info[z1].count) + bitmap_size(zones.info[z1].count);
 
 	/*
 	 * Copy frames and bits from both zones to preserve parents, etc.
@@ -491,6 +839,8 @@ _NO_TRACE static void zone_merge_internal(size_t z1, size_t z2, zone_t *old_z1,
 		zones.info[z1].frames[base_diff + i] =
 		    zones.info[z2].frames[i];
 	}
+
+	zone_buddy_rebuild(&zones.info[z1]);
 }
 
 /** Return old configuration frames into the zone.
@@ -649,9 +999,22 @@ _NO_TRACE static void zone_construct(zone_t *zone, pfn_t start, size_t count,
 
 		for (size_t i = 0; i < count; i++)
 			frame_initialize(&zone->frames[i]);
+
+		/*
+		 * Initialize the free area index (located after the
+		 * bitmap in the configuration space).
+		 */
+
+		assert(count < ZONE_BUDDY_NIL);
+
+		zone->buddy_order = confdata + (sizeof(frame_t) * count) +
+		    bitmap_size(count);
+		zone_buddy_rebuild(zone);
 	} else {
 		bitmap_initialize(&zone->bitmap, 0, NULL);
 		zone->frames = NULL;
+		zone->buddy_order = NULL;
+		zone_buddy_rebuild(zone);
 	}
 }
 
@@ -664,7 +1027,8 @@ _NO_TRACE static void zone_construct(zone_t *zone, pfn_t start, size_t count,
  */
 size_t zone_conf_size(size_t count)
 {
-	return (count * sizeof(frame_t) + bitmap_size(count));
+	return (count * sizeof(frame_t) + bitmap_size(count) +
+	    count * sizeof(uint8_t));
 }
 
 /** Allocate external configuration frames from low memory. */
@@ -829,6 +1193,321 @@ static size_t try_find_zone(size_t count, bool lowmem,
 	    frame_constraint, hint);
 }
 
+/************************/
+/* Per-CPU frame caches */
+/************************/
+
+/** Initialize per-CPU frame cache.
+ *
+ * @param cache Frame cache to be initialized.
+ *
+ */
+void frame_cache_initialize(frame_cache_t *cache)
+{
+	irq_spinlock_initialize(&cache->lock, "frame_cache.lock");
+
+	for (unsigned int type = 0; type < 2; type++) {
+		for (unsigned int order = 0; order < FRAME_CACHE_ORDERS; order++)
+			cache->lists[type][order].count = 0;
+	}
+
+	cache->hits = 0;
+	cache->misses = 0;
+}
+
+/** Return the block order of a frame count suitable for the frame caches.
+ *
+ * @param count Number of frames.
+ *
+ * @return Block order or FRAME_CACHE_ORDERS if the count cannot be
+ *         cached.
+ *
+ */
+_NO_TRACE static unsigned int frame_cache_order(size_t count)
+{
+	unsigned int order = fnzb(count);
+
+	if ((order >= FRAME_CACHE_ORDERS) || (count != ((size_t) 1 << order)))
+		return FRAME_CACHE_ORDERS;
+
+	return order;
+}
+
+/** Move blocks from a frame cache list back to the zones.
+ *
+ * Assume interrupts are disabled and the cache lock is locked.
+ *
+ * @param list  Frame cache list.
+ * @param order Block order of the list.
+ * @param count Maximum number of blocks to move.
+ *
+ * @return Number of frames returned to the zones.
+ *
+ */
+_NO_TRACE static size_t frame_cache_drain(frame_cache_list_t *list,
+    unsigned int order, size_t count)
+{
+	size_t freed = 0;
+
+	irq_spinlock_lock(&zones.lock, false);
+
+	while ((count > 0) && (list->count > 0)) {
+		pfn_t pfn = list->blocks[--list->count];
+		size_t znum = find_zone(pfn, (size_t) 1 << order, 0);
+
+		assert(znum != (size_t) -1);
+
+		for (size_t i = 0; i < ((size_t) 1 << order); i++) {
+			freed += zone_frame_free(&zones.info[znum],
+			    pfn - zones.info[znum].base + i);
+		}
+
+		count--;
+	}
+
+	irq_spinlock_unlock(&zones.lock, false);
+
+	return freed;
+}
+
+/** Refill a frame cache list from the zones.
+ *
+ * Assume interrupts are disabled and the cache lock is locked.
+ *
+ * @param list   Frame cache list.
+ * @param order  Block order of the list.
+ * @param lowmem Whether the blocks must come from low memory.
+ *
+ */
+_NO_TRACE static void frame_cache_refill(frame_cache_list_t *list,
+    unsigned int order, bool lowmem)
+{
+	size_t count = (size_t) 1 << order;
+	pfn_t constraint = count - 1;
+	size_t znum = 0;
+
+	irq_spinlock_lock(&zones.lock, false);
+
+	for (size_t i = 0; i < FRAME_CACHE_BATCH; i++) {
+		if (list->count == FRAME_CACHE_SIZE)
+			break;
+
+		znum = try_find_zone(count, lowmem, constraint, znum);
+		if (znum == (size_t) -1)
+			break;
+
+		list->blocks[list->count++] = zones.info[znum].base +
+		    zone_frame_alloc(&zones.info[znum], count, constraint);
+	}
+
+	irq_spinlock_unlock(&zones.lock, false);
+}
+
+/** Allocate frames from the frame cache of the current CPU.
+ *
+ * Only naturally aligned power-of-two blocks of up to
+ * 2^(FRAME_CACHE_ORDERS - 1) frames are cached. On a miss, the cache is
+ * refilled with a batch of blocks under a single acquisition of the zones
+ * lock.
+ *
+ * @param count      Number of frames to allocate.
+ * @param lowmem     Whether the frames must come from low memory.
+ * @param constraint Indication of bits that cannot be set in the
+ *                   physical frame number of the first allocated frame.
+ * @param pfn        Place to store the first allocated frame number.
+ *
+ * @return True if the frames were allocated from the cache.
+ *
+ */
+_NO_TRACE static bool frame_cache_alloc(size_t count, bool lowmem,
+    pfn_t constraint, pfn_t *pfn)
+{
+	unsigned int order = frame_cache_order(count);
+	if (order == FRAME_CACHE_ORDERS)
+		return false;
+
+	/* The cached blocks only guarantee their natural alignment. */
+	if ((constraint & ~((pfn_t) count - 1)) != 0)
+		return false;
+
+	ipl_t ipl = interrupts_disable();
+
+	if (CPU == NULL) {
+		interrupts_restore(ipl);
+		return false;
+	}
+
+	frame_cache_t *cache = &CPU->frame_cache;
+	frame_cache_list_t *list = &cache->lists[lowmem ?
+	    FRAME_CACHE_LOWMEM : FRAME_CACHE_HIGHMEM][order];
+
+	irq_spinlock_lock(&cache->lock, false);
+
+	if (list->count == 0) {
+		cache->misses++;
+		frame_cache_refill(list, order, lowmem);
+	} else
+		cache->hits++;
+
+	bool allocated = (list->count > 0);
+	if (allocated)
+		*pfn = list->blocks[--list->count];
+
+	irq_spinlock_unlock(&cache->lock, false);
+	interrupts_restore(ipl);
+
+	return allocated;
+}
+
+/** Free frames to the frame cache of the current CPU.
+ *
+ * The frames are cached only if they form a naturally aligned block of
+ * a cacheable order and the caller holds their only reference. The zones
+ * are not rearranged once other CPUs are running, so they can be looked
+ * up without the zones lock. If the cache list is full, a batch of blocks
+ * is returned to the zones first.
+ *
+ * @param pfn   First frame number.
+ * @param count Number of frames.
+ *
+ * @return True if the frames were put into the cache.
+ *
+ */
+_NO_TRACE static bool frame_cache_free(pfn_t pfn, size_t count)
+{
+	unsigned int order = frame_cache_order(count);
+	if (order == FRAME_CACHE_ORDERS)
+		return false;
+
+	if ((pfn & ((pfn_t) count - 1)) != 0)
+		return false;
+
+	/* Do not hide memory from threads waiting for it. */
+	if (mem_avail_req > 0)
+		return false;
+
+	ipl_t ipl = interrupts_disable();
+
+	if (CPU == NULL) {
+		interrupts_restore(ipl);
+		return false;
+	}
+
+	size_t znum = find_zone(pfn, count, 0);
+	if (znum == (size_t) -1) {
+		interrupts_restore(ipl);
+		return false;
+	}
+
+	/*
+	 * The reference counts are read without the zones lock. The caller
+	 * holds a reference to each frame, so the frames are allocated and
+	 * their refcount field is valid. A count of one is the caller's own
+	 * reference, and only a holder of a reference may add another, so
+	 * it cannot change under us. A larger count may be decremented
+	 * concurrently by another holder. Reading the old value merely sends
+	 * the frames down the locked path, and reading one means the other
+	 * holder is gone.
+	 */
+	zone_t *zone = &zones.info[znum];
+	for (size_t i = 0; i < count; i++) {
+		frame_t *frame = zone_get_frame(zone, pfn - zone->base + i);
+		if (ACCESS_ONCE(frame->refcount) != 1) {
+			interrupts_restore(ipl);
+			return false;
+		}
+	}
+
+	/* Order the other holder's last accesses before the reuse. */
+	read_barrier();
+
+	bool lowmem = ((zone->flags & ZONE_LOWMEM) != 0);
+	frame_cache_t *cache = &CPU->frame_cache;
+	frame_cache_list_t *list = &cache->lists[lowmem ?
+	    FRAME_CACHE_LOWMEM : FRAME_CACHE_HIGHMEM][order];
+
+	irq_spinlock_lock(&cache->lock, false);
+
+	if (list->count == FRAME_CACHE_SIZE)
+		(void) frame_cache_drain(list, order, FRAME_CACHE_BATCH);
+
+	list->blocks[list->count++] = pfn;
+
+	irq_spinlock_unlock(&cache->lock, false);
+	interrupts_restore(ipl);
+
+	return true;
+}
+
+/** Return all frames from all per-CPU frame caches to the zones.
+ *
+ * Used when the zones cannot satisfy an allocation.
+ *
+ * @return Number of frames returned to the zones.
+ *
+ */
+size_t frame_cache_drain_all(void)
+{
+	size_t freed = 0;
+
+	if (cpus == NULL)
+		return 0;
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		frame_cache_t *cache = &cpus[i].frame_cache;
+
+		irq_spinlock_lock(&cache->lock, true);
+
+		for (unsigned int type = 0; type < 2; type++) {
+			for (unsigned int order = 0; order < FRAME_CACHE_ORDERS;
+			    order++) {
+				freed += frame_cache_drain(
+				    &cache->lists[type][order], order,
+				    FRAME_CACHE_SIZE);
+			}
+		}
+
+		irq_spinlock_unlock(&cache->lock, true);
+	}
+
+	return freed;
+}
+
+/** Gather statistics of the per-CPU frame caches.
+ *
+ * The values are read without locking and are therefore only
+ * approximate.
+ *
+ * @param cached Place to store the number of cached frames.
+ * @param hits   Place to store the number of cache hits.
+ * @param misses Place to store the number of cache misses.
+ *
+ */
+void frame_cache_stats(uint64_t *cached, uint64_t *hits, uint64_t *misses)
+{
+	*cached = 0;
+	*hits = 0;
+	*misses = 0;
+
+	if (cpus == NULL)
+		return;
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		frame_cache_t *cache = &cpus[i].frame_cache;
+
+		for (unsigned int type = 0; type < 2; type++) {
+			for (unsigned int order = 0; order < FRAME_CACHE_ORDERS;
+			    order++) {
+				*cached += (uint64_t)
+				    cache->lists[type][order].count << order;
+			}
+		}
+
+		*hits += cache->hits;
+		*misses += cache->misses;
+	}
+}
+
 /** Allocate frames of physical memory.
  *
  * @param count      Number of continuous frames to allocate.
@@ -854,19 +1533,41 @@ uintptr_t frame_alloc_generic(size_t count, frame_flags_t flags,
 	if (!(flags & FRAME_NO_RESERVE))
 		reserve_force_alloc(count);
 
-loop:
-	irq_spinlock_lock(&zones.lock, true);
-
 	// TODO: Print diagnostic if neither is explicitly specified.
 	bool lowmem = (flags & FRAME_LOWMEM) || !(flags & FRAME_HIGHMEM);
 
+	/*
+	 * Small blocks are preferably taken from the per-CPU frame cache.
+	 */
+	pfn_t pfn;
+	if (frame_cache_alloc(count, lowmem, frame_constraint, &pfn))
+		return PFN2ADDR(pfn);
+
+loop:
+	irq_spinlock_lock(&zones.lock, true);
+
 	/*
 	 * First, find suitable frame zone.
 	 */
 	size_t znum = try_find_zone(count, lowmem, frame_constraint, hint);
 
 	/*
-	 * If no memory, reclaim some slab memory,
+	 * If no memory, return frames held in the per-CPU zero pools and
+	 * frame caches, unless the caller asked for no reclaim.
+	 */
+	if ((znum == (size_t) -1) && (!(flags & FRAME_NO_RECLAIM))) {
+		irq_spinlock_unlock(&zones.lock, true);
+		size_t freed = zero_pool_drain_all();
+		freed += frame_cache_drain_all();
+		irq_spinlock_lock(&zones.lock, true);
+
+		if (freed > 0)
+			znum = try_find_zone(count, lowmem,
+			    frame_constraint, hint);
+	}
+
+	/*
+	 * If still no memory, reclaim some slab memory,
 	 * if it does not help, reclaim all.
 	 */
 	if ((znum == (size_t) -1) && (!(flags & FRAME_NO_RECLAIM))) {
@@ -945,7 +1646,7 @@ loop:
 		goto loop;
 	}
 
-	pfn_t pfn = zone_frame_alloc(&zones.info[znum], count,
+	pfn = zone_frame_alloc(&zones.info[znum], count,
 	    frame_constraint) + zones.info[znum].base;
 
 	irq_spinlock_unlock(&zones.lock, true);
@@ -974,6 +1675,17 @@ uintptr_t frame_alloc(size_t count, frame_flags_t flags, uintptr_t constraint)
  */
 void frame_free_generic(uintptr_t start, size_t count, frame_flags_t flags)
 {
+	/*
+	 * Small blocks with a single reference are preferably kept in the
+	 * per-CPU frame cache.
+	 */
+	if (frame_cache_free(ADDR2PFN(start), count)) {
+		if (!(flags & FRAME_NO_RESERVE))
+			reserve_free(count);
+
+		return;
+	}
+
 	size_t freed = 0;
 
 	irq_spinlock_lock(&zones.lock, true);
@@ -1199,11 +1911,11 @@ void zones_stats(uint64_t *total, uint64_t *unavail, uint64_t *busy,
 void zones_print_list(void)
 {
 #ifdef __32_BITS__
-	printf("[nr] [base addr] [frames    ] [flags ] [free frames ] [busy frames ]\n");
+	printf("[nr] [base addr] [frames    ] [flags ] [free frames ] [busy frames ] [frag]\n");
 #endif
 
 #ifdef __64_BITS__
-	printf("[nr] [base address    ] [frames    ] [flags ] [free frames ] [busy frames ]\n");
+	printf("[nr] [base address    ] [frames    ] [flags ] [free frames ] [busy frames ] [frag]\n");
 #endif
 
 	/*
@@ -1220,6 +1932,7 @@ void zones_print_list(void)
 	size_t free_lowmem = 0;
 	size_t free_highmem = 0;
 	size_t free_highprio = 0;
+	size_t free_blocks[ZONE_BUDDY_ORDERS] = { 0 };
 
 	for (size_t i = 0; ; i++) {
 		irq_spinlock_lock(&zones.lock, true);
@@ -1235,6 +1948,10 @@ void zones_print_list(void)
 		zone_flags_t flags = zones.info[i].flags;
 		size_t free_count = zones.info[i].free_count;
 		size_t busy_count = zones.info[i].busy_count;
+		size_t frag = zone_frag_index(zones.info[i].buddy_free);
+
+		for (unsigned int order = 0; order < ZONE_BUDDY_ORDERS; order++)
+			free_blocks[order] += zones.info[i].buddy_free[order];
 
 		bool available = ((flags & ZONE_AVAILABLE) != 0);
 		bool lowmem = ((flags & ZONE_LOWMEM) != 0);
@@ -1287,14 +2004,23 @@ void zones_print_list(void)
 		    (flags & ZONE_HIGHMEM) ? 'H' : '-');
 
 		if (available)
-			printf("%14zu %14zu",
-			    free_count, busy_count);
+			printf("%14zu %14zu %5zu%%",
+			    free_count, busy_count, frag);
 
 		printf("\n");
 	}
 
 	printf("\n");
 
+	printf("Free blocks by order:   ");
+	for (unsigned int order = 0; order < ZONE_BUDDY_ORDERS; order++) {
+		if (free_blocks[order] > 0)
+			printf(" %u:%zu", order, free_blocks[order]);
+	}
+	printf("\n");
+	printf("Fragmentation index:     %zu%% (order %u)\n",
+	    zone_frag_index(free_blocks), ZONE_FRAG_ORDER);
+
 	uint64_t size;
 	const char *size_suffix;
 
@@ -1348,6 +2074,10 @@ void zone_print_one(size_t num)
 	size_t free_count = zones.info[znum].free_count;
 	size_t busy_count = zones.info[znum].busy_count;
 
+	size_t free_blocks[ZONE_BUDDY_ORDERS];
+	for (unsigned int order = 0; order < ZONE_BUDDY_ORDERS; order++)
+		free_blocks[order] = zones.info[znum].buddy_free[order];
+
 	bool available = ((flags & ZONE_AVAILABLE) != 0);
 	bool lowmem = ((flags & ZONE_LOWMEM) != 0);
 	bool highmem = ((flags & ZONE_HIGHMEM) != 0);
@@ -1422,6 +2152,16 @@ void zone_print_one(size_t num)
 		    false);
 		printf("Available high priority: %zu frames (%" PRIu64 " %s)\n",
 		    free_highprio, size, size_suffix);
+
+		printf("Free blocks by order:   ");
+		for (unsigned int order = 0; order < ZONE_BUDDY_ORDERS; order++) {
+			if (free_blocks[order] > 0)
+				printf(" %u:%zu", order, free_blocks[order]);
+		}
+		printf("\n");
+
+		printf("Fragmentation index:     %zu%% (order %u)\n",
+		    zone_frag_index(free_blocks), ZONE_FRAG_ORDER);
 	}
 }
 
@@ -240,15 +240,16 @@ static void km_unmap_deferred(uintptr_t page)
  *
  * @param[inout] framep	Pointer to a variable which will receive the physical
  *			address of the allocated frame.
- * @param[in] flags	Frame allocation flags. FRAME_NONE, FRAME_NO_RESERVE
- *			and FRAME_ATOMIC bits are allowed.
+ * @param[in] flags	Frame allocation flags. FRAME_NONE, FRAME_NO_RESERVE,
+ *			FRAME_ATOMIC and FRAME_NO_RECLAIM bits are allowed.
  * @return		Virtual address of the allocated frame.
  */
 uintptr_t km_temporary_page_get(uintptr_t *framep, frame_flags_t flags)
 {
 	assert(THREAD);
 	assert(framep);
-	assert(!(flags & ~(FRAME_NO_RESERVE | FRAME_ATOMIC)));
+	assert(!(flags &
+	    ~(FRAME_NO_RESERVE | FRAME_ATOMIC | FRAME_NO_RECLAIM)));
 
 	/*
 	 * Allocate a frame, preferably from high memory.
@@ -73,10 +73,17 @@
 #include <syscall/copy.h>
 #include <errno.h>
 #include <align.h>
+#include <atomic.h>
 
 /** Virtual operations for page subsystem. */
 page_mapping_operations_t *page_mapping_operations = NULL;
 
+/** Size of large pages, zero if the architecture cannot map them. */
+size_t large_page_size = 0;
+
+/** Number of large pages currently mapped in all address spaces. */
+static atomic_size_t large_mappings = 0;
+
 void page_init(void)
 {
 	page_arch_init();
@@ -189,6 +196,84 @@ void page_mapping_make_global(uintptr_t base, size_t size)
 	return page_mapping_operations->mapping_make_global(base, size);
 }
 
+/** Insert mapping of a large page to a block of frames.
+ *
+ * The mapping is not created if a page within the range of the large page
+ * is mapped already. The caller is expected to fall back to mapping pages
+ * of PAGE_SIZE in that case.
+ *
+ * @param as    Address space to which page belongs.
+ * @param page  Virtual address of the large page, aligned to
+ *              large_page_size.
+ * @param frame Physical address of the first frame of the block, aligned
+ *              to large_page_size.
+ * @param flags Flags to be used for mapping.
+ *
+ * @return True if the large page was mapped, false otherwise.
+ *
+ */
+_NO_TRACE bool page_mapping_insert_large(as_t *as, uintptr_t page,
+    uintptr_t frame, unsigned int flags)
+{
+	assert(page_table_locked(as));
+
+	assert(page_mapping_operations);
+
+	if ((large_page_size == 0) ||
+	    (!page_mapping_operations->mapping_insert_large))
+		return false;
+
+	assert(IS_ALIGNED(page, large_page_size));
+	assert(IS_ALIGNED(frame, large_page_size));
+
+	if (!page_mapping_operations->mapping_insert_large(as, page, frame,
+	    flags))
+		return false;
+
+	atomic_inc(&large_mappings);
+
+	/* Repel prefetched accesses to the old mapping. */
+	memory_barrier();
+
+	return true;
+}
+
+/** Split the large page containing page into pages of PAGE_SIZE.
+ *
+ * The pages keep mapping the same frames with the same flags, so that
+ * they can be removed or remapped one by one. Nothing is done if page is
+ * not mapped by a large page. TLB shootdown should follow in order to make
+ * effects of this call visible.
+ *
+ * @param as   Address space to which page belongs.
+ * @param page Virtual address within the large page.
+ *
+ */
+_NO_TRACE void page_mapping_demote(as_t *as, uintptr_t page)
+{
+	assert(page_table_locked(as));
+
+	assert(page_mapping_operations);
+
+	if ((large_page_size == 0) ||
+	    (!page_mapping_operations->mapping_demote))
+		return;
+
+	if (page_mapping_operations->mapping_demote(as,
+	    ALIGN_DOWN(page, large_page_size)))
+		atomic_dec(&large_mappings);
+}
+
+/** Get the number of large pages mapped in all address spaces.
+ *
+ * @return Number of large page mappings.
+ *
+ */
+size_t page_large_mappings(void)
+{
+	return atomic_load(&large_mappings);
+}
+
 errno_t page_find_mapping(uintptr_t virt, uintptr_t *phys)
 {
 	page_table_lock(AS, true);
@@ -39,6 +39,7 @@
 #include <mm/reserve.h>
 #include <mm/frame.h>
 #include <mm/slab.h>
+#include <mm/zero.h>
 #include <synch/spinlock.h>
 #include <typedefs.h>
 #include <arch/types.h>
@@ -79,12 +80,14 @@ bool reserve_try_alloc(size_t size)
 		reserved = true;
 	} else {
 		/*
-		 * Some reservable frames may be cached by the slab allocator.
-		 * Try to reclaim some reservable memory. Try to be gentle for
-		 * the first time. If it does not help, try to reclaim
-		 * everything.
+		 * Some reservable frames may be held by the zero pools or
+		 * cached by the slab allocator. Return the pre-zeroed frames
+		 * first, then try to reclaim some reservable memory. Try to be
+		 * gentle for the first time. If it does not help, try to
+		 * reclaim everything.
 		 */
 		irq_spinlock_unlock(&reserve_lock, true);
+		zero_pool_drain_all();
 		slab_reclaim(0);
 		irq_spinlock_lock(&reserve_lock, true);
 		if (reserve >= 0 && (size_t) reserve >= size) {
@@ -105,6 +108,30 @@ bool reserve_try_alloc(size_t size)
 	return reserved;
 }
 
+/** Try to reserve memory without reclaiming any.
+ *
+ * Used by opportunistic allocations, which should rather give up than make
+ * the system reclaim memory on their behalf.
+ *
+ * @param size		Number of frames to reserve.
+ * @return		True on success or false otherwise.
+ */
+bool reserve_try_alloc_noreclaim(size_t size)
+{
+	bool reserved = false;
+
+	assert(reserve_initialized);
+
+	irq_spinlock_lock(&reserve_lock, true);
+	if (reserve >= 0 && (size_t) reserve >= size) {
+		reserve -= size;
+		reserved = true;
+	}
+	irq_spinlock_unlock(&reserve_lock, true);
+
+	return reserved;
+}
+
 /** Reserve memory.
  *
  * This function simply marks the respective amount of memory frames reserved.
@@ -35,8 +35,9 @@
  * @brief Generic TLB shootdown algorithm.
  *
  * The algorithm implemented here is based on the CMU TLB shootdown
- * algorithm and is further simplified (e.g. all CPUs receive all TLB
- * shootdown messages).
+ * algorithm. Shootdowns in a user address space are sent only to the
+ * processors recorded in the address space CPU mask; the remaining
+ * shootdowns are sent to all processors.
  */
 
 #include <mm/tlb.h>
@@ -46,17 +47,40 @@
 #include <smp/ipi.h>
 #include <synch/spinlock.h>
 #include <atomic.h>
+#include <barrier.h>
 #include <arch/interrupt.h>
 #include <config.h>
 #include <arch.h>
 #include <panic.h>
 #include <cpu.h>
+#include <cpu/cpu_mask.h>
+#include <mm/as.h>
+#include <mm/page.h>
+#include <macros.h>
 
 void tlb_init(void)
 {
 	tlb_arch_init();
 }
 
+/** Invalidate TLB entries for a page range on the current processor.
+ *
+ * Ranges longer than TLB_INVL_PAGES_MAX pages of a user address space are
+ * invalidated by flushing the whole address space.
+ *
+ * @param asid  Address space identifier.
+ * @param page  Address of the first page.
+ * @param count Number of pages.
+ *
+ */
+void tlb_invalidate_range(asid_t asid, uintptr_t page, size_t count)
+{
+	if ((count > TLB_INVL_PAGES_MAX) && (asid != ASID_KERNEL))
+		tlb_invalidate_asid(asid);
+	else
+		tlb_invalidate_pages(asid, page, count);
+}
+
 #ifdef CONFIG_SMP
 
 /**
@@ -67,11 +91,130 @@ void tlb_init(void)
  */
 IRQ_SPINLOCK_STATIC_INITIALIZE(tlblock);
 
-/** Send TLB shootdown message.
+/** Message of the shootdown in progress. Protected by tlblock. */
+static tlb_shootdown_msg_t tlb_msg;
+
+/**
+ * Address space of the shootdown in progress or NULL if the shootdown
+ * targets all processors. Protected by tlblock.
+ */
+static as_t *tlb_as;
+
+/** Merge a TLB shootdown message into a queued one.
  *
- * This function attempts to deliver TLB shootdown message
- * to all other processors.
+ * @param dst Queued message.
+ * @param msg New message.
+ *
+ * @return True if @a dst now covers @a msg as well.
+ *
+ */
+static bool tlb_shootdown_merge(tlb_shootdown_msg_t *dst,
+    const tlb_shootdown_msg_t *msg)
+{
+	if (dst->type == TLB_INVL_ALL)
+		return true;
+
+	if (msg->type == TLB_INVL_ALL) {
+		*dst = *msg;
+		return true;
+	}
+
+	if (dst->asid != msg->asid)
+		return false;
+
+	if (dst->type == TLB_INVL_ASID)
+		return true;
+
+	if (msg->type == TLB_INVL_ASID) {
+		*dst = *msg;
+		return true;
+	}
+
+	/* Both messages invalidate pages of the same address space. */
+	uintptr_t dst_end = dst->page + P2SZ(dst->count);
+	uintptr_t msg_end = msg->page + P2SZ(msg->count);
+
+	if ((msg->page > dst_end) || (dst->page > msg_end))
+		return false;
+
+	dst->page = min(dst->page, msg->page);
+	dst->count = (max(dst_end, msg_end) - dst->page) >> PAGE_WIDTH;
+	return true;
+}
+
+/** Enqueue TLB shootdown message to a processor and mark it as a target.
  *
+ * @param cpu Processor to receive the message.
+ * @param msg Message to enqueue.
+ *
+ */
+static void tlb_shootdown_enqueue(cpu_t *cpu, const tlb_shootdown_msg_t *msg)
+{
+	irq_spinlock_lock(&cpu->lock, false);
+
+	size_t count = cpu->tlb_messages_count;
+	if ((count > 0) &&
+	    (tlb_shootdown_merge(&cpu->tlb_messages[count - 1], msg))) {
+		/*
+		 * The last queued message already covers the new one.
+		 */
+	} else if (count == TLB_MESSAGE_QUEUE_LEN) {
+		/*
+		 * The message queue is full.
+		 * Erase the queue and store one TLB_INVL_ALL message.
+		 */
+		cpu->tlb_messages_count = 1;
+		cpu->tlb_messages[0].type = TLB_INVL_ALL;
+		cpu->tlb_messages[0].asid = ASID_INVALID;
+		cpu->tlb_messages[0].page = 0;
+		cpu->tlb_messages[0].count = 0;
+	} else {
+		/*
+		 * Enqueue the message.
+		 */
+		cpu->tlb_messages[cpu->tlb_messages_count++] = *msg;
+	}
+
+	/*
+	 * The processor must see the message and the mark together,
+	 * otherwise it could drain the message without stalling.
+	 */
+	cpu->tlb_targeted = true;
+
+	irq_spinlock_unlock(&cpu->lock, false);
+}
+
+/** Interrupt the target processors and wait until they stall.
+ *
+ * The IPI is sent to each target processor. If the architecture cannot
+ * address single processors, it is broadcast instead and the processors
+ * which are not targeted only process messages left over from past
+ * shootdowns.
+ *
+ * @param targets Processors to interrupt.
+ *
+ */
+static void tlb_shootdown_notify(cpu_mask_t *targets)
+{
+	memory_barrier();
+
+	cpu_mask_for_each(*targets, i) {
+		if (!ipi_unicast(i, VECTOR_TLB_SHOOTDOWN_IPI)) {
+			tlb_shootdown_ipi_send();
+			break;
+		}
+	}
+
+	cpu_mask_for_each(*targets, i) {
+		while (cpus[i].tlb_active)
+			;
+	}
+}
+
+/** Start TLB shootdown sequence.
+ *
+ * @param as    Address space whose processors are targeted or NULL to
+ *              target all processors.
  * @param type  Type describing scope of shootdown.
  * @param asid  Address space, if required by type.
  * @param page  Virtual page address, if required by type.
@@ -80,62 +223,132 @@ IRQ_SPINLOCK_STATIC_INITIALIZE(tlblock);
  * @return The interrupt priority level as it existed prior to this call.
  *
  */
-ipl_t tlb_shootdown_start(tlb_invalidate_type_t type, asid_t asid,
-    uintptr_t page, size_t count)
+static ipl_t tlb_shootdown_begin(as_t *as, tlb_invalidate_type_t type,
+    asid_t asid, uintptr_t page, size_t count)
 {
 	ipl_t ipl = interrupts_disable();
 	CPU->tlb_active = false;
 	irq_spinlock_lock(&tlblock, false);
 
-	size_t i;
-	for (i = 0; i < config.cpu_count; i++) {
+	if ((type == TLB_INVL_PAGES) && (count > TLB_INVL_PAGES_MAX) &&
+	    (asid != ASID_KERNEL))
+		type = TLB_INVL_ASID;
+
+	tlb_msg.type = type;
+	tlb_msg.asid = asid;
+	tlb_msg.page = page;
+	tlb_msg.count = count;
+	tlb_as = as;
+
+	DEFINE_CPU_MASK(targets);
+	cpu_mask_none(targets);
+
+	if (as)
+		spinlock_lock(&as->cpus_lock);
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
 		if (i == CPU->id)
 			continue;
 
-		cpu_t *cpu = &cpus[i];
-
-		irq_spinlock_lock(&cpu->lock, false);
-		if (cpu->tlb_messages_count == TLB_MESSAGE_QUEUE_LEN) {
-			/*
-			 * The message queue is full.
-			 * Erase the queue and store one TLB_INVL_ALL message.
-			 */
-			cpu->tlb_messages_count = 1;
-			cpu->tlb_messages[0].type = TLB_INVL_ALL;
-			cpu->tlb_messages[0].asid = ASID_INVALID;
-			cpu->tlb_messages[0].page = 0;
-			cpu->tlb_messages[0].count = 0;
-		} else {
-			/*
-			 * Enqueue the message.
-			 */
-			size_t idx = cpu->tlb_messages_count++;
-			cpu->tlb_messages[idx].type = type;
-			cpu->tlb_messages[idx].asid = asid;
-			cpu->tlb_messages[idx].page = page;
-			cpu->tlb_messages[idx].count = count;
-		}
-		irq_spinlock_unlock(&cpu->lock, false);
+		if ((as) && (!cpu_mask_is_set(as->cpus, i)))
+			continue;
+
+		tlb_shootdown_enqueue(&cpus[i], &tlb_msg);
+		cpu_mask_set(targets, i);
 	}
 
-	tlb_shootdown_ipi_send();
+	if (as)
+		spinlock_unlock(&as->cpus_lock);
 
-busy_wait:
-	for (i = 0; i < config.cpu_count; i++) {
-		if (cpus[i].tlb_active)
-			goto busy_wait;
-	}
+	if (!cpu_mask_is_none(targets))
+		tlb_shootdown_notify(targets);
 
 	return ipl;
 }
 
+/** Send TLB shootdown message.
+ *
+ * This function attempts to deliver TLB shootdown message
+ * to all other processors.
+ *
+ * @param type  Type describing scope of shootdown.
+ * @param asid  Address space, if required by type.
+ * @param page  Virtual page address, if required by type.
+ * @param count Number of pages, if required by type.
+ *
+ * @return The interrupt priority level as it existed prior to this call.
+ *
+ */
+ipl_t tlb_shootdown_start(tlb_invalidate_type_t type, asid_t asid,
+    uintptr_t page, size_t count)
+{
+	return tlb_shootdown_begin(NULL, type, asid, page, count);
+}
+
+/** Send TLB shootdown message for an address space.
+ *
+ * This function delivers TLB shootdown message only to the
+ * processors which may cache translations of the address space.
+ *
+ * @param as    Address space.
+ * @param type  Type describing scope of shootdown.
+ * @param page  Virtual page address, if required by type.
+ * @param count Number of pages, if required by type.
+ *
+ * @return The interrupt priority level as it existed prior to this call.
+ *
+ */
+ipl_t tlb_shootdown_as_start(as_t *as, tlb_invalidate_type_t type,
+    uintptr_t page, size_t count)
+{
+	/* The kernel address space is not tracked. */
+	return tlb_shootdown_begin(as->cpus ? as : NULL, type, as->asid, page,
+	    count);
+}
+
 /** Finish TLB shootdown sequence.
+ *
+ * Processors which switched to the address space while the shootdown was
+ * in progress may have cached the old translations as well. They receive
+ * the message now, before the lock is released.
  *
  * @param ipl Previous interrupt priority level.
  *
  */
 void tlb_shootdown_finalize(ipl_t ipl)
 {
+	if (tlb_as) {
+		DEFINE_CPU_MASK(joined);
+		cpu_mask_none(joined);
+
+		spinlock_lock(&tlb_as->cpus_lock);
+		for (size_t i = 0; i < config.cpu_count; i++) {
+			if ((i == CPU->id) || (cpus[i].tlb_targeted))
+				continue;
+
+			if (!cpu_mask_is_set(tlb_as->cpus, i))
+				continue;
+
+			tlb_shootdown_enqueue(&cpus[i], &tlb_msg);
+			cpu_mask_set(joined, i);
+		}
+		spinlock_unlock(&tlb_as->cpus_lock);
+
+		if (!cpu_mask_is_none(joined))
+			tlb_shootdown_notify(joined);
+
+		tlb_as = NULL;
+	}
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		if (!cpus[i].tlb_targeted)
+			continue;
+
+		irq_spinlock_lock(&cpus[i].lock, false);
+		cpus[i].tlb_targeted = false;
+		irq_spinlock_unlock(&cpus[i].lock, false);
+	}
+
 	irq_spinlock_unlock(&tlblock, false);
 	CPU->tlb_active = true;
 	interrupts_restore(ipl);
@@ -153,11 +366,26 @@ void tlb_shootdown_ipi_recv(void)
 {
 	assert(CPU);
 
-	CPU->tlb_active = false;
-	irq_spinlock_lock(&tlblock, false);
-	irq_spinlock_unlock(&tlblock, false);
-
 	irq_spinlock_lock(&CPU->lock, false);
+
+	/*
+	 * While this processor is targeted, some of the queued messages
+	 * may belong to a shootdown whose sender has not updated the page
+	 * tables yet. Stall until the sender finishes. Another sender may
+	 * target this processor in the meantime, so check again. Once the
+	 * processor is not targeted, all queued messages belong to finished
+	 * shootdowns and can be processed.
+	 */
+	while (CPU->tlb_targeted) {
+		irq_spinlock_unlock(&CPU->lock, false);
+
+		CPU->tlb_active = false;
+		irq_spinlock_lock(&tlblock, false);
+		irq_spinlock_unlock(&tlblock, false);
+
+		irq_spinlock_lock(&CPU->lock, false);
+	}
+
 	assert(CPU->tlb_messages_count <= TLB_MESSAGE_QUEUE_LEN);
 
 	size_t i;
@@ -176,7 +404,7 @@ void tlb_shootdown_ipi_recv(void)
 			break;
 		case TLB_INVL_PAGES:
 			assert(count);
-			tlb_invalidate_pages(asid, page, count);
+			tlb_invalidate_range(asid, page, count);
 			break;
 		default:
 			panic("Unknown type (%d).", type);
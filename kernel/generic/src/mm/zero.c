@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup kernel_generic_mm
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Pools of pre-zeroed frames.
+ *
+ * Anonymous memory must be cleared before it is handed to userspace. Each
+ * CPU keeps a small pool of frames that its kzero thread clears while the
+ * CPU has no other thread ready to run, so that the first touch of a page
+ * does not have to pay for the clearing. When the pool is empty, the frame
+ * is cleared on demand as before.
+ */
+
+#include <mm/zero.h>
+#include <mm/frame.h>
+#include <mm/km.h>
+#include <mm/reserve.h>
+#include <arch/mm/page.h>
+#include <proc/thread.h>
+#include <atomic.h>
+#include <config.h>
+#include <cpu.h>
+#include <mem.h>
+
+/** Initialize a zero pool.
+ *
+ * @param pool Zero pool to initialize.
+ *
+ */
+void zero_pool_initialize(zero_pool_t *pool)
+{
+	irq_spinlock_initialize(&pool->lock, "zero_pool.lock");
+	pool->count = 0;
+	pool->hits = 0;
+	pool->misses = 0;
+}
+
+/** Allocate a zeroed frame.
+ *
+ * The caller must have already reserved the memory, as with
+ * FRAME_NO_RESERVE. The frame is preferably taken from the zero pool of
+ * the current CPU.
+ *
+ * @return Physical address of the zeroed frame.
+ *
+ */
+uintptr_t zero_frame_alloc(void)
+{
+	zero_pool_t *pool = &CPU->zero_pool;
+	uintptr_t frame = 0;
+
+	irq_spinlock_lock(&pool->lock, true);
+	if (pool->count > 0) {
+		frame = pool->frames[--pool->count];
+		pool->hits++;
+	} else {
+		pool->misses++;
+	}
+	irq_spinlock_unlock(&pool->lock, true);
+
+	if (frame != 0) {
+		/* The reservation of the caller covers the frame now. */
+		reserve_free(1);
+		return frame;
+	}
+
+	uintptr_t kpage = km_temporary_page_get(&frame, FRAME_NO_RESERVE);
+	memsetb((void *) kpage, PAGE_SIZE, 0);
+	km_temporary_page_put(kpage);
+
+	return frame;
+}
+
+/** Return the frames held in the zero pools of all CPUs.
+ *
+ * Used when the memory runs out.
+ *
+ * @return Number of frames freed.
+ *
+ */
+size_t zero_pool_drain_all(void)
+{
+	size_t freed = 0;
+
+	if (cpus == NULL)
+		return 0;
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		zero_pool_t *pool = &cpus[i].zero_pool;
+
+		while (true) {
+			uintptr_t frame = 0;
+
+			irq_spinlock_lock(&pool->lock, true);
+			if (pool->count > 0)
+				frame = pool->frames[--pool->count];
+			irq_spinlock_unlock(&pool->lock, true);
+
+			if (frame == 0)
+				break;
+
+			frame_free(frame, 1);
+			freed++;
+		}
+	}
+
+	return freed;
+}
+
+/** Gather statistics of the zero pools.
+ *
+ * The values are read without locking and are therefore only
+ * approximate.
+ *
+ * @param zeroed Place to store the number of pre-zeroed frames.
+ * @param hits   Place to store the number of pool hits.
+ * @param misses Place to store the number of pool misses.
+ *
+ */
+void zero_pool_stats(uint64_t *zeroed, uint64_t *hits, uint64_t *misses)
+{
+	*zeroed = 0;
+	*hits = 0;
+	*misses = 0;
+
+	if (cpus == NULL)
+		return;
+
+	for (size_t i = 0; i < config.cpu_count; i++) {
+		zero_pool_t *pool = &cpus[i].zero_pool;
+
+		*zeroed += pool->count;
+		*hits += pool->hits;
+		*misses += pool->misses;
+	}
+}
+
+/** Add one pre-zeroed frame to the zero pool of the current CPU.
+ *
+ * @param pool Zero pool of the current CPU.
+ *
+ * @return False if the pool is full or no memory is available.
+ *
+ */
+static bool zero_pool_refill(zero_pool_t *pool)
+{
+	if (pool->count >= ZERO_POOL_SIZE)
+		return false;
+
+	/* Do not make others reclaim memory only to fill the pool. */
+	if (!reserve_try_alloc_noreclaim(1))
+		return false;
+
+	uintptr_t frame;
+	uintptr_t kpage = km_temporary_page_get(&frame,
+	    FRAME_NO_RESERVE | FRAME_ATOMIC | FRAME_NO_RECLAIM);
+	if (frame == 0) {
+		reserve_free(1);
+		return false;
+	}
+
+	memsetb((void *) kpage, PAGE_SIZE, 0);
+	km_temporary_page_put(kpage);
+
+	irq_spinlock_lock(&pool->lock, true);
+	bool added = (pool->count < ZERO_POOL_SIZE);
+	if (added)
+		pool->frames[pool->count++] = frame;
+	irq_spinlock_unlock(&pool->lock, true);
+
+	if (!added)
+		frame_free(frame, 1);
+
+	return added;
+}
+
+/** Kernel thread keeping the zero pool of its CPU filled.
+ *
+ * The thread is wired to its CPU and clears frames only while no other
+ * thread is ready to run there.
+ *
+ * @param arg Not used.
+ *
+ */
+void kzero(void *arg)
+{
+	/*
+	 * Detach kzero as nobody will call thread_join_timeout() on it.
+	 */
+	thread_detach(THREAD);
+
+	zero_pool_t *pool = &CPU->zero_pool;
+
+	while (true) {
+		thread_usleep(ZERO_POOL_INTERVAL);
+
+		while (atomic_load(&CPU->nrdy) == 0) {
+			if (!zero_pool_refill(pool))
+				break;
+		}
+	}
+}
+
+/** @}
+ */
@@ -52,6 +52,7 @@
 #include <arch/faddr.h>
 #include <arch/cycle.h>
 #include <atomic.h>
+#include <bitops.h>
 #include <synch/spinlock.h>
 #include <config.h>
 #include <context.h>
@@ -172,12 +173,150 @@ void scheduler_init(void)
 {
 }
 
+#ifdef CONFIG_SMP
+/** Steal a ready thread from a run queue of another CPU
+ *
+ * The queue is searched from the back, so that the thread which has been
+ * waiting the shortest time and is therefore least likely to have a warm
+ * cache on its CPU is taken first. CPU-wired threads, threads already
+ * stolen, threads for which migration was temporarily disabled or threads
+ * whose FPU context is still in the CPU are never stolen.
+ *
+ * Interrupts must be disabled.
+ *
+ * @param cpu CPU to steal from.
+ * @param rq  Index of the run queue on @a cpu.
+ *
+ * @return Stolen thread removed from the run queue and with the stolen
+ *         flag set, or NULL if there was no suitable thread.
+ *
+ */
+static thread_t *steal_thread(cpu_t *cpu, int rq)
+{
+	assert(interrupts_disabled());
+
+	irq_spinlock_lock(&(cpu->rq[rq].lock), false);
+	if (cpu->rq[rq].n == 0) {
+		irq_spinlock_unlock(&(cpu->rq[rq].lock), false);
+		return NULL;
+	}
+
+	thread_t *thread = NULL;
+
+	/* Search rq from the back */
+	link_t *link = cpu->rq[rq].rq.head.prev;
+
+	while (link != &(cpu->rq[rq].rq.head)) {
+		thread = (thread_t *) list_get_instance(link,
+		    thread_t, rq_link);
+
+		irq_spinlock_lock(&thread->lock, false);
+
+		if ((!thread->wired) && (!thread->stolen) &&
+		    (!thread->nomigrate) &&
+		    (!thread->fpu_context_engaged)) {
+			/*
+			 * Remove thread from ready queue.
+			 */
+			irq_spinlock_unlock(&thread->lock, false);
+
+			atomic_dec(&cpu->nrdy);
+			atomic_dec(&nrdy);
+
+			if (--cpu->rq[rq].n == 0)
+				atomic_fetch_and(&cpu->rq_bitmap, ~RQ_BIT(rq));
+			list_remove(&thread->rq_link);
+
+			break;
+		}
+
+		irq_spinlock_unlock(&thread->lock, false);
+
+		link = link->prev;
+		thread = NULL;
+	}
+
+	if (thread == NULL) {
+		irq_spinlock_unlock(&(cpu->rq[rq].lock), false);
+		return NULL;
+	}
+
+	irq_spinlock_pass(&(cpu->rq[rq].lock), &thread->lock);
+
+	thread->stolen = true;
+	thread->state = Entering;
+
+	irq_spinlock_unlock(&thread->lock, false);
+
+	return thread;
+}
+
+/** Pull work to a CPU that is about to go idle
+ *
+ * Instead of waiting for the next pass of kcpulb, find the busiest active
+ * CPU and steal one ready thread from it, starting with its lowest-priority
+ * non-empty run queue. The stolen thread is readied on the current CPU.
+ *
+ * Interrupts must be disabled.
+ *
+ * @return True if a thread was moved to the current CPU.
+ *
+ */
+static bool steal_work(void)
+{
+	assert(interrupts_disabled());
+
+	cpu_t *busiest = NULL;
+	size_t busiest_nrdy = 0;
+
+	for (size_t acpu = 0; acpu < config.cpu_active; acpu++) {
+		cpu_t *cpu = &cpus[(CPU->id + 1 + acpu) % config.cpu_active];
+
+		if (cpu == CPU)
+			continue;
+
+		size_t cpu_nrdy = atomic_load(&cpu->nrdy);
+		if (cpu_nrdy > busiest_nrdy) {
+			busiest = cpu;
+			busiest_nrdy = cpu_nrdy;
+		}
+	}
+
+	if (busiest == NULL)
+		return false;
+
+	unsigned int rq_bitmap = atomic_load(&busiest->rq_bitmap);
+	while (rq_bitmap != 0) {
+		int rq = fnzb32(rq_bitmap);
+		rq_bitmap &= ~RQ_BIT(rq);
+
+		thread_t *thread = steal_thread(busiest, rq);
+		if (thread != NULL) {
+#ifdef KCPULB_VERBOSE
+			log(LF_OTHER, LVL_DEBUG,
+			    "cpu%u: idle steal of TID %" PRIu64 " from cpu%u",
+			    CPU->id, thread->tid, busiest->id);
+#endif
+			thread_ready(thread);
+			return true;
+		}
+	}
+
+	return false;
+}
+#endif /* CONFIG_SMP */
+
 /** Get thread to be scheduled
  *
  * Get the optimal thread to be scheduled
  * according to thread accounting and scheduler
  * policy.
  *
+ * The highest-priority non-empty run queue is found directly from the
+ * per-CPU bitmap of non-empty queues. If the CPU has nothing to run, it
+ * first tries to steal a thread from the busiest other CPU before going
+ * to sleep.
+ *
  * @return Thread to be scheduled.
  *
  */
@@ -188,6 +327,11 @@ static thread_t *find_best_thread(void)
 loop:
 
 	if (atomic_load(&CPU->nrdy) == 0) {
+#ifdef CONFIG_SMP
+		if (steal_work())
+			goto loop;
+#endif
+
 		/*
 		 * For there was nothing to run, the CPU goes to sleep
 		 * until a hardware interrupt or an IPI comes.
@@ -210,45 +354,53 @@ loop:
 
 	assert(!CPU->idle);
 
-	unsigned int i;
-	for (i = 0; i < RQ_COUNT; i++) {
-		irq_spinlock_lock(&(CPU->rq[i].lock), false);
-		if (CPU->rq[i].n == 0) {
-			/*
-			 * If this queue is empty, try a lower-priority queue.
-			 */
-			irq_spinlock_unlock(&(CPU->rq[i].lock), false);
-			continue;
-		}
+	unsigned int rq_bitmap = atomic_load(&CPU->rq_bitmap);
+	if (rq_bitmap == 0) {
+		/*
+		 * The thread accounted in nrdy is not in the queue yet
+		 * or has just been stolen.
+		 */
+		goto loop;
+	}
 
-		atomic_dec(&CPU->nrdy);
-		atomic_dec(&nrdy);
-		CPU->rq[i].n--;
+	unsigned int i = fnzb32_right(rq_bitmap);
 
+	irq_spinlock_lock(&(CPU->rq[i].lock), false);
+	if (CPU->rq[i].n == 0) {
 		/*
-		 * Take the first thread from the queue.
+		 * The queue has been emptied by a stealing CPU in the
+		 * meantime.
 		 */
-		thread_t *thread = list_get_instance(
-		    list_first(&CPU->rq[i].rq), thread_t, rq_link);
-		list_remove(&thread->rq_link);
+		irq_spinlock_unlock(&(CPU->rq[i].lock), false);
+		goto loop;
+	}
 
-		irq_spinlock_pass(&(CPU->rq[i].lock), &thread->lock);
+	atomic_dec(&CPU->nrdy);
+	atomic_dec(&nrdy);
+	if (--CPU->rq[i].n == 0)
+		atomic_fetch_and(&CPU->rq_bitmap, ~RQ_BIT(i));
 
-		thread->cpu = CPU;
-		thread->ticks = us2ticks((i + 1) * 10000);
-		thread->priority = i;  /* Correct rq index */
+	/*
+	 * Take the first thread from the queue.
+	 */
+	thread_t *thread = list_get_instance(
+	    list_first(&CPU->rq[i].rq), thread_t, rq_link);
+	list_remove(&thread->rq_link);
 
-		/*
-		 * Clear the stolen flag so that it can be migrated
-		 * when load balancing needs emerge.
-		 */
-		thread->stolen = false;
-		irq_spinlock_unlock(&thread->lock, false);
+	irq_spinlock_pass(&(CPU->rq[i].lock), &thread->lock);
 
-		return thread;
-	}
+	thread->cpu = CPU;
+	thread->ticks = us2ticks((i + 1) * 10000);
+	thread->priority = i;  /* Correct rq index */
 
-	goto loop;
+	/*
+	 * Clear the stolen flag so that it can be migrated
+	 * when load balancing needs emerge.
+	 */
+	thread->stolen = false;
+	irq_spinlock_unlock(&thread->lock, false);
+
+	return thread;
 }
 
 /** Prevent rq starvation
@@ -278,6 +430,7 @@ static void relink_rq(int start)
 			list_concat(&list, &CPU->rq[i + 1].rq);
 			size_t n = CPU->rq[i + 1].n;
 			CPU->rq[i + 1].n = 0;
+			atomic_fetch_and(&CPU->rq_bitmap, ~RQ_BIT(i + 1));
 			irq_spinlock_unlock(&CPU->rq[i + 1].lock, false);
 
 			/* Append rq[i + 1] to rq[i] */
@@ -285,6 +438,8 @@ static void relink_rq(int start)
 			irq_spinlock_lock(&CPU->rq[i].lock, false);
 			list_concat(&CPU->rq[i].rq, &list);
 			CPU->rq[i].n += n;
+			if (CPU->rq[i].n > 0)
+				atomic_fetch_or(&CPU->rq_bitmap, RQ_BIT(i));
 			irq_spinlock_unlock(&CPU->rq[i].lock, false);
 		}
 
@@ -600,61 +755,18 @@ not_satisfied:
 			if (atomic_load(&cpu->nrdy) <= average)
 				continue;
 
-			irq_spinlock_lock(&(cpu->rq[rq].lock), true);
-			if (cpu->rq[rq].n == 0) {
-				irq_spinlock_unlock(&(cpu->rq[rq].lock), true);
+			if (!(atomic_load(&cpu->rq_bitmap) & RQ_BIT(rq)))
 				continue;
-			}
-
-			thread_t *thread = NULL;
-
-			/* Search rq from the back */
-			link_t *link = cpu->rq[rq].rq.head.prev;
-
-			while (link != &(cpu->rq[rq].rq.head)) {
-				thread = (thread_t *) list_get_instance(link,
-				    thread_t, rq_link);
-
-				/*
-				 * Do not steal CPU-wired threads, threads
-				 * already stolen, threads for which migration
-				 * was temporarily disabled or threads whose
-				 * FPU context is still in the CPU.
-				 */
-				irq_spinlock_lock(&thread->lock, false);
-
-				if ((!thread->wired) && (!thread->stolen) &&
-				    (!thread->nomigrate) &&
-				    (!thread->fpu_context_engaged)) {
-					/*
-					 * Remove thread from ready queue.
-					 */
-					irq_spinlock_unlock(&thread->lock,
-					    false);
 
-					atomic_dec(&cpu->nrdy);
-					atomic_dec(&nrdy);
-
-					cpu->rq[rq].n--;
-					list_remove(&thread->rq_link);
-
-					break;
-				}
-
-				irq_spinlock_unlock(&thread->lock, false);
-
-				link = link->prev;
-				thread = NULL;
-			}
+			ipl_t ipl = interrupts_disable();
+			thread_t *thread = steal_thread(cpu, rq);
+			interrupts_restore(ipl);
 
 			if (thread) {
 				/*
 				 * Ready thread on local CPU
 				 */
 
-				irq_spinlock_pass(&(cpu->rq[rq].lock),
-				    &thread->lock);
-
 #ifdef KCPULB_VERBOSE
 				log(LF_OTHER, LVL_DEBUG,
 				    "kcpulb%u: TID %" PRIu64 " -> cpu%u, "
@@ -663,10 +775,6 @@ not_satisfied:
 				    atomic_load(&nrdy) / config.cpu_active);
 #endif
 
-				thread->stolen = true;
-				thread->state = Entering;
-
-				irq_spinlock_unlock(&thread->lock, true);
 				thread_ready(thread);
 
 				if (--count == 0)
@@ -678,10 +786,7 @@ not_satisfied:
 				 *
 				 */
 				acpu_bias++;
-
-				continue;
-			} else
-				irq_spinlock_unlock(&(cpu->rq[rq].lock), true);
+			}
 
 		}
 	}
@@ -720,9 +825,10 @@ void sched_print_list(void)
 
 		irq_spinlock_lock(&cpus[cpu].lock, true);
 
-		printf("cpu%u: address=%p, nrdy=%zu, needs_relink=%zu\n",
-		    cpus[cpu].id, &cpus[cpu], atomic_load(&cpus[cpu].nrdy),
-		    cpus[cpu].needs_relink);
+		printf("cpu%u: address=%p, nrdy=%zu, needs_relink=%zu, "
+		    "rq_bitmap=%#x\n", cpus[cpu].id, &cpus[cpu],
+		    atomic_load(&cpus[cpu].nrdy), cpus[cpu].needs_relink,
+		    atomic_load(&cpus[cpu].rq_bitmap));
 
 		unsigned int i;
 		for (i = 0; i < RQ_COUNT; i++) {
@@ -38,6 +38,7 @@
 #ifdef CONFIG_SMP
 
 #include <smp/ipi.h>
+#include <assert.h>
 #include <config.h>
 
 /** Broadcast IPI message
@@ -59,6 +60,24 @@ void ipi_broadcast(int ipi)
 		ipi_broadcast_arch(ipi);
 }
 
+/** Send IPI message to one CPU
+ *
+ * Not all architectures can address a single CPU. Callers have to fall
+ * back to ipi_broadcast() if the message was not sent.
+ *
+ * @param cpu_id Logical ID of the target CPU.
+ * @param ipi    Message to send.
+ *
+ * @return True if the message was sent.
+ *
+ */
+bool ipi_unicast(unsigned int cpu_id, int ipi)
+{
+	assert(cpu_id < config.cpu_count);
+
+	return ipi_unicast_arch(cpu_id, ipi);
+}
+
 #endif /* CONFIG_SMP */
 
 /** @}
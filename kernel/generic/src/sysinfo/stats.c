@@ -43,6 +43,8 @@
 #include <synch/mutex.h>
 #include <time/clock.h>
 #include <mm/frame.h>
+#include <mm/page.h>
+#include <mm/zero.h>
 #include <proc/task.h>
 #include <proc/thread.h>
 #include <interrupt.h>
@@ -664,6 +666,20 @@ static void *get_stats_physmem(struct sysinfo_item *item, size_t *size,
 	zones_stats(&(stats_physmem->total), &(stats_physmem->unavail),
 	    &(stats_physmem->used), &(stats_physmem->free));
 
+	uint64_t cached_frames;
+	frame_cache_stats(&cached_frames, &(stats_physmem->cache_hits),
+	    &(stats_physmem->cache_misses));
+	stats_physmem->cached = FRAMES2SIZE(cached_frames);
+
+	uint64_t zeroed_frames;
+	zero_pool_stats(&zeroed_frames, &(stats_physmem->zero_hits),
+	    &(stats_physmem->zero_misses));
+	stats_physmem->zeroed = FRAMES2SIZE(zeroed_frames);
+
+	stats_physmem->large_pages = page_large_mappings();
+	stats_physmem->large_mapped = stats_physmem->large_pages *
+	    large_page_size;
+
 	return ((void *) stats_physmem);
 }
 
@@ -36,6 +36,7 @@
  */
 
 #include <time/timeout.h>
+#include <assert.h>
 #include <typedefs.h>
 #include <config.h>
 #include <panic.h>
@@ -45,6 +46,15 @@
 #include <arch/asm.h>
 #include <arch.h>
 
+/** Farthest deadline (relative to the current tick) the wheel can hold. */
+#define TIMEOUT_WHEEL_RANGE \
+	(((uint64_t) 1 << (TIMEOUT_WHEEL_BITS * TIMEOUT_WHEEL_LEVELS)) - 1)
+
+/** Index of the slot on a wheel level that covers a deadline. */
+#define TIMEOUT_WHEEL_SLOT(deadline, level) \
+	(((deadline) >> (TIMEOUT_WHEEL_BITS * (level))) & \
+	    (TIMEOUT_WHEEL_SLOTS - 1))
+
 /** Initialize timeouts
  *
  * Initialize kernel timeouts.
@@ -53,7 +63,12 @@
 void timeout_init(void)
 {
 	irq_spinlock_initialize(&CPU->timeoutlock, "cpu.timeoutlock");
-	list_initialize(&CPU->timeout_active_list);
+	CPU->timeout_now = 0;
+
+	for (unsigned int level = 0; level < TIMEOUT_WHEEL_LEVELS; level++) {
+		for (unsigned int slot = 0; slot < TIMEOUT_WHEEL_SLOTS; slot++)
+			list_initialize(&CPU->timeout_wheel[level][slot]);
+	}
 }
 
 /** Reinitialize timeout
@@ -66,7 +81,7 @@ void timeout_init(void)
 void timeout_reinitialize(timeout_t *timeout)
 {
 	timeout->cpu = NULL;
-	timeout->ticks = 0;
+	timeout->deadline = 0;
 	timeout->handler = NULL;
 	timeout->arg = NULL;
 	link_initialize(&timeout->link);
@@ -85,10 +100,47 @@ void timeout_initialize(timeout_t *timeout)
 	timeout_reinitialize(timeout);
 }
 
+/** Insert timeout into the timeout wheel
+ *
+ * The timeout is put on the lowest wheel level which can resolve the
+ * distance of its deadline from the current tick. Deadlines too far in
+ * the future are parked on the highest level to be
+ * reinserted when that slot is cascaded.
+ *
+ * @param cpu     CPU whose wheel is to be used. cpu->timeoutlock must
+ *                be held.
+ * @param timeout Timeout with a valid deadline.
+ *
+ */
+static void timeout_wheel_insert(cpu_t *cpu, timeout_t *timeout)
+{
+	assert(irq_spinlock_locked(&cpu->timeoutlock));
+
+	uint64_t now = cpu->timeout_now;
+	uint64_t deadline = timeout->deadline;
+
+	if (deadline < now)
+		deadline = now;
+
+	uint64_t delta = deadline - now;
+	if (delta > TIMEOUT_WHEEL_RANGE) {
+		delta = TIMEOUT_WHEEL_RANGE;
+		deadline = now + TIMEOUT_WHEEL_RANGE;
+	}
+
+	unsigned int level = 0;
+	while ((level < TIMEOUT_WHEEL_LEVELS - 1) &&
+	    (delta >= ((uint64_t) 1 << (TIMEOUT_WHEEL_BITS * (level + 1)))))
+		level++;
+
+	list_append(&timeout->link,
+	    &cpu->timeout_wheel[level][TIMEOUT_WHEEL_SLOT(deadline, level)]);
+}
+
 /** Register timeout
  *
  * Insert timeout handler f (with argument arg)
- * to timeout list and make it execute in
+ * to timeout wheel and make it execute in
  * time microseconds (or slightly more).
  *
  * @param timeout Timeout structure.
@@ -107,49 +159,16 @@ void timeout_register(timeout_t *timeout, uint64_t time,
 		panic("Unexpected: timeout->cpu != 0.");
 
 	timeout->cpu = CPU;
-	timeout->ticks = us2ticks(time);
-
-	timeout->handler = handler;
-	timeout->arg = arg;
 
 	/*
-	 * Insert timeout into the active timeouts list according to timeout->ticks.
+	 * A timeout of zero ticks is activated by the next clock() tick.
 	 */
-	uint64_t sum = 0;
-	timeout_t *target = NULL;
-	link_t *cur;
-	for (cur = CPU->timeout_active_list.head.next;
-	    cur != &CPU->timeout_active_list.head; cur = cur->next) {
-		target = list_get_instance(cur, timeout_t, link);
-		irq_spinlock_lock(&target->lock, false);
-
-		if (timeout->ticks < sum + target->ticks) {
-			irq_spinlock_unlock(&target->lock, false);
-			break;
-		}
+	timeout->deadline = CPU->timeout_now + us2ticks(time) + 1;
 
-		sum += target->ticks;
-		irq_spinlock_unlock(&target->lock, false);
-	}
-
-	/* Avoid using cur->prev directly */
-	link_t *prev = cur->prev;
-	list_insert_after(&timeout->link, prev);
-
-	/*
-	 * Adjust timeout->ticks according to ticks
-	 * accumulated in target's predecessors.
-	 */
-	timeout->ticks -= sum;
+	timeout->handler = handler;
+	timeout->arg = arg;
 
-	/*
-	 * Decrease ticks of timeout's immediate succesor by timeout->ticks.
-	 */
-	if (cur != &CPU->timeout_active_list.head) {
-		irq_spinlock_lock(&target->lock, false);
-		target->ticks -= timeout->ticks;
-		irq_spinlock_unlock(&target->lock, false);
-	}
+	timeout_wheel_insert(CPU, timeout);
 
 	irq_spinlock_unlock(&timeout->lock, false);
 	irq_spinlock_unlock(&CPU->timeoutlock, true);
@@ -157,7 +176,7 @@ void timeout_register(timeout_t *timeout, uint64_t time,
 
 /** Unregister timeout
  *
- * Remove timeout from timeout list.
+ * Remove timeout from timeout wheel.
  *
  * @param timeout Timeout to unregister.
  *
@@ -183,17 +202,9 @@ grab_locks:
 
 	/*
 	 * Now we know for sure that timeout hasn't been activated yet
-	 * and is lurking in timeout->cpu->timeout_active_list.
+	 * and is lurking in a slot of timeout->cpu->timeout_wheel.
 	 */
 
-	link_t *cur = timeout->link.next;
-	if (cur != &timeout->cpu->timeout_active_list.head) {
-		timeout_t *tmp = list_get_instance(cur, timeout_t, link);
-		irq_spinlock_lock(&tmp->lock, false);
-		tmp->ticks += timeout->ticks;
-		irq_spinlock_unlock(&tmp->lock, false);
-	}
-
 	list_remove(&timeout->link);
 	irq_spinlock_unlock(&timeout->cpu->timeoutlock, false);
 
@@ -203,5 +214,68 @@ grab_locks:
 	return true;
 }
 
+/** Advance the timeout wheel by one tick
+ *
+ * Called from clock() with interrupts disabled for every clock tick
+ * (including the missed ones). First, the slots of the higher wheel levels
+ * whose period has just started are cascaded into the lower levels. Then,
+ * all timeouts in the current slot of the lowest level are expired, without
+ * the need to look at any other pending timeout.
+ *
+ * To avoid lock ordering problems, the handlers of the expired timeouts
+ * are executed as they are visited, without holding CPU->timeoutlock.
+ *
+ */
+void timeout_tick(void)
+{
+	assert(interrupts_disabled());
+
+	irq_spinlock_lock(&CPU->timeoutlock, false);
+
+	uint64_t now = ++CPU->timeout_now;
+
+	unsigned int top = 0;
+	while ((top < TIMEOUT_WHEEL_LEVELS - 1) &&
+	    ((now & (((uint64_t) 1 << (TIMEOUT_WHEEL_BITS * (top + 1))) - 1)) == 0))
+		top++;
+
+	for (unsigned int level = top; level > 0; level--) {
+		list_t cascade;
+		list_initialize(&cascade);
+		list_concat(&cascade,
+		    &CPU->timeout_wheel[level][TIMEOUT_WHEEL_SLOT(now, level)]);
+
+		link_t *cur;
+		while ((cur = list_first(&cascade)) != NULL) {
+			list_remove(cur);
+			timeout_wheel_insert(CPU,
+			    list_get_instance(cur, timeout_t, link));
+		}
+	}
+
+	list_t *expired = &CPU->timeout_wheel[0][TIMEOUT_WHEEL_SLOT(now, 0)];
+
+	link_t *cur;
+	while ((cur = list_first(expired)) != NULL) {
+		timeout_t *timeout = list_get_instance(cur, timeout_t, link);
+
+		irq_spinlock_lock(&timeout->lock, false);
+
+		list_remove(cur);
+		timeout_handler_t handler = timeout->handler;
+		void *arg = timeout->arg;
+		timeout_reinitialize(timeout);
+
+		irq_spinlock_unlock(&timeout->lock, false);
+		irq_spinlock_unlock(&CPU->timeoutlock, false);
+
+		handler(arg);
+
+		irq_spinlock_lock(&CPU->timeoutlock, false);
+	}
+
+	irq_spinlock_unlock(&CPU->timeoutlock, false);
+}
+
 /** @}
  */
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <test.h>
+#include <atomic.h>
+#include <stdlib.h>
+#include <proc/thread.h>
+#include <time/timeout.h>
+#include <arch/cycle.h>
+
+/*
+ * Register a large number of timeouts, cancel half of them and let the rest
+ * expire, measuring the cost of each operation. The delays are spread over
+ * several levels of the timeout wheel and all start only after
+ * TIMEOUT_BASE_US, so that no timeout expires before it can be cancelled.
+ */
+
+#define TIMEOUT_COUNT    100000
+#define TIMEOUT_BASE_US  2000000
+#define TIMEOUT_SPREAD   3000000
+#define WAIT_SECONDS     30
+
+static atomic_t fired;
+
+static void timeout1_handler(void *arg)
+{
+	atomic_inc(&fired);
+}
+
+const char *test_timeout1(void)
+{
+	timeout_t *timeouts = (timeout_t *)
+	    malloc(TIMEOUT_COUNT * sizeof(timeout_t));
+	if (timeouts == NULL)
+		return "Unable to allocate timeouts";
+
+	atomic_store(&fired, 0);
+
+	for (size_t i = 0; i < TIMEOUT_COUNT; i++)
+		timeout_initialize(&timeouts[i]);
+
+	TPRINTF("Registering %d timeouts ... ", TIMEOUT_COUNT);
+
+	uint64_t start = get_cycle();
+	for (size_t i = 0; i < TIMEOUT_COUNT; i++) {
+		timeout_register(&timeouts[i],
+		    TIMEOUT_BASE_US + (i * 7919) % TIMEOUT_SPREAD,
+		    timeout1_handler, NULL);
+	}
+	uint64_t insert = get_cycle() - start;
+
+	TPRINTF("%" PRIu64 " cycles per timeout.\n", insert / TIMEOUT_COUNT);
+	TPRINTF("Cancelling every other timeout ... ");
+
+	size_t cancelled = 0;
+	start = get_cycle();
+	for (size_t i = 0; i < TIMEOUT_COUNT; i += 2) {
+		if (timeout_unregister(&timeouts[i]))
+			cancelled++;
+	}
+	uint64_t cancel = get_cycle() - start;
+
+	TPRINTF("%" PRIu64 " cycles per timeout.\n",
+	    cancel / ((TIMEOUT_COUNT + 1) / 2));
+
+	if (cancelled != (TIMEOUT_COUNT + 1) / 2) {
+		free(timeouts);
+		return "Timeout expired before it could be cancelled";
+	}
+
+	size_t expected = TIMEOUT_COUNT - cancelled;
+
+	TPRINTF("Waiting for %zu timeouts to expire ...\n", expected);
+
+	unsigned int waited = 0;
+	while (atomic_load(&fired) < expected) {
+		if (waited++ == WAIT_SECONDS)
+			break;
+
+		thread_sleep(1);
+	}
+
+	/*
+	 * Timeouts which have not fired must not be left registered when
+	 * freeing their structures.
+	 */
+	size_t late = 0;
+	for (size_t i = 1; i < TIMEOUT_COUNT; i += 2) {
+		if (timeout_unregister(&timeouts[i]))
+			late++;
+	}
+
+	free(timeouts);
+
+	TPRINTF("%zu timeouts expired in about %u seconds.\n",
+	    atomic_load(&fired), waited);
+
+	if (late != 0)
+		return "Not all timeouts expired";
+
+	if (atomic_load(&fired) != expected)
+		return "Cancelled timeout expired";
+
+	return NULL;
+}
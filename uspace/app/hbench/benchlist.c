@@ -39,10 +39,14 @@
 
 benchmark_t *benchmarks[] = {
 	&benchmark_dir_read,
+	&benchmark_fibril_fan_out,
 	&benchmark_fibril_mutex,
+	&benchmark_fibril_ping_pong,
 	&benchmark_file_read,
+	&benchmark_inet_checksum,
 	&benchmark_malloc1,
 	&benchmark_malloc2,
+	&benchmark_malloc3,
 	&benchmark_ns_ping,
 	&benchmark_ping_pong
 };
@@ -99,6 +99,7 @@ typedef struct {
 
 extern void bench_run_init(bench_run_t *, char *, size_t);
 extern bool bench_run_fail(bench_run_t *, const char *, ...);
+extern bool bench_setup_runners(bench_env_t *, bench_run_t *);
 
 /*
  * We keep the following two functions inline to ensure that we start
@@ -132,10 +133,14 @@ extern size_t benchmark_count;
 
 /* Put your benchmark descriptors here (and also to benchlist.c). */
 extern benchmark_t benchmark_dir_read;
+extern benchmark_t benchmark_fibril_fan_out;
 extern benchmark_t benchmark_fibril_mutex;
+extern benchmark_t benchmark_fibril_ping_pong;
 extern benchmark_t benchmark_file_read;
+extern benchmark_t benchmark_inet_checksum;
 extern benchmark_t benchmark_malloc1;
 extern benchmark_t benchmark_malloc2;
+extern benchmark_t benchmark_malloc3;
 extern benchmark_t benchmark_ns_ping;
 extern benchmark_t benchmark_ping_pong;
 
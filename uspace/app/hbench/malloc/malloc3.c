@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "../hbench.h"
+
+/*
+ * Several fibrils allocate and free blocks of mixed sizes, keeping a window
+ * of blocks alive. Most blocks are small enough for the per-runner caches,
+ * some are served from the heap directly. Run it on a libc built with and
+ * without CONFIG_DEBUG_MALLOC (which serves everything from the heap) to
+ * compare the allocators, and with a varying 'runners' parameter to see how
+ * they scale.
+ */
+
+/** Number of blocks each fibril keeps alive. */
+#define WINDOW  256
+
+typedef struct {
+	uint64_t count;
+	atomic_bool failed;
+	fibril_semaphore_t done;
+} malloc3_t;
+
+/** Pick the size of the next block (a small one in seven cases of eight). */
+static size_t next_size(uint32_t *seed)
+{
+	/* xorshift32 */
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+
+	if ((*seed & 7) != 0)
+		return 8 + (*seed >> 3) % 504;
+
+	return 512 + (*seed >> 3) % 3584;
+}
+
+static errno_t malloc3_worker(void *arg)
+{
+	malloc3_t *m3 = arg;
+	void *blocks[WINDOW] = { NULL };
+	uint32_t seed = (uint32_t) (uintptr_t) &blocks | 1;
+
+	for (uint64_t i = 0; i < m3->count; i++) {
+		size_t slot = i % WINDOW;
+
+		free(blocks[slot]);
+		blocks[slot] = malloc(next_size(&seed));
+		if (blocks[slot] == NULL) {
+			atomic_store(&m3->failed, true);
+			break;
+		}
+
+		/* Touch the block like a real user would. */
+		*(volatile char *) blocks[slot] = 0;
+	}
+
+	for (size_t slot = 0; slot < WINDOW; slot++)
+		free(blocks[slot]);
+
+	fibril_semaphore_up(&m3->done);
+	return EOK;
+}
+
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *str = bench_env_param_get(env, "fibrils", "8");
+	char *end;
+	long workers = strtol(str, &end, 10);
+	if (*end != '\0' || workers < 1)
+		return bench_run_fail(run, "invalid fibril count '%s'", str);
+
+	malloc3_t m3;
+	m3.count = size / workers;
+	atomic_store(&m3.failed, false);
+	fibril_semaphore_initialize(&m3.done, 0);
+
+	bench_run_start(run);
+
+	long started;
+	for (started = 0; started < workers; started++) {
+		fid_t fid = fibril_create(malloc3_worker, &m3);
+		if (fid == 0)
+			break;
+		fibril_add_ready(fid);
+	}
+
+	for (long i = 0; i < started; i++)
+		fibril_semaphore_down(&m3.done);
+
+	bench_run_stop(run);
+
+	if (started < workers)
+		return bench_run_fail(run, "failed to create fibril");
+
+	if (atomic_load(&m3.failed))
+		return bench_run_fail(run, "failed to allocate a block");
+
+	return true;
+}
+
+benchmark_t benchmark_malloc3 = {
+	.name = "malloc3",
+	.desc = "User-space memory allocator benchmark, mixed sizes from many fibrils (use 'runners' and 'fibrils' params)",
+	.entry = &runner,
+	.setup = &bench_setup_runners,
+	.teardown = NULL
+};
+
+/** @}
+ */
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <inet/checksum.h>
+#include <stdint.h>
+#include "../hbench.h"
+
+/** Size of the checksummed data (one Ethernet MTU) */
+#define BUFFER_SIZE 1500
+
+static uint8_t buf[BUFFER_SIZE];
+
+static bool setup(bench_env_t *env, bench_run_t *run)
+{
+	for (size_t i = 0; i < BUFFER_SIZE; i++)
+		buf[i] = (uint8_t) (i * 7 + 3);
+
+	return true;
+}
+
+/** Compute the Internet checksum of one packet worth of data repeatedly. */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	volatile uint16_t cs;
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++)
+		cs = inet_checksum_calc(INET_CHECKSUM_INIT, buf, BUFFER_SIZE);
+	bench_run_stop(run);
+
+	(void) cs;
+	return true;
+}
+
+benchmark_t benchmark_inet_checksum = {
+	.name = "inet_checksum",
+	.desc = "Compute the Internet checksum of a 1500B packet",
+	.entry = &runner,
+	.setup = &setup,
+	.teardown = NULL
+};
+
+/** @}
+ */
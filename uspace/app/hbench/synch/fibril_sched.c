@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "../hbench.h"
+
+/*
+ * Benchmarks of the fibril scheduler. Both use the 'runners' parameter to
+ * set the number of threads that execute fibrils (see bench_setup_runners).
+ */
+
+typedef struct {
+	fibril_semaphore_t ping;
+	fibril_semaphore_t pong;
+	uint64_t count;
+	fibril_semaphore_t done;
+} ping_pong_t;
+
+static errno_t ponger(void *arg)
+{
+	ping_pong_t *pp = arg;
+
+	for (uint64_t i = 0; i < pp->count; i++) {
+		fibril_semaphore_down(&pp->ping);
+		fibril_semaphore_up(&pp->pong);
+	}
+
+	fibril_semaphore_up(&pp->done);
+	return EOK;
+}
+
+/*
+ * Two fibrils pass control back and forth, which measures the latency of
+ * waking up a fibril and switching to it.
+ */
+static bool ping_pong_runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	ping_pong_t pp;
+	fibril_semaphore_initialize(&pp.ping, 0);
+	fibril_semaphore_initialize(&pp.pong, 0);
+	fibril_semaphore_initialize(&pp.done, 0);
+	pp.count = size;
+
+	fid_t other = fibril_create(ponger, &pp);
+	if (other == 0)
+		return bench_run_fail(run, "failed to create fibril");
+	fibril_add_ready(other);
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		fibril_semaphore_up(&pp.ping);
+		fibril_semaphore_down(&pp.pong);
+	}
+	bench_run_stop(run);
+
+	fibril_semaphore_down(&pp.done);
+	return true;
+}
+
+typedef struct {
+	fibril_semaphore_t work;
+	fibril_semaphore_t finished;
+	fibril_semaphore_t exited;
+	atomic_uint_least64_t completed;
+	uint64_t count;
+	atomic_bool stop;
+} fan_out_t;
+
+static errno_t fan_out_worker(void *arg)
+{
+	fan_out_t *fo = arg;
+
+	while (true) {
+		fibril_semaphore_down(&fo->work);
+		if (atomic_load(&fo->stop))
+			break;
+
+		if (atomic_fetch_add(&fo->completed, 1) + 1 == fo->count)
+			fibril_semaphore_up(&fo->finished);
+	}
+
+	fibril_semaphore_up(&fo->exited);
+	return EOK;
+}
+
+/*
+ * One fibril hands out work items to a pool of worker fibrils, which
+ * measures how well the wakeups are spread over the runners.
+ */
+static bool fan_out_runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *str = bench_env_param_get(env, "fibrils", "16");
+	char *end;
+	long workers = strtol(str, &end, 10);
+	if (*end != '\0' || workers < 1)
+		return bench_run_fail(run, "invalid fibril count '%s'", str);
+
+	fan_out_t fo;
+	fibril_semaphore_initialize(&fo.work, 0);
+	fibril_semaphore_initialize(&fo.finished, 0);
+	fibril_semaphore_initialize(&fo.exited, 0);
+	atomic_store(&fo.completed, 0);
+	atomic_store(&fo.stop, false);
+	fo.count = size;
+
+	long started;
+	for (started = 0; started < workers; started++) {
+		fid_t fid = fibril_create(fan_out_worker, &fo);
+		if (fid == 0)
+			break;
+		fibril_add_ready(fid);
+	}
+
+	bool ret = true;
+	if (started < workers) {
+		bench_run_fail(run, "failed to create fibril");
+		ret = false;
+		goto leave;
+	}
+
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++)
+		fibril_semaphore_up(&fo.work);
+	if (size > 0)
+		fibril_semaphore_down(&fo.finished);
+	bench_run_stop(run);
+
+leave:
+	atomic_store(&fo.stop, true);
+	for (long i = 0; i < started; i++)
+		fibril_semaphore_up(&fo.work);
+	for (long i = 0; i < started; i++)
+		fibril_semaphore_down(&fo.exited);
+
+	return ret;
+}
+
+benchmark_t benchmark_fibril_ping_pong = {
+	.name = "fibril_ping_pong",
+	.desc = "Fibril wakeup and switch latency (use 'runners' param to set number of threads)",
+	.entry = &ping_pong_runner,
+	.setup = &bench_setup_runners,
+	.teardown = NULL
+};
+
+benchmark_t benchmark_fibril_fan_out = {
+	.name = "fibril_fan_out",
+	.desc = "Fibril work distribution throughput (use 'runners' and 'fibrils' params)",
+	.entry = &fan_out_runner,
+	.setup = &bench_setup_runners,
+	.teardown = NULL
+};
+
+/** @}
+ */
@@ -33,8 +33,10 @@
  * @file
  */
 
+#include <fibril.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "hbench.h"
 
 /** Initialize bench run structure.
@@ -75,5 +77,32 @@ bool bench_run_fail(bench_run_t *run, const char *fmt, ...)
 	return false;
 }
 
+/** Start fibril runners as set by the 'runners' parameter.
+ *
+ * Meant to be used as the setup function of benchmarks that run
+ * fibrils on multiple threads. Runners are never stopped, so use
+ * a separate hbench invocation for each runner count.
+ *
+ * @param env Benchmark environment.
+ * @param run Current benchmark run.
+ * @return Whether the runners were started.
+ */
+bool bench_setup_runners(bench_env_t *env, bench_run_t *run)
+{
+	const char *str = bench_env_param_get(env, "runners", "1");
+	char *end;
+	long runners = strtol(str, &end, 10);
+	if (*end != '\0' || runners < 1 || runners > 64)
+		return bench_run_fail(run, "invalid runner count '%s'", str);
+
+	int have = fibril_set_runner_count((int) runners);
+	if (have < runners) {
+		return bench_run_fail(run, "only %d runners out of %ld started",
+		    have, runners);
+	}
+
+	return true;
+}
+
 /** @}
  */
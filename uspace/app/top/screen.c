@@ -287,6 +287,45 @@ static inline void print_physmem_info(data_t *data)
 	    PRIu64 "%s used, %" PRIu64 "%s free", total, total_suffix,
 	    unavail, unavail_suffix, used, used_suffix, free, free_suffix);
 	screen_newline();
+
+	uint64_t cached;
+	const char *cached_suffix;
+	uint64_t requests = data->physmem->cache_hits +
+	    data->physmem->cache_misses;
+	uint64_t hit_rate = (requests > 0) ?
+	    data->physmem->cache_hits * 100 / requests : 0;
+
+	bin_order_suffix(data->physmem->cached, &cached, &cached_suffix, false);
+
+	printf("frame cache: %" PRIu64 "%s cached, %" PRIu64 " hits, %"
+	    PRIu64 " misses (%" PRIu64 "%% hit rate)", cached, cached_suffix,
+	    data->physmem->cache_hits, data->physmem->cache_misses, hit_rate);
+	screen_newline();
+
+	uint64_t zeroed;
+	const char *zeroed_suffix;
+	uint64_t zero_requests = data->physmem->zero_hits +
+	    data->physmem->zero_misses;
+	uint64_t zero_hit_rate = (zero_requests > 0) ?
+	    data->physmem->zero_hits * 100 / zero_requests : 0;
+
+	bin_order_suffix(data->physmem->zeroed, &zeroed, &zeroed_suffix, false);
+
+	printf("zero pool: %" PRIu64 "%s zeroed, %" PRIu64 " hits, %"
+	    PRIu64 " misses (%" PRIu64 "%% hit rate)", zeroed, zeroed_suffix,
+	    data->physmem->zero_hits, data->physmem->zero_misses,
+	    zero_hit_rate);
+	screen_newline();
+
+	uint64_t large;
+	const char *large_suffix;
+
+	bin_order_suffix(data->physmem->large_mapped, &large, &large_suffix,
+	    false);
+
+	printf("large pages: %" PRIu64 " mapped (%" PRIu64 "%s)",
+	    data->physmem->large_pages, large, large_suffix);
+	screen_newline();
 }
 
 static inline void print_help_head(void)
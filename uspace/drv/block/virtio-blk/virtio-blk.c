@@ -32,11 +32,14 @@
 #include <stdint.h>
 
 #include <as.h>
+#include <align.h>
+#include <byteorder.h>
 #include <ddf/driver.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
 #include <pci_dev_iface.h>
 #include <fibril_synch.h>
+#include <macros.h>
 
 #include <bd_srv.h>
 
@@ -50,16 +53,19 @@
 
 /*
  * VIRTIO_BLK requests need at least two descriptors so that device-read-only
- * buffers are separated from device-writable buffers. For convenience, we
- * always use three descriptors for the request header, buffer and footer.
- * We therefore organize the virtque so that first RQ_BUFFERS descriptors are
- * used for request headers, the following RQ_BUFFERS descriptors are used
- * for in/out buffers and the last RQ_BUFFERS descriptors are used for request
- * footers.
+ * buffers are separated from device-writable buffers. A request consists of
+ * a header descriptor, up to RQ_SEGS data segment descriptors and a footer
+ * descriptor. We therefore organize the virtqueue so that first RQ_BUFFERS
+ * descriptors are used for request headers, the following RQ_BUFFERS
+ * descriptors are used for request footers and the last RQ_BUFFERS * RQ_SEGS
+ * descriptors are used for data segments.
  */
 #define REQ_HEADER_DESC(descno)	(0 * RQ_BUFFERS + (descno))
-#define REQ_BUFFER_DESC(descno)	(1 * RQ_BUFFERS + (descno))
-#define REQ_FOOTER_DESC(descno)	(2 * RQ_BUFFERS + (descno))
+#define REQ_FOOTER_DESC(descno)	(1 * RQ_BUFFERS + (descno))
+#define REQ_SEG_DESC(descno, seg) \
+	(2 * RQ_BUFFERS + (descno) * RQ_SEGS + (seg))
+
+#define RQ_QUEUE_SIZE	((2 + RQ_SEGS) * RQ_BUFFERS)
 
 static errno_t virtio_blk_dev_add(ddf_dev_t *dev);
 
@@ -83,6 +89,7 @@ static void virtio_blk_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
 	while (virtio_virtq_consume_used(vdev, RQ_QUEUE, &descno, &len)) {
 		assert(descno < RQ_BUFFERS);
 		fibril_mutex_lock(&virtio_blk->completion_lock[descno]);
+		virtio_blk->completed[descno] = true;
 		fibril_condvar_signal(&virtio_blk->completion_cv[descno]);
 		fibril_mutex_unlock(&virtio_blk->completion_lock[descno]);
 	}
@@ -157,22 +164,26 @@ static errno_t virtio_blk_bd_close(bd_srv_t *bd)
 	return EOK;
 }
 
-static errno_t virtio_blk_rw_block(virtio_blk_t *virtio_blk, bool read,
-    aoff64_t ba, void *buf)
+/** Allocate a request
+ *
+ * The allocated descno will determine the header descriptor
+ * (REQ_HEADER_DESC), the data segment descriptors (REQ_SEG_DESC), the
+ * footer descriptor (REQ_FOOTER_DESC) and the DMA buffers of the request.
+ *
+ * @param virtio_blk  Device
+ * @param wait        Wait for a request to become free
+ *
+ * @return  Allocated request or 0xFFFF if @a wait is false and there is
+ *          no free request
+ */
+static uint16_t virtio_blk_rq_alloc(virtio_blk_t *virtio_blk, bool wait)
 {
 	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
 
-	/*
-	 * Allocate a descriptor.
-	 *
-	 * The allocated descno will determine the header descriptor
-	 * (REQ_HEADER_DESC), the buffer descriptor (REQ_BUFFER_DESC) and the
-	 * footer (REQ_FOOTER_DESC) descriptor.
-	 */
 	fibril_mutex_lock(&virtio_blk->free_lock);
 	uint16_t descno = virtio_alloc_desc(vdev, RQ_QUEUE,
 	    &virtio_blk->rq_free_head);
-	while (descno == (uint16_t) -1U) {
+	while (descno == (uint16_t) -1U && wait) {
 		fibril_condvar_wait(&virtio_blk->free_cv,
 		    &virtio_blk->free_lock);
 		descno = virtio_alloc_desc(vdev, RQ_QUEUE,
@@ -180,43 +191,101 @@ static errno_t virtio_blk_rw_block(virtio_blk_t *virtio_blk, bool read,
 	}
 	fibril_mutex_unlock(&virtio_blk->free_lock);
 
-	assert(descno < RQ_BUFFERS);
+	assert(descno == (uint16_t) -1U || descno < RQ_BUFFERS);
+	return descno;
+}
+
+/** Free a request
+ *
+ * @param virtio_blk  Device
+ * @param descno      Request
+ */
+static void virtio_blk_rq_free(virtio_blk_t *virtio_blk, uint16_t descno)
+{
+	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
+
+	fibril_mutex_lock(&virtio_blk->free_lock);
+	virtio_free_desc(vdev, RQ_QUEUE, &virtio_blk->rq_free_head, descno);
+	fibril_condvar_signal(&virtio_blk->free_cv);
+	fibril_mutex_unlock(&virtio_blk->free_lock);
+}
+
+/** Put a request into the virtqueue
+ *
+ * The device is not notified, the caller is expected to call
+ * virtio_virtq_kick() after submitting a batch of requests.
+ *
+ * @param virtio_blk  Device
+ * @param descno      Request
+ * @param type        Request type
+ * @param ba          First sector
+ * @param size        Size of data in the request buffer
+ */
+static void virtio_blk_rq_submit(virtio_blk_t *virtio_blk, uint16_t descno,
+    uint32_t type, aoff64_t ba, size_t size)
+{
+	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
+
+	assert(size <= virtio_blk->rq_max_size);
 
 	/* Setup the request header */
 	virtio_blk_req_header_t *req_header =
 	    (virtio_blk_req_header_t *) virtio_blk->rq_header[descno];
 	memset(req_header, 0, sizeof(virtio_blk_req_header_t));
-	pio_write_le32(&req_header->type,
-	    read ? VIRTIO_BLK_T_IN : VIRTIO_BLK_T_OUT);
+	pio_write_le32(&req_header->type, type);
 	pio_write_le64(&req_header->sector, ba);
 
-	/* Copy write data to the request. */
-	if (!read)
-		memcpy(virtio_blk->rq_buf[descno], buf, VIRTIO_BLK_BLOCK_SIZE);
-
 	fibril_mutex_lock(&virtio_blk->completion_lock[descno]);
+	virtio_blk->completed[descno] = false;
+	fibril_mutex_unlock(&virtio_blk->completion_lock[descno]);
 
 	/*
-	 * Set the descriptors, chain them in the virtqueue and notify the
-	 * device.
+	 * Set the descriptors and chain them. The data buffer is split
+	 * into segments no larger than the device accepts.
 	 */
-	virtio_virtq_desc_set(vdev, RQ_QUEUE, REQ_HEADER_DESC(descno),
-	    virtio_blk->rq_header_p[descno], sizeof(virtio_blk_req_header_t),
-	    VIRTQ_DESC_F_NEXT, REQ_BUFFER_DESC(descno));
-	virtio_virtq_desc_set(vdev, RQ_QUEUE, REQ_BUFFER_DESC(descno),
-	    virtio_blk->rq_buf_p[descno], VIRTIO_BLK_BLOCK_SIZE,
-	    VIRTQ_DESC_F_NEXT | (read ? VIRTQ_DESC_F_WRITE : 0),
-	    REQ_FOOTER_DESC(descno));
+	uint16_t data_flags = type == VIRTIO_BLK_T_IN ? VIRTQ_DESC_F_WRITE : 0;
+	uint16_t prev = REQ_HEADER_DESC(descno);
+	size_t prev_size = sizeof(virtio_blk_req_header_t);
+	uintptr_t prev_addr = virtio_blk->rq_header_p[descno];
+	uint16_t prev_flags = 0;
+	unsigned seg = 0;
+
+	for (size_t off = 0; off < size; off += virtio_blk->seg_size) {
+		assert(seg < RQ_SEGS);
+		virtio_virtq_desc_set(vdev, RQ_QUEUE, prev, prev_addr,
+		    prev_size, prev_flags | VIRTQ_DESC_F_NEXT,
+		    REQ_SEG_DESC(descno, seg));
+
+		prev = REQ_SEG_DESC(descno, seg);
+		prev_addr = virtio_blk->rq_buf_p[descno] + off;
+		prev_size = min(size - off, virtio_blk->seg_size);
+		prev_flags = data_flags;
+		seg++;
+	}
+
+	virtio_virtq_desc_set(vdev, RQ_QUEUE, prev, prev_addr, prev_size,
+	    prev_flags | VIRTQ_DESC_F_NEXT, REQ_FOOTER_DESC(descno));
 	virtio_virtq_desc_set(vdev, RQ_QUEUE, REQ_FOOTER_DESC(descno),
 	    virtio_blk->rq_footer_p[descno], sizeof(virtio_blk_req_footer_t),
 	    VIRTQ_DESC_F_WRITE, 0);
-	virtio_virtq_produce_available(vdev, RQ_QUEUE, descno);
 
-	/*
-	 * Wait for the completion of the request.
-	 */
-	fibril_condvar_wait(&virtio_blk->completion_cv[descno],
-	    &virtio_blk->completion_lock[descno]);
+	virtio_virtq_add_available(vdev, RQ_QUEUE, REQ_HEADER_DESC(descno));
+}
+
+/** Wait for a request to complete
+ *
+ * @param virtio_blk  Device
+ * @param descno      Request
+ *
+ * @return  EOK on success or an error code
+ */
+static errno_t virtio_blk_rq_wait(virtio_blk_t *virtio_blk, uint16_t descno)
+{
+	fibril_mutex_lock(&virtio_blk->completion_lock[descno]);
+	while (!virtio_blk->completed[descno]) {
+		fibril_condvar_wait(&virtio_blk->completion_cv[descno],
+		    &virtio_blk->completion_lock[descno]);
+	}
 	fibril_mutex_unlock(&virtio_blk->completion_lock[descno]);
 
 	errno_t rc;
@@ -239,37 +308,111 @@ static errno_t virtio_blk_rw_block(virtio_blk_t *virtio_blk, bool read,
 		break;
 	}
 
-	/* Copy read data from the request */
-	if (rc == EOK && read)
-		memcpy(buf, virtio_blk->rq_buf[descno], VIRTIO_BLK_BLOCK_SIZE);
+	return rc;
+}
 
-	/* Free the descriptor and buffer */
-	fibril_mutex_lock(&virtio_blk->free_lock);
-	virtio_free_desc(vdev, RQ_QUEUE, &virtio_blk->rq_free_head, descno);
-	fibril_condvar_signal(&virtio_blk->free_cv);
-	fibril_mutex_unlock(&virtio_blk->free_lock);
+/** Execute a single request without data transfer to or from the client
+ *
+ * @param virtio_blk  Device
+ * @param type        Request type
+ * @param ba          First sector
+ * @param data        Data to pass to the device or NULL
+ * @param size        Size of @a data
+ *
+ * @return  EOK on success or an error code
+ */
+static errno_t virtio_blk_rq_exec(virtio_blk_t *virtio_blk, uint32_t type,
+    aoff64_t ba, const void *data, size_t size)
+{
+	uint16_t descno = virtio_blk_rq_alloc(virtio_blk, true);
+
+	if (size > 0)
+		memcpy(virtio_blk->rq_buf[descno], data, size);
 
+	virtio_blk_rq_submit(virtio_blk, descno, type, ba, size);
+	virtio_virtq_kick(&virtio_blk->virtio_dev, RQ_QUEUE);
+
+	errno_t rc = virtio_blk_rq_wait(virtio_blk, descno);
+	virtio_blk_rq_free(virtio_blk, descno);
 	return rc;
 }
 
+/** Read or write a range of blocks
+ *
+ * The range is split into requests of up to rq_max_size bytes. As many
+ * of them as there are free request buffers are submitted at once and
+ * the device is notified only once per such batch. The requests are
+ * then completed in order, refilling the pipeline as they finish.
+ */
 static errno_t virtio_blk_bd_rw_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
     void *buf, size_t size, bool read)
 {
 	virtio_blk_t *virtio_blk = (virtio_blk_t *) bd->srvs->sarg;
-	aoff64_t i;
-	errno_t rc;
+	virtio_dev_t *vdev = &virtio_blk->virtio_dev;
+	uint16_t rq[RQ_BUFFERS];
+	size_t rq_off[RQ_BUFFERS];
+	size_t rq_size[RQ_BUFFERS];
+	unsigned first = 0;
+	unsigned pending = 0;
+	size_t off = 0;
+	errno_t rc = EOK;
 
 	if (size != cnt * VIRTIO_BLK_BLOCK_SIZE)
 		return EINVAL;
 
-	for (i = 0; i < cnt; i++) {
-		rc = virtio_blk_rw_block(virtio_blk, read, ba + i,
-		    buf + i * VIRTIO_BLK_BLOCK_SIZE);
-		if (rc != EOK)
-			return rc;
+	while (off < size || pending > 0) {
+		unsigned submitted = 0;
+
+		/*
+		 * Only wait for a free request when we have none in flight,
+		 * otherwise we could wait for requests held by other clients
+		 * which wait for ours.
+		 */
+		while (rc == EOK && off < size && pending < RQ_BUFFERS) {
+			uint16_t descno = virtio_blk_rq_alloc(virtio_blk,
+			    pending == 0);
+			if (descno == (uint16_t) -1U)
+				break;
+
+			size_t xfer = min(size - off, virtio_blk->rq_max_size);
+			if (!read)
+				memcpy(virtio_blk->rq_buf[descno], buf + off, xfer);
+
+			virtio_blk_rq_submit(virtio_blk, descno,
+			    read ? VIRTIO_BLK_T_IN : VIRTIO_BLK_T_OUT,
+			    ba + off / VIRTIO_BLK_BLOCK_SIZE, xfer);
+
+			unsigned i = (first + pending) % RQ_BUFFERS;
+			rq[i] = descno;
+			rq_off[i] = off;
+			rq_size[i] = xfer;
+			pending++;
+			submitted++;
+			off += xfer;
+		}
+
+		if (submitted > 0)
+			virtio_virtq_kick(vdev, RQ_QUEUE);
+
+		if (pending == 0)
+			break;
+
+		/* Complete the oldest request */
+		uint16_t descno = rq[first];
+		errno_t rrc = virtio_blk_rq_wait(virtio_blk, descno);
+		if (rrc == EOK && read) {
+			memcpy(buf + rq_off[first], virtio_blk->rq_buf[descno],
+			    rq_size[first]);
+		}
+		if (rc == EOK)
+			rc = rrc;
+
+		virtio_blk_rq_free(virtio_blk, descno);
+		first = (first + 1) % RQ_BUFFERS;
+		pending--;
 	}
 
-	return EOK;
+	return rc;
 }
 
 static errno_t virtio_blk_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
@@ -284,6 +427,51 @@ static errno_t virtio_blk_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
 	return virtio_blk_bd_rw_blocks(bd, ba, cnt, (void *) buf, size, false);
 }
 
+static errno_t virtio_blk_bd_sync_cache(bd_srv_t *bd, aoff64_t ba, size_t cnt)
+{
+	virtio_blk_t *virtio_blk = (virtio_blk_t *) bd->srvs->sarg;
+
+	/* Without VIRTIO_BLK_F_FLUSH the device does not cache writes */
+	if (!(virtio_blk->virtio_dev.features & VIRTIO_BLK_F_FLUSH))
+		return EOK;
+
+	/* The device can only flush everything */
+	return virtio_blk_rq_exec(virtio_blk, VIRTIO_BLK_T_FLUSH, 0, NULL, 0);
+}
+
+static errno_t virtio_blk_bd_discard(bd_srv_t *bd, aoff64_t ba, size_t cnt)
+{
+	virtio_blk_t *virtio_blk = (virtio_blk_t *) bd->srvs->sarg;
+	virtio_blk_cfg_t *blkcfg = virtio_blk->virtio_dev.device_cfg;
+	errno_t rc;
+
+	if (!(virtio_blk->virtio_dev.features & VIRTIO_BLK_F_DISCARD))
+		return ENOTSUP;
+
+	size_t max_sectors = pio_read_le32(&blkcfg->max_discard_sectors);
+	if (max_sectors == 0)
+		return ENOTSUP;
+
+	while (cnt > 0) {
+		virtio_blk_discard_t seg;
+		size_t n = min(cnt, max_sectors);
+
+		memset(&seg, 0, sizeof(seg));
+		seg.sector = host2uint64_t_le(ba);
+		seg.num_sectors = host2uint32_t_le(n);
+
+		rc = virtio_blk_rq_exec(virtio_blk, VIRTIO_BLK_T_DISCARD, 0,
+		    &seg, sizeof(seg));
+		if (rc != EOK)
+			return rc;
+
+		ba += n;
+		cnt -= n;
+	}
+
+	return EOK;
+}
+
 static errno_t virtio_blk_bd_get_block_size(bd_srv_t *bd, size_t *size)
 {
 	*size = VIRTIO_BLK_BLOCK_SIZE;
@@ -302,6 +490,8 @@ bd_ops_t virtio_blk_bd_ops = {
 	.open = virtio_blk_bd_open,
 	.close = virtio_blk_bd_close,
 	.read_blocks = virtio_blk_bd_read_blocks,
+	.sync_cache = virtio_blk_bd_sync_cache,
+	.discard = virtio_blk_bd_discard,
 	.write_blocks = virtio_blk_bd_write_blocks,
 	.get_block_size = virtio_blk_bd_get_block_size,
 	.get_num_blocks = virtio_blk_bd_get_num_blocks,
@@ -341,12 +531,39 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 		goto fail;
 
 	/* Reset the device and negotiate the feature bits */
-	rc = virtio_device_setup_start(vdev, 0);
+	rc = virtio_device_setup_start(vdev, 0,
+	    VIRTIO_BLK_F_SIZE_MAX | VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_FLUSH |
+	    VIRTIO_BLK_F_DISCARD | VIRTIO_RING_F_EVENT_IDX);
 	if (rc != EOK)
 		goto fail;
 
 	/* Perform device-specific setup */
 
+	/*
+	 * Determine the maximum size of a request with respect to the limits
+	 * on segment size and count.
+	 */
+	virtio_blk_cfg_t *blkcfg = vdev->device_cfg;
+	size_t seg_size = RQ_BUF_SIZE;
+	size_t segs = RQ_SEGS;
+
+	if (vdev->features & VIRTIO_BLK_F_SIZE_MAX) {
+		size_t size_max = pio_read_le32(&blkcfg->size_max);
+		if (size_max >= VIRTIO_BLK_BLOCK_SIZE && size_max < seg_size)
+			seg_size = ALIGN_DOWN(size_max, VIRTIO_BLK_BLOCK_SIZE);
+	}
+
+	if (vdev->features & VIRTIO_BLK_F_SEG_MAX) {
+		size_t seg_max = pio_read_le32(&blkcfg->seg_max);
+		if (seg_max > 0 && seg_max < segs)
+			segs = seg_max;
+	}
+
+	virtio_blk->seg_size = seg_size;
+	virtio_blk->rq_max_size = min(segs * seg_size, (size_t) RQ_BUF_SIZE);
+	ddf_msg(LVL_NOTE, "Maximum request size %zu bytes",
+	    virtio_blk->rq_max_size);
+
 	/*
 	 * Discover and configure the virtqueue
 	 */
@@ -364,8 +581,8 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 		goto fail;
 	}
 
-	/* For each in/out request we need 3 descriptors */
-	rc = virtio_virtq_setup(vdev, RQ_QUEUE, 3 * RQ_BUFFERS);
+	/* Each request needs a header, a footer and RQ_SEGS data descriptors */
+	rc = virtio_virtq_setup(vdev, RQ_QUEUE, RQ_QUEUE_SIZE);
 	if (rc != EOK)
 		goto fail;
 
@@ -376,7 +593,7 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 	    true, virtio_blk->rq_header, virtio_blk->rq_header_p);
 	if (rc != EOK)
 		goto fail;
-	rc = virtio_setup_dma_bufs(RQ_BUFFERS, VIRTIO_BLK_BLOCK_SIZE,
+	rc = virtio_setup_dma_bufs(RQ_BUFFERS, RQ_BUF_SIZE,
 	    true, virtio_blk->rq_buf, virtio_blk->rq_buf_p);
 	if (rc != EOK)
 		goto fail;
@@ -387,7 +604,7 @@ static errno_t virtio_blk_initialize(ddf_dev_t *dev)
 
 	/*
 	 * Put all request descriptors on a free list. Because of the
-	 * correspondence between the request, buffer and footer descriptors,
+	 * correspondence between the request, segment and footer descriptors,
 	 * we only need to manage allocations for one set: the request header
 	 * descriptors.
 	 */
@@ -34,22 +34,38 @@
 #include <abi/cap.h>
 
 #include <fibril_synch.h>
+#include <stdbool.h>
 
 #define VIRTIO_BLK_BLOCK_SIZE	512
 
 /* Operation types. */
 #define VIRTIO_BLK_T_IN		0
 #define VIRTIO_BLK_T_OUT	1
+#define VIRTIO_BLK_T_FLUSH	4
+#define VIRTIO_BLK_T_DISCARD	11
 
 /* Status codes returned by the device. */
 #define VIRTIO_BLK_S_OK		0
 #define VIRTIO_BLK_S_IOERR	1
 #define VIRTIO_BLK_S_UNSUPP	2
 
-#define RQ_BUFFERS	32
-
+/** Number of requests which can be in flight at the same time */
+#define RQ_BUFFERS	16
+/** Maximum number of data segments of one request */
+#define RQ_SEGS		6
+/** Size of the data buffer of one request */
+#define RQ_BUF_SIZE	(64 * 1024)
+
+/** Maximum size of any single segment is in size_max. */
+#define VIRTIO_BLK_F_SIZE_MAX	(1U << 1)
+/** Maximum number of segments in a request is in seg_max. */
+#define VIRTIO_BLK_F_SEG_MAX	(1U << 2)
 /** Device is read-only. */
 #define VIRTIO_BLK_F_RO		(1U << 5)
+/** Cache flush command support. */
+#define VIRTIO_BLK_F_FLUSH	(1U << 9)
+/** Device can support discard command. */
+#define VIRTIO_BLK_F_DISCARD	(1U << 13)
 
 typedef struct {
 	uint32_t type;
@@ -61,8 +77,33 @@ typedef struct {
 	uint8_t status;
 } virtio_blk_req_footer_t;
 
+typedef struct {
+	uint64_t sector;
+	uint32_t num_sectors;
+	uint32_t flags;
+} virtio_blk_discard_t;
+
 typedef struct {
 	uint64_t capacity;
+	uint32_t size_max;
+	uint32_t seg_max;
+	struct {
+		uint16_t cylinders;
+		uint8_t heads;
+		uint8_t sectors;
+	} geometry;
+	uint32_t blk_size;
+	struct {
+		uint8_t physical_block_exp;
+		uint8_t alignment_offset;
+		uint16_t min_io_size;
+		uint32_t opt_io_size;
+	} topology;
+	uint8_t writeback;
+	uint8_t unused0[3];
+	uint32_t max_discard_sectors;
+	uint32_t max_discard_seg;
+	uint32_t discard_sector_alignment;
 } virtio_blk_cfg_t;
 
 typedef struct {
@@ -79,6 +120,11 @@ typedef struct {
 
 	uint16_t rq_free_head;
 
+	/** Maximum size of a data segment */
+	size_t seg_size;
+	/** Maximum size of data transferred by one request */
+	size_t rq_max_size;
+
 	int irq;
 	cap_irq_handle_t irq_handle;
 
@@ -89,6 +135,7 @@ typedef struct {
 
 	fibril_mutex_t completion_lock[RQ_BUFFERS];
 	fibril_condvar_t completion_cv[RQ_BUFFERS];
+	bool completed[RQ_BUFFERS];
 } virtio_blk_t;
 
 #endif
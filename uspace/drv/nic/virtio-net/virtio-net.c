@@ -32,9 +32,12 @@
 #include <stdint.h>
 
 #include <as.h>
+#include <byteorder.h>
 #include <ddf/driver.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
+#include <fibril.h>
+#include <inet/checksum.h>
 #include <ops/nic.h>
 #include <pci_dev_iface.h>
 #include <nic/nic.h>
@@ -56,6 +59,9 @@
 #define TX_BUF_SIZE	BUFFER_SIZE
 #define CT_BUF_SIZE	BUFFER_SIZE
 
+/** Maximum number of frames received in one go before yielding */
+#define RX_BUDGET	32
+
 static ddf_dev_ops_t virtio_net_dev_ops;
 
 static errno_t virtio_net_dev_add(ddf_dev_t *dev);
@@ -69,45 +75,203 @@ static driver_t virtio_net_driver = {
 	.driver_ops = &virtio_net_driver_ops
 };
 
-static void virtio_net_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+/** Complete partial checksum of a received frame
+ *
+ * With VIRTIO_NET_F_GUEST_CSUM the device may hand over frames whose
+ * transport checksum only covers the pseudo header.
+ *
+ * @param hdr    Virtio header of the frame
+ * @param data   Frame data
+ * @param size   Frame size
+ */
+static void virtio_net_rx_csum(virtio_net_hdr_t *hdr, uint8_t *data,
+    size_t size)
+{
+	size_t start = uint16_t_le2host(hdr->csum_start);
+	size_t offset = uint16_t_le2host(hdr->csum_offset);
+
+	if (start + offset + sizeof(uint16_t) > size) {
+		ddf_msg(LVL_WARN, "RX checksum offset out of range");
+		return;
+	}
+
+	uint16_t csum = inet_checksum_calc(INET_CHECKSUM_INIT, data + start,
+	    size - start);
+	if (csum == 0)
+		csum = 0xffff;
+
+	csum = host2uint16_t_be(csum);
+	memcpy(data + start + offset, &csum, sizeof(csum));
+}
+
+/** Receive frames from the RX queue
+ *
+ * The RX lock must be held. The processed buffers are given back to the
+ * device and the device is notified once for the whole batch.
+ *
+ * @param nic     NIC
+ * @param budget  Maximum number of frames to receive
+ *
+ * @return  Number of frames received or dropped
+ */
+static unsigned virtio_net_rx(nic_t *nic, unsigned budget)
 {
-	nic_t *nic = ddf_dev_data_get(dev);
 	virtio_net_t *virtio_net = nic_get_specific(nic);
 	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	uint16_t descs[RX_BUFFERS];
+	uint32_t lens[RX_BUFFERS];
+	unsigned frames = 0;
 
-	uint16_t descno;
-	uint32_t len;
-	while (virtio_virtq_consume_used(vdev, RX_QUEUE_1, &descno, &len)) {
+	assert(fibril_mutex_is_locked(&virtio_net->rx_lock));
+
+	while (frames < budget && virtio_virtq_consume_used(vdev, RX_QUEUE_1,
+	    &descs[0], &lens[0])) {
 		virtio_net_hdr_t *hdr =
-		    (virtio_net_hdr_t *) virtio_net->rx_buf[descno];
-		if (len <= sizeof(*hdr)) {
-			ddf_msg(LVL_WARN,
-			    "RX data length too short, packet dropped");
-			virtio_virtq_produce_available(vdev, RX_QUEUE_1,
-			    descno);
-			continue;
+		    (virtio_net_hdr_t *) virtio_net->rx_buf[descs[0]];
+		unsigned nbufs = 1;
+		unsigned n = 1;
+
+		frames++;
+
+		if (vdev->features & VIRTIO_NET_F_MRG_RXBUF)
+			nbufs = uint16_t_le2host(hdr->num_buffers);
+
+		/*
+		 * The device publishes all buffers of a merged frame at once,
+		 * so they are already in the used ring.
+		 */
+		while (n < nbufs && n < RX_BUFFERS &&
+		    virtio_virtq_consume_used(vdev, RX_QUEUE_1, &descs[n],
+		    &lens[n]))
+			n++;
+
+		size_t size = 0;
+		for (unsigned i = 0; i < n; i++)
+			size += lens[i];
+
+		if (n != nbufs || lens[0] < sizeof(*hdr) ||
+		    size <= sizeof(*hdr)) {
+			ddf_msg(LVL_WARN, "Malformed RX data, packet dropped");
+			nic_report_receive_error(nic, NIC_REC_OTHER, 1);
+			goto recycle;
 		}
 
-		nic_frame_t *frame = nic_alloc_frame(nic, len - sizeof(*hdr));
-		if (frame) {
-			memcpy(frame->data, &hdr[1], len - sizeof(*hdr));
-			nic_received_frame(nic, frame);
-		} else {
+		size -= sizeof(*hdr);
+
+		nic_frame_t *frame = nic_alloc_frame(nic, size);
+		if (frame == NULL) {
 			ddf_msg(LVL_WARN,
 			    "Cannot allocate RX frame, packet dropped");
+			goto recycle;
+		}
+
+		uint8_t *dst = frame->data;
+		memcpy(dst, &hdr[1], lens[0] - sizeof(*hdr));
+		dst += lens[0] - sizeof(*hdr);
+		for (unsigned i = 1; i < n; i++) {
+			memcpy(dst, virtio_net->rx_buf[descs[i]], lens[i]);
+			dst += lens[i];
+		}
+
+		if (hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM)
+			virtio_net_rx_csum(hdr, frame->data, size);
+
+		nic_received_frame(nic, frame);
+
+	recycle:
+		for (unsigned i = 0; i < n; i++)
+			virtio_virtq_add_available(vdev, RX_QUEUE_1, descs[i]);
+	}
+
+	if (frames > 0)
+		virtio_virtq_kick(vdev, RX_QUEUE_1);
+
+	return frames;
+}
+
+/** Receive frames while RX interrupts are in use
+ *
+ * While frames keep arriving, the RX interrupt stays disabled and the
+ * queue is processed in batches of RX_BUDGET frames, yielding between
+ * them. The interrupt is re-enabled only once the queue is drained,
+ * so a busy link does not cause an interrupt per frame.
+ *
+ * @param nic  NIC
+ */
+static void virtio_net_rx_irq(nic_t *nic)
+{
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+
+	fibril_mutex_lock(&virtio_net->rx_lock);
+
+	while (virtio_net->rx_irq) {
+		virtio_virtq_irq_disable(vdev, RX_QUEUE_1);
+
+		if (virtio_net_rx(nic, RX_BUDGET) == RX_BUDGET) {
+			fibril_mutex_unlock(&virtio_net->rx_lock);
+			fibril_yield();
+			fibril_mutex_lock(&virtio_net->rx_lock);
+			continue;
 		}
 
-		virtio_virtq_produce_available(vdev, RX_QUEUE_1, descno);
+		if (!virtio_virtq_irq_enable(vdev, RX_QUEUE_1))
+			break;
 	}
 
+	fibril_mutex_unlock(&virtio_net->rx_lock);
+}
+
+/** Reclaim descriptors of transmitted frames
+ *
+ * The TX lock must be held. TX interrupts are only enabled while the
+ * transmission is stopped for lack of descriptors; otherwise the
+ * completed descriptors are reclaimed when sending.
+ *
+ * @param nic  NIC
+ */
+static void virtio_net_tx_reclaim(nic_t *nic)
+{
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	uint16_t descno;
+	uint32_t len;
+	bool freed = false;
+
+	assert(fibril_mutex_is_locked(&virtio_net->tx_lock));
+
 	while (virtio_virtq_consume_used(vdev, TX_QUEUE_1, &descno, &len)) {
 		virtio_free_desc(vdev, TX_QUEUE_1, &virtio_net->tx_free_head,
 		    descno);
+		freed = true;
+	}
+
+	if (freed && virtio_net->tx_stopped) {
+		virtio_virtq_irq_disable(vdev, TX_QUEUE_1);
+		virtio_net->tx_stopped = false;
+		nic_set_tx_busy(nic, 0);
 	}
+}
+
+static void virtio_net_irq_handler(ipc_call_t *icall, ddf_dev_t *dev)
+{
+	nic_t *nic = ddf_dev_data_get(dev);
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+
+	uint16_t descno;
+	uint32_t len;
+
+	fibril_mutex_lock(&virtio_net->tx_lock);
+	virtio_net_tx_reclaim(nic);
+	fibril_mutex_unlock(&virtio_net->tx_lock);
+
 	while (virtio_virtq_consume_used(vdev, CT_QUEUE_1, &descno, &len)) {
 		virtio_free_desc(vdev, CT_QUEUE_1, &virtio_net->ct_free_head,
 		    descno);
 	}
+
+	virtio_net_rx_irq(nic);
 }
 
 static errno_t virtio_net_register_interrupt(ddf_dev_t *dev)
@@ -180,6 +344,10 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 
 	nic_set_specific(nic, virtio_net);
 
+	fibril_mutex_initialize(&virtio_net->rx_lock);
+	fibril_mutex_initialize(&virtio_net->tx_lock);
+	virtio_net->rx_irq = true;
+
 	errno_t rc = virtio_pci_dev_initialize(dev, &virtio_net->virtio_dev);
 	if (rc != EOK)
 		return rc;
@@ -197,7 +365,9 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 
 	/* Reset the device and negotiate the feature bits */
 	rc = virtio_device_setup_start(vdev,
-	    VIRTIO_NET_F_MAC | VIRTIO_NET_F_CTRL_VQ);
+	    VIRTIO_NET_F_MAC | VIRTIO_NET_F_CTRL_VQ,
+	    VIRTIO_NET_F_MRG_RXBUF | VIRTIO_NET_F_GUEST_CSUM |
+	    VIRTIO_RING_F_EVENT_IDX);
 	if (rc != EOK)
 		goto fail;
 
@@ -261,8 +431,9 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 		 * Put the set descriptor into the available ring of the RX
 		 * queue.
 		 */
-		virtio_virtq_produce_available(vdev, RX_QUEUE_1, i);
+		virtio_virtq_add_available(vdev, RX_QUEUE_1, i);
 	}
+	virtio_virtq_kick(vdev, RX_QUEUE_1);
 
 	/*
 	 * Put all TX and CT buffers on a free list
@@ -272,6 +443,9 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 	virtio_create_desc_free_list(vdev, CT_QUEUE_1, CT_BUFFERS,
 	    &virtio_net->ct_free_head);
 
+	/* Transmitted frames are reclaimed when sending new ones */
+	virtio_virtq_irq_disable(vdev, TX_QUEUE_1);
+
 	/*
 	 * Read the MAC address
 	 */
@@ -329,15 +503,36 @@ static void virtio_net_send(nic_t *nic, void *data, size_t size)
 	virtio_net_t *virtio_net = nic_get_specific(nic);
 	virtio_dev_t *vdev = &virtio_net->virtio_dev;
 
-	if (size > sizeof(virtio_net) + TX_BUF_SIZE) {
+	if (size > TX_BUF_SIZE - sizeof(virtio_net_hdr_t)) {
 		ddf_msg(LVL_WARN, "TX data too big, frame dropped");
+		nic_report_send_error(nic, NIC_SEC_OTHER, 1);
 		return;
 	}
 
+	fibril_mutex_lock(&virtio_net->tx_lock);
+
+	virtio_net_tx_reclaim(nic);
+
 	uint16_t descno = virtio_alloc_desc(vdev, TX_QUEUE_1,
 	    &virtio_net->tx_free_head);
 	if (descno == (uint16_t) -1U) {
-		ddf_msg(LVL_WARN, "No TX buffers available, frame dropped");
+		/*
+		 * Stop accepting frames and let the device interrupt us once
+		 * it completes some of the pending ones.
+		 */
+		virtio_net->tx_stopped = true;
+		nic_set_tx_busy(nic, 1);
+		if (virtio_virtq_irq_enable(vdev, TX_QUEUE_1)) {
+			virtio_net_tx_reclaim(nic);
+			descno = virtio_alloc_desc(vdev, TX_QUEUE_1,
+			    &virtio_net->tx_free_head);
+		}
+	}
+
+	if (descno == (uint16_t) -1U) {
+		fibril_mutex_unlock(&virtio_net->tx_lock);
+		ddf_msg(LVL_DEBUG, "No TX buffers available, frame dropped");
+		nic_report_send_error(nic, NIC_SEC_BUFFER_FULL, 1);
 		return;
 	}
 	assert(descno < TX_BUFFERS);
@@ -353,10 +548,71 @@ static void virtio_net_send(nic_t *nic, void *data, size_t size)
 
 	/*
 	 * Set the descriptor, put it into the virtqueue and notify the device
+	 * unless it is still busy with the previously sent frames.
 	 */
 	virtio_virtq_desc_set(vdev, TX_QUEUE_1, descno,
 	    virtio_net->tx_buf_p[descno], sizeof(virtio_net_hdr_t) + size, 0, 0);
 	virtio_virtq_produce_available(vdev, TX_QUEUE_1, descno);
+
+	fibril_mutex_unlock(&virtio_net->tx_lock);
+}
+
+/** Set polling mode
+ *
+ * Periodic polling is left to the NIC framework which falls back to
+ * software periodic polling in combination with NIC_POLL_ON_DEMAND.
+ *
+ * @param nic     NIC
+ * @param mode    Mode to set
+ * @param period  Period for NIC_POLL_PERIODIC
+ *
+ * @return EOK if succeed
+ * @return ENOTSUP if the mode is not supported
+ */
+static errno_t virtio_net_poll_mode_change(nic_t *nic, nic_poll_mode_t mode,
+    const struct timespec *period)
+{
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+
+	switch (mode) {
+	case NIC_POLL_IMMEDIATE:
+		fibril_mutex_lock(&virtio_net->rx_lock);
+		virtio_net->rx_irq = true;
+		fibril_mutex_unlock(&virtio_net->rx_lock);
+
+		/* Receive frames which arrived while polling */
+		virtio_net_rx_irq(nic);
+		break;
+	case NIC_POLL_ON_DEMAND:
+		fibril_mutex_lock(&virtio_net->rx_lock);
+		virtio_net->rx_irq = false;
+		virtio_virtq_irq_disable(vdev, RX_QUEUE_1);
+		fibril_mutex_unlock(&virtio_net->rx_lock);
+		break;
+	default:
+		return ENOTSUP;
+	}
+
+	return EOK;
+}
+
+/** Receive all frames waiting in the RX queue
+ *
+ * @param nic  NIC
+ */
+static void virtio_net_poll(nic_t *nic)
+{
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+
+	fibril_mutex_lock(&virtio_net->tx_lock);
+	virtio_net_tx_reclaim(nic);
+	fibril_mutex_unlock(&virtio_net->tx_lock);
+
+	fibril_mutex_lock(&virtio_net->rx_lock);
+	while (virtio_net_rx(nic, RX_BUDGET) == RX_BUDGET)
+		;
+	fibril_mutex_unlock(&virtio_net->rx_lock);
 }
 
 static errno_t virtio_net_on_multicast_mode_change(nic_t *nic,
@@ -411,6 +667,8 @@ static errno_t virtio_net_dev_add(ddf_dev_t *dev)
 	ddf_fun_set_ops(fun, &virtio_net_dev_ops);
 
 	nic_set_send_frame_handler(nic, virtio_net_send);
+	nic_set_poll_handlers(nic, virtio_net_poll_mode_change,
+	    virtio_net_poll);
 	nic_set_filtering_change_handlers(nic, NULL,
 	    virtio_net_on_multicast_mode_change,
 	    virtio_net_on_broadcast_mode_change, NULL, NULL);
@@ -31,10 +31,12 @@
 
 #include <virtio-pci.h>
 #include <abi/cap.h>
+#include <fibril_synch.h>
 #include <nic/nic.h>
+#include <stdbool.h>
 
-#define RX_BUFFERS	8
-#define TX_BUFFERS	8
+#define RX_BUFFERS	64
+#define TX_BUFFERS	64
 #define CT_BUFFERS	4
 
 /** Device handles packets with partial checksum. */
@@ -43,9 +45,14 @@
 #define VIRTIO_NET_F_GUEST_CSUM		(1U << 2)
 /** Device has given MAC address. */
 #define VIRTIO_NET_F_MAC		(1U << 5)
+/** Driver can merge receive buffers. */
+#define VIRTIO_NET_F_MRG_RXBUF		(1U << 15)
 /** Control channel is available */
 #define VIRTIO_NET_F_CTRL_VQ		(1U << 17)
 
+/** Checksum of the packet needs to be completed */
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM	1
+
 #define VIRTIO_NET_HDR_GSO_NONE 0
 typedef struct {
 	uint8_t flags;
@@ -73,6 +80,16 @@ typedef struct {
 	uint16_t tx_free_head;
 	uint16_t ct_free_head;
 
+	/** Serializes processing of the RX queue */
+	fibril_mutex_t rx_lock;
+	/** RX interrupts are in use (not polling on demand) */
+	bool rx_irq;
+
+	/** Serializes TX descriptor allocation and reclamation */
+	fibril_mutex_t tx_lock;
+	/** TX is stopped until the device completes some frames */
+	bool tx_stopped;
+
 	int irq;
 	cap_irq_handle_t irq_handle;
 } virtio_net_t;
@@ -43,6 +43,7 @@
 #include <as.h>
 #include <assert.h>
 #include <bd.h>
+#include <fibril.h>
 #include <fibril_synch.h>
 #include <adt/list.h>
 #include <adt/hash_table.h>
@@ -54,24 +55,99 @@
 #include <str_error.h>
 #include <offset.h>
 #include <inttypes.h>
+#include <time.h>
 #include "block.h"
 
 #define MAX_WRITE_RETRIES 10
 
+/** Number of shards the cache of a device is split into. */
+#define CACHE_SHARDS  8
+
+/** Size of the cache if the client does not set the number of blocks. */
+#define CACHE_DEFAULT_SIZE  (2 * 1024 * 1024)
+
+/** Minimum number of blocks a cache shard keeps. */
+#define SHARD_MIN_BLOCKS  4
+
+/** Default age of a dirty block that triggers its writeback (usec). */
+#define FLUSH_DEFAULT_AGE  5000000
+
+/** Default percentage of dirty blocks that triggers writeback. */
+#define FLUSH_DEFAULT_RATIO  25
+
+/** Maximum number of blocks written back at once. */
+#define FLUSH_BATCH  256
+
+/** Maximum size of a single coalesced writeback request. */
+#define FLUSH_MAX_BYTES  (128 * 1024)
+
+/** Number of sequential access streams tracked per device. */
+#define RA_STREAMS  4
+
+/** Initial readahead window of a sequential stream (blocks). */
+#define RA_MIN_WINDOW  4
+
+/** Maximum size of a single readahead request. */
+#define RA_MAX_BYTES  (128 * 1024)
+
 /** Lock protecting the device connection list */
 static FIBRIL_MUTEX_INITIALIZE(dcl_lock);
 /** Device connection list head. */
 static LIST_INITIALIZE(dcl);
 
+/** Part of the block cache holding the blocks of some of the addresses.
+ *
+ * Unreferenced blocks are kept on two LRU lists. A block enters the cache on
+ * the probation list and moves to the protected list once it is looked up
+ * again, so that blocks used only once (e.g. by a large sequential read) are
+ * recycled before the working set of the file system.
+ */
 typedef struct {
 	fibril_mutex_t lock;
+	unsigned capacity;        /**< Number of blocks to keep cached. */
+	unsigned blocks_cached;   /**< Number of cached blocks. */
+	hash_table_t block_hash;
+	list_t probation;         /**< Blocks looked up once, LRU first. */
+	list_t protected;         /**< Blocks looked up again, LRU first. */
+	unsigned protected_count; /**< Number of blocks on the protected list. */
+	list_t dirty_list;        /**< Dirty blocks, oldest first. */
+	unsigned dirty_count;     /**< Number of blocks on the dirty list. */
+} cache_shard_t;
+
+/** Sequential access stream. */
+typedef struct {
+	aoff64_t next;            /**< Address of the block expected next. */
+	size_t window;            /**< Blocks to read ahead on the next miss. */
+	unsigned stamp;           /**< Time of the last access to the stream. */
+} ra_stream_t;
+
+typedef struct {
 	size_t lblock_size;       /**< Logical block size. */
 	unsigned blocks_cluster;  /**< Physical blocks per block_t */
 	unsigned block_count;     /**< Total number of blocks. */
-	unsigned blocks_cached;   /**< Number of cached blocks. */
-	hash_table_t block_hash;
-	list_t free_list;
 	enum cache_mode mode;
+	/** Shards of the cache, selected by the logical block address. */
+	cache_shard_t shards[CACHE_SHARDS];
+
+	/** Lock protecting the writeback parameters and the flusher state. */
+	fibril_mutex_t flush_lock;
+	/** Condition variable waking up the flusher fibril. */
+	fibril_condvar_t flush_cv;
+	usec_t flush_age;         /**< Age of a dirty block to write it back. */
+	unsigned flush_ratio;     /**< Percentage of dirty blocks to write back. */
+	bool flush_stop;          /**< The flusher fibril should terminate. */
+	bool flush_running;       /**< The flusher fibril is running. */
+	/** Blocks being written back by the flusher. */
+	block_t *flush_batch[FLUSH_BATCH];
+
+	/** Lock protecting the sequential access streams. */
+	fibril_mutex_t ra_lock;
+	/** Sequential access streams detected on the device. */
+	ra_stream_t ra_streams[RA_STREAMS];
+	/** Counter for stamping the streams. */
+	unsigned ra_clock;
+	/** Maximum readahead window (blocks). */
+	size_t ra_max;
 } cache_t;
 
 typedef struct {
@@ -267,40 +343,397 @@ static hash_table_ops_t cache_ops = {
 	.remove_callback = NULL
 };
 
+/** Get the cache shard holding the block with the given logical address. */
+static cache_shard_t *cache_shard(cache_t *cache, aoff64_t lba)
+{
+	return &cache->shards[lba % CACHE_SHARDS];
+}
+
+/** Take an unreferenced block off the LRU lists of its shard. */
+static void lru_remove(cache_shard_t *shard, block_t *b)
+{
+	list_remove(&b->free_link);
+	if (b->referenced)
+		shard->protected_count--;
+}
+
+/** Put a block which is no longer referenced on the LRU lists of its shard. */
+static void lru_insert(cache_shard_t *shard, block_t *b)
+{
+	if (!b->referenced) {
+		list_append(&b->free_link, &shard->probation);
+		return;
+	}
+
+	list_append(&b->free_link, &shard->protected);
+	shard->protected_count++;
+
+	/*
+	 * Leave at least a quarter of the shard to the probation list so that
+	 * newly read blocks get a chance to be looked up again.
+	 */
+	if (shard->protected_count > shard->capacity - shard->capacity / 4) {
+		block_t *old = list_get_instance(list_first(&shard->protected),
+		    block_t, free_link);
+
+		list_remove(&old->free_link);
+		shard->protected_count--;
+		old->referenced = false;
+		list_append(&old->free_link, &shard->probation);
+	}
+}
+
+/** Get the unreferenced block of a shard which is the best to recycle. */
+static block_t *lru_victim(cache_shard_t *shard)
+{
+	link_t *link = list_first(&shard->probation);
+	if (!link)
+		link = list_first(&shard->protected);
+	if (!link)
+		return NULL;
+
+	return list_get_instance(link, block_t, free_link);
+}
+
+/** Take a block off the dirty list of its shard. */
+static void dirty_remove(cache_shard_t *shard, block_t *b)
+{
+	if (link_in_use(&b->dirty_link)) {
+		list_remove(&b->dirty_link);
+		shard->dirty_count--;
+	}
+}
+
+/** Put a dirty block which is no longer referenced on the dirty list.
+ *
+ * The flusher fibril is woken up if the shard has too many dirty blocks.
+ */
+static void dirty_insert(cache_t *cache, cache_shard_t *shard, block_t *b)
+{
+	if (link_in_use(&b->dirty_link))
+		return;
+
+	getuptime(&b->dirty_time);
+	list_append(&b->dirty_link, &shard->dirty_list);
+	shard->dirty_count++;
+
+	if (shard->dirty_count * 100 > shard->capacity * cache->flush_ratio)
+		fibril_condvar_signal(&cache->flush_cv);
+}
+
+/** Compare blocks by their physical address, for qsort(). */
+static int block_pba_cmp(const void *a, const void *b)
+{
+	aoff64_t pa = (*(block_t * const *) a)->pba;
+	aoff64_t pb = (*(block_t * const *) b)->pba;
+
+	if (pa < pb)
+		return -1;
+	return (pa > pb) ? 1 : 0;
+}
+
+/** Take the dirty blocks which are due for writeback.
+ *
+ * Blocks which have been dirty for too long are taken from all shards, as well
+ * as the oldest blocks of shards with too many dirty blocks until the ratio is
+ * met again. Only unreferenced blocks are taken, each gets a reference on
+ * behalf of the caller.
+ *
+ * @param cache		Cache to take the blocks from.
+ * @param all		If true, take all dirty unreferenced blocks.
+ * @param batch		Array for storing the blocks.
+ * @param max		Size of the array.
+ *
+ * @return		Number of blocks taken.
+ */
+static size_t cache_take_dirty(cache_t *cache, bool all, block_t **batch,
+    size_t max)
+{
+	struct timespec now;
+	size_t cnt = 0;
+
+	getuptime(&now);
+
+	for (unsigned i = 0; i < CACHE_SHARDS && cnt < max; i++) {
+		cache_shard_t *shard = &cache->shards[i];
+
+		fibril_mutex_lock(&shard->lock);
+
+		list_foreach_safe(shard->dirty_list, cur, next) {
+			block_t *b = list_get_instance(cur, block_t, dirty_link);
+			bool over = shard->dirty_count * 100 >
+			    shard->capacity * cache->flush_ratio;
+
+			if (cnt == max)
+				break;
+			if (!all && !over && NSEC2USEC(ts_sub_diff(&now,
+			    &b->dirty_time)) < cache->flush_age)
+				break;
+
+			fibril_mutex_lock(&b->lock);
+			if (b->refcnt == 0) {
+				dirty_remove(shard, b);
+				if (b->dirty && !b->toxic) {
+					lru_remove(shard, b);
+					b->refcnt++;
+					batch[cnt++] = b;
+				}
+			}
+			fibril_mutex_unlock(&b->lock);
+		}
+
+		fibril_mutex_unlock(&shard->lock);
+	}
+
+	return cnt;
+}
+
+/** Write back blocks with consecutive physical addresses in one request.
+ *
+ * The caller must hold a reference to the blocks. A single block is written
+ * with its lock held, so that it cannot be referenced and modified meanwhile.
+ * Otherwise the data are gathered in a bounce buffer and the blocks are free
+ * to be modified again while the request is in progress.
+ *
+ * @param devcon	Device connection.
+ * @param run		Blocks to write back.
+ * @param cnt		Number of blocks.
+ */
+static void cache_write_run(devcon_t *devcon, block_t **run, size_t cnt)
+{
+	cache_t *cache = devcon->cache;
+	size_t size = cache->lblock_size;
+	void *buf = NULL;
+	errno_t rc;
+
+	if (cnt > 1) {
+		buf = malloc(cnt * size);
+		if (!buf) {
+			for (size_t i = 0; i < cnt; i++)
+				cache_write_run(devcon, &run[i], 1);
+			return;
+		}
+	}
+
+	for (size_t i = 0; i < cnt; i++) {
+		fibril_mutex_lock(&run[i]->lock);
+		run[i]->dirty = false;
+		if (buf) {
+			memcpy(buf + i * size, run[i]->data, size);
+			fibril_mutex_unlock(&run[i]->lock);
+		}
+	}
+
+	rc = write_blocks(devcon, run[0]->pba, cnt * cache->blocks_cluster,
+	    buf ? buf : run[0]->data, cnt * size);
+
+	for (size_t i = 0; i < cnt; i++) {
+		block_t *b = run[i];
+
+		if (buf)
+			fibril_mutex_lock(&b->lock);
+		if (rc == EOK) {
+			b->write_failures = 0;
+		} else if (b->write_failures < MAX_WRITE_RETRIES) {
+			/* Try again during one of the next writebacks. */
+			b->write_failures++;
+			b->dirty = true;
+		} else {
+			printf("Too many errors writing block %"
+			    PRIuOFF64 "from device handle %" PRIun "\n"
+			    "SEVERE DATA LOSS POSSIBLE\n",
+			    b->lba, devcon->service_id);
+		}
+		fibril_mutex_unlock(&b->lock);
+	}
+
+	free(buf);
+}
+
+/** Write back dirty blocks of a write-back cache.
+ *
+ * The blocks are sorted by their physical address and blocks with consecutive
+ * addresses are written back in a single request.
+ *
+ * @param devcon	Device connection.
+ * @param all		If true, write back all dirty blocks which are not in
+ *			use, not only those which are due.
+ */
+static void cache_flush(devcon_t *devcon, bool all)
+{
+	cache_t *cache = devcon->cache;
+	block_t **batch = cache->flush_batch;
+	size_t max_run = max(FLUSH_MAX_BYTES / cache->lblock_size, 1);
+	size_t cnt;
+
+	do {
+		cnt = cache_take_dirty(cache, all, batch, FLUSH_BATCH);
+
+		qsort(batch, cnt, sizeof(block_t *), block_pba_cmp);
+
+		size_t i = 0;
+		while (i < cnt) {
+			size_t n = 1;
+
+			while (i + n < cnt && n < max_run &&
+			    batch[i + n]->pba ==
+			    batch[i + n - 1]->pba + cache->blocks_cluster)
+				n++;
+
+			cache_write_run(devcon, &batch[i], n);
+			i += n;
+		}
+
+		for (i = 0; i < cnt; i++)
+			(void) block_put(batch[i]);
+	} while (cnt == FLUSH_BATCH);
+}
+
+/** Fibril writing back dirty blocks of a write-back cache. */
+static errno_t cache_flusher(void *arg)
+{
+	devcon_t *devcon = (devcon_t *) arg;
+	cache_t *cache = devcon->cache;
+
+	fibril_mutex_lock(&cache->flush_lock);
+	while (!cache->flush_stop) {
+		(void) fibril_condvar_wait_timeout(&cache->flush_cv,
+		    &cache->flush_lock, cache->flush_age / 2);
+		if (cache->flush_stop)
+			break;
+
+		fibril_mutex_unlock(&cache->flush_lock);
+		cache_flush(devcon, false);
+		fibril_mutex_lock(&cache->flush_lock);
+	}
+
+	cache->flush_running = false;
+	fibril_condvar_broadcast(&cache->flush_cv);
+	fibril_mutex_unlock(&cache->flush_lock);
+
+	return EOK;
+}
+
+/** Initialize the block cache of a device.
+ *
+ * @param service_id		Service ID of the block device.
+ * @param size			Logical block size.
+ * @param blocks		Number of blocks to keep cached or zero for
+ *				a default based on the block size.
+ * @param mode			Caching mode. In the write-back mode, a fibril
+ *				writes back dirty blocks in the background, see
+ *				block_cache_set_writeback().
+ *
+ * @return			EOK on success or an error code.
+ */
 errno_t block_cache_init(service_id_t service_id, size_t size, unsigned blocks,
     enum cache_mode mode)
 {
 	devcon_t *devcon = devcon_search(service_id);
 	cache_t *cache;
+	unsigned i;
+
 	if (!devcon)
 		return ENOENT;
 	if (devcon->cache)
 		return EEXIST;
+
+	/* Allow 1:1 or small-to-large block size translation */
+	if (size == 0 || size % devcon->pblock_size != 0)
+		return ENOTSUP;
+
 	cache = malloc(sizeof(cache_t));
 	if (!cache)
 		return ENOMEM;
 
-	fibril_mutex_initialize(&cache->lock);
-	list_initialize(&cache->free_list);
+	if (blocks == 0) {
+		blocks = max(CACHE_DEFAULT_SIZE / size,
+		    CACHE_SHARDS * SHARD_MIN_BLOCKS);
+	}
+
 	cache->lblock_size = size;
 	cache->block_count = blocks;
-	cache->blocks_cached = 0;
 	cache->mode = mode;
+	cache->blocks_cluster = cache->lblock_size / devcon->pblock_size;
 
-	/* Allow 1:1 or small-to-large block size translation */
-	if (cache->lblock_size % devcon->pblock_size != 0) {
-		free(cache);
-		return ENOTSUP;
+	for (i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shards[i];
+
+		fibril_mutex_initialize(&shard->lock);
+		shard->capacity = max(blocks / CACHE_SHARDS, SHARD_MIN_BLOCKS);
+		shard->blocks_cached = 0;
+		list_initialize(&shard->probation);
+		list_initialize(&shard->protected);
+		shard->protected_count = 0;
+		list_initialize(&shard->dirty_list);
+		shard->dirty_count = 0;
+
+		if (!hash_table_create(&shard->block_hash, 0, 0, &cache_ops)) {
+			while (i-- > 0)
+				hash_table_destroy(&cache->shards[i].block_hash);
+			free(cache);
+			return ENOMEM;
+		}
 	}
 
-	cache->blocks_cluster = cache->lblock_size / devcon->pblock_size;
+	fibril_mutex_initialize(&cache->flush_lock);
+	fibril_condvar_initialize(&cache->flush_cv);
+	cache->flush_age = FLUSH_DEFAULT_AGE;
+	cache->flush_ratio = FLUSH_DEFAULT_RATIO;
+	cache->flush_stop = false;
+	cache->flush_running = false;
 
-	if (!hash_table_create(&cache->block_hash, 0, 0, &cache_ops)) {
-		free(cache);
-		return ENOMEM;
-	}
+	fibril_mutex_initialize(&cache->ra_lock);
+	memset(cache->ra_streams, 0, sizeof(cache->ra_streams));
+	cache->ra_clock = 0;
+	cache->ra_max = max(min(RA_MAX_BYTES / size, blocks / 4), 1);
 
 	devcon->cache = cache;
+
+	if (mode == CACHE_MODE_WB) {
+		fid_t fid = fibril_create(cache_flusher, devcon);
+		if (fid) {
+			cache->flush_running = true;
+			fibril_add_ready(fid);
+		}
+	}
+
+	return EOK;
+}
+
+/** Set the writeback parameters of a write-back cache.
+ *
+ * A dirty block is written back once it has been dirty for @a age, or earlier
+ * if more than @a ratio percent of the blocks of its cache shard are dirty.
+ * A zero @a age or @a ratio leaves the respective parameter unchanged.
+ *
+ * @param service_id		Service ID of the block device.
+ * @param age			Age of a dirty block to write it back (usec).
+ * @param ratio			Percentage of dirty blocks to write them back.
+ *
+ * @return			EOK on success or an error code.
+ */
+errno_t block_cache_set_writeback(service_id_t service_id, usec_t age,
+    unsigned ratio)
+{
+	devcon_t *devcon = devcon_search(service_id);
+	cache_t *cache;
+
+	if (!devcon || !devcon->cache)
+		return ENOENT;
+	if (age == 1 || ratio > 100)
+		return EINVAL;
+
+	cache = devcon->cache;
+
+	fibril_mutex_lock(&cache->flush_lock);
+	if (age != 0)
+		cache->flush_age = age;
+	if (ratio != 0)
+		cache->flush_ratio = ratio;
+	fibril_condvar_broadcast(&cache->flush_cv);
+	fibril_mutex_unlock(&cache->flush_lock);
+
 	return EOK;
 }
 
@@ -316,43 +749,57 @@ errno_t block_cache_fini(service_id_t service_id)
 		return EOK;
 	cache = devcon->cache;
 
+	/* Stop the flusher and write back everything in large requests. */
+	fibril_mutex_lock(&cache->flush_lock);
+	cache->flush_stop = true;
+	fibril_condvar_broadcast(&cache->flush_cv);
+	while (cache->flush_running)
+		fibril_condvar_wait(&cache->flush_cv, &cache->flush_lock);
+	fibril_mutex_unlock(&cache->flush_lock);
+
+	if (cache->mode == CACHE_MODE_WB)
+		cache_flush(devcon, true);
+
 	/*
 	 * We are expecting to find all blocks for this device handle on the
-	 * free list, i.e. the block reference count should be zero. Do not
+	 * LRU lists, i.e. the block reference count should be zero. Do not
 	 * bother with the cache and block locks because we are single-threaded.
 	 */
-	while (!list_empty(&cache->free_list)) {
-		block_t *b = list_get_instance(list_first(&cache->free_list),
-		    block_t, free_link);
+	for (unsigned i = 0; i < CACHE_SHARDS; i++) {
+		cache_shard_t *shard = &cache->shards[i];
+		block_t *b;
 
-		list_remove(&b->free_link);
-		if (b->dirty) {
-			rc = write_blocks(devcon, b->pba, cache->blocks_cluster,
-			    b->data, b->size);
-			if (rc != EOK)
-				return rc;
-		}
+		while ((b = lru_victim(shard)) != NULL) {
+			lru_remove(shard, b);
+			dirty_remove(shard, b);
+			if (b->dirty) {
+				rc = write_blocks(devcon, b->pba,
+				    cache->blocks_cluster, b->data, b->size);
+				if (rc != EOK)
+					return rc;
+			}
 
-		hash_table_remove_item(&cache->block_hash, &b->hash_link);
+			hash_table_remove_item(&shard->block_hash,
+			    &b->hash_link);
 
-		free(b->data);
-		free(b);
+			free(b->data);
+			free(b);
+		}
+
+		hash_table_destroy(&shard->block_hash);
 	}
 
-	hash_table_destroy(&cache->block_hash);
 	devcon->cache = NULL;
 	free(cache);
 
 	return EOK;
 }
 
-#define CACHE_LO_WATERMARK	10
-#define CACHE_HI_WATERMARK	20
-static bool cache_can_grow(cache_t *cache)
+static bool cache_can_grow(cache_shard_t *shard)
 {
-	if (cache->blocks_cached < CACHE_LO_WATERMARK)
+	if (shard->blocks_cached < shard->capacity)
 		return true;
-	if (!list_empty(&cache->free_list))
+	if (lru_victim(shard) != NULL)
 		return false;
 	return true;
 }
@@ -364,8 +811,319 @@ static void block_initialize(block_t *b)
 	b->write_failures = 0;
 	b->dirty = false;
 	b->toxic = false;
+	b->referenced = false;
+	b->readahead = false;
+	b->unread = false;
 	fibril_rwlock_initialize(&b->contents_lock);
 	link_initialize(&b->free_link);
+	link_initialize(&b->dirty_link);
+}
+
+/** Note an access to a block in the sequential access streams.
+ *
+ * An access to the block expected next by one of the streams continues the
+ * stream, any other access starts a new stream in place of the least recently
+ * used one. Each miss within a stream doubles its readahead window.
+ *
+ * @param cache			Cache of the device.
+ * @param ba			Logical address of the block.
+ * @param miss			If true, the block was not in the cache.
+ *
+ * @return			Number of blocks following @a ba to read ahead.
+ */
+static size_t ra_update(cache_t *cache, aoff64_t ba, bool miss)
+{
+	ra_stream_t *s = NULL;
+	ra_stream_t *oldest = &cache->ra_streams[0];
+	size_t window = 0;
+
+	fibril_mutex_lock(&cache->ra_lock);
+
+	for (unsigned i = 0; i < RA_STREAMS; i++) {
+		ra_stream_t *cur = &cache->ra_streams[i];
+
+		if (cur->window > 0 && cur->next == ba) {
+			s = cur;
+			break;
+		}
+		if (cur->stamp < oldest->stamp)
+			oldest = cur;
+	}
+
+	if (s) {
+		if (miss) {
+			window = s->window;
+			s->window = min(2 * s->window, cache->ra_max);
+		}
+	} else {
+		s = oldest;
+		s->window = min(RA_MIN_WINDOW, cache->ra_max);
+	}
+
+	s->next = ba + 1;
+	s->stamp = ++cache->ra_clock;
+
+	fibril_mutex_unlock(&cache->ra_lock);
+
+	return window;
+}
+
+/** Instantiate a block to be read ahead.
+ *
+ * The block is only instantiated if it is not cached yet and this does not
+ * require waiting or writing back another block. A shard which is full only
+ * recycles blocks from its probation list for readahead.
+ *
+ * @param devcon		Device connection.
+ * @param ba			Logical address of the block.
+ *
+ * @return			Referenced and locked block whose data need to
+ *				be read, or NULL.
+ */
+static block_t *ra_block_get(devcon_t *devcon, aoff64_t ba)
+{
+	cache_t *cache = devcon->cache;
+	cache_shard_t *shard = cache_shard(cache, ba);
+	block_t *b = NULL;
+
+	if (ba_ltop(devcon, ba) + cache->blocks_cluster > devcon->pblocks)
+		return NULL;
+
+	/*
+	 * The caller may hold locks of blocks that fibrils holding the shard
+	 * lock are waiting for, so do not wait for it.
+	 */
+	if (!fibril_mutex_trylock(&shard->lock))
+		return NULL;
+
+	if (hash_table_find(&shard->block_hash, &ba)) {
+		fibril_mutex_unlock(&shard->lock);
+		return NULL;
+	}
+
+	if (shard->blocks_cached < shard->capacity) {
+		b = malloc(sizeof(block_t));
+		if (b) {
+			b->data = malloc(cache->lblock_size);
+			if (b->data) {
+				shard->blocks_cached++;
+			} else {
+				free(b);
+				b = NULL;
+			}
+		}
+	} else if (!list_empty(&shard->probation)) {
+		b = list_get_instance(list_first(&shard->probation), block_t,
+		    free_link);
+		if (fibril_mutex_trylock(&b->lock)) {
+			bool dirty = b->dirty;
+			fibril_mutex_unlock(&b->lock);
+			if (dirty)
+				b = NULL;
+		} else {
+			b = NULL;
+		}
+
+		if (b) {
+			lru_remove(shard, b);
+			dirty_remove(shard, b);
+			hash_table_remove_item(&shard->block_hash,
+			    &b->hash_link);
+		}
+	}
+
+	if (b) {
+		block_initialize(b);
+		b->readahead = true;
+		b->service_id = devcon->service_id;
+		b->size = cache->lblock_size;
+		b->lba = ba;
+		b->pba = ba_ltop(devcon, b->lba);
+		hash_table_insert(&shard->block_hash, &b->hash_link);
+		fibril_mutex_lock(&b->lock);
+	}
+
+	fibril_mutex_unlock(&shard->lock);
+	return b;
+}
+
+/** Instantiate a run of blocks to be read ahead.
+ *
+ * @param devcon		Device connection.
+ * @param ba			Logical address of the first block.
+ * @param run			Array for storing the blocks.
+ * @param max			Maximum number of blocks.
+ *
+ * @return			Number of blocks instantiated, the run ends
+ *				before the first block which could not be.
+ */
+static size_t ra_run_get(devcon_t *devcon, aoff64_t ba, block_t **run,
+    size_t max)
+{
+	size_t cnt = 0;
+
+	while (cnt < max) {
+		run[cnt] = ra_block_get(devcon, ba + cnt);
+		if (!run[cnt])
+			break;
+		cnt++;
+	}
+
+	return cnt;
+}
+
+/** Read blocks with consecutive addresses in a single request.
+ *
+ * The blocks must be locked by the caller. Should the request fail, the blocks
+ * are read one by one. A block which cannot be read is marked toxic if it was
+ * requested. A block being read ahead is marked unread instead, so that it is
+ * dropped from the cache or read again when it is looked up.
+ *
+ * @param devcon		Device connection.
+ * @param run			Blocks to read.
+ * @param cnt			Number of blocks.
+ *
+ * @return			EOK if the first block was read or an error
+ *				code.
+ */
+static errno_t cache_read_run(devcon_t *devcon, block_t **run, size_t cnt)
+{
+	cache_t *cache = devcon->cache;
+	size_t size = cache->lblock_size;
+	errno_t rc = EOK;
+
+	if (cnt > 1) {
+		void *buf = malloc(cnt * size);
+		if (buf) {
+			rc = read_blocks(devcon, run[0]->pba,
+			    cnt * cache->blocks_cluster, buf, cnt * size);
+			if (rc == EOK) {
+				for (size_t i = 0; i < cnt; i++) {
+					memcpy(run[i]->data, buf + i * size,
+					    size);
+				}
+			}
+			free(buf);
+
+			if (rc == EOK)
+				return EOK;
+		}
+	}
+
+	for (size_t i = cnt; i-- > 0;) {
+		rc = read_blocks(devcon, run[i]->pba, cache->blocks_cluster,
+		    run[i]->data, size);
+		if (rc != EOK) {
+			if (run[i]->readahead) {
+				run[i]->readahead = false;
+				run[i]->unread = true;
+			} else {
+				run[i]->toxic = true;
+			}
+		}
+	}
+
+	return rc;
+}
+
+/** Release blocks read ahead.
+ *
+ * @param run			Locked blocks.
+ * @param cnt			Number of blocks.
+ */
+static void ra_run_put(block_t **run, size_t cnt)
+{
+	for (size_t i = 0; i < cnt; i++) {
+		fibril_mutex_unlock(&run[i]->lock);
+		(void) block_put(run[i]);
+	}
+}
+
+/** Read a block which is being instantiated, along with the following ones.
+ *
+ * @param devcon		Device connection.
+ * @param b			Locked block to read.
+ * @param window		Number of following blocks to read ahead.
+ *
+ * @return			EOK on success or an error code.
+ */
+static errno_t cache_read_ahead(devcon_t *devcon, block_t *b, size_t window)
+{
+	block_t **run = NULL;
+	size_t cnt = 1;
+	errno_t rc;
+
+	if (window > 0)
+		run = malloc((1 + window) * sizeof(block_t *));
+
+	if (!run) {
+		rc = read_blocks(devcon, b->pba, devcon->cache->blocks_cluster,
+		    b->data, devcon->cache->lblock_size);
+		if (rc != EOK)
+			b->toxic = true;
+		return rc;
+	}
+
+	run[0] = b;
+	cnt += ra_run_get(devcon, b->lba + 1, &run[1], window);
+
+	rc = cache_read_run(devcon, run, cnt);
+	if (rc != EOK)
+		b->toxic = true;
+
+	ra_run_put(&run[1], cnt - 1);
+	free(run);
+
+	return rc;
+}
+
+/** Read a range of blocks into the cache ahead of their use.
+ *
+ * A client which knows it is going to read a range of blocks (e.g. a cluster
+ * or an extent of a file) can have the blocks which are not cached yet read
+ * with large requests. Blocks which cannot be cached without waiting or
+ * evicting the working set are skipped.
+ *
+ * @param service_id		Service ID of the block device.
+ * @param ba			Address of the first block (logical).
+ * @param cnt			Number of blocks.
+ *
+ * @return			EOK on success or an error code.
+ */
+errno_t block_readahead(service_id_t service_id, aoff64_t ba, size_t cnt)
+{
+	devcon_t *devcon = devcon_search(service_id);
+	cache_t *cache;
+	block_t **run;
+	size_t chunk;
+
+	assert(devcon);
+	assert(devcon->cache);
+
+	cache = devcon->cache;
+	chunk = max(RA_MAX_BYTES / cache->lblock_size, 1);
+
+	run = malloc(chunk * sizeof(block_t *));
+	if (!run)
+		return ENOMEM;
+
+	while (cnt > 0) {
+		size_t n = ra_run_get(devcon, ba, run, min(cnt, chunk));
+
+		if (n == 0) {
+			/* Skip a block which is cached or cannot be. */
+			n = 1;
+		} else {
+			(void) cache_read_run(devcon, run, n);
+			ra_run_put(run, n);
+		}
+
+		ba += n;
+		cnt -= n;
+	}
+
+	free(run);
+	return EOK;
 }
 
 /** Instantiate a block in memory and get a reference to it.
@@ -384,9 +1142,11 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 {
 	devcon_t *devcon;
 	cache_t *cache;
+	cache_shard_t *shard;
 	block_t *b;
-	link_t *link;
 	aoff64_t p_ba;
+	bool prefetched;
+	bool unread;
 	errno_t rc;
 
 	devcon = devcon_search(service_id);
@@ -395,6 +1155,7 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 	assert(devcon->cache);
 
 	cache = devcon->cache;
+	shard = cache_shard(cache, ba);
 
 	/*
 	 * Check whether the logical block (or part of it) is beyond
@@ -410,9 +1171,11 @@ errno_t block_get(block_t **block, service_id_t service_id, aoff64_t ba, int fla
 retry:
 	rc = EOK;
 	b = NULL;
+	prefetched = false;
+	unread = false;
 
-	fibril_mutex_lock(&cache->lock);
-	ht_link_t *hlink = hash_table_find(&cache->block_hash, &ba);
+	fibril_mutex_lock(&shard->lock);
+	ht_link_t *hlink = hash_table_find(&shard->block_hash, &ba);
 	if (hlink) {
 	found:
 		/*
@@ -421,16 +1184,45 @@ retry:
 		b = hash_table_get_inst(hlink, block_t, hash_link);
 		fibril_mutex_lock(&b->lock);
 		if (b->refcnt++ == 0)
-			list_remove(&b->free_link);
+			lru_remove(shard, b);
+		if (b->readahead) {
+			/*
+			 * The first lookup of a block read ahead is not
+			 * a repeated one, but it continues a stream.
+			 */
+			b->readahead = false;
+			prefetched = true;
+		} else
+			b->referenced = true;
 		if (b->toxic)
 			rc = EIO;
+		unread = b->unread;
 		fibril_mutex_unlock(&b->lock);
-		fibril_mutex_unlock(&cache->lock);
+		fibril_mutex_unlock(&shard->lock);
+
+		if (prefetched)
+			(void) ra_update(cache, ba, false);
+
+		if (unread) {
+			/*
+			 * Reading the block ahead failed. Read it now to
+			 * report the error, unless it has been read already.
+			 */
+			fibril_mutex_lock(&b->lock);
+			if (b->unread && !(flags & BLOCK_FLAGS_NOREAD)) {
+				rc = read_blocks(devcon, b->pba,
+				    cache->blocks_cluster, b->data, b->size);
+				if (rc != EOK)
+					b->toxic = true;
+			}
+			b->unread = false;
+			fibril_mutex_unlock(&b->lock);
+		}
 	} else {
 		/*
 		 * The block was not found in the cache.
 		 */
-		if (cache_can_grow(cache)) {
+		if (cache_can_grow(shard)) {
 			/*
 			 * We can grow the cache by allocating new blocks.
 			 * Should the allocation fail, we fail over and try to
@@ -445,34 +1237,33 @@ retry:
 				b = NULL;
 				goto recycle;
 			}
-			cache->blocks_cached++;
+			shard->blocks_cached++;
 		} else {
 			/*
-			 * Try to recycle a block from the free list.
+			 * Try to recycle a block from the LRU lists.
 			 */
 		recycle:
-			if (list_empty(&cache->free_list)) {
-				fibril_mutex_unlock(&cache->lock);
+			b = lru_victim(shard);
+			if (!b) {
+				fibril_mutex_unlock(&shard->lock);
 				rc = ENOMEM;
 				goto out;
 			}
-			link = list_first(&cache->free_list);
-			b = list_get_instance(link, block_t, free_link);
 
 			fibril_mutex_lock(&b->lock);
 			if (b->dirty) {
 				/*
 				 * The block needs to be written back to the
 				 * device before it changes identity. Do this
-				 * while not holding the cache lock so that
+				 * while not holding the shard lock so that
 				 * concurrency is not impeded. Also move the
-				 * block to the end of the free list so that we
+				 * block to the end of its LRU list so that we
 				 * do not slow down other instances of
-				 * block_get() draining the free list.
+				 * block_get() recycling blocks.
 				 */
-				list_remove(&b->free_link);
-				list_append(&b->free_link, &cache->free_list);
-				fibril_mutex_unlock(&cache->lock);
+				lru_remove(shard, b);
+				lru_insert(shard, b);
+				fibril_mutex_unlock(&shard->lock);
 				rc = write_blocks(devcon, b->pba,
 				    cache->blocks_cluster, b->data, b->size);
 				if (rc != EOK) {
@@ -496,7 +1287,7 @@ retry:
 					b->write_failures = 0;
 
 				b->dirty = false;
-				if (!fibril_mutex_trylock(&cache->lock)) {
+				if (!fibril_mutex_trylock(&shard->lock)) {
 					/*
 					 * Somebody is probably racing with us.
 					 * Unlock the block and retry.
@@ -504,14 +1295,14 @@ retry:
 					fibril_mutex_unlock(&b->lock);
 					goto retry;
 				}
-				hlink = hash_table_find(&cache->block_hash, &ba);
+				hlink = hash_table_find(&shard->block_hash, &ba);
 				if (hlink) {
 					/*
 					 * Someone else must have already
 					 * instantiated the block while we were
-					 * not holding the cache lock.
+					 * not holding the shard lock.
 					 * Leave the recycled block on the
-					 * freelist and continue as if we
+					 * LRU list and continue as if we
 					 * found the block of interest during
 					 * the first try.
 					 */
@@ -523,11 +1314,12 @@ retry:
 			fibril_mutex_unlock(&b->lock);
 
 			/*
-			 * Unlink the block from the free list and the hash
-			 * table.
+			 * Unlink the block from the LRU and dirty lists and
+			 * the hash table.
 			 */
-			list_remove(&b->free_link);
-			hash_table_remove_item(&cache->block_hash, &b->hash_link);
+			lru_remove(shard, b);
+			dirty_remove(shard, b);
+			hash_table_remove_item(&shard->block_hash, &b->hash_link);
 		}
 
 		block_initialize(b);
@@ -535,25 +1327,25 @@ retry:
 		b->size = cache->lblock_size;
 		b->lba = ba;
 		b->pba = ba_ltop(devcon, b->lba);
-		hash_table_insert(&cache->block_hash, &b->hash_link);
+		hash_table_insert(&shard->block_hash, &b->hash_link);
 
 		/*
-		 * Lock the block before releasing the cache lock. Thus we don't
+		 * Lock the block before releasing the shard lock. Thus we don't
 		 * kill concurrent operations on the cache while doing I/O on
 		 * the block.
 		 */
 		fibril_mutex_lock(&b->lock);
-		fibril_mutex_unlock(&cache->lock);
+		fibril_mutex_unlock(&shard->lock);
 
 		if (!(flags & BLOCK_FLAGS_NOREAD)) {
 			/*
 			 * The block contains old or no data. We need to read
-			 * the new contents from the device.
+			 * the new contents from the device. If the block
+			 * continues a sequential stream, read the blocks
+			 * following it in the same request.
 			 */
-			rc = read_blocks(devcon, b->pba, cache->blocks_cluster,
-			    b->data, cache->lblock_size);
-			if (rc != EOK)
-				b->toxic = true;
+			rc = cache_read_ahead(devcon, b,
+			    ra_update(cache, ba, true));
 		} else
 			rc = EOK;
 
@@ -571,7 +1363,8 @@ out:
 
 /** Release a reference to a block.
  *
- * If the last reference is dropped, the block is put on the free list.
+ * If the last reference is dropped, the block is put on the LRU lists of its
+ * cache shard and, if it is dirty in the write-back mode, on the dirty list.
  *
  * @param block		Block of which a reference is to be released.
  *
@@ -581,6 +1374,7 @@ errno_t block_put(block_t *block)
 {
 	devcon_t *devcon = devcon_search(block->service_id);
 	cache_t *cache;
+	cache_shard_t *shard;
 	unsigned blocks_cached;
 	enum cache_mode mode;
 	errno_t rc = EOK;
@@ -590,25 +1384,26 @@ errno_t block_put(block_t *block)
 	assert(block->refcnt >= 1);
 
 	cache = devcon->cache;
+	shard = cache_shard(cache, block->lba);
 
 retry:
-	fibril_mutex_lock(&cache->lock);
-	blocks_cached = cache->blocks_cached;
+	fibril_mutex_lock(&shard->lock);
+	blocks_cached = shard->blocks_cached;
 	mode = cache->mode;
-	fibril_mutex_unlock(&cache->lock);
+	fibril_mutex_unlock(&shard->lock);
 
 	/*
 	 * Determine whether to sync the block. Syncing the block is best done
-	 * when not holding the cache lock as it does not impede concurrency.
-	 * Since the situation may have changed when we unlocked the cache, the
+	 * when not holding the shard lock as it does not impede concurrency.
+	 * Since the situation may have changed when we unlocked the shard, the
 	 * blocks_cached and mode variables are mere hints. We will recheck the
-	 * conditions later when the cache lock is held again.
+	 * conditions later when the shard lock is held again.
 	 */
 	fibril_mutex_lock(&block->lock);
 	if (block->toxic)
 		block->dirty = false;	/* will not write back toxic block */
 	if (block->dirty && (block->refcnt == 1) &&
-	    (blocks_cached > CACHE_HI_WATERMARK || mode != CACHE_MODE_WB)) {
+	    (blocks_cached > shard->capacity || mode != CACHE_MODE_WB)) {
 		rc = write_blocks(devcon, block->pba, cache->blocks_cluster,
 		    block->data, block->size);
 		if (rc == EOK)
@@ -617,32 +1412,32 @@ retry:
 	}
 	fibril_mutex_unlock(&block->lock);
 
-	fibril_mutex_lock(&cache->lock);
+	fibril_mutex_lock(&shard->lock);
 	fibril_mutex_lock(&block->lock);
 	if (!--block->refcnt) {
 		/*
 		 * Last reference to the block was dropped. Either free the
-		 * block or put it on the free list. In case of an I/O error,
+		 * block or put it on the LRU lists. In case of an I/O error,
 		 * free the block.
 		 */
-		if ((cache->blocks_cached > CACHE_HI_WATERMARK) ||
-		    (rc != EOK)) {
+		if ((shard->blocks_cached > shard->capacity) ||
+		    (rc != EOK) || block->unread) {
 			/*
-			 * Currently there are too many cached blocks or there
+			 * Currently there are too many cached blocks, there
 			 * was an I/O error when writing the block back to the
-			 * device.
+			 * device or the block could not be read ahead.
 			 */
 			if (block->dirty) {
 				/*
 				 * We cannot sync the block while holding the
-				 * cache lock. Release everything and retry.
+				 * shard lock. Release everything and retry.
 				 */
 				block->refcnt++;
 
 				if (block->write_failures < MAX_WRITE_RETRIES) {
 					block->write_failures++;
 					fibril_mutex_unlock(&block->lock);
-					fibril_mutex_unlock(&cache->lock);
+					fibril_mutex_unlock(&shard->lock);
 					goto retry;
 				} else {
 					printf("Too many errors writing block %"
@@ -654,31 +1449,34 @@ retry:
 			/*
 			 * Take the block out of the cache and free it.
 			 */
-			hash_table_remove_item(&cache->block_hash, &block->hash_link);
+			dirty_remove(shard, block);
+			hash_table_remove_item(&shard->block_hash, &block->hash_link);
 			fibril_mutex_unlock(&block->lock);
 			free(block->data);
 			free(block);
-			cache->blocks_cached--;
-			fibril_mutex_unlock(&cache->lock);
+			shard->blocks_cached--;
+			fibril_mutex_unlock(&shard->lock);
 			return rc;
 		}
 		/*
-		 * Put the block on the free list.
+		 * Put the block on the LRU lists.
 		 */
 		if (cache->mode != CACHE_MODE_WB && block->dirty) {
 			/*
-			 * We cannot sync the block while holding the cache
+			 * We cannot sync the block while holding the shard
 			 * lock. Release everything and retry.
 			 */
 			block->refcnt++;
 			fibril_mutex_unlock(&block->lock);
-			fibril_mutex_unlock(&cache->lock);
+			fibril_mutex_unlock(&shard->lock);
 			goto retry;
 		}
-		list_append(&block->free_link, &cache->free_list);
+		lru_insert(shard, block);
+		if (block->dirty)
+			dirty_insert(cache, shard, block);
 	}
 	fibril_mutex_unlock(&block->lock);
-	fibril_mutex_unlock(&cache->lock);
+	fibril_mutex_unlock(&shard->lock);
 
 	return rc;
 }
@@ -805,6 +1603,24 @@ errno_t block_sync_cache(service_id_t service_id, aoff64_t ba, size_t cnt)
 	return bd_sync_cache(devcon->bd, ba, cnt);
 }
 
+/** Discard blocks which no longer hold useful data.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of first block (physical).
+ * @param cnt		Number of blocks.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_discard(service_id_t service_id, aoff64_t ba, size_t cnt)
+{
+	devcon_t *devcon;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	return bd_discard(devcon->bd, ba, cnt);
+}
+
 /** Get device block size.
  *
  * @param service_id	Service ID of the block device.
@@ -44,6 +44,7 @@
 #include <adt/hash_table.h>
 #include <adt/list.h>
 #include <loc.h>
+#include <time.h>
 
 /*
  * Flags that can be used with block_get().
@@ -82,8 +83,18 @@ typedef struct block {
 	size_t size;
 	/** Number of write failures. */
 	int write_failures;
-	/** Link for placing the block into the free block list. */
+	/** If true, the block was looked up again after being cached. */
+	bool referenced;
+	/** If true, the block was read ahead and not looked up yet. */
+	bool readahead;
+	/** If true, reading the block ahead failed and it needs to be read. */
+	bool unread;
+	/** Link for placing the block into the LRU lists. */
 	link_t free_link;
+	/** Link for placing the block into the dirty block list. */
+	link_t dirty_link;
+	/** Time when the block was put on the dirty block list. */
+	struct timespec dirty_time;
 	/** Link for placing the block into the block hash table. */
 	ht_link_t hash_link;
 	/** Buffer with the block data. */
@@ -105,10 +116,12 @@ extern errno_t block_bb_read(service_id_t, aoff64_t);
 extern void *block_bb_get(service_id_t);
 
 extern errno_t block_cache_init(service_id_t, size_t, unsigned, enum cache_mode);
+extern errno_t block_cache_set_writeback(service_id_t, usec_t, unsigned);
 extern errno_t block_cache_fini(service_id_t);
 
 extern errno_t block_get(block_t **, service_id_t, aoff64_t, int);
 extern errno_t block_put(block_t *);
+extern errno_t block_readahead(service_id_t, aoff64_t, size_t);
 
 extern errno_t block_seqread(service_id_t, void *, size_t *, size_t *, aoff64_t *,
     void *, size_t);
@@ -120,6 +133,7 @@ extern errno_t block_read_direct(service_id_t, aoff64_t, size_t, void *);
 extern errno_t block_read_bytes_direct(service_id_t, aoff64_t, size_t, void *);
 extern errno_t block_write_direct(service_id_t, aoff64_t, size_t, const void *);
 extern errno_t block_sync_cache(service_id_t, aoff64_t, size_t);
+extern errno_t block_discard(service_id_t, aoff64_t, size_t);
 
 #endif
 
@@ -35,6 +35,12 @@
 #ifndef _LIBC_ia32_THREAD_H_
 #define _LIBC_ia32_THREAD_H_
 
+/** Tell the processor that we are busy waiting. */
+static inline void cpu_spin_hint(void)
+{
+	asm volatile ("pause");
+}
+
 #endif
 
 /** @}
@@ -36,6 +36,10 @@
 #ifndef _LIBC_mips32_THREAD_H_
 #define _LIBC_mips32_THREAD_H_
 
+static inline void cpu_spin_hint(void)
+{
+}
+
 #endif
 
 /** @}
@@ -35,6 +35,10 @@
 #ifndef _LIBC_ppc32_THREAD_H_
 #define _LIBC_ppc32_THREAD_H_
 
+static inline void cpu_spin_hint(void)
+{
+}
+
 #endif
 
 /** @}
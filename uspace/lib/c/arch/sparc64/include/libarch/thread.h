@@ -34,6 +34,10 @@
 #ifndef _LIBC_sparc64_THREAD_H_
 #define _LIBC_sparc64_THREAD_H_
 
+static inline void cpu_spin_hint(void)
+{
+}
+
 #endif
 
 /** @}
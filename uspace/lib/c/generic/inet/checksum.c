@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Internet checksum
+ *
+ * One's complement sum as per RFC 1071. The sum does not depend on byte
+ * order, so data is summed in host byte order, 64 bits at a time with
+ * end-around carry, and the result is converted to network byte order
+ * at the end.
+ */
+
+#include <assert.h>
+#include <byteorder.h>
+#include <inet/addr.h>
+#include <inet/checksum.h>
+#include <mem.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Add two 64-bit quantities with end-around carry.
+ *
+ * @param sum Partial sum
+ * @param w   Value to add
+ * @return    New partial sum
+ */
+static inline uint64_t inet_checksum_add64(uint64_t sum, uint64_t w)
+{
+	sum += w;
+	return sum + (sum < w);
+}
+
+/** Fold 64-bit partial sum to 16 bits.
+ *
+ * @param sum Partial sum
+ * @return    16-bit one's complement sum
+ */
+static uint16_t inet_checksum_fold(uint64_t sum)
+{
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return sum;
+}
+
+/** Compute Internet checksum.
+ *
+ * The computation can be split over several blocks of data by passing
+ * the result for the preceding blocks in @a ivalue. All blocks except
+ * the last one must be of even size.
+ *
+ * @param ivalue Initial value, @c INET_CHECKSUM_INIT or result of
+ *               preceding computation
+ * @param data   Data
+ * @param size   Data size in bytes
+ * @return       Checksum in host byte order
+ */
+uint16_t inet_checksum_calc(uint16_t ivalue, const void *data, size_t size)
+{
+	const uint8_t *bdata = (const uint8_t *) data;
+	uint64_t w[4];
+	uint32_t w32;
+	uint16_t w16;
+	uint8_t tail[2];
+	uint64_t sum;
+
+	sum = host2uint16_t_be((uint16_t) ~ivalue);
+
+	while (size >= sizeof(w)) {
+		memcpy(w, bdata, sizeof(w));
+		sum = inet_checksum_add64(sum, w[0]);
+		sum = inet_checksum_add64(sum, w[1]);
+		sum = inet_checksum_add64(sum, w[2]);
+		sum = inet_checksum_add64(sum, w[3]);
+		bdata += sizeof(w);
+		size -= sizeof(w);
+	}
+
+	while (size >= sizeof(w[0])) {
+		memcpy(w, bdata, sizeof(w[0]));
+		sum = inet_checksum_add64(sum, w[0]);
+		bdata += sizeof(w[0]);
+		size -= sizeof(w[0]);
+	}
+
+	if (size >= sizeof(w32)) {
+		memcpy(&w32, bdata, sizeof(w32));
+		sum = inet_checksum_add64(sum, w32);
+		bdata += sizeof(w32);
+		size -= sizeof(w32);
+	}
+
+	if (size >= sizeof(w16)) {
+		memcpy(&w16, bdata, sizeof(w16));
+		sum = inet_checksum_add64(sum, w16);
+		bdata += sizeof(w16);
+		size -= sizeof(w16);
+	}
+
+	if (size > 0) {
+		/* Odd byte is padded with zero */
+		tail[0] = *bdata;
+		tail[1] = 0;
+		memcpy(&w16, tail, sizeof(w16));
+		sum = inet_checksum_add64(sum, w16);
+	}
+
+	return ~uint16_t_be2host(inet_checksum_fold(sum));
+}
+
+/** Compute Internet checksum of transport protocol pseudo header.
+ *
+ * Sums the TCP/UDP pseudo header (RFC 793, RFC 768 for IPv4, RFC 8200
+ * sec. 8.1 for IPv6) directly from the addresses, without constructing
+ * it in memory. The result can be passed as initial value to
+ * inet_checksum_calc() to continue with the transport header.
+ *
+ * @param ivalue Initial value, usually @c INET_CHECKSUM_INIT
+ * @param src    Source address
+ * @param dest   Destination address
+ * @param proto  Protocol number
+ * @param length Length of transport header and data in bytes
+ * @return       Checksum in host byte order
+ */
+uint16_t inet_checksum_phdr(uint16_t ivalue, const inet_addr_t *src,
+    const inet_addr_t *dest, uint8_t proto, size_t length)
+{
+	uint64_t sum;
+
+	assert(src->version == dest->version);
+
+	sum = (uint16_t) ~ivalue;
+
+	switch (src->version) {
+	case ip_v4:
+		sum += src->addr;
+		sum += dest->addr;
+		break;
+	case ip_v6:
+		sum += (uint16_t) ~inet_checksum_calc(INET_CHECKSUM_INIT,
+		    src->addr6, sizeof(addr128_t));
+		sum += (uint16_t) ~inet_checksum_calc(INET_CHECKSUM_INIT,
+		    dest->addr6, sizeof(addr128_t));
+		break;
+	default:
+		assert(false);
+		break;
+	}
+
+	sum += proto;
+	sum += (uint32_t) length;
+
+	return ~inet_checksum_fold(sum);
+}
+
+/** Update Internet checksum after a 16-bit field changed.
+ *
+ * Incremental update as per RFC 1624 eqn. 3.
+ *
+ * @param csum Checksum (in host byte order)
+ * @param oval Old value of the field (in host byte order)
+ * @param nval New value of the field (in host byte order)
+ * @return     Updated checksum in host byte order
+ */
+uint16_t inet_checksum_update16(uint16_t csum, uint16_t oval, uint16_t nval)
+{
+	uint64_t sum;
+
+	sum = (uint16_t) ~csum;
+	sum += (uint16_t) ~oval;
+	sum += nval;
+
+	return ~inet_checksum_fold(sum);
+}
+
+/** Update Internet checksum after a block of data changed.
+ *
+ * Incremental update as per RFC 1624 eqn. 3. Only the changed data
+ * is summed, not the entire message.
+ *
+ * @param csum  Checksum (in host byte order)
+ * @param odata Old contents of the block
+ * @param ndata New contents of the block
+ * @param size  Block size in bytes, must be even
+ * @return      Updated checksum in host byte order
+ */
+uint16_t inet_checksum_update(uint16_t csum, const void *odata,
+    const void *ndata, size_t size)
+{
+	uint64_t sum;
+
+	assert(size % 2 == 0);
+
+	sum = (uint16_t) ~csum;
+	/* Sum of the old data, complemented */
+	sum += inet_checksum_calc(INET_CHECKSUM_INIT, odata, size);
+	/* Sum of the new data */
+	sum += (uint16_t) ~inet_checksum_calc(INET_CHECKSUM_INIT, ndata, size);
+
+	return ~inet_checksum_fold(sum);
+}
+
+/** @}
+ */
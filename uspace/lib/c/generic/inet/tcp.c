@@ -630,6 +630,123 @@ again:
 	return EOK;
 }
 
+/** Get connection statistics.
+ *
+ * Returns congestion control and retransmission statistics of the
+ * connection, such as congestion window, smoothed round-trip time and
+ * number of retransmitted segments.
+ *
+ * @param conn  Connection
+ * @param stats Place to store statistics
+ * @return EOK on success or an error code
+ */
+errno_t tcp_conn_get_stats(tcp_conn_t *conn, tcp_conn_stats_t *stats)
+{
+	async_exch_t *exch;
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	aid_t req = async_send_1(exch, TCP_CONN_GET_STATS, conn->id, NULL);
+	errno_t rc = async_data_read_start(exch, stats,
+	    sizeof(tcp_conn_stats_t));
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	return retval;
+}
+
+/** Set connection buffer sizes.
+ *
+ * Larger buffers allow more data in flight, which is needed to fully
+ * utilize links with a high bandwidth-delay product. The receive buffer
+ * cannot be shrunk once the connection has been established.
+ *
+ * @param conn     Connection
+ * @param snd_size Send buffer size in bytes or zero to leave unchanged
+ * @param rcv_size Receive buffer size in bytes or zero to leave unchanged
+ * @return EOK on success or an error code
+ */
+errno_t tcp_conn_set_buf_size(tcp_conn_t *conn, size_t snd_size,
+    size_t rcv_size)
+{
+	async_exch_t *exch;
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	errno_t rc = async_req_3_0(exch, TCP_CONN_SET_BUF_SIZE, conn->id,
+	    snd_size, rcv_size);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
+/** Enable or disable Nagle's algorithm on connection.
+ *
+ * By default small writes are coalesced while previously sent data
+ * is not acknowledged. With @a nodelay set, data is sent immediately.
+ *
+ * @param conn    Connection
+ * @param nodelay @c true to send small segments without delay
+ * @return EOK on success or an error code
+ */
+errno_t tcp_conn_set_nodelay(tcp_conn_t *conn, bool nodelay)
+{
+	async_exch_t *exch;
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	errno_t rc = async_req_2_0(exch, TCP_CONN_SET_NODELAY, conn->id,
+	    nodelay);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
+/** Cork or uncork connection.
+ *
+ * @param conn Connection
+ * @param cork @c true to cork, @c false to uncork
+ * @return EOK on success or an error code
+ */
+static errno_t tcp_conn_set_cork(tcp_conn_t *conn, bool cork)
+{
+	async_exch_t *exch;
+
+	exch = async_exchange_begin(conn->tcp->sess);
+	errno_t rc = async_req_2_0(exch, TCP_CONN_SET_CORK, conn->id, cork);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
+/** Cork connection.
+ *
+ * While a connection is corked, only full-sized segments are sent.
+ * Use this to build up a message from several small writes.
+ *
+ * @param conn Connection
+ * @return EOK on success or an error code
+ */
+errno_t tcp_conn_cork(tcp_conn_t *conn)
+{
+	return tcp_conn_set_cork(conn, true);
+}
+
+/** Uncork connection.
+ *
+ * Send out any data held back while the connection was corked.
+ *
+ * @param conn Connection
+ * @return EOK on success or an error code
+ */
+errno_t tcp_conn_uncork(tcp_conn_t *conn)
+{
+	return tcp_conn_set_cork(conn, false);
+}
+
 /** Connection established event.
  *
  * @param tcp   TCP client
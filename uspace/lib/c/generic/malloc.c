@@ -45,6 +45,8 @@
 #include <mem.h>
 #include <stdlib.h>
 #include <adt/gcdlcm.h>
+#include <adt/list.h>
+#include <stdatomic.h>
 
 #include "private/malloc.h"
 #include "private/fibril.h"
@@ -58,6 +60,12 @@
 /** Magic used in heap descriptor. */
 #define HEAP_AREA_MAGIC  UINT32_C(0xBEEFCAFE)
 
+/** Magic used in small object headers. */
+#define HEAP_SMALL_MAGIC  UINT32_C(0xBEEF0303)
+
+/** Magic used in slab descriptors. */
+#define HEAP_SLAB_MAGIC  UINT32_C(0xBEEF0404)
+
 /** Allocation alignment.
  *
  * This also covers the alignment of fields
@@ -76,6 +84,27 @@
  */
 #define SHRINK_GRANULARITY  (64 * PAGE_SIZE)
 
+/** Largest allocation served from the size classes. */
+#define SMALL_MAX  1024
+
+/** Number of size classes.
+ *
+ * The classes are spaced by BASE_ALIGN up to 128 bytes
+ * and by a quarter of the power of two above that.
+ *
+ */
+#define SMALL_CLASSES  20
+
+/** Minimum number of objects in a slab. */
+#define SLAB_OBJECTS  32
+
+/** Amount of memory moved between a cache and the slabs at once. */
+#define CACHE_BATCH_SIZE  4096
+
+/** Get small object header from the object address. */
+#define SMALL_HEAD(addr) \
+	((heap_small_head_t *) (((uintptr_t) (addr)) - sizeof(heap_small_head_t)))
+
 /** Overhead of each heap block. */
 #define STRUCT_OVERHEAD \
 	(sizeof(heap_block_head_t) + sizeof(heap_block_foot_t))
@@ -184,6 +213,111 @@ typedef struct {
 	uint32_t magic;
 } heap_block_foot_t;
 
+/** Slab of small objects
+ *
+ * A slab is an ordinary heap block which is carved into
+ * objects of a single size class. Each object is preceded
+ * by a heap_small_head_t.
+ *
+ */
+typedef struct heap_slab {
+	/** Link in the list of slabs with free objects of the class */
+	link_t link;
+
+	/** Free objects (linked through their first word) */
+	void *free;
+
+	/** Header of the first object never handed out */
+	uintptr_t bump;
+
+	/** End of the slab */
+	uintptr_t end;
+
+	/** Number of objects handed out (including cached ones) */
+	size_t used;
+
+	/** Size class of the objects */
+	unsigned int cls;
+
+	/** Indication of the slab being in the list of its class */
+	bool listed;
+
+	/** A magic value */
+	uint32_t magic;
+} heap_slab_t;
+
+/** Header of a small object
+ *
+ */
+typedef struct {
+	/** Slab the object belongs to */
+	heap_slab_t *slab;
+
+	/*
+	 * A magic value, stored at the same distance from the object
+	 * as the magic value of heap_block_head_t is from the data
+	 * of a heap block, so that free() can tell them apart.
+	 */
+	uint32_t magic;
+} heap_small_head_t;
+
+static_assert(sizeof(heap_small_head_t) - offsetof(heap_small_head_t, magic) ==
+    sizeof(heap_block_head_t) - offsetof(heap_block_head_t, magic), "");
+
+/** Size class
+ *
+ */
+typedef struct {
+	/** Slabs with free objects */
+	list_t slabs;
+
+	/** Distance between two objects (including the header) */
+	size_t stride;
+
+	/** Net size of the heap block of a slab */
+	size_t slab_size;
+
+	/** Number of objects moved between a cache and the slabs at once */
+	size_t batch;
+} heap_class_t;
+
+/** Per-class list of objects kept by a cache
+ *
+ */
+typedef struct {
+	/** Cached objects (linked through their first word) */
+	void *head;
+
+	/** Number of cached objects */
+	size_t count;
+} heap_bin_t;
+
+/** Cache of small objects
+ *
+ * There is a cache for each fibril runner, so that threads
+ * running fibrils can allocate and free small objects
+ * without contending for the heap lock.
+ *
+ */
+typedef struct {
+	fibril_rmutex_t lock;
+	heap_bin_t bins[SMALL_CLASSES];
+} heap_cache_t;
+
+/** Object sizes of the size classes */
+static const uint16_t small_sizes[SMALL_CLASSES] = {
+	16, 32, 48, 64, 80, 96, 112, 128,
+	160, 192, 224, 256,
+	320, 384, 448, 512,
+	640, 768, 896, 1024
+};
+
+/** Size classes (protected by the heap lock) */
+static heap_class_t heap_classes[SMALL_CLASSES];
+
+/** Caches of the fibril runners (allocated on demand) */
+static _Atomic(heap_cache_t *) heap_caches[FIBRIL_RUNNER_MAX];
+
 /** First heap area */
 static heap_area_t *first_heap_area = NULL;
 
@@ -474,6 +608,24 @@ static void heap_shrink(heap_area_t *area)
 	next_fit = NULL;
 }
 
+/** Initialize the size classes
+ *
+ */
+static void small_init(void)
+{
+	for (unsigned int cls = 0; cls < SMALL_CLASSES; cls++) {
+		heap_class_t *hc = &heap_classes[cls];
+
+		list_initialize(&hc->slabs);
+		hc->stride = ALIGN_UP(small_sizes[cls] +
+		    sizeof(heap_small_head_t), BASE_ALIGN);
+		hc->slab_size = ALIGN_UP(GROSS_SIZE(sizeof(heap_slab_t) +
+		    BASE_ALIGN + SLAB_OBJECTS * hc->stride), PAGE_SIZE) -
+		    STRUCT_OVERHEAD;
+		hc->batch = max(CACHE_BATCH_SIZE / small_sizes[cls], 4);
+	}
+}
+
 /** Initialize the heap allocator
  *
  * Create initial heap memory area. This routine is
@@ -486,6 +638,8 @@ void __malloc_init(void)
 	if (fibril_rmutex_initialize(&malloc_mutex) != EOK)
 		abort();
 
+	small_init();
+
 	if (!area_create(PAGE_SIZE))
 		abort();
 }
@@ -763,6 +917,360 @@ static void *malloc_internal(const size_t size, const size_t align)
 	return heap_grow_and_alloc(gross_size, falign);
 }
 
+/** Free a memory block
+ *
+ * Should be called only inside the critical section.
+ *
+ * @param addr The address of the block.
+ *
+ */
+static void free_internal(void *const addr)
+{
+	/* Calculate the position of the header. */
+	heap_block_head_t *head =
+	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
+
+	block_check(head);
+	malloc_assert(!head->free);
+
+	heap_area_t *area = head->area;
+
+	area_check(area);
+	malloc_assert((void *) head >= (void *) AREA_FIRST_BLOCK_HEAD(area));
+	malloc_assert((void *) head < area->end);
+
+	/* Mark the block itself as free. */
+	head->free = true;
+
+	/* Look at the next block. If it is free, merge the two. */
+	heap_block_head_t *next_head =
+	    (heap_block_head_t *) (((void *) head) + head->size);
+
+	if ((void *) next_head < area->end) {
+		block_check(next_head);
+		if (next_head->free)
+			block_init(head, head->size + next_head->size, true, area);
+	}
+
+	/* Look at the previous block. If it is free, merge the two. */
+	if ((void *) head > (void *) AREA_FIRST_BLOCK_HEAD(area)) {
+		heap_block_foot_t *prev_foot =
+		    (heap_block_foot_t *) (((void *) head) - sizeof(heap_block_foot_t));
+
+		heap_block_head_t *prev_head =
+		    (heap_block_head_t *) (((void *) head) - prev_foot->size);
+
+		block_check(prev_head);
+
+		if (prev_head->free)
+			block_init(prev_head, prev_head->size + head->size, true,
+			    area);
+	}
+
+	heap_shrink(area);
+}
+
+/** Decide whether an allocation is served from the size classes
+ *
+ * With CONFIG_DEBUG_MALLOC, all allocations come from the
+ * heap blocks, so that every block is guarded by the header
+ * and footer magic values and covered by heap_check().
+ *
+ * @param size Number of bytes to allocate.
+ *
+ */
+static inline bool small_fits(size_t size)
+{
+#ifdef CONFIG_DEBUG_MALLOC
+	return false;
+#else
+	return size <= SMALL_MAX;
+#endif
+}
+
+/** Get the size class of a small allocation
+ *
+ * @param size Number of bytes to allocate (at most SMALL_MAX).
+ *
+ * @return Index of the smallest class the allocation fits in.
+ *
+ */
+static inline unsigned int small_class(size_t size)
+{
+	if (size <= 128)
+		return (size == 0) ? 0 : (size - 1) / BASE_ALIGN;
+
+	unsigned int order = fnzb(size - 1);
+	return 8 + (order - 7) * 4 +
+	    ((size - 1 - ((size_t) 1 << order)) >> (order - 2));
+}
+
+/** Check a slab structure
+ *
+ * @param slab Slab to check.
+ *
+ */
+static void slab_check(heap_slab_t *slab)
+{
+	malloc_assert(slab->magic == HEAP_SLAB_MAGIC);
+	malloc_assert(slab->cls < SMALL_CLASSES);
+	block_check((void *) slab - sizeof(heap_block_head_t));
+}
+
+/** Create a new slab
+ *
+ * Should be called only inside the critical section.
+ *
+ * @param cls Size class of the slab.
+ *
+ * @return New slab or NULL on not enough memory.
+ *
+ */
+static heap_slab_t *slab_create(unsigned int cls)
+{
+	heap_class_t *hc = &heap_classes[cls];
+	heap_slab_t *slab = malloc_internal(hc->slab_size, BASE_ALIGN);
+	if (slab == NULL)
+		return NULL;
+
+	link_initialize(&slab->link);
+	slab->free = NULL;
+	slab->bump = ALIGN_UP((uintptr_t) slab + sizeof(heap_slab_t) +
+	    sizeof(heap_small_head_t), BASE_ALIGN) - sizeof(heap_small_head_t);
+	slab->end = (uintptr_t) slab + hc->slab_size;
+	slab->used = 0;
+	slab->cls = cls;
+	slab->listed = true;
+	slab->magic = HEAP_SLAB_MAGIC;
+
+	list_prepend(&slab->link, &hc->slabs);
+	return slab;
+}
+
+/** Take an object from the slabs of a size class
+ *
+ * Should be called only inside the critical section.
+ * The objects are carved from a slab only as they are
+ * needed, so that a new slab does not touch all its pages.
+ *
+ * @param cls Size class.
+ *
+ * @return Object or NULL on not enough memory.
+ *
+ */
+static void *slab_get(unsigned int cls)
+{
+	heap_class_t *hc = &heap_classes[cls];
+	heap_slab_t *slab = list_get_instance(list_first(&hc->slabs),
+	    heap_slab_t, link);
+
+	if (slab == NULL) {
+		slab = slab_create(cls);
+		if (slab == NULL)
+			return NULL;
+	}
+
+	void *obj;
+
+	if (slab->free != NULL) {
+		obj = slab->free;
+		slab->free = *((void **) obj);
+	} else {
+		heap_small_head_t *head = (heap_small_head_t *) slab->bump;
+
+		head->slab = slab;
+		head->magic = HEAP_SMALL_MAGIC;
+
+		obj = (void *) (slab->bump + sizeof(heap_small_head_t));
+		slab->bump += hc->stride;
+	}
+
+	slab->used++;
+
+	if ((slab->free == NULL) && (slab->bump + hc->stride > slab->end)) {
+		/* The slab is full. */
+		list_remove(&slab->link);
+		slab->listed = false;
+	}
+
+	return obj;
+}
+
+/** Return an object to its slab
+ *
+ * Should be called only inside the critical section.
+ * A slab which becomes entirely free is returned to the heap
+ * unless it is the only slab of its class with free objects.
+ *
+ * @param obj Object to return.
+ *
+ */
+static void slab_put(void *obj)
+{
+	heap_slab_t *slab = SMALL_HEAD(obj)->slab;
+
+	slab_check(slab);
+	malloc_assert(slab->used > 0);
+
+	heap_class_t *hc = &heap_classes[slab->cls];
+
+	*((void **) obj) = slab->free;
+	slab->free = obj;
+	slab->used--;
+
+	if (!slab->listed) {
+		list_prepend(&slab->link, &hc->slabs);
+		slab->listed = true;
+	}
+
+	if ((slab->used == 0) &&
+	    (list_first(&hc->slabs) != list_last(&hc->slabs))) {
+		list_remove(&slab->link);
+		slab->magic = 0;
+		free_internal(slab);
+	}
+}
+
+/** Get the cache of the current fibril runner
+ *
+ * @return Cache or NULL on not enough memory.
+ *
+ */
+static heap_cache_t *cache_get(void)
+{
+	_Atomic(heap_cache_t *) *slot = &heap_caches[fibril_runner_index()];
+	heap_cache_t *cache = atomic_load_explicit(slot, memory_order_acquire);
+
+	if (cache != NULL)
+		return cache;
+
+	heap_lock();
+
+	cache = atomic_load_explicit(slot, memory_order_relaxed);
+	if (cache == NULL) {
+		cache = malloc_internal(sizeof(heap_cache_t), BASE_ALIGN);
+		if (cache != NULL) {
+			memset(cache, 0, sizeof(heap_cache_t));
+
+			if (fibril_rmutex_initialize(&cache->lock) != EOK) {
+				free_internal(cache);
+				cache = NULL;
+			} else {
+				atomic_store_explicit(slot, cache,
+				    memory_order_release);
+			}
+		}
+	}
+
+	heap_unlock();
+
+	return cache;
+}
+
+/** Allocate a small object
+ *
+ * The object is taken from the cache of the current fibril
+ * runner. An empty cache is refilled by a batch of objects
+ * from the slabs of the size class.
+ *
+ * @param size Number of bytes to allocate (at most SMALL_MAX).
+ *
+ * @return Allocated memory or NULL.
+ *
+ */
+static void *small_alloc(size_t size)
+{
+	heap_cache_t *cache = cache_get();
+	if (cache == NULL)
+		return NULL;
+
+	unsigned int cls = small_class(size);
+	heap_bin_t *bin = &cache->bins[cls];
+
+	fibril_rmutex_lock(&cache->lock);
+
+	if (bin->head == NULL) {
+		heap_lock();
+
+		while (bin->count < heap_classes[cls].batch) {
+			void *obj = slab_get(cls);
+			if (obj == NULL)
+				break;
+
+			*((void **) obj) = bin->head;
+			bin->head = obj;
+			bin->count++;
+		}
+
+		heap_unlock();
+	}
+
+	void *obj = bin->head;
+	if (obj != NULL) {
+		bin->head = *((void **) obj);
+		bin->count--;
+	}
+
+	fibril_rmutex_unlock(&cache->lock);
+
+	return obj;
+}
+
+/** Free a small object
+ *
+ * The object is put into the cache of the current fibril runner.
+ * Once the cache holds more than two batches of objects of the
+ * size class, the objects beyond the first batch are returned
+ * to their slabs.
+ *
+ * @param addr The address of the object.
+ *
+ */
+static void small_free(void *const addr)
+{
+	heap_slab_t *slab = SMALL_HEAD(addr)->slab;
+	slab_check(slab);
+
+	heap_cache_t *cache = cache_get();
+	if (cache == NULL) {
+		heap_lock();
+		slab_put(addr);
+		heap_unlock();
+		return;
+	}
+
+	size_t batch = heap_classes[slab->cls].batch;
+	heap_bin_t *bin = &cache->bins[slab->cls];
+
+	fibril_rmutex_lock(&cache->lock);
+
+	*((void **) addr) = bin->head;
+	bin->head = addr;
+	bin->count++;
+
+	if (bin->count > 2 * batch) {
+		void **last = &bin->head;
+		for (size_t i = 0; i < batch; i++)
+			last = (void **) *last;
+
+		void *obj = *last;
+		*last = NULL;
+		bin->count = batch;
+
+		heap_lock();
+
+		while (obj != NULL) {
+			void *next = *((void **) obj);
+			slab_put(obj);
+			obj = next;
+		}
+
+		heap_unlock();
+	}
+
+	fibril_rmutex_unlock(&cache->lock);
+}
+
 /** Allocate memory by number of elements
  *
  * @param nmemb Number of members to allocate.
@@ -792,6 +1300,9 @@ void *calloc(const size_t nmemb, const size_t size)
  */
 void *malloc(const size_t size)
 {
+	if (small_fits(size))
+		return small_alloc(size);
+
 	heap_lock();
 	void *block = malloc_internal(size, BASE_ALIGN);
 	heap_unlock();
@@ -815,6 +1326,10 @@ void *memalign(const size_t align, const size_t size)
 	size_t palign =
 	    1 << (fnzb(max(sizeof(void *), align) - 1) + 1);
 
+	/* Small objects are aligned on BASE_ALIGN. */
+	if (palign <= BASE_ALIGN)
+		return malloc(size);
+
 	heap_lock();
 	void *block = malloc_internal(size, palign);
 	heap_unlock();
@@ -840,6 +1355,24 @@ void *realloc(void *const addr, const size_t size)
 	if (addr == NULL)
 		return malloc(size);
 
+	heap_small_head_t *small = SMALL_HEAD(addr);
+	if (small->magic == HEAP_SMALL_MAGIC) {
+		heap_slab_t *slab = small->slab;
+		slab_check(slab);
+
+		/* Keep the object if the size class does not change. */
+		if (small_fits(size) && (small_class(size) == slab->cls))
+			return addr;
+
+		void *ptr = malloc(size);
+		if (ptr != NULL) {
+			memcpy(ptr, addr, min(size, small_sizes[slab->cls]));
+			free(addr);
+		}
+
+		return ptr;
+	}
+
 	heap_lock();
 
 	/* Calculate the position of the header. */
@@ -949,51 +1482,13 @@ void free(void *const addr)
 	if (addr == NULL)
 		return;
 
-	heap_lock();
-
-	/* Calculate the position of the header. */
-	heap_block_head_t *head =
-	    (heap_block_head_t *) (addr - sizeof(heap_block_head_t));
-
-	block_check(head);
-	malloc_assert(!head->free);
-
-	heap_area_t *area = head->area;
-
-	area_check(area);
-	malloc_assert((void *) head >= (void *) AREA_FIRST_BLOCK_HEAD(area));
-	malloc_assert((void *) head < area->end);
-
-	/* Mark the block itself as free. */
-	head->free = true;
-
-	/* Look at the next block. If it is free, merge the two. */
-	heap_block_head_t *next_head =
-	    (heap_block_head_t *) (((void *) head) + head->size);
-
-	if ((void *) next_head < area->end) {
-		block_check(next_head);
-		if (next_head->free)
-			block_init(head, head->size + next_head->size, true, area);
-	}
-
-	/* Look at the previous block. If it is free, merge the two. */
-	if ((void *) head > (void *) AREA_FIRST_BLOCK_HEAD(area)) {
-		heap_block_foot_t *prev_foot =
-		    (heap_block_foot_t *) (((void *) head) - sizeof(heap_block_foot_t));
-
-		heap_block_head_t *prev_head =
-		    (heap_block_head_t *) (((void *) head) - prev_foot->size);
-
-		block_check(prev_head);
-
-		if (prev_head->free)
-			block_init(prev_head, prev_head->size + head->size, true,
-			    area);
+	if (SMALL_HEAD(addr)->magic == HEAP_SMALL_MAGIC) {
+		small_free(addr);
+		return;
 	}
 
-	heap_shrink(area);
-
+	heap_lock();
+	free_internal(addr);
 	heap_unlock();
 }
 
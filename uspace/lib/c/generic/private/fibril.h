@@ -31,6 +31,7 @@
 
 #include <adt/list.h>
 #include <context.h>
+#include <stdatomic.h>
 #include <tls.h>
 #include <abi/proc/uarg.h>
 #include <fibril.h>
@@ -39,9 +40,14 @@
 #include "./futex.h"
 
 typedef struct {
-	fibril_t *fibril;
+	_Atomic(fibril_t *) fibril;
 } fibril_event_t;
 
+typedef struct fibril_runner fibril_runner_t;
+
+/** Maximum number of runners with a ready queue of their own. */
+#define FIBRIL_RUNNER_MAX  64
+
 #define FIBRIL_EVENT_INIT ((fibril_event_t) {0})
 
 struct fibril {
@@ -62,6 +68,13 @@ struct fibril {
 
 	fibril_t *thread_ctx;
 
+	/** Runner that last executed this fibril. */
+	fibril_runner_t *runner;
+	/** Fibril that switched to this one and still needs finishing. */
+	fibril_t *switched_from;
+	/** Set until the context of this fibril is saved by a switch. */
+	atomic_bool in_switch;
+
 	bool is_running : 1;
 	bool is_writer : 1;
 	/* In some places, we use fibril structs that can't be freed. */
@@ -81,6 +94,8 @@ extern fibril_t *fibril_self(void);
 extern void __fibrils_init(void);
 extern void __fibrils_fini(void);
 
+extern int fibril_runner_index(void);
+
 extern void fibril_wait_for(fibril_event_t *);
 extern errno_t fibril_wait_timeout(fibril_event_t *, const struct timespec *);
 extern void fibril_notify(fibril_event_t *);
@@ -47,6 +47,7 @@
 #include <str.h>
 #include <ipc/ipc.h>
 #include <libarch/faddr.h>
+#include <stdatomic.h>
 
 #include "../private/thread.h"
 #include "../private/futex.h"
@@ -56,9 +57,17 @@
 #define DPRINTF(...) ((void)0)
 #undef READY_DEBUG
 
-/** Member of timeout_list. */
-typedef struct {
-	link_t link;
+/** Node of the timeout heap. */
+typedef struct _timeout {
+	/** First child. */
+	struct _timeout *child;
+	/** Next sibling. */
+	struct _timeout *next;
+	/** Previous sibling, or parent if this is the first child. */
+	struct _timeout *prev;
+	/** True while the timeout is in the heap. */
+	bool queued;
+
 	struct timespec expires;
 	fibril_event_t *event;
 } _timeout_t;
@@ -83,16 +92,48 @@ typedef enum {
 	SWITCH_FROM_BLOCKED,
 } _switch_type_t;
 
+/** Number of runners used by fibril_enable_multithreaded(). */
+#define RUNNER_DEFAULT  4
+
+/**
+ * Fibril runner, i.e. an OS thread that executes fibrils.
+ *
+ * Each runner has a queue of ready fibrils of its own. A fibril is made ready
+ * on the queue of the runner that last executed it, and a runner that has
+ * nothing left in its own queue steals from the others.
+ */
+struct fibril_runner {
+	/** Protects the ready list. */
+	futex_t futex;
+	list_t ready;
+	/** Number of fibrils in the ready list. */
+	atomic_size_t count;
+};
+
 static bool multithreaded = false;
 
-/* This futex serializes access to global data. */
+/* This futex serializes access to fibril_list and runners. */
 static futex_t fibril_futex;
 static futex_t ready_semaphore;
 static long ready_st_count;
 
-static LIST_INITIALIZE(ready_list);
+static fibril_runner_t runners[FIBRIL_RUNNER_MAX];
+/** Number of initialized entries in runners. */
+static atomic_int runner_count;
+/** Number of runners handed out so far, may exceed FIBRIL_RUNNER_MAX. */
+static int runner_next;
+/** Number of OS threads running fibrils. */
+static atomic_int runner_threads = 1;
+
 static LIST_INITIALIZE(fibril_list);
-static LIST_INITIALIZE(timeout_list);
+
+/*
+ * Pending timeouts are kept in a pairing heap ordered by expiration time.
+ * Insertion is constant time and so is unlinking a cancelled timeout, the
+ * rest of its removal being amortized logarithmic.
+ */
+static futex_t timeout_futex;
+static _timeout_t *timeout_heap;
 
 static futex_t ipc_lists_futex;
 static LIST_INITIALIZE(ipc_waiter_list);
@@ -106,11 +147,46 @@ static fibril_t _fibril_event_timed_out;
 #define _EVENT_TRIGGERED (&_fibril_event_triggered)
 #define _EVENT_TIMED_OUT (&_fibril_event_timed_out)
 
+/** @return Number of runners whose ready queues need to be looked at. */
+static inline int _runner_span(void)
+{
+	return atomic_load_explicit(&runner_count, memory_order_acquire);
+}
+
+/** @return Runner of the current thread, or NULL if it does not have one. */
+static inline fibril_runner_t *_runner_self(void)
+{
+	fibril_t *ctx = fibril_self()->thread_ctx;
+	return ctx ? ctx->runner : NULL;
+}
+
+/**
+ * @return Index of the runner of the current thread, or 0 if it does not
+ *         have one. Lets other parts of libc keep per-runner data.
+ */
+int fibril_runner_index(void)
+{
+	fibril_runner_t *r = _runner_self();
+	return r ? (int) (r - runners) : 0;
+}
+
+/** @return Number of ready fibrils in all runner queues. */
+static size_t _ready_count(void)
+{
+	size_t count = 0;
+	int span = _runner_span();
+
+	for (int i = 0; i < span; i++)
+		count += atomic_load(&runners[i].count);
+
+	return count;
+}
+
 static inline void _ready_debug_check(void)
 {
 #ifdef READY_DEBUG
 	assert(!multithreaded);
-	long count = (long) list_count(&ready_list) +
+	long count = (long) _ready_count() +
 	    (long) list_count(&ipc_buffer_free_list);
 	assert(ready_st_count == count);
 #endif
@@ -138,6 +214,8 @@ static inline errno_t _ready_down(const struct timespec *expires)
 
 static atomic_int threads_in_ipc_wait;
 
+static void _fibril_switch_done(void);
+
 /** Function that spans the whole life-cycle of a fibril.
  *
  * Each fibril begins execution in this function. Then the function implementing
@@ -147,8 +225,8 @@ static atomic_int threads_in_ipc_wait;
  */
 static void _fibril_main(void)
 {
-	/* fibril_futex is locked when a fibril is started. */
-	futex_unlock(&fibril_futex);
+	/* Finish the switch that started this fibril. */
+	_fibril_switch_done();
 
 	fibril_t *fibril = fibril_self();
 
@@ -206,32 +284,29 @@ void fibril_teardown(fibril_t *fibril)
  *
  * @param reason  Reason of the notification.
  *                Can be either _EVENT_TRIGGERED or _EVENT_TIMED_OUT.
+ * @return        Fibril that was waiting for the event and needs to be
+ *                made ready, or NULL.
  */
 static fibril_t *_fibril_trigger_internal(fibril_event_t *event, fibril_t *reason)
 {
 	assert(reason != _EVENT_INITIAL);
 	assert(reason == _EVENT_TIMED_OUT || reason == _EVENT_TRIGGERED);
 
-	futex_assert_is_locked(&fibril_futex);
+	fibril_t *f = atomic_load_explicit(&event->fibril, memory_order_acquire);
 
-	if (event->fibril == _EVENT_INITIAL) {
-		event->fibril = reason;
-		return NULL;
-	}
+	do {
+		if (f == _EVENT_TRIGGERED) {
+			/* Already triggered. Nothing to do. */
+			return NULL;
+		}
 
-	if (event->fibril == _EVENT_TIMED_OUT) {
-		assert(reason == _EVENT_TRIGGERED);
-		event->fibril = reason;
-		return NULL;
-	}
+		if (f == _EVENT_TIMED_OUT)
+			assert(reason == _EVENT_TRIGGERED);
+	} while (!atomic_compare_exchange_weak_explicit(&event->fibril, &f,
+	    reason, memory_order_acq_rel, memory_order_acquire));
 
-	if (event->fibril == _EVENT_TRIGGERED) {
-		/* Already triggered. Nothing to do. */
+	if (f == _EVENT_INITIAL || f == _EVENT_TIMED_OUT)
 		return NULL;
-	}
-
-	fibril_t *f = event->fibril;
-	event->fibril = reason;
 
 	assert(f->sleep_event == event);
 	return f;
@@ -251,48 +326,127 @@ static errno_t _ipc_wait(ipc_call_t *call, const struct timespec *expires)
 	if (ts_gteq(&now, expires))
 		return ipc_wait(call, SYNCH_NO_TIMEOUT, SYNCH_FLAGS_NON_BLOCKING);
 
-	return ipc_wait(call, NSEC2USEC(ts_sub_diff(expires, &now)),
-	    SYNCH_FLAGS_NONE);
+	/* Less than a microsecond left must not turn into no timeout. */
+	usec_t timeout = NSEC2USEC(ts_sub_diff(expires, &now));
+	if (timeout == 0)
+		timeout = 1;
+
+	return ipc_wait(call, timeout, SYNCH_FLAGS_NONE);
 }
 
-/*
- * Waits until a ready fibril is added to the list, or an IPC message arrives.
- * Returns NULL on timeout and may also return NULL if returning from IPC
- * wait after new ready fibrils are added.
+/** Allocate a runner for the current thread. */
+static fibril_runner_t *_runner_alloc(void)
+{
+	futex_lock(&fibril_futex);
+
+	int i = runner_next++;
+	if (i > 0 && i < FIBRIL_RUNNER_MAX) {
+		fibril_runner_t *r = &runners[i];
+		if (futex_initialize(&r->futex, 1) != EOK)
+			abort();
+		list_initialize(&r->ready);
+		atomic_store_explicit(&runner_count, i + 1,
+		    memory_order_release);
+	}
+
+	futex_unlock(&fibril_futex);
+
+	/* Once all queues are taken, additional runners share them. */
+	return &runners[i % FIBRIL_RUNNER_MAX];
+}
+
+/**
+ * Remove a fibril from a runner's ready queue.
+ *
+ * The owner of the queue takes the oldest entry. Other runners steal from
+ * the other end of the queue.
  */
-static fibril_t *_ready_list_pop(const struct timespec *expires, bool locked)
+static fibril_t *_runner_pop(fibril_runner_t *r, bool steal)
 {
-	if (locked) {
-		futex_assert_is_locked(&fibril_futex);
-		assert(expires);
-		/* Must be nonblocking. */
-		assert(expires->tv_sec == 0);
-	} else {
-		futex_assert_is_not_locked(&fibril_futex);
+	if (atomic_load_explicit(&r->count, memory_order_relaxed) == 0)
+		return NULL;
+
+	futex_lock(&r->futex);
+
+	link_t *link = steal ? list_last(&r->ready) : list_first(&r->ready);
+	if (link) {
+		list_remove(link);
+		atomic_fetch_sub(&r->count, 1);
 	}
 
+	futex_unlock(&r->futex);
+
+	return link ? list_get_instance(link, fibril_t, link) : NULL;
+}
+
+/**
+ * Take a ready fibril, preferably from the queue of the given runner.
+ *
+ * @param self  Runner of the current thread, may be NULL.
+ * @return      Ready fibril or NULL if none was found.
+ */
+static fibril_t *_ready_list_take(fibril_runner_t *self)
+{
+	fibril_t *f;
+
+	if (self) {
+		f = _runner_pop(self, false);
+		if (f)
+			return f;
+	}
+
+	int span = _runner_span();
+	int start = self ? (int) (self - runners) : 0;
+
+	for (int i = 0; i < span; i++) {
+		fibril_runner_t *r = &runners[(start + i) % span];
+		if (r == self)
+			continue;
+
+		f = _runner_pop(r, true);
+		if (f)
+			return f;
+	}
+
+	return NULL;
+}
+
+/*
+ * Waits until a ready fibril is added to a ready queue, or an IPC message
+ * arrives. Returns NULL on timeout and may also return NULL if returning
+ * from IPC wait after new ready fibrils are added.
+ */
+static fibril_t *_ready_list_pop(const struct timespec *expires)
+{
 	errno_t rc = _ready_down(expires);
 	if (rc != EOK)
 		return NULL;
 
 	/*
 	 * Once we acquire a token from ready_semaphore, there are two options.
-	 * Either there is a ready fibril in the list, or it's our turn to
-	 * call `ipc_wait_cycle()`. There is one extra token on the semaphore
-	 * for each entry of the call buffer.
+	 * Either there is a ready fibril in one of the queues, or it's our
+	 * turn to call `ipc_wait_cycle()`. There is one extra token on the
+	 * semaphore for each entry of the call buffer.
 	 */
 
-	if (!locked)
-		futex_lock(&fibril_futex);
-	fibril_t *f = list_pop(&ready_list, fibril_t, link);
-	if (!f)
-		atomic_fetch_add_explicit(&threads_in_ipc_wait, 1,
-		    memory_order_relaxed);
-	if (!locked)
-		futex_unlock(&fibril_futex);
+	fibril_runner_t *self = _runner_self();
+	fibril_t *f;
 
-	if (f)
-		return f;
+	while (true) {
+		f = _ready_list_take(self);
+		if (f)
+			return f;
+
+		/*
+		 * The queues are scanned one by one, so a fibril that was made
+		 * ready in the meantime can be missed. Before going for IPC,
+		 * announce ourselves to _ready_list_push() and look again.
+		 */
+		atomic_fetch_add(&threads_in_ipc_wait, 1);
+		if (_ready_count() == 0)
+			break;
+		atomic_fetch_sub(&threads_in_ipc_wait, 1);
+	}
 
 	if (!multithreaded)
 		assert(list_empty(&ipc_buffer_list));
@@ -324,9 +478,6 @@ static fibril_t *_ready_list_pop(const struct timespec *expires, bool locked)
 	 * returned.
 	 */
 
-	if (!locked)
-		futex_lock(&fibril_futex);
-
 	futex_lock(&ipc_lists_futex);
 
 	_ipc_waiter_t *w = list_pop(&ipc_waiter_list, _ipc_waiter_t, link);
@@ -347,16 +498,13 @@ static fibril_t *_ready_list_pop(const struct timespec *expires, bool locked)
 
 	futex_unlock(&ipc_lists_futex);
 
-	if (!locked)
-		futex_unlock(&fibril_futex);
-
 	return f;
 }
 
-static fibril_t *_ready_list_pop_nonblocking(bool locked)
+static fibril_t *_ready_list_pop_nonblocking(void)
 {
 	struct timespec tv = { .tv_sec = 0, .tv_nsec = 0 };
-	return _ready_list_pop(&tv, locked);
+	return _ready_list_pop(&tv);
 }
 
 static void _ready_list_push(fibril_t *f)
@@ -364,13 +512,21 @@ static void _ready_list_push(fibril_t *f)
 	if (!f)
 		return;
 
-	futex_assert_is_locked(&fibril_futex);
+	/* Prefer the runner that ran the fibril last. */
+	fibril_runner_t *r = f->runner;
+	if (!r)
+		r = _runner_self();
+	if (!r)
+		r = &runners[0];
+
+	futex_lock(&r->futex);
+	list_append(&f->link, &r->ready);
+	atomic_fetch_add(&r->count, 1);
+	futex_unlock(&r->futex);
 
-	/* Enqueue in ready_list. */
-	list_append(&f->link, &ready_list);
 	_ready_up();
 
-	if (atomic_load_explicit(&threads_in_ipc_wait, memory_order_relaxed)) {
+	if (atomic_load(&threads_in_ipc_wait)) {
 		DPRINTF("Poking.\n");
 		/* Wakeup one thread sleeping in SYS_IPC_WAIT. */
 		ipc_poke();
@@ -414,37 +570,138 @@ static errno_t _wait_ipc(ipc_call_t *call, const struct timespec *expires)
 	return rc;
 }
 
+/** Meld two timeout heaps. Both roots must have no siblings. */
+static _timeout_t *_timeout_meld(_timeout_t *a, _timeout_t *b)
+{
+	if (!a)
+		return b;
+	if (!b)
+		return a;
+
+	if (ts_gt(&a->expires, &b->expires)) {
+		_timeout_t *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	b->prev = a;
+	b->next = a->child;
+	if (a->child)
+		a->child->prev = b;
+	a->child = b;
+
+	return a;
+}
+
+/** Meld a list of sibling heaps into one heap, in two passes. */
+static _timeout_t *_timeout_merge_pairs(_timeout_t *first)
+{
+	_timeout_t *pairs = NULL;
+
+	/* Meld siblings pairwise, stacking the results. */
+	while (first) {
+		_timeout_t *a = first;
+		_timeout_t *b = a->next;
+		first = b ? b->next : NULL;
+
+		a->next = a->prev = NULL;
+		if (b)
+			b->next = b->prev = NULL;
+
+		_timeout_t *m = _timeout_meld(a, b);
+		m->next = pairs;
+		pairs = m;
+	}
+
+	/* Meld the pairs, from the last one to the first one. */
+	_timeout_t *root = NULL;
+	while (pairs) {
+		_timeout_t *m = pairs;
+		pairs = m->next;
+		m->next = NULL;
+		root = _timeout_meld(root, m);
+	}
+
+	return root;
+}
+
+static void _insert_timeout(_timeout_t *timeout)
+{
+	futex_assert_is_locked(&timeout_futex);
+	assert(timeout);
+	assert(!timeout->queued);
+
+	timeout->child = timeout->next = timeout->prev = NULL;
+	timeout->queued = true;
+	timeout_heap = _timeout_meld(timeout_heap, timeout);
+}
+
+static void _remove_timeout(_timeout_t *timeout)
+{
+	futex_assert_is_locked(&timeout_futex);
+	assert(timeout->queued);
+
+	if (timeout == timeout_heap) {
+		timeout_heap = _timeout_merge_pairs(timeout->child);
+	} else {
+		/* Cut the subtree out and meld it back into the heap. */
+		if (timeout->prev->child == timeout)
+			timeout->prev->child = timeout->next;
+		else
+			timeout->prev->next = timeout->next;
+		if (timeout->next)
+			timeout->next->prev = timeout->prev;
+
+		timeout_heap = _timeout_meld(timeout_heap,
+		    _timeout_merge_pairs(timeout->child));
+	}
+
+	timeout->queued = false;
+}
+
 /** Fire all timeouts that expired. */
 static struct timespec *_handle_expired_timeouts(struct timespec *next_timeout)
 {
 	struct timespec ts;
 	getuptime(&ts);
 
-	futex_lock(&fibril_futex);
+	struct timespec *ret = NULL;
+	list_t expired;
+	list_initialize(&expired);
+
+	futex_lock(&timeout_futex);
 
-	while (!list_empty(&timeout_list)) {
-		link_t *cur = list_first(&timeout_list);
-		_timeout_t *to = list_get_instance(cur, _timeout_t, link);
+	while (timeout_heap) {
+		_timeout_t *to = timeout_heap;
 
 		if (ts_gt(&to->expires, &ts)) {
 			*next_timeout = to->expires;
-			futex_unlock(&fibril_futex);
-			return next_timeout;
+			ret = next_timeout;
+			break;
 		}
 
-		list_remove(&to->link);
+		_remove_timeout(to);
 
-		_ready_list_push(_fibril_trigger_internal(
-		    to->event, _EVENT_TIMED_OUT));
+		/* The fibril is ours now, so its ready link is free to use. */
+		fibril_t *f = _fibril_trigger_internal(to->event,
+		    _EVENT_TIMED_OUT);
+		if (f)
+			list_append(&f->link, &expired);
 	}
 
-	futex_unlock(&fibril_futex);
-	return NULL;
+	futex_unlock(&timeout_futex);
+
+	/* Make the whole batch ready without holding timeout_futex. */
+	fibril_t *f;
+	while ((f = list_pop(&expired, fibril_t, link)))
+		_ready_list_push(f);
+
+	return ret;
 }
 
 /**
  * Clean up after a dead fibril from which we restored context, if any.
- * Called after a switch is made and fibril_futex is unlocked.
+ * Called after a switch is made.
  */
 static void _fibril_cleanup_dead(void)
 {
@@ -459,22 +716,49 @@ static void _fibril_cleanup_dead(void)
 	srcf->clean_after_me = NULL;
 }
 
-/** Switch to a fibril. */
-static void _fibril_switch_to(_switch_type_t type, fibril_t *dstf, bool locked)
+/**
+ * Finish a switch. Called by the fibril that was switched to, right after
+ * the switch is made.
+ */
+static void _fibril_switch_done(void)
 {
-	assert(fibril_self()->rmutex_locks == 0);
+	fibril_t *self = fibril_self();
+	fibril_t *srcf = self->switched_from;
+
+	if (srcf) {
+		self->switched_from = NULL;
+		/* The context of srcf is saved, other runners may resume it. */
+		atomic_store_explicit(&srcf->in_switch, false,
+		    memory_order_release);
+	}
 
-	if (!locked)
-		futex_lock(&fibril_futex);
-	else
-		futex_assert_is_locked(&fibril_futex);
+	_fibril_cleanup_dead();
+}
+
+/**
+ * Switch to a fibril.
+ *
+ * No lock is held across the switch. A fibril that may be made ready by
+ * another thread before its context is saved has in_switch set, and the
+ * runner that picks it up waits for the flag to clear. To avoid two runners
+ * waiting for each other, a blocking fibril always takes @a dstf before it
+ * makes itself visible to others.
+ */
+static void _fibril_switch_to(_switch_type_t type, fibril_t *dstf)
+{
+	assert(fibril_self()->rmutex_locks == 0);
 
 	fibril_t *srcf = fibril_self();
 	assert(srcf);
 	assert(dstf);
+	assert(dstf != srcf);
+
+	fibril_runner_t *runner = _runner_self();
 
 	switch (type) {
 	case SWITCH_FROM_YIELD:
+		atomic_store_explicit(&srcf->in_switch, true,
+		    memory_order_relaxed);
 		_ready_list_push(srcf);
 		break;
 	case SWITCH_FROM_DEAD:
@@ -485,11 +769,18 @@ static void _fibril_switch_to(_switch_type_t type, fibril_t *dstf, bool locked)
 		break;
 	}
 
+	/*
+	 * Wait until the runner that ran dstf last is done saving it.
+	 * That takes a few instructions, unless that thread is preempted.
+	 */
+	while (atomic_load_explicit(&dstf->in_switch, memory_order_acquire))
+		cpu_spin_hint();
+
 	dstf->thread_ctx = srcf->thread_ctx;
 	srcf->thread_ctx = NULL;
-
-	/* Just some bookkeeping to allow better debugging of futex locks. */
-	futex_give_to(&fibril_futex, dstf);
+	dstf->switched_from = srcf;
+	if (runner)
+		dstf->runner = runner;
 
 	/* Swap to the next fibril. */
 	context_swap(&srcf->ctx, &dstf->ctx);
@@ -497,11 +788,7 @@ static void _fibril_switch_to(_switch_type_t type, fibril_t *dstf, bool locked)
 	assert(srcf == fibril_self());
 	assert(srcf->thread_ctx);
 
-	if (!locked) {
-		/* Must be after context_swap()! */
-		futex_unlock(&fibril_futex);
-		_fibril_cleanup_dead();
-	}
+	_fibril_switch_done();
 }
 
 /**
@@ -517,15 +804,16 @@ static errno_t _helper_fibril_fn(void *arg)
 {
 	/* Set itself as the thread's own context. */
 	fibril_self()->thread_ctx = fibril_self();
+	fibril_self()->runner = _runner_alloc();
 
 	(void) arg;
 
 	struct timespec next_timeout;
 	while (true) {
 		struct timespec *to = _handle_expired_timeouts(&next_timeout);
-		fibril_t *f = _ready_list_pop(to, false);
+		fibril_t *f = _ready_list_pop(to);
 		if (f) {
-			_fibril_switch_to(SWITCH_FROM_HELPER, f, false);
+			_fibril_switch_to(SWITCH_FROM_HELPER, f);
 		}
 	}
 
@@ -595,24 +883,6 @@ void fibril_destroy(fid_t fid)
 	fibril_teardown(fibril);
 }
 
-static void _insert_timeout(_timeout_t *timeout)
-{
-	futex_assert_is_locked(&fibril_futex);
-	assert(timeout);
-
-	link_t *tmp = timeout_list.head.next;
-	while (tmp != &timeout_list.head) {
-		_timeout_t *cur = list_get_instance(tmp, _timeout_t, link);
-
-		if (ts_gteq(&cur->expires, &timeout->expires))
-			break;
-
-		tmp = tmp->next;
-	}
-
-	list_insert_before(&timeout->link, tmp);
-}
-
 /**
  * Same as `fibril_wait_for()`, except with a timeout.
  *
@@ -626,84 +896,86 @@ static void _insert_timeout(_timeout_t *timeout)
 errno_t fibril_wait_timeout(fibril_event_t *event,
     const struct timespec *expires)
 {
-	assert(fibril_self()->rmutex_locks == 0);
+	fibril_t *srcf = fibril_self();
+	assert(srcf->rmutex_locks == 0);
 
-	DPRINTF("### Fibril %p sleeping on event %p.\n", fibril_self(), event);
+	DPRINTF("### Fibril %p sleeping on event %p.\n", srcf, event);
 
-	if (!fibril_self()->thread_ctx) {
-		fibril_self()->thread_ctx =
+	if (!srcf->thread_ctx) {
+		srcf->thread_ctx =
 		    fibril_create_generic(_helper_fibril_fn, NULL, PAGE_SIZE);
-		if (!fibril_self()->thread_ctx)
+		if (!srcf->thread_ctx)
 			return ENOMEM;
 	}
 
-	futex_lock(&fibril_futex);
-
-	if (event->fibril == _EVENT_TRIGGERED) {
+	fibril_t *state = _EVENT_TRIGGERED;
+	if (atomic_compare_exchange_strong_explicit(&event->fibril, &state,
+	    _EVENT_INITIAL, memory_order_acquire, memory_order_relaxed)) {
 		DPRINTF("### Already triggered. Returning. \n");
-		event->fibril = _EVENT_INITIAL;
-		futex_unlock(&fibril_futex);
 		return EOK;
 	}
 
-	assert(event->fibril == _EVENT_INITIAL);
-
-	fibril_t *srcf = fibril_self();
-	fibril_t *dstf = NULL;
+	assert(state == _EVENT_INITIAL);
 
 	/*
 	 * We cannot block here waiting for another fibril becoming
-	 * ready, since that would require unlocking the fibril_futex,
-	 * and that in turn would allow another thread to restore
-	 * the source fibril before this thread finished switching.
+	 * ready, since once the event refers to us, another thread
+	 * may restore the source fibril.
 	 *
 	 * Instead, we switch to an internal "helper" fibril whose only
 	 * job is to wait for an event, freeing the source fibril for
 	 * wakeups. There is always one for each running thread.
+	 *
+	 * The fibril to switch to is taken before the event refers to
+	 * us, see _fibril_switch_to().
 	 */
 
-	dstf = _ready_list_pop_nonblocking(true);
-	if (!dstf) {
-		// XXX: It is possible for the _ready_list_pop_nonblocking() to
-		//      check for IPC, find a pending message, and trigger the
-		//      event on which we are currently trying to sleep.
-		if (event->fibril == _EVENT_TRIGGERED) {
-			event->fibril = _EVENT_INITIAL;
-			futex_unlock(&fibril_futex);
-			return EOK;
-		}
-
-		dstf = srcf->thread_ctx;
-		assert(dstf);
-	}
+	fibril_t *dstf = _ready_list_pop_nonblocking();
 
 	_timeout_t timeout = { 0 };
 	if (expires) {
 		timeout.expires = *expires;
 		timeout.event = event;
+		futex_lock(&timeout_futex);
 		_insert_timeout(&timeout);
+		futex_unlock(&timeout_futex);
 	}
 
-	assert(srcf);
-
-	event->fibril = srcf;
 	srcf->sleep_event = event;
+	atomic_store_explicit(&srcf->in_switch, true, memory_order_relaxed);
+
+	state = _EVENT_INITIAL;
+	if (atomic_compare_exchange_strong_explicit(&event->fibril, &state,
+	    srcf, memory_order_acq_rel, memory_order_acquire)) {
+		if (!dstf)
+			dstf = srcf->thread_ctx;
 
-	assert(event->fibril != _EVENT_INITIAL);
+		_fibril_switch_to(SWITCH_FROM_BLOCKED, dstf);
+	} else {
+		/*
+		 * The event was triggered or timed out in the meantime,
+		 * possibly by _ready_list_pop_nonblocking() reading IPC.
+		 */
+		atomic_store_explicit(&srcf->in_switch, false,
+		    memory_order_relaxed);
 
-	_fibril_switch_to(SWITCH_FROM_BLOCKED, dstf, true);
+		if (dstf)
+			_fibril_switch_to(SWITCH_FROM_YIELD, dstf);
+	}
 
-	assert(event->fibril != srcf);
-	assert(event->fibril != _EVENT_INITIAL);
-	assert(event->fibril == _EVENT_TIMED_OUT || event->fibril == _EVENT_TRIGGERED);
+	if (expires) {
+		/* After this, the timeout cannot touch the event anymore. */
+		futex_lock(&timeout_futex);
+		if (timeout.queued)
+			_remove_timeout(&timeout);
+		futex_unlock(&timeout_futex);
+	}
 
-	list_remove(&timeout.link);
-	errno_t rc = (event->fibril == _EVENT_TIMED_OUT) ? ETIMEOUT : EOK;
-	event->fibril = _EVENT_INITIAL;
+	state = atomic_exchange_explicit(&event->fibril, _EVENT_INITIAL,
+	    memory_order_acquire);
+	assert(state == _EVENT_TIMED_OUT || state == _EVENT_TRIGGERED);
 
-	futex_unlock(&fibril_futex);
-	_fibril_cleanup_dead();
-	return rc;
+	return (state == _EVENT_TIMED_OUT) ? ETIMEOUT : EOK;
 }
 
 void fibril_wait_for(fibril_event_t *event)
@@ -721,9 +993,7 @@ void fibril_wait_for(fibril_event_t *event)
  */
 void fibril_notify(fibril_event_t *event)
 {
-	futex_lock(&fibril_futex);
 	_ready_list_push(_fibril_trigger_internal(event, _EVENT_TRIGGERED));
-	futex_unlock(&fibril_futex);
 }
 
 /** Start a fibril that has not been running yet. */
@@ -736,9 +1006,9 @@ void fibril_start(fibril_t *fibril)
 	if (!link_in_use(&fibril->all_link))
 		list_append(&fibril->all_link, &fibril_list);
 
-	_ready_list_push(fibril);
-
 	futex_unlock(&fibril_futex);
+
+	_ready_list_push(fibril);
 }
 
 /** Start a fibril that has not been running yet. (obsolete) */
@@ -775,9 +1045,9 @@ void fibril_yield(void)
 	if (fibril_self()->rmutex_locks > 0)
 		return;
 
-	fibril_t *f = _ready_list_pop_nonblocking(false);
+	fibril_t *f = _ready_list_pop_nonblocking();
 	if (f)
-		_fibril_switch_to(SWITCH_FROM_YIELD, f, false);
+		_fibril_switch_to(SWITCH_FROM_YIELD, f);
 }
 
 static void _runner_fn(void *arg)
@@ -812,27 +1082,46 @@ int fibril_test_spawn_runners(int n)
 		if (rc != EOK)
 			return i;
 		thread_detach(tid);
+		atomic_fetch_add(&runner_threads, 1);
 	}
 
 	return n;
 }
 
+/**
+ * Set the total number of runners (i.e. OS threads) executing fibrils,
+ * including the calling thread.
+ *
+ * Runners are never stopped, so the number of runners only ever grows.
+ * A program may use this to pass a runner count from its command line.
+ *
+ * @param n  Requested number of runners.
+ * @return   Number of runners after the call.
+ */
+int fibril_set_runner_count(int n)
+{
+	int have = atomic_load(&runner_threads);
+	if (n > have)
+		fibril_test_spawn_runners(n - have);
+
+	return atomic_load(&runner_threads);
+}
+
 /**
  * Opt-in to have more than one runner thread.
  *
  * Currently, a task only ever runs in one thread because multithreading
  * might break some existing code.
  *
- * Eventually, the number of runner threads for a given task should become
- * configurable in the environment and this function becomes no-op.
+ * RUNNER_DEFAULT runners are used. A program which needs a different
+ * number can call fibril_set_runner_count() instead.
  */
 void fibril_enable_multithreaded(void)
 {
-	// TODO: Implement better.
-	//       For now, 4 total runners is a sensible default.
-	if (!multithreaded) {
-		fibril_test_spawn_runners(3);
-	}
+	if (multithreaded)
+		return;
+
+	fibril_set_runner_count(RUNNER_DEFAULT);
 }
 
 /**
@@ -855,11 +1144,11 @@ _Noreturn void fibril_exit(long retval)
 	// TODO: implement fibril_join() and remember retval
 	(void) retval;
 
-	fibril_t *f = _ready_list_pop_nonblocking(false);
+	fibril_t *f = _ready_list_pop_nonblocking();
 	if (!f)
 		f = fibril_self()->thread_ctx;
 
-	_fibril_switch_to(SWITCH_FROM_DEAD, f, false);
+	_fibril_switch_to(SWITCH_FROM_DEAD, f);
 	__builtin_unreachable();
 }
 
@@ -869,6 +1158,17 @@ void __fibrils_init(void)
 		abort();
 	if (futex_initialize(&ipc_lists_futex, 1) != EOK)
 		abort();
+	if (futex_initialize(&timeout_futex, 1) != EOK)
+		abort();
+
+	/*
+	 * The first runner queue also takes fibrils made ready by threads
+	 * that do not have a runner yet.
+	 */
+	if (futex_initialize(&runners[0].futex, 1) != EOK)
+		abort();
+	list_initialize(&runners[0].ready);
+	atomic_store(&runner_count, 1);
 
 	/*
 	 * We allow a fixed, small amount of parallelism for IPC reads, but
@@ -889,6 +1189,11 @@ void __fibrils_fini(void)
 {
 	futex_destroy(&fibril_futex);
 	futex_destroy(&ipc_lists_futex);
+	futex_destroy(&timeout_futex);
+
+	int span = _runner_span();
+	for (int i = 0; i < span; i++)
+		futex_destroy(&runners[i].futex);
 }
 
 void fibril_usleep(usec_t timeout)
@@ -62,6 +62,7 @@ struct bd_ops {
 	errno_t (*read_blocks)(bd_srv_t *, aoff64_t, size_t, void *, size_t);
 	errno_t (*read_toc)(bd_srv_t *, uint8_t, void *, size_t);
 	errno_t (*sync_cache)(bd_srv_t *, aoff64_t, size_t);
+	errno_t (*discard)(bd_srv_t *, aoff64_t, size_t);
 	errno_t (*write_blocks)(bd_srv_t *, aoff64_t, size_t, const void *, size_t);
 	errno_t (*get_block_size)(bd_srv_t *, size_t *);
 	errno_t (*get_num_blocks)(bd_srv_t *, aoff64_t *);
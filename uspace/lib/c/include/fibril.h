@@ -64,6 +64,7 @@ extern void fibril_sleep(sec_t);
 
 extern void fibril_enable_multithreaded(void);
 extern int fibril_test_spawn_runners(int);
+extern int fibril_set_runner_count(int);
 
 extern void fibril_detach(fid_t fid);
 
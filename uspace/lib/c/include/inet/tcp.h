@@ -39,6 +39,8 @@
 #include <inet/addr.h>
 #include <inet/endpoint.h>
 #include <inet/inet.h>
+#include <ipc/tcp.h>
+#include <stdbool.h>
 
 /** TCP connection */
 typedef struct {
@@ -116,6 +118,11 @@ extern errno_t tcp_conn_reset(tcp_conn_t *);
 
 extern errno_t tcp_conn_recv(tcp_conn_t *, void *, size_t, size_t *);
 extern errno_t tcp_conn_recv_wait(tcp_conn_t *, void *, size_t, size_t *);
+extern errno_t tcp_conn_get_stats(tcp_conn_t *, tcp_conn_stats_t *);
+extern errno_t tcp_conn_set_buf_size(tcp_conn_t *, size_t, size_t);
+extern errno_t tcp_conn_set_nodelay(tcp_conn_t *, bool);
+extern errno_t tcp_conn_cork(tcp_conn_t *);
+extern errno_t tcp_conn_uncork(tcp_conn_t *);
 
 #endif
 
@@ -36,6 +36,7 @@
 #define _LIBC_IPC_TCP_H_
 
 #include <ipc/common.h>
+#include <stdint.h>
 
 typedef enum {
 	TCP_CALLBACK_CREATE = IPC_FIRST_USER_METHOD,
@@ -48,7 +49,11 @@ typedef enum {
 	TCP_CONN_PUSH,
 	TCP_CONN_RESET,
 	TCP_CONN_RECV,
-	TCP_CONN_RECV_WAIT
+	TCP_CONN_RECV_WAIT,
+	TCP_CONN_GET_STATS,
+	TCP_CONN_SET_BUF_SIZE,
+	TCP_CONN_SET_NODELAY,
+	TCP_CONN_SET_CORK
 } tcp_request_t;
 
 typedef enum {
@@ -60,6 +65,30 @@ typedef enum {
 	TCP_EV_NEW_CONN
 } tcp_event_t;
 
+/** TCP connection statistics */
+typedef struct {
+	/** Congestion window (bytes) */
+	uint32_t cwnd;
+	/** Slow start threshold (bytes) */
+	uint32_t ssthresh;
+	/** Send window advertised by peer (bytes) */
+	uint32_t snd_wnd;
+	/** Bytes sent but not yet acknowledged */
+	uint32_t flight;
+	/** Smoothed round-trip time (usec), zero if not measured yet */
+	uint64_t srtt;
+	/** Round-trip time variation (usec) */
+	uint64_t rttvar;
+	/** Current retransmission timeout (usec) */
+	uint64_t rto;
+	/** Number of retransmitted segments */
+	uint32_t retransmits;
+	/** Number of fast retransmits */
+	uint32_t fast_retransmits;
+	/** Number of retransmission timeouts */
+	uint32_t timeouts;
+} tcp_conn_stats_t;
+
 #endif
 
 /** @}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <pcut/pcut.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(fibril_timeout);
+
+#define SLEEPERS 16
+#define WAITERS 256
+
+typedef struct {
+	fibril_semaphore_t *sem;
+	fibril_semaphore_t *done;
+	usec_t timeout;
+	errno_t rc;
+} waiter_t;
+
+static fibril_semaphore_t sleepers_done;
+static int wake_order[SLEEPERS];
+static int wake_count;
+
+static errno_t sleeper_fn(void *arg)
+{
+	int i = (int) (uintptr_t) arg;
+
+	/* Deadlines are in the opposite order than fibrils go to sleep. */
+	fibril_usleep((SLEEPERS - i) * 2000);
+	wake_order[wake_count++] = i;
+	fibril_semaphore_up(&sleepers_done);
+	return EOK;
+}
+
+static errno_t waiter_fn(void *arg)
+{
+	waiter_t *w = arg;
+
+	w->rc = fibril_semaphore_down_timeout(w->sem, w->timeout);
+	fibril_semaphore_up(w->done);
+	return EOK;
+}
+
+static void start_waiters(waiter_t *w, fibril_semaphore_t *sem,
+    fibril_semaphore_t *done, usec_t timeout, usec_t step)
+{
+	for (int i = 0; i < WAITERS; i++) {
+		w[i].sem = sem;
+		w[i].done = done;
+		w[i].timeout = timeout + i * step;
+		w[i].rc = EINVAL;
+
+		fid_t fid = fibril_create(waiter_fn, &w[i]);
+		PCUT_ASSERT_NOT_NULL(fid);
+		fibril_add_ready(fid);
+	}
+}
+
+/** Timeouts fire in the order of their deadlines. */
+PCUT_TEST(expire_in_order)
+{
+	fibril_semaphore_initialize(&sleepers_done, 0);
+	wake_count = 0;
+
+	for (int i = 0; i < SLEEPERS; i++) {
+		fid_t fid = fibril_create(sleeper_fn, (void *) (uintptr_t) i);
+		PCUT_ASSERT_NOT_NULL(fid);
+		fibril_add_ready(fid);
+	}
+
+	for (int i = 0; i < SLEEPERS; i++)
+		fibril_semaphore_down(&sleepers_done);
+
+	PCUT_ASSERT_INT_EQUALS(SLEEPERS, wake_count);
+	for (int i = 0; i < SLEEPERS; i++)
+		PCUT_ASSERT_INT_EQUALS(SLEEPERS - 1 - i, wake_order[i]);
+}
+
+/** Many waits time out. */
+PCUT_TEST(expire_many)
+{
+	static waiter_t w[WAITERS];
+	fibril_semaphore_t sem;
+	fibril_semaphore_t done;
+
+	fibril_semaphore_initialize(&sem, 0);
+	fibril_semaphore_initialize(&done, 0);
+
+	start_waiters(w, &sem, &done, 1000, 10);
+
+	for (int i = 0; i < WAITERS; i++)
+		fibril_semaphore_down(&done);
+
+	for (int i = 0; i < WAITERS; i++)
+		PCUT_ASSERT_ERRNO_VAL(ETIMEOUT, w[i].rc);
+}
+
+/** Waits that are satisfied before they time out cancel their timeouts. */
+PCUT_TEST(cancel_many)
+{
+	static waiter_t w[WAITERS];
+	fibril_semaphore_t sem;
+	fibril_semaphore_t done;
+
+	fibril_semaphore_initialize(&sem, 0);
+	fibril_semaphore_initialize(&done, 0);
+
+	start_waiters(w, &sem, &done, 10 * 1000 * 1000, 1000);
+
+	/* Let all the waiters block. */
+	fibril_usleep(1000);
+
+	for (int i = 0; i < WAITERS; i++)
+		fibril_semaphore_up(&sem);
+
+	for (int i = 0; i < WAITERS; i++)
+		fibril_semaphore_down(&done);
+
+	for (int i = 0; i < WAITERS; i++)
+		PCUT_ASSERT_ERRNO_VAL(EOK, w[i].rc);
+}
+
+PCUT_EXPORT(fibril_timeout);
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <inet/addr.h>
+#include <inet/checksum.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(checksum);
+
+/** Size of the test buffer */
+#define CHECKSUM_BUF_SIZE 1500
+
+static uint8_t buf[CHECKSUM_BUF_SIZE + 1];
+
+/** Reference implementation, summing one 16-bit word at a time. */
+static uint16_t checksum_ref(uint16_t ivalue, const void *data, size_t size)
+{
+	const uint8_t *bdata = (const uint8_t *) data;
+	uint32_t sum;
+	size_t i;
+
+	sum = (uint16_t) ~ivalue;
+	for (i = 0; i + 1 < size; i += 2) {
+		sum += ((uint16_t) bdata[i] << 8) | bdata[i + 1];
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	if (size % 2 != 0) {
+		sum += (uint16_t) bdata[size - 1] << 8;
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return ~sum;
+}
+
+/** Fill test buffer with pseudo-random data. */
+static void checksum_fill(unsigned seed)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(buf); i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = seed >> 16;
+	}
+}
+
+/** Checksum of data of all sizes and alignments matches reference */
+PCUT_TEST(calc)
+{
+	size_t size;
+	size_t offs;
+
+	checksum_fill(1);
+
+	for (offs = 0; offs < 8; offs++) {
+		for (size = 0; size <= 80; size++) {
+			PCUT_ASSERT_INT_EQUALS(
+			    checksum_ref(INET_CHECKSUM_INIT, buf + offs, size),
+			    inet_checksum_calc(INET_CHECKSUM_INIT, buf + offs,
+			    size));
+		}
+	}
+
+	PCUT_ASSERT_INT_EQUALS(
+	    checksum_ref(INET_CHECKSUM_INIT, buf + 1, CHECKSUM_BUF_SIZE),
+	    inet_checksum_calc(INET_CHECKSUM_INIT, buf + 1,
+	    CHECKSUM_BUF_SIZE));
+}
+
+/** Known checksum value (RFC 1071 sec. 3 example) */
+PCUT_TEST(calc_known)
+{
+	uint8_t data[] = { 0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7 };
+
+	PCUT_ASSERT_INT_EQUALS((uint16_t) ~0xddf2,
+	    inet_checksum_calc(INET_CHECKSUM_INIT, data, sizeof(data)));
+}
+
+/** Checksum can be computed in several steps */
+PCUT_TEST(calc_chained)
+{
+	uint16_t cs;
+
+	checksum_fill(2);
+
+	cs = inet_checksum_calc(INET_CHECKSUM_INIT, buf, 20);
+	cs = inet_checksum_calc(cs, buf + 20, 6);
+	cs = inet_checksum_calc(cs, buf + 26, 999);
+
+	PCUT_ASSERT_INT_EQUALS(checksum_ref(INET_CHECKSUM_INIT, buf, 1025),
+	    cs);
+}
+
+/** Pseudo header checksum matches checksum of pseudo header in memory */
+PCUT_TEST(phdr)
+{
+	inet_addr_t src;
+	inet_addr_t dest;
+	uint8_t phdr[40];
+
+	inet_addr(&src, 10, 0, 2, 15);
+	inet_addr(&dest, 192, 168, 1, 1);
+
+	/* IPv4: source, destination, zero, protocol, length */
+	uint8_t phdr4[] = {
+		10, 0, 2, 15, 192, 168, 1, 1, 0, 6, 0x05, 0xdc
+	};
+
+	PCUT_ASSERT_INT_EQUALS(
+	    checksum_ref(INET_CHECKSUM_INIT, phdr4, sizeof(phdr4)),
+	    inet_checksum_phdr(INET_CHECKSUM_INIT, &src, &dest, 6, 1500));
+
+	inet_addr6(&src, 0xfe80, 0, 0, 0, 0x1234, 0x5678, 0x9abc, 0xdef0);
+	inet_addr6(&dest, 0x2001, 0xdb8, 0, 0, 0, 0, 0, 0xffff);
+
+	/* IPv6: source, destination, length (32 bits), zero, next header */
+	memcpy(phdr, src.addr6, 16);
+	memcpy(phdr + 16, dest.addr6, 16);
+	phdr[32] = 0x00;
+	phdr[33] = 0x01;
+	phdr[34] = 0x23;
+	phdr[35] = 0x45;
+	phdr[36] = 0;
+	phdr[37] = 0;
+	phdr[38] = 0;
+	phdr[39] = 17;
+
+	PCUT_ASSERT_INT_EQUALS(
+	    checksum_ref(INET_CHECKSUM_INIT, phdr, sizeof(phdr)),
+	    inet_checksum_phdr(INET_CHECKSUM_INIT, &src, &dest, 17, 0x12345));
+}
+
+/** Incremental update gives the same result as full computation */
+PCUT_TEST(update)
+{
+	uint8_t old[4];
+	uint16_t cs;
+	unsigned i;
+
+	checksum_fill(3);
+
+	for (i = 0; i < 64; i++) {
+		cs = inet_checksum_calc(INET_CHECKSUM_INIT, buf, 64);
+
+		/* Change a 16-bit word */
+		old[0] = buf[2 * i % 64];
+		old[1] = buf[2 * i % 64 + 1];
+		buf[2 * i % 64] += 37 * i;
+		buf[2 * i % 64 + 1] ^= i;
+
+		cs = inet_checksum_update16(cs, (old[0] << 8) | old[1],
+		    (buf[2 * i % 64] << 8) | buf[2 * i % 64 + 1]);
+		PCUT_ASSERT_INT_EQUALS(
+		    inet_checksum_calc(INET_CHECKSUM_INIT, buf, 64), cs);
+
+		/* Change a 32-bit block */
+		memcpy(old, buf + 4 * (i % 16), 4);
+		buf[4 * (i % 16)] = i;
+		buf[4 * (i % 16) + 3] = ~i;
+
+		cs = inet_checksum_update(cs, old, buf + 4 * (i % 16), 4);
+		PCUT_ASSERT_INT_EQUALS(
+		    inet_checksum_calc(INET_CHECKSUM_INIT, buf, 64), cs);
+	}
+}
+
+PCUT_EXPORT(checksum);
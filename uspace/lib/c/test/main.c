@@ -32,7 +32,9 @@
 PCUT_INIT;
 
 PCUT_IMPORT(casting);
+PCUT_IMPORT(checksum);
 PCUT_IMPORT(circ_buf);
+PCUT_IMPORT(fibril_timeout);
 PCUT_IMPORT(fibril_timer);
 PCUT_IMPORT(inttypes);
 PCUT_IMPORT(mem);
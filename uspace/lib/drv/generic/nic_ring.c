@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libdrv
+ * @{
+ */
+/** @file Shared memory receive ring between NIC driver and its client
+ *
+ * Single producer, single consumer ring. The driver copies received
+ * frames into the slot buffers and advances the head index, the client
+ * processes them in place and advances the tail index. The client only
+ * needs to be notified (by an IPC message) when it has run out of frames
+ * and asked for notification, so under load many frames are passed for
+ * each notification.
+ */
+
+#include <assert.h>
+#include <barrier.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdint.h>
+#include "nic_ring.h"
+
+/** Maximum number of slots accepted by the driver */
+#define NIC_RING_SLOTS_MAX 65536
+
+/** Compute offset of the first frame buffer in a ring.
+ *
+ * @param slots Number of slots
+ * @return Offset in bytes
+ */
+static size_t nic_ring_buf_offs(uint32_t slots)
+{
+	size_t offs;
+
+	offs = sizeof(nic_ring_t) + slots * sizeof(nic_ring_desc_t);
+	/* Align frame buffers to a cache line */
+	return (offs + 63) & ~(size_t) 63;
+}
+
+/** Get pointer to frame buffer of a ring slot.
+ *
+ * @param ring     Ring
+ * @param buf_offs Offset of the first frame buffer
+ * @param buf_size Size of one frame buffer
+ * @param idx      Slot index
+ * @return Pointer to the frame buffer
+ */
+static void *nic_ring_buf(nic_ring_t *ring, uint32_t buf_offs,
+    uint32_t buf_size, uint32_t idx)
+{
+	return (uint8_t *) ring + buf_offs + (size_t) idx * buf_size;
+}
+
+/** Compute size of memory area needed for a receive ring.
+ *
+ * @param slots    Number of slots (power of two)
+ * @param buf_size Size of one frame buffer in bytes
+ * @return Size in bytes
+ */
+size_t nic_ring_area_size(uint32_t slots, uint32_t buf_size)
+{
+	return nic_ring_buf_offs(slots) + (size_t) slots * buf_size;
+}
+
+/** Initialize receive ring.
+ *
+ * Called by the client before sharing the ring with the driver.
+ *
+ * @param ring     Ring at the start of an area of at least
+ *                 nic_ring_area_size(@a slots, @a buf_size) bytes
+ * @param slots    Number of slots (power of two)
+ * @param buf_size Size of one frame buffer in bytes
+ */
+void nic_ring_init(nic_ring_t *ring, uint32_t slots, uint32_t buf_size)
+{
+	assert(slots != 0 && (slots & (slots - 1)) == 0);
+
+	ring->slots = slots;
+	ring->buf_size = buf_size;
+	ring->buf_offs = nic_ring_buf_offs(slots);
+	ring->head = 0;
+	ring->tail = 0;
+	ring->notify = 0;
+	ring->dropped = 0;
+}
+
+/** Attach driver to a receive ring shared by the client.
+ *
+ * @param prod Producer structure to initialize
+ * @param area Shared memory area
+ * @param size Size of the shared area in bytes
+ * @return EOK on success, EINVAL if the ring layout is not valid
+ */
+errno_t nic_ring_prod_attach(nic_ring_prod_t *prod, void *area, size_t size)
+{
+	nic_ring_t *ring = (nic_ring_t *) area;
+	uint32_t slots;
+	uint32_t buf_size;
+	uint32_t buf_offs;
+
+	if (size < sizeof(nic_ring_t))
+		return EINVAL;
+
+	slots = ACCESS_ONCE(ring->slots);
+	buf_size = ACCESS_ONCE(ring->buf_size);
+	buf_offs = ACCESS_ONCE(ring->buf_offs);
+
+	if (slots == 0 || slots > NIC_RING_SLOTS_MAX ||
+	    (slots & (slots - 1)) != 0 || buf_size == 0)
+		return EINVAL;
+
+	if (buf_offs < sizeof(nic_ring_t) + slots * sizeof(nic_ring_desc_t))
+		return EINVAL;
+
+	if ((uint64_t) buf_offs + (uint64_t) slots * buf_size > size)
+		return EINVAL;
+
+	prod->ring = ring;
+	prod->area_size = size;
+	prod->slots = slots;
+	prod->buf_size = buf_size;
+	prod->buf_offs = buf_offs;
+	prod->head = ACCESS_ONCE(ring->head);
+	return EOK;
+}
+
+/** Put frame into receive ring.
+ *
+ * The frame is not visible to the client until nic_ring_publish()
+ * is called.
+ *
+ * @param prod Producer
+ * @param data Frame data
+ * @param size Frame size in bytes
+ * @return EOK on success, EINVAL if the frame does not fit into a slot
+ *         buffer, ELIMIT if the ring is full
+ */
+errno_t nic_ring_put(nic_ring_prod_t *prod, const void *data, size_t size)
+{
+	nic_ring_t *ring = prod->ring;
+	uint32_t tail;
+	uint32_t idx;
+
+	if (size > prod->buf_size)
+		return EINVAL;
+
+	tail = ACCESS_ONCE(ring->tail);
+	/* Do not overwrite the slot before the client is done with it */
+	read_barrier();
+
+	if (prod->head - tail >= prod->slots) {
+		ACCESS_ONCE(ring->dropped)++;
+		return ELIMIT;
+	}
+
+	idx = prod->head & (prod->slots - 1);
+	memcpy(nic_ring_buf(ring, prod->buf_offs, prod->buf_size, idx), data,
+	    size);
+	ring->desc[idx].size = size;
+	++prod->head;
+
+	return EOK;
+}
+
+/** Make frames put into the ring visible to the client.
+ *
+ * @param prod Producer
+ * @return @c true if the client asked to be notified and a notification
+ *         should be sent to it
+ */
+bool nic_ring_publish(nic_ring_prod_t *prod)
+{
+	nic_ring_t *ring = prod->ring;
+
+	/* Frame data must be visible before the head index */
+	write_barrier();
+	ACCESS_ONCE(ring->head) = prod->head;
+
+	/* Pairs with the barrier in nic_ring_wait_prepare() */
+	memory_barrier();
+
+	if (ACCESS_ONCE(ring->notify) != 0) {
+		ACCESS_ONCE(ring->notify) = 0;
+		return true;
+	}
+
+	return false;
+}
+
+/** Attach client to a receive ring.
+ *
+ * @param cons Consumer structure to initialize
+ * @param ring Ring
+ */
+void nic_ring_cons_attach(nic_ring_cons_t *cons, nic_ring_t *ring)
+{
+	cons->ring = ring;
+	cons->tail = ring->tail;
+}
+
+/** Get next frame from receive ring.
+ *
+ * The frame stays in the ring buffer until nic_ring_release() is called.
+ *
+ * @param cons  Consumer
+ * @param rdata Place to store pointer to frame data
+ * @param rsize Place to store frame size
+ * @return @c true if a frame was returned, @c false if the ring is empty
+ */
+bool nic_ring_get(nic_ring_cons_t *cons, void **rdata, size_t *rsize)
+{
+	nic_ring_t *ring = cons->ring;
+	uint32_t idx;
+
+	if (ACCESS_ONCE(ring->head) == cons->tail)
+		return false;
+
+	/* Do not read the frame before it has been published */
+	read_barrier();
+
+	idx = cons->tail & (ring->slots - 1);
+	*rdata = nic_ring_buf(ring, ring->buf_offs, ring->buf_size, idx);
+	*rsize = min(ring->desc[idx].size, ring->buf_size);
+	return true;
+}
+
+/** Return slot of the frame obtained by nic_ring_get() to the driver.
+ *
+ * @param cons Consumer
+ */
+void nic_ring_release(nic_ring_cons_t *cons)
+{
+	/* Finish reading the frame before the driver may reuse the slot */
+	write_barrier();
+	ACCESS_ONCE(cons->ring->tail) = ++cons->tail;
+}
+
+/** Ask for notification before waiting for more frames.
+ *
+ * @param cons Consumer
+ * @return @c true if the ring is empty and the client should wait for
+ *         notification, @c false if more frames have arrived meanwhile
+ */
+bool nic_ring_wait_prepare(nic_ring_cons_t *cons)
+{
+	nic_ring_t *ring = cons->ring;
+
+	ACCESS_ONCE(ring->notify) = 1;
+
+	/* Pairs with the barrier in nic_ring_publish() */
+	memory_barrier();
+
+	return ACCESS_ONCE(ring->head) == cons->tail;
+}
+
+/** @}
+ */
@@ -34,6 +34,7 @@
  * @brief Driver-side RPC skeletons for DDF NIC interface
  */
 
+#include <as.h>
 #include <assert.h>
 #include <async.h>
 #include <errno.h>
@@ -85,7 +86,8 @@ typedef enum {
 	NIC_OFFLOAD_SET,
 	NIC_POLL_GET_MODE,
 	NIC_POLL_SET_MODE,
-	NIC_POLL_NOW
+	NIC_POLL_NOW,
+	NIC_RX_RING_CREATE
 } nic_funcs_t;
 
 /** Send frame from NIC
@@ -1335,6 +1337,40 @@ errno_t nic_poll_now(async_sess_t *dev_sess)
 	return rc;
 }
 
+/** Share receive ring with the driver.
+ *
+ * Once the ring is set up, the driver passes received frames through
+ * the ring instead of sending them in @c NIC_EV_RECEIVED events, and
+ * sends @c NIC_EV_RX_RING when the client asks to be notified.
+ *
+ * @param[in] dev_sess
+ * @param[in] area     Memory area containing an initialized ring
+ *                     (see nic_ring_init())
+ *
+ * @return EOK If the operation was successfully completed
+ *
+ */
+errno_t nic_rx_ring_create(async_sess_t *dev_sess, void *area)
+{
+	async_exch_t *exch = async_exchange_begin(dev_sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, DEV_IFACE_ID(NIC_DEV_IFACE),
+	    NIC_RX_RING_CREATE, &answer);
+	errno_t rc = async_share_out_start(exch, area,
+	    AS_AREA_READ | AS_AREA_WRITE);
+
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	async_wait_for(req, &rc);
+	return rc;
+}
+
 static void remote_nic_send_frame(ddf_fun_t *dev, void *iface,
     ipc_call_t *call)
 {
@@ -2485,6 +2521,40 @@ static void remote_nic_poll_now(ddf_fun_t *dev, void *iface,
 	async_answer_0(call, rc);
 }
 
+static void remote_nic_rx_ring_create(ddf_fun_t *dev, void *iface,
+    ipc_call_t *call)
+{
+	nic_iface_t *nic_iface = (nic_iface_t *) iface;
+	ipc_call_t data;
+	size_t size;
+	unsigned int flags;
+	void *area;
+	errno_t rc;
+
+	if (!async_share_out_receive(&data, &size, &flags)) {
+		async_answer_0(call, EINVAL);
+		return;
+	}
+
+	if (nic_iface->rx_ring_create == NULL) {
+		async_answer_0(&data, ENOTSUP);
+		async_answer_0(call, ENOTSUP);
+		return;
+	}
+
+	rc = async_share_out_finalize(&data, &area);
+	if (rc != EOK) {
+		async_answer_0(call, rc);
+		return;
+	}
+
+	rc = nic_iface->rx_ring_create(dev, area, size);
+	if (rc != EOK)
+		as_area_destroy(area);
+
+	async_answer_0(call, rc);
+}
+
 /** Remote NIC interface operations.
  *
  */
@@ -2529,7 +2599,8 @@ static const remote_iface_func_ptr_t remote_nic_iface_ops[] = {
 	[NIC_OFFLOAD_SET] = remote_nic_offload_set,
 	[NIC_POLL_GET_MODE] = remote_nic_poll_get_mode,
 	[NIC_POLL_SET_MODE] = remote_nic_poll_set_mode,
-	[NIC_POLL_NOW] = remote_nic_poll_now
+	[NIC_POLL_NOW] = remote_nic_poll_now,
+	[NIC_RX_RING_CREATE] = remote_nic_rx_ring_create
 };
 
 /** Remote NIC interface structure.
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libdrv
+ * @{
+ */
+/** @file Shared memory receive ring between NIC driver and its client
+ */
+
+#ifndef LIBDRV_NIC_RING_H_
+#define LIBDRV_NIC_RING_H_
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Default number of slots in a receive ring */
+#define NIC_RING_SLOTS 256
+/** Default size of a receive ring frame buffer */
+#define NIC_RING_BUF_SIZE 2048
+
+/** Receive ring slot descriptor */
+typedef struct {
+	/** Size of the frame in the slot buffer in bytes */
+	uint32_t size;
+} nic_ring_desc_t;
+
+/** Receive ring.
+ *
+ * Lives at the start of a memory area the client shares with the driver,
+ * followed by the slot descriptors and the slot frame buffers. The driver
+ * produces frames at @c head, the client consumes them at @c tail. Both
+ * indices run freely and are taken modulo the number of slots.
+ */
+typedef struct {
+	/** Number of slots (power of two) */
+	uint32_t slots;
+	/** Size of one slot frame buffer in bytes */
+	uint32_t buf_size;
+	/** Offset of the first frame buffer from the start of the ring */
+	uint32_t buf_offs;
+	/** Index of the next slot to fill, written by the driver only */
+	uint32_t head;
+	/** Index of the next slot to consume, written by the client only */
+	uint32_t tail;
+	/** Client wants to be notified when @c head moves */
+	uint32_t notify;
+	/** Number of frames dropped because the ring was full */
+	uint32_t dropped;
+	/** Slot descriptors */
+	nic_ring_desc_t desc[];
+} nic_ring_t;
+
+/** Driver (producer) side of a receive ring.
+ *
+ * The ring geometry is copied when the ring is attached, so that the
+ * client cannot make the driver write outside of the shared area.
+ */
+typedef struct {
+	/** Ring */
+	nic_ring_t *ring;
+	/** Size of the shared area in bytes */
+	size_t area_size;
+	/** Number of slots */
+	uint32_t slots;
+	/** Size of one slot frame buffer in bytes */
+	uint32_t buf_size;
+	/** Offset of the first frame buffer */
+	uint32_t buf_offs;
+	/** Index of the next slot to fill */
+	uint32_t head;
+} nic_ring_prod_t;
+
+/** Client (consumer) side of a receive ring. */
+typedef struct {
+	/** Ring */
+	nic_ring_t *ring;
+	/** Index of the next slot to consume */
+	uint32_t tail;
+} nic_ring_cons_t;
+
+extern size_t nic_ring_area_size(uint32_t, uint32_t);
+extern void nic_ring_init(nic_ring_t *, uint32_t, uint32_t);
+
+extern errno_t nic_ring_prod_attach(nic_ring_prod_t *, void *, size_t);
+extern errno_t nic_ring_put(nic_ring_prod_t *, const void *, size_t);
+extern bool nic_ring_publish(nic_ring_prod_t *);
+
+extern void nic_ring_cons_attach(nic_ring_cons_t *, nic_ring_t *);
+extern bool nic_ring_get(nic_ring_cons_t *, void **, size_t *);
+extern void nic_ring_release(nic_ring_cons_t *);
+extern bool nic_ring_wait_prepare(nic_ring_cons_t *);
+
+#endif
+
+/** @}
+ */
@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <mem.h>
+#include <nic_ring.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(nic_ring);
+
+/** Number of slots in the test ring */
+#define TEST_SLOTS 4
+/** Size of a slot frame buffer in the test ring */
+#define TEST_BUF_SIZE 64
+
+/** Test ring with both of its sides attached */
+typedef struct {
+	nic_ring_t *ring;
+	size_t size;
+	nic_ring_prod_t prod;
+	nic_ring_cons_t cons;
+} test_ring_t;
+
+/** Create test ring with head and tail starting at @a start. */
+static void test_ring_create(test_ring_t *tr, uint32_t start)
+{
+	errno_t rc;
+
+	tr->size = nic_ring_area_size(TEST_SLOTS, TEST_BUF_SIZE);
+	tr->ring = calloc(1, tr->size);
+	PCUT_ASSERT_NOT_NULL(tr->ring);
+
+	nic_ring_init(tr->ring, TEST_SLOTS, TEST_BUF_SIZE);
+	tr->ring->head = start;
+	tr->ring->tail = start;
+
+	rc = nic_ring_prod_attach(&tr->prod, tr->ring, tr->size);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	nic_ring_cons_attach(&tr->cons, tr->ring);
+}
+
+/** Fill frame buffer with a pattern derived from @a seq. */
+static void test_frame_fill(uint8_t *buf, size_t size, unsigned seq)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = seq + i;
+}
+
+/** Put frame number @a seq of size depending on it into the ring. */
+static errno_t test_put(test_ring_t *tr, unsigned seq)
+{
+	uint8_t buf[TEST_BUF_SIZE];
+	size_t size = 1 + seq % TEST_BUF_SIZE;
+
+	test_frame_fill(buf, size, seq);
+	return nic_ring_put(&tr->prod, buf, size);
+}
+
+/** Get next frame from the ring, check it is frame @a seq and release it. */
+static void test_get(test_ring_t *tr, unsigned seq)
+{
+	uint8_t buf[TEST_BUF_SIZE];
+	size_t size = 1 + seq % TEST_BUF_SIZE;
+	void *data;
+	size_t rsize;
+
+	PCUT_ASSERT_TRUE(nic_ring_get(&tr->cons, &data, &rsize));
+	PCUT_ASSERT_INT_EQUALS(size, rsize);
+
+	test_frame_fill(buf, size, seq);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(buf, data, size));
+
+	nic_ring_release(&tr->cons);
+}
+
+/** Producer rejects rings whose layout does not fit into the area */
+PCUT_TEST(prod_attach_invalid)
+{
+	nic_ring_prod_t prod;
+	nic_ring_t *ring;
+	size_t size;
+	errno_t rc;
+
+	size = nic_ring_area_size(TEST_SLOTS, TEST_BUF_SIZE);
+	ring = calloc(1, size);
+	PCUT_ASSERT_NOT_NULL(ring);
+
+	nic_ring_init(ring, TEST_SLOTS, TEST_BUF_SIZE);
+	rc = nic_ring_prod_attach(&prod, ring, size);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = nic_ring_prod_attach(&prod, ring, size - 1);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	rc = nic_ring_prod_attach(&prod, ring, sizeof(nic_ring_t) - 1);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	ring->slots = TEST_SLOTS - 1;
+	rc = nic_ring_prod_attach(&prod, ring, size);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	ring->slots = TEST_SLOTS;
+	ring->buf_size = 0;
+	rc = nic_ring_prod_attach(&prod, ring, size);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	ring->buf_size = TEST_BUF_SIZE;
+	ring->buf_offs = sizeof(nic_ring_t);
+	rc = nic_ring_prod_attach(&prod, ring, size);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	free(ring);
+}
+
+/** Newly initialized ring is empty */
+PCUT_TEST(empty)
+{
+	test_ring_t tr;
+	void *data;
+	size_t size;
+
+	test_ring_create(&tr, 0);
+
+	PCUT_ASSERT_FALSE(nic_ring_get(&tr.cons, &data, &size));
+	PCUT_ASSERT_TRUE(nic_ring_wait_prepare(&tr.cons));
+
+	free(tr.ring);
+}
+
+/** Frames become visible only when published and come out in order */
+PCUT_TEST(fill)
+{
+	test_ring_t tr;
+	void *data;
+	size_t size;
+	unsigned i;
+	errno_t rc;
+
+	test_ring_create(&tr, 0);
+
+	for (i = 0; i < TEST_SLOTS; i++) {
+		rc = test_put(&tr, i);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	}
+
+	PCUT_ASSERT_FALSE(nic_ring_get(&tr.cons, &data, &size));
+
+	PCUT_ASSERT_FALSE(nic_ring_publish(&tr.prod));
+
+	for (i = 0; i < TEST_SLOTS; i++)
+		test_get(&tr, i);
+
+	PCUT_ASSERT_FALSE(nic_ring_get(&tr.cons, &data, &size));
+	PCUT_ASSERT_INT_EQUALS(0, tr.ring->dropped);
+
+	free(tr.ring);
+}
+
+/** Frames are dropped while the ring is full */
+PCUT_TEST(full)
+{
+	test_ring_t tr;
+	unsigned i;
+	errno_t rc;
+
+	test_ring_create(&tr, 0);
+
+	for (i = 0; i < TEST_SLOTS; i++) {
+		rc = test_put(&tr, i);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	}
+
+	rc = test_put(&tr, TEST_SLOTS);
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, rc);
+	PCUT_ASSERT_INT_EQUALS(1, tr.ring->dropped);
+
+	(void) nic_ring_publish(&tr.prod);
+
+	/* Releasing one slot makes room for one frame */
+	test_get(&tr, 0);
+
+	rc = test_put(&tr, TEST_SLOTS);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = test_put(&tr, TEST_SLOTS + 1);
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, rc);
+	PCUT_ASSERT_INT_EQUALS(2, tr.ring->dropped);
+
+	(void) nic_ring_publish(&tr.prod);
+
+	for (i = 1; i <= TEST_SLOTS; i++)
+		test_get(&tr, i);
+
+	free(tr.ring);
+}
+
+/** Frames larger than a slot buffer are rejected */
+PCUT_TEST(put_too_big)
+{
+	test_ring_t tr;
+	uint8_t buf[TEST_BUF_SIZE + 1];
+	errno_t rc;
+
+	test_ring_create(&tr, 0);
+
+	memset(buf, 0, sizeof(buf));
+	rc = nic_ring_put(&tr.prod, buf, sizeof(buf));
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+	PCUT_ASSERT_INT_EQUALS(0, tr.ring->dropped);
+
+	rc = nic_ring_put(&tr.prod, buf, TEST_BUF_SIZE);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	free(tr.ring);
+}
+
+/** Slot indices wrap around the ring */
+PCUT_TEST(wraparound)
+{
+	test_ring_t tr;
+	unsigned i;
+	errno_t rc;
+
+	test_ring_create(&tr, 0);
+
+	for (i = 0; i < 5 * TEST_SLOTS; i++) {
+		rc = test_put(&tr, i);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		(void) nic_ring_publish(&tr.prod);
+
+		/* Keep the ring nearly full */
+		if (i >= TEST_SLOTS - 1)
+			test_get(&tr, i - (TEST_SLOTS - 1));
+	}
+
+	for (i = 4 * TEST_SLOTS + 1; i < 5 * TEST_SLOTS; i++)
+		test_get(&tr, i);
+
+	free(tr.ring);
+}
+
+/** Head and tail indices wrap around the 32-bit range */
+PCUT_TEST(index_overflow)
+{
+	test_ring_t tr;
+	void *data;
+	size_t size;
+	unsigned i;
+	errno_t rc;
+
+	test_ring_create(&tr, UINT32_MAX - 1);
+
+	for (i = 0; i < TEST_SLOTS; i++) {
+		rc = test_put(&tr, i);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	}
+
+	rc = test_put(&tr, TEST_SLOTS);
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, rc);
+
+	(void) nic_ring_publish(&tr.prod);
+
+	for (i = 0; i < TEST_SLOTS; i++)
+		test_get(&tr, i);
+
+	PCUT_ASSERT_FALSE(nic_ring_get(&tr.cons, &data, &size));
+	PCUT_ASSERT_INT_EQUALS(TEST_SLOTS - 2, tr.ring->tail);
+
+	free(tr.ring);
+}
+
+/** Publishing notifies the client only after it has asked for it */
+PCUT_TEST(notify)
+{
+	test_ring_t tr;
+	errno_t rc;
+
+	test_ring_create(&tr, 0);
+
+	PCUT_ASSERT_TRUE(nic_ring_wait_prepare(&tr.cons));
+
+	rc = test_put(&tr, 0);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_TRUE(nic_ring_publish(&tr.prod));
+
+	/* The request is consumed by the notification */
+	rc = test_put(&tr, 1);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_FALSE(nic_ring_publish(&tr.prod));
+
+	/* Frames arrived meanwhile, no need to wait */
+	PCUT_ASSERT_FALSE(nic_ring_wait_prepare(&tr.cons));
+
+	test_get(&tr, 0);
+	test_get(&tr, 1);
+
+	PCUT_ASSERT_TRUE(nic_ring_wait_prepare(&tr.cons));
+
+	free(tr.ring);
+}
+
+PCUT_EXPORT(nic_ring);
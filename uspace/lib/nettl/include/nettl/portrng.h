@@ -36,21 +36,33 @@
 #ifndef LIBNETTL_PORTRNG_H_
 #define LIBNETTL_PORTRNG_H_
 
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /** Allocated port */
 typedef struct {
 	/** Link to portrng_t.used */
 	link_t lprng;
+	/** Link to portrng_t.index */
+	ht_link_t lindex;
 	/** Port number */
 	uint16_t pn;
 	/** User argument */
 	void *arg;
 } portrng_port_t;
 
+/** Port range */
 typedef struct {
 	list_t used; /* of portrng_port_t */
+	/** Number of allocated ports */
+	size_t count;
+	/** Allocated ports by number, NULL while there are only a few */
+	hash_table_t *index;
+	/** Dynamic port number to try allocating next */
+	uint16_t dyn_next;
 } portrng_t;
 
 typedef enum {
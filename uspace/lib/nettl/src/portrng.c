@@ -36,6 +36,7 @@
  * Allocates port numbers from IETF port number ranges.
  */
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <errno.h>
 #include <inet/endpoint.h>
@@ -45,6 +46,86 @@
 
 #include <io/log.h>
 
+/** Number of allocated ports above which they are indexed by number */
+#define PORTRNG_INDEX_MIN 16
+
+static size_t portrng_key_hash(void *key)
+{
+	return *(uint16_t *) key;
+}
+
+static size_t portrng_hash(const ht_link_t *item)
+{
+	portrng_port_t *port = hash_table_get_inst(item, portrng_port_t,
+	    lindex);
+	return port->pn;
+}
+
+static bool portrng_key_equal(void *key, const ht_link_t *item)
+{
+	portrng_port_t *port = hash_table_get_inst(item, portrng_port_t,
+	    lindex);
+	return port->pn == *(uint16_t *) key;
+}
+
+/** Port range index operations */
+static hash_table_ops_t portrng_index_ops = {
+	.hash = portrng_hash,
+	.key_hash = portrng_key_hash,
+	.key_equal = portrng_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Index ports of a port range by number.
+ *
+ * Ranges with few ports are searched linearly. Once the number of ports
+ * grows, they are indexed in a hash table. Failure to create the index is
+ * not fatal, the range is then searched linearly.
+ *
+ * @param pr Port range
+ */
+static void portrng_index_create(portrng_t *pr)
+{
+	pr->index = malloc(sizeof(hash_table_t));
+	if (pr->index == NULL)
+		return;
+
+	if (!hash_table_create(pr->index, 0, 0, &portrng_index_ops)) {
+		free(pr->index);
+		pr->index = NULL;
+		return;
+	}
+
+	list_foreach(pr->used, lprng, portrng_port_t, port) {
+		hash_table_insert(pr->index, &port->lindex);
+	}
+}
+
+/** Find allocated port.
+ *
+ * @param pr   Port range
+ * @param pnum Port number
+ * @return Port or @c NULL if @a pnum is not allocated
+ */
+static portrng_port_t *portrng_port_find(portrng_t *pr, uint16_t pnum)
+{
+	if (pr->index != NULL) {
+		ht_link_t *link = hash_table_find(pr->index, &pnum);
+		if (link == NULL)
+			return NULL;
+
+		return hash_table_get_inst(link, portrng_port_t, lindex);
+	}
+
+	list_foreach(pr->used, lprng, portrng_port_t, port) {
+		if (port->pn == pnum)
+			return port;
+	}
+
+	return NULL;
+}
+
 /** Create port range.
  *
  * @param rpr Place to store pointer to new port range
@@ -61,6 +142,7 @@ errno_t portrng_create(portrng_t **rpr)
 		return ENOMEM;
 
 	list_initialize(&pr->used);
+	pr->dyn_next = inet_port_dyn_lo;
 	*rpr = pr;
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_create() - end");
 	return EOK;
@@ -74,6 +156,10 @@ void portrng_destroy(portrng_t *pr)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_destroy()");
 	assert(list_empty(&pr->used));
+	if (pr->index != NULL) {
+		hash_table_destroy(pr->index);
+		free(pr->index);
+	}
 	free(pr);
 }
 
@@ -97,32 +183,35 @@ errno_t portrng_alloc(portrng_t *pr, uint16_t pnum, void *arg,
 {
 	portrng_port_t *p;
 	uint32_t i;
-	bool found;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_alloc() - begin");
 
 	if (pnum == inet_port_any) {
+		/*
+		 * Continue where the last allocation stopped so that
+		 * allocating many ports does not rescan the used ones.
+		 */
+		uint16_t cand = pr->dyn_next;
 
 		for (i = inet_port_dyn_lo; i <= inet_port_dyn_hi; i++) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "trying %" PRIu32, i);
-			found = false;
-			list_foreach(pr->used, lprng, portrng_port_t, port) {
-				if (port->pn == pnum) {
-					found = true;
-					break;
-				}
-			}
-
-			if (!found) {
-				pnum = i;
+			if (portrng_port_find(pr, cand) == NULL) {
+				pnum = cand;
 				break;
 			}
+
+			if (cand == inet_port_dyn_hi)
+				cand = inet_port_dyn_lo;
+			else
+				cand++;
 		}
 
 		if (pnum == inet_port_any) {
 			/* No free port found */
 			return ENOENT;
 		}
+
+		pr->dyn_next = (pnum == inet_port_dyn_hi) ? inet_port_dyn_lo :
+		    pnum + 1;
 		log_msg(LOG_DEFAULT, LVL_DEBUG2, "selected %" PRIu16, pnum);
 	} else {
 		log_msg(LOG_DEFAULT, LVL_DEBUG2, "user asked for %" PRIu16, pnum);
@@ -133,11 +222,9 @@ errno_t portrng_alloc(portrng_t *pr, uint16_t pnum, void *arg,
 			return EINVAL;
 		}
 
-		list_foreach(pr->used, lprng, portrng_port_t, port) {
-			if (port->pn == pnum) {
-				log_msg(LOG_DEFAULT, LVL_DEBUG2, "port already used");
-				return EEXIST;
-			}
+		if (portrng_port_find(pr, pnum) != NULL) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG2, "port already used");
+			return EEXIST;
 		}
 	}
 
@@ -148,6 +235,12 @@ errno_t portrng_alloc(portrng_t *pr, uint16_t pnum, void *arg,
 	p->pn = pnum;
 	p->arg = arg;
 	list_append(&p->lprng, &pr->used);
+	pr->count++;
+
+	if (pr->index != NULL)
+		hash_table_insert(pr->index, &p->lindex);
+	else if (pr->count > PORTRNG_INDEX_MIN)
+		portrng_index_create(pr);
 	*apnum = pnum;
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_alloc() - end OK pn=%" PRIu16,
 	    pnum);
@@ -164,14 +257,14 @@ errno_t portrng_alloc(portrng_t *pr, uint16_t pnum, void *arg,
  */
 errno_t portrng_find_port(portrng_t *pr, uint16_t pnum, void **rarg)
 {
-	list_foreach(pr->used, lprng, portrng_port_t, port) {
-		if (port->pn == pnum) {
-			*rarg = port->arg;
-			return EOK;
-		}
-	}
+	portrng_port_t *port;
 
-	return ENOENT;
+	port = portrng_port_find(pr, pnum);
+	if (port == NULL)
+		return ENOENT;
+
+	*rarg = port->arg;
+	return EOK;
 }
 
 /** Free port in port range.
@@ -181,21 +274,22 @@ errno_t portrng_find_port(portrng_t *pr, uint16_t pnum, void **rarg)
  */
 void portrng_free_port(portrng_t *pr, uint16_t pnum)
 {
+	portrng_port_t *port;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port(%u)", pnum);
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port() - begin");
-	list_foreach(pr->used, lprng, portrng_port_t, port) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port - check port %u", port->pn);
-		if (port->pn == pnum) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port - OK");
-			list_remove(&port->lprng);
-			free(port);
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port() - end");
-			return;
-		}
+
+	port = portrng_port_find(pr, pnum);
+	if (port == NULL) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port - FAIL");
+		assert(false);
+		return;
 	}
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port - FAIL");
-	assert(false);
+	list_remove(&port->lprng);
+	if (pr->index != NULL)
+		hash_table_remove_item(pr->index, &port->lindex);
+	pr->count--;
+	free(port);
 }
 
 /** Determine if port range is empty.
@@ -205,7 +299,6 @@ void portrng_free_port(portrng_t *pr, uint16_t pnum)
  */
 bool portrng_empty(portrng_t *pr)
 {
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_empty()");
 	return list_empty(&pr->used);
 }
 
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <inet/addr.h>
+#include <inet/endpoint.h>
+#include <nettl/amap.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(amap);
+
+/** Number of connections in the large map test */
+#define AMAP_TEST_MANY 16384
+
+/** Fill in endpoint pair of a test connection.
+ *
+ * @param i   Connection number
+ * @param epp Endpoint pair
+ */
+static void amap_test_conn(int i, inet_ep2_t *epp)
+{
+	inet_ep2_init(epp);
+	inet_addr_set(0x0a000001, &epp->local.addr);
+	epp->local.port = 80;
+	inet_addr_set(0xc0a80000 + i / 1024, &epp->remote.addr);
+	epp->remote.port = inet_port_dyn_lo + i % 1024;
+}
+
+/** Insert connections into association map.
+ *
+ * @param map   Association map
+ * @param first Number of the first connection
+ * @param cnt   Number of connections
+ * @param arg   Array of user arguments indexed by connection number
+ */
+static void amap_test_insert(amap_t *map, int first, int cnt, int *arg)
+{
+	inet_ep2_t epp, aepp;
+	errno_t rc;
+	int i;
+
+	for (i = first; i < first + cnt; i++) {
+		amap_test_conn(i, &epp);
+		rc = amap_insert(map, &epp, &arg[i], af_allow_system, &aepp);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	}
+}
+
+/** Remove connections from association map.
+ *
+ * @param map   Association map
+ * @param cnt   Number of connections
+ */
+static void amap_test_remove(amap_t *map, int cnt)
+{
+	inet_ep2_t epp;
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		amap_test_conn(i, &epp);
+		amap_remove(map, &epp);
+	}
+}
+
+/** Look up connections in association map.
+ *
+ * @param map Association map
+ * @param cnt Number of connections in the map
+ * @param arg Array of user arguments indexed by connection number
+ */
+static void amap_test_lookups(amap_t *map, int cnt, int *arg)
+{
+	inet_ep2_t epp;
+	void *found;
+	errno_t rc;
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		amap_test_conn(i, &epp);
+		rc = amap_find_match(map, &epp, &found);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		PCUT_ASSERT_EQUALS(&arg[i], found);
+	}
+}
+
+/** Create and destroy association map */
+PCUT_TEST(create_destroy)
+{
+	amap_t *map;
+	errno_t rc;
+
+	rc = amap_create(&map);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	amap_destroy(map);
+}
+
+/** Connections take precedence over listeners */
+PCUT_TEST(find_match)
+{
+	amap_t *map;
+	inet_ep2_t epp, aepp, listen;
+	int conn, lconn, unspec;
+	void *found;
+	errno_t rc;
+
+	rc = amap_create(&map);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Listener on local address and port 80 */
+	inet_ep2_init(&listen);
+	inet_addr_set(0x0a000001, &listen.local.addr);
+	listen.local.port = 80;
+	rc = amap_insert(map, &listen, &lconn, af_allow_system, &aepp);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Listener on any address and port 8080 */
+	inet_ep2_init(&epp);
+	epp.local.port = 8080;
+	rc = amap_insert(map, &epp, &unspec, af_allow_system, &aepp);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Connection to port 80 */
+	amap_test_conn(0, &epp);
+	rc = amap_insert(map, &epp, &conn, af_allow_system, &aepp);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = amap_insert(map, &epp, &conn, af_allow_system, &aepp);
+	PCUT_ASSERT_ERRNO_VAL(EEXIST, rc);
+
+	rc = amap_find_match(map, &epp, &found);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_EQUALS(&conn, found);
+
+	/* Another remote endpoint matches the listener */
+	amap_test_conn(1, &epp);
+	rc = amap_find_match(map, &epp, &found);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_EQUALS(&lconn, found);
+
+	/* Any address matches the unspecified listener */
+	epp.local.port = 8080;
+	rc = amap_find_match(map, &epp, &found);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_EQUALS(&unspec, found);
+
+	epp.local.port = 8081;
+	rc = amap_find_match(map, &epp, &found);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+
+	/* With the connection removed, the listener matches */
+	amap_test_conn(0, &epp);
+	amap_remove(map, &epp);
+	rc = amap_find_match(map, &epp, &found);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_EQUALS(&lconn, found);
+
+	amap_remove(map, &listen);
+	inet_ep2_init(&epp);
+	epp.local.port = 8080;
+	amap_remove(map, &epp);
+
+	amap_destroy(map);
+}
+
+/** Find matches in a map with many connections */
+PCUT_TEST(find_match_many)
+{
+	amap_t *map;
+	int *arg;
+	errno_t rc;
+
+	arg = calloc(AMAP_TEST_MANY, sizeof(int));
+	PCUT_ASSERT_NOT_NULL(arg);
+
+	rc = amap_create(&map);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	amap_test_insert(map, 0, AMAP_TEST_MANY, arg);
+	amap_test_lookups(map, AMAP_TEST_MANY, arg);
+
+	amap_test_remove(map, AMAP_TEST_MANY);
+	amap_destroy(map);
+	free(arg);
+}
+
+PCUT_EXPORT(amap);
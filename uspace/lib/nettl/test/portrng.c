@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <inet/endpoint.h>
+#include <nettl/portrng.h>
+#include <pcut/pcut.h>
+#include <stdbool.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(portrng);
+
+/** Number of ports allocated by the tests of many ports */
+#define PORTRNG_TEST_MANY 1000
+
+/** Allocate specific port, find it and free it */
+PCUT_TEST(alloc_specific)
+{
+	portrng_t *pr;
+	uint16_t pnum;
+	void *arg;
+	errno_t rc;
+
+	rc = portrng_create(&pr);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = portrng_alloc(pr, 80, &pnum, 0, &pnum);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	rc = portrng_alloc(pr, 80, &pnum, pf_allow_system, &pnum);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(80, pnum);
+
+	rc = portrng_alloc(pr, 80, NULL, pf_allow_system, &pnum);
+	PCUT_ASSERT_ERRNO_VAL(EEXIST, rc);
+
+	rc = portrng_find_port(pr, 80, &arg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_EQUALS(&pnum, arg);
+
+	portrng_free_port(pr, 80);
+	PCUT_ASSERT_TRUE(portrng_empty(pr));
+
+	rc = portrng_find_port(pr, 80, &arg);
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+
+	portrng_destroy(pr);
+}
+
+/** Allocated dynamic ports are distinct and can be found */
+PCUT_TEST(alloc_many)
+{
+	portrng_t *pr;
+	uint16_t pnum[PORTRNG_TEST_MANY];
+	void *arg;
+	errno_t rc;
+	int i, j;
+
+	rc = portrng_create(&pr);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	for (i = 0; i < PORTRNG_TEST_MANY; i++) {
+		rc = portrng_alloc(pr, inet_port_any, &pnum[i], 0, &pnum[i]);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		PCUT_ASSERT_TRUE(pnum[i] >= inet_port_dyn_lo);
+		for (j = 0; j < i; j++)
+			PCUT_ASSERT_TRUE(pnum[i] != pnum[j]);
+	}
+
+	for (i = 0; i < PORTRNG_TEST_MANY; i++) {
+		rc = portrng_find_port(pr, pnum[i], &arg);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		PCUT_ASSERT_EQUALS(&pnum[i], arg);
+	}
+
+	/* Free every other port and check the rest is still found */
+	for (i = 0; i < PORTRNG_TEST_MANY; i += 2)
+		portrng_free_port(pr, pnum[i]);
+
+	for (i = 0; i < PORTRNG_TEST_MANY; i++) {
+		rc = portrng_find_port(pr, pnum[i], &arg);
+		if (i % 2 == 0) {
+			PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+		} else {
+			PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+			PCUT_ASSERT_EQUALS(&pnum[i], arg);
+		}
+	}
+
+	for (i = 1; i < PORTRNG_TEST_MANY; i += 2)
+		portrng_free_port(pr, pnum[i]);
+
+	PCUT_ASSERT_TRUE(portrng_empty(pr));
+	portrng_destroy(pr);
+}
+
+PCUT_EXPORT(portrng);
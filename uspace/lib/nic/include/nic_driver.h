@@ -44,7 +44,9 @@
 
 #include <fibril_synch.h>
 #include <nic/nic.h>
+#include <nic_ring.h>
 #include <async.h>
+#include <stdbool.h>
 
 #include "nic.h"
 #include "nic_rx_control.h"
@@ -79,6 +81,12 @@ struct nic {
 	nic_address_t default_mac;
 	/** Client callback session */
 	async_sess_t *client_session;
+	/** Receive ring shared with the client */
+	nic_ring_prod_t rx_ring;
+	/** Received frames are passed to the client through @c rx_ring */
+	bool rx_ring_active;
+	/** Lock for the receive ring */
+	fibril_mutex_t rx_ring_lock;
 	/** Current polling mode of the NIC */
 	nic_poll_mode_t poll_mode;
 	/** Polling period (applicable when poll_mode == NIC_POLL_PERIODIC) */
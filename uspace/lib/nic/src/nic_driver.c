@@ -143,6 +143,8 @@ void nic_driver_implement(driver_ops_t *driver_ops, ddf_dev_ops_t *dev_ops,
 			iface->poll_set_mode = nic_poll_set_mode_impl;
 		if (!iface->poll_now)
 			iface->poll_now = nic_poll_now_impl;
+		if (!iface->rx_ring_create)
+			iface->rx_ring_create = nic_rx_ring_create_impl;
 	}
 }
 
@@ -507,6 +509,47 @@ void nic_set_tx_busy(nic_t *nic_data, int busy)
 	nic_data->tx_busy = busy;
 }
 
+/**
+ * Pass received frame to the client.
+ *
+ * Uses the receive ring if the client has set one up. Frames that do
+ * not fit into a ring buffer are sent in a NIC_EV_RECEIVED event.
+ *
+ * @param nic_data
+ * @param data		Frame data
+ * @param size		Frame size in bytes
+ */
+static void nic_deliver_frame(nic_t *nic_data, void *data, size_t size)
+{
+	bool notify = false;
+	errno_t rc;
+
+	fibril_mutex_lock(&nic_data->rx_ring_lock);
+	if (nic_data->rx_ring_active) {
+		rc = nic_ring_put(&nic_data->rx_ring, data, size);
+		if (rc == EOK)
+			notify = nic_ring_publish(&nic_data->rx_ring);
+		fibril_mutex_unlock(&nic_data->rx_ring_lock);
+
+		if (rc == ELIMIT) {
+			/* Ring is full, client is not keeping up */
+			fibril_rwlock_write_lock(&nic_data->stats_lock);
+			nic_data->stats.receive_dropped++;
+			fibril_rwlock_write_unlock(&nic_data->stats_lock);
+		}
+
+		if (notify)
+			nic_ev_rx_ring(nic_data->client_session);
+
+		if (rc != EINVAL)
+			return;
+	} else {
+		fibril_mutex_unlock(&nic_data->rx_ring_lock);
+	}
+
+	nic_ev_received(nic_data->client_session, data, size);
+}
+
 /**
  * This is the function that the driver should call when it receives a frame.
  * The frame is checked by filters and then sent up to the NIL layer or
@@ -543,8 +586,7 @@ void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
 			break;
 		}
 		fibril_rwlock_write_unlock(&nic_data->stats_lock);
-		nic_ev_received(nic_data->client_session, frame->data,
-		    frame->size);
+		nic_deliver_frame(nic_data, frame->data, frame->size);
 	} else {
 		switch (frame_type) {
 		case NIC_FRAME_UNICAST:
@@ -609,6 +651,7 @@ static nic_t *nic_create(ddf_dev_t *dev)
 	nic_data->fun = NULL;
 	nic_data->state = NIC_STATE_STOPPED;
 	nic_data->client_session = NULL;
+	nic_data->rx_ring_active = false;
 	nic_data->poll_mode = NIC_POLL_IMMEDIATE;
 	nic_data->default_poll_mode = NIC_POLL_IMMEDIATE;
 	nic_data->send_frame = NULL;
@@ -621,6 +664,7 @@ static nic_t *nic_create(ddf_dev_t *dev)
 	fibril_rwlock_initialize(&nic_data->stats_lock);
 	fibril_rwlock_initialize(&nic_data->rxc_lock);
 	fibril_rwlock_initialize(&nic_data->wv_lock);
+	fibril_mutex_initialize(&nic_data->rx_ring_lock);
 
 	memset(&nic_data->mac, 0, sizeof(nic_address_t));
 	memset(&nic_data->default_mac, 0, sizeof(nic_address_t));
@@ -658,6 +702,9 @@ nic_t *nic_create_and_bind(ddf_dev_t *device)
  */
 static void nic_destroy(nic_t *nic_data)
 {
+	if (nic_data->rx_ring_active)
+		as_area_destroy(nic_data->rx_ring.ring);
+
 	free(nic_data->specific);
 }
 
@@ -93,5 +93,15 @@ errno_t nic_ev_received(async_sess_t *sess, void *data, size_t size)
 	return retval;
 }
 
+/** Frames are waiting in the receive ring. */
+errno_t nic_ev_rx_ring(async_sess_t *sess)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+	async_msg_0(exch, NIC_EV_RX_RING);
+	async_exchange_end(exch);
+
+	return EOK;
+}
+
 /** @}
  */
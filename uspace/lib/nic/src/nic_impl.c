@@ -35,6 +35,7 @@
  * @brief Default DDF NIC interface methods implementations
  */
 
+#include <as.h>
 #include <errno.h>
 #include <str_error.h>
 #include <ipc/services.h>
@@ -203,6 +204,14 @@ errno_t nic_callback_create_impl(ddf_fun_t *fun)
 		return ENOMEM;
 	}
 
+	/* Receive ring belonged to the previous client */
+	fibril_mutex_lock(&nic->rx_ring_lock);
+	if (nic->rx_ring_active) {
+		as_area_destroy(nic->rx_ring.ring);
+		nic->rx_ring_active = false;
+	}
+	fibril_mutex_unlock(&nic->rx_ring_lock);
+
 	fibril_rwlock_write_unlock(&nic->main_lock);
 	return EOK;
 }
@@ -804,6 +813,39 @@ errno_t nic_poll_now_impl(ddf_fun_t *fun)
 	}
 }
 
+/**
+ * Default implementation of the rx_ring_create method.
+ * Starts passing received frames to the client through the ring
+ * in the memory area shared by the client.
+ *
+ * @param fun
+ * @param area	Shared memory area containing the ring
+ * @param size	Size of the area in bytes
+ *
+ * @return EOK		If the ring was set up
+ * @return EINVAL	If the ring layout is not valid
+ */
+errno_t nic_rx_ring_create_impl(ddf_fun_t *fun, void *area, size_t size)
+{
+	nic_t *nic_data = nic_get_from_ddf_fun(fun);
+	nic_ring_prod_t prod;
+	errno_t rc;
+
+	rc = nic_ring_prod_attach(&prod, area, size);
+	if (rc != EOK)
+		return rc;
+
+	fibril_mutex_lock(&nic_data->rx_ring_lock);
+	if (nic_data->rx_ring_active)
+		as_area_destroy(nic_data->rx_ring.ring);
+
+	nic_data->rx_ring = prod;
+	nic_data->rx_ring_active = true;
+	fibril_mutex_unlock(&nic_data->rx_ring_lock);
+
+	return EOK;
+}
+
 /**
  * Default handler for unknown methods (outside of the NIC interface).
  * Logs a warning message and returns ENOTSUP to the caller.
@@ -63,6 +63,9 @@
 
 #define VIRTIO_F_VERSION_1	1
 
+/** Driver and device use the used_event and avail_event fields */
+#define VIRTIO_RING_F_EVENT_IDX	(1U << 29)
+
 /** Common configuration structure layout according to VIRTIO version 1.0 */
 typedef struct virtio_pci_common_cfg {
 	ioport32_t device_feature_select;
@@ -151,6 +154,15 @@ typedef struct {
 	virtq_used_t *used;
 	uint16_t used_last_idx;
 
+	/** Available ring index at the time the device was last notified */
+	uint16_t avail_kick_idx;
+	/** Used event field (trails the available ring) */
+	ioport16_t *used_event;
+	/** Available event field (trails the used ring) */
+	ioport16_t *avail_event;
+	/** The driver asked the device not to interrupt */
+	bool irq_disabled;
+
 	/** Address of the queue's notification register */
 	ioport16_t *notify;
 } virtq_t;
@@ -179,6 +191,9 @@ typedef struct {
 	/** Device-specific configuration */
 	void *device_cfg;
 
+	/** Negotiated feature bits 0 - 31 */
+	uint32_t features;
+
 	/** Virtqueues */
 	virtq_t *queues;
 } virtio_dev_t;
@@ -197,14 +212,19 @@ extern void virtio_create_desc_free_list(virtio_dev_t *, uint16_t, uint16_t,
 extern uint16_t virtio_alloc_desc(virtio_dev_t *, uint16_t, uint16_t *);
 extern void virtio_free_desc(virtio_dev_t *, uint16_t, uint16_t *, uint16_t);
 
+extern void virtio_virtq_add_available(virtio_dev_t *, uint16_t, uint16_t);
+extern void virtio_virtq_kick(virtio_dev_t *, uint16_t);
 extern void virtio_virtq_produce_available(virtio_dev_t *, uint16_t, uint16_t);
 extern bool virtio_virtq_consume_used(virtio_dev_t *, uint16_t, uint16_t *,
     uint32_t *);
 
+extern void virtio_virtq_irq_disable(virtio_dev_t *, uint16_t);
+extern bool virtio_virtq_irq_enable(virtio_dev_t *, uint16_t);
+
 extern errno_t virtio_virtq_setup(virtio_dev_t *, uint16_t, uint16_t);
 extern void virtio_virtq_teardown(virtio_dev_t *, uint16_t);
 
-extern errno_t virtio_device_setup_start(virtio_dev_t *, uint32_t);
+extern errno_t virtio_device_setup_start(virtio_dev_t *, uint32_t, uint32_t);
 extern void virtio_device_setup_fail(virtio_dev_t *);
 extern void virtio_device_setup_finalize(virtio_dev_t *);
 
@@ -169,7 +169,17 @@ void virtio_free_desc(virtio_dev_t *vdev, uint16_t num, uint16_t *head,
 	fibril_mutex_unlock(&q->lock);
 }
 
-void virtio_virtq_produce_available(virtio_dev_t *vdev, uint16_t num,
+/** Put a descriptor into the available ring without notifying the device
+ *
+ * The device is allowed to see the descriptor right away, but it is
+ * not notified until virtio_virtq_kick() is called. This way a batch of
+ * descriptors can be made available with a single notification.
+ *
+ * @param vdev[in]    VIRTIO device.
+ * @param num[in]     Index of the virtqueue.
+ * @param descno[in]  Descriptor to make available.
+ */
+void virtio_virtq_add_available(virtio_dev_t *vdev, uint16_t num,
     uint16_t descno)
 {
 	virtq_t *q = &vdev->queues[num];
@@ -179,23 +189,98 @@ void virtio_virtq_produce_available(virtio_dev_t *vdev, uint16_t num,
 	pio_write_le16(&q->avail->ring[idx % q->queue_size], descno);
 	write_barrier();
 	pio_write_le16(&q->avail->idx, idx + 1);
-	write_barrier();
-	pio_write_le16(q->notify, num);
 	fibril_mutex_unlock(&q->lock);
 }
 
+/** Notify the device about descriptors added since the last notification
+ *
+ * The notification is skipped if the device indicated it does not need
+ * it, either using the avail_event field (with VIRTIO_RING_F_EVENT_IDX)
+ * or using the VIRTQ_USED_F_NO_NOTIFY flag.
+ *
+ * @param vdev[in]  VIRTIO device.
+ * @param num[in]   Index of the virtqueue.
+ */
+void virtio_virtq_kick(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *q = &vdev->queues[num];
+	bool notify;
+
+	fibril_mutex_lock(&q->lock);
+
+	/* The new index must be visible before we look at the device's wish */
+	memory_barrier();
+
+	uint16_t old_idx = q->avail_kick_idx;
+	uint16_t new_idx = pio_read_le16(&q->avail->idx);
+	q->avail_kick_idx = new_idx;
+
+	if (vdev->features & VIRTIO_RING_F_EVENT_IDX) {
+		uint16_t event = pio_read_le16(q->avail_event);
+		notify = (uint16_t) (new_idx - event - 1) <
+		    (uint16_t) (new_idx - old_idx);
+	} else {
+		notify = new_idx != old_idx &&
+		    !(pio_read_le16(&q->used->flags) & VIRTQ_USED_F_NO_NOTIFY);
+	}
+
+	if (notify)
+		pio_write_le16(q->notify, num);
+
+	fibril_mutex_unlock(&q->lock);
+}
+
+void virtio_virtq_produce_available(virtio_dev_t *vdev, uint16_t num,
+    uint16_t descno)
+{
+	virtio_virtq_add_available(vdev, num, descno);
+	virtio_virtq_kick(vdev, num);
+}
+
+/** Consume a used buffer from a virtqueue
+ *
+ * When the used ring is drained and interrupts are enabled for the
+ * virtqueue, the used_event field (with VIRTIO_RING_F_EVENT_IDX) is moved
+ * to the first buffer not consumed yet, so that the device interrupts for
+ * the next buffer it uses. Callers are thus expected to consume the used
+ * buffers until this function returns false.
+ *
+ * @param vdev[in]     VIRTIO device.
+ * @param num[in]      Index of the virtqueue.
+ * @param descno[out]  Descriptor of the used buffer.
+ * @param len[out]     Number of bytes written by the device.
+ *
+ * @return  True if a used buffer was consumed, false if there was none.
+ */
 bool virtio_virtq_consume_used(virtio_dev_t *vdev, uint16_t num,
     uint16_t *descno, uint32_t *len)
 {
 	virtq_t *q = &vdev->queues[num];
 
 	fibril_mutex_lock(&q->lock);
-	uint16_t last_idx = q->used_last_idx % q->queue_size;
-	if (last_idx == (pio_read_le16(&q->used->idx) % q->queue_size)) {
-		fibril_mutex_unlock(&q->lock);
-		return false;
+	if (q->used_last_idx == pio_read_le16(&q->used->idx)) {
+		if (!(vdev->features & VIRTIO_RING_F_EVENT_IDX) ||
+		    q->irq_disabled) {
+			fibril_mutex_unlock(&q->lock);
+			return false;
+		}
+
+		/* Re-arm the interrupt for the next used buffer */
+		pio_write_le16(q->used_event, q->used_last_idx);
+
+		/* Make the request visible before checking for missed buffers */
+		memory_barrier();
+
+		if (q->used_last_idx == pio_read_le16(&q->used->idx)) {
+			fibril_mutex_unlock(&q->lock);
+			return false;
+		}
 	}
 
+	/* Do not read the element before the index which published it */
+	read_barrier();
+
+	uint16_t last_idx = q->used_last_idx % q->queue_size;
 	*descno = (uint16_t) pio_read_le32(&q->used->ring[last_idx].id);
 	*len = pio_read_le32(&q->used->ring[last_idx].len);
 
@@ -205,6 +290,61 @@ bool virtio_virtq_consume_used(virtio_dev_t *vdev, uint16_t num,
 	return true;
 }
 
+/** Ask the device not to interrupt when it uses buffers of a virtqueue
+ *
+ * This is only a hint, the device may still interrupt. With
+ * VIRTIO_RING_F_EVENT_IDX the driver must leave the available ring flags
+ * clear and suppresses interrupts by the used_event field alone.
+ *
+ * @param vdev[in]  VIRTIO device.
+ * @param num[in]   Index of the virtqueue.
+ */
+void virtio_virtq_irq_disable(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *q = &vdev->queues[num];
+
+	fibril_mutex_lock(&q->lock);
+	q->irq_disabled = true;
+	if (vdev->features & VIRTIO_RING_F_EVENT_IDX) {
+		/* Move the event behind the used index already consumed */
+		pio_write_le16(q->used_event, q->used_last_idx - 1);
+	} else {
+		pio_write_le16(&q->avail->flags, VIRTQ_AVAIL_F_NO_INTERRUPT);
+	}
+	fibril_mutex_unlock(&q->lock);
+}
+
+/** Ask the device to interrupt when it uses buffers of a virtqueue
+ *
+ * Used buffers which the device published before the interrupts were
+ * enabled do not cause an interrupt. The caller must process them when
+ * this function returns true.
+ *
+ * @param vdev[in]  VIRTIO device.
+ * @param num[in]   Index of the virtqueue.
+ *
+ * @return  True if there are used buffers waiting to be consumed.
+ */
+bool virtio_virtq_irq_enable(virtio_dev_t *vdev, uint16_t num)
+{
+	virtq_t *q = &vdev->queues[num];
+
+	fibril_mutex_lock(&q->lock);
+	q->irq_disabled = false;
+	if (vdev->features & VIRTIO_RING_F_EVENT_IDX)
+		pio_write_le16(q->used_event, q->used_last_idx);
+	else
+		pio_write_le16(&q->avail->flags, 0);
+
+	/* Make the request visible before checking for missed buffers */
+	memory_barrier();
+
+	bool pending = q->used_last_idx != pio_read_le16(&q->used->idx);
+	fibril_mutex_unlock(&q->lock);
+
+	return pending;
+}
+
 errno_t virtio_virtq_setup(virtio_dev_t *vdev, uint16_t num, uint16_t size)
 {
 	virtq_t *q = &vdev->queues[num];
@@ -257,6 +397,10 @@ errno_t virtio_virtq_setup(virtio_dev_t *vdev, uint16_t num, uint16_t size)
 	q->avail = q->virt + avail_offset;
 	q->used = q->virt + used_offset;
 	q->used_last_idx = 0;
+	q->avail_kick_idx = 0;
+	q->used_event = &q->avail->ring[size];
+	q->avail_event = (ioport16_t *) &q->used->ring[size];
+	q->irq_disabled = false;
 
 	memset(q->virt, 0, q->size);
 
@@ -298,8 +442,16 @@ void virtio_virtq_teardown(virtio_dev_t *vdev, uint16_t num)
 /**
  * Perform device initialization as described in section 3.1.1 of the
  * specification, steps 1 - 6.
+ *
+ * @param vdev[in]      VIRTIO device.
+ * @param features[in]  Feature bits the driver cannot work without.
+ * @param optional[in]  Feature bits the driver uses if the device offers
+ *                      them.
+ *
+ * The negotiated feature bits are stored in @a vdev->features.
  */
-errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
+errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features,
+    uint32_t optional)
 {
 	virtio_pci_common_cfg_t *cfg = vdev->common_cfg;
 
@@ -328,7 +480,7 @@ errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
 
 	if (features != (features & device_features))
 		return ENOTSUP;
-	features &= device_features;
+	features = (features | optional) & device_features;
 
 	if (reserved_features != (reserved_features & device_reserved_features))
 		return ENOTSUP;
@@ -343,6 +495,8 @@ errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
 	ddf_msg(LVL_NOTE, "accepted features %x, reserved features %x",
 	    features, reserved_features);
 
+	vdev->features = features;
+
 	/* 5. Set FEATURES_OK */
 	status |= VIRTIO_DEV_STATUS_FEATURES_OK;
 	pio_write_8(&cfg->device_status, status);
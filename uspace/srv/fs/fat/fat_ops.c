@@ -56,6 +56,7 @@
 #include <fibril_synch.h>
 #include <align.h>
 #include <stdlib.h>
+#include <time.h>
 
 #define FAT_NODE(node)	((node) ? (fat_node_t *) (node)->data : NULL)
 #define FS_NODE(node)	((node) ? (node)->bp : NULL)
@@ -1079,6 +1080,8 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
     aoff64_t *size)
 {
 	enum cache_mode cmode = CACHE_MODE_WB;
+	uint32_t wbage = 0;
+	uint32_t wbratio = 0;
 	fat_instance_t *instance;
 	fat_idx_t *ridxp;
 	fs_node_t *rfn;
@@ -1097,6 +1100,23 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 			cmode = CACHE_MODE_WT;
 		else if (str_cmp(opt, "nolfn") == 0)
 			instance->lfn_enabled = false;
+		else if (str_test_prefix(opt, "wbage=")) {
+			/* Age of a dirty block to write it back (msec) */
+			rc = str_uint32_t(opt + str_length("wbage="), NULL, 10,
+			    true, &wbage);
+			if (rc != EOK || wbage == 0) {
+				free(instance);
+				return EINVAL;
+			}
+		} else if (str_test_prefix(opt, "wbratio=")) {
+			/* Percentage of dirty blocks to write them back */
+			rc = str_uint32_t(opt + str_length("wbratio="), NULL, 10,
+			    true, &wbratio);
+			if (rc != EOK || wbratio == 0) {
+				free(instance);
+				return EINVAL;
+			}
+		}
 	}
 
 	rc = fat_fs_open(service_id, cmode, &rfn, &ridxp);
@@ -1105,6 +1125,16 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 		return rc;
 	}
 
+	if (cmode == CACHE_MODE_WB && (wbage != 0 || wbratio != 0)) {
+		rc = block_cache_set_writeback(service_id, MSEC2USEC(wbage),
+		    wbratio);
+		if (rc != EOK) {
+			fat_fs_close(service_id, rfn);
+			free(instance);
+			return rc;
+		}
+	}
+
 	fibril_mutex_lock(&ridxp->lock);
 
 	rc = fs_instance_create(service_id, instance);
@@ -1254,6 +1284,17 @@ fat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 				async_answer_0(&call, rc);
 				return rc;
 			}
+			if ((pos / BPS(bs)) % SPC(bs) == 0) {
+				/*
+				 * Entering a new cluster. Its sectors are
+				 * contiguous, let the cache read the rest of
+				 * them at once.
+				 */
+				aoff64_t left = ROUND_UP(nodep->size, BPS(bs)) /
+				    BPS(bs) - pos / BPS(bs) - 1;
+				(void) block_readahead(service_id, b->lba + 1,
+				    min(SPC(bs) - 1, left));
+			}
 			(void) async_data_read_finalize(&call,
 			    b->data + pos % BPS(bs), bytes);
 			rc = block_put(b);
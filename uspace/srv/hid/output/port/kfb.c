@@ -759,7 +759,8 @@ errno_t kfb_init(void)
 
 	rc = physmem_map((void *) paddr + offset,
 	    ALIGN_UP(kfb.size, PAGE_SIZE) >> PAGE_WIDTH,
-	    AS_AREA_READ | AS_AREA_WRITE, (void *) &kfb.addr);
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_LARGE_PAGES,
+	    (void *) &kfb.addr);
 	if (rc != EOK) {
 		free(kfb.glyphs);
 		return rc;
@@ -39,9 +39,12 @@
 
 #include <adt/list.h>
 #include <async.h>
+#include <fibril_synch.h>
 #include <inet/iplink_srv.h>
 #include <inet/addr.h>
 #include <loc.h>
+#include <nic_ring.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -67,6 +70,17 @@ typedef struct ethip_nic {
 	 * (of the type ethip_link_addr_t)
 	 */
 	list_t addr_list;
+
+	/** Receive ring shared with the NIC driver (NULL if not used) */
+	void *rx_ring_area;
+	/** Consumer side of the receive ring */
+	nic_ring_cons_t rx_ring;
+	/** Protects @c rx_signaled */
+	fibril_mutex_t rx_lock;
+	/** Signalled when the driver notifies us about new frames */
+	fibril_condvar_t rx_cv;
+	/** Driver notified us since the ring fibril last checked */
+	bool rx_signaled;
 } ethip_nic_t;
 
 /** Ethernet frame */
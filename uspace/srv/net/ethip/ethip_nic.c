@@ -35,15 +35,18 @@
  */
 
 #include <adt/list.h>
+#include <as.h>
 #include <async.h>
 #include <stdbool.h>
 #include <errno.h>
 #include <str_error.h>
+#include <fibril.h>
 #include <fibril_synch.h>
 #include <inet/iplink_srv.h>
 #include <io/log.h>
 #include <loc.h>
 #include <nic_iface.h>
+#include <nic_ring.h>
 #include <stdlib.h>
 #include <mem.h>
 #include "ethip.h"
@@ -114,6 +117,8 @@ static ethip_nic_t *ethip_nic_new(void)
 
 	link_initialize(&nic->link);
 	list_initialize(&nic->addr_list);
+	fibril_mutex_initialize(&nic->rx_lock);
+	fibril_condvar_initialize(&nic->rx_cv);
 
 	return nic;
 }
@@ -146,6 +151,85 @@ static void ethip_link_addr_delete(ethip_link_addr_t *laddr)
 	free(laddr);
 }
 
+/** Receive ring consumer fibril.
+ *
+ * Processes frames the driver placed into the shared ring and sleeps
+ * once the ring is empty until the driver notifies us with
+ * NIC_EV_RX_RING.
+ */
+static errno_t ethip_nic_rx_fibril(void *arg)
+{
+	ethip_nic_t *nic = (ethip_nic_t *) arg;
+	void *data;
+	size_t size;
+
+	while (true) {
+		while (nic_ring_get(&nic->rx_ring, &data, &size)) {
+			(void) ethip_received(&nic->iplink, data, size);
+			nic_ring_release(&nic->rx_ring);
+		}
+
+		fibril_mutex_lock(&nic->rx_lock);
+		nic->rx_signaled = false;
+		fibril_mutex_unlock(&nic->rx_lock);
+
+		if (!nic_ring_wait_prepare(&nic->rx_ring))
+			continue;
+
+		fibril_mutex_lock(&nic->rx_lock);
+		while (!nic->rx_signaled)
+			fibril_condvar_wait(&nic->rx_cv, &nic->rx_lock);
+		fibril_mutex_unlock(&nic->rx_lock);
+	}
+
+	return EOK;
+}
+
+/** Set up receive ring shared with the NIC driver.
+ *
+ * If the driver does not support it, received frames keep being
+ * delivered using NIC_EV_RECEIVED.
+ */
+static void ethip_nic_rx_ring_init(ethip_nic_t *nic)
+{
+	size_t size = nic_ring_area_size(NIC_RING_SLOTS, NIC_RING_BUF_SIZE);
+	void *area = as_area_create(AS_AREA_ANY, size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+	    AS_AREA_UNPAGED);
+	if (area == AS_MAP_FAILED) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Failed allocating receive "
+		    "ring for '%s'.", nic->svc_name);
+		return;
+	}
+
+	nic_ring_init((nic_ring_t *) area, NIC_RING_SLOTS, NIC_RING_BUF_SIZE);
+
+	errno_t rc = nic_rx_ring_create(nic->sess, area);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "NIC '%s' does not support "
+		    "receive ring: %s.", nic->svc_name, str_error(rc));
+		as_area_destroy(area);
+		return;
+	}
+
+	nic_ring_cons_attach(&nic->rx_ring, (nic_ring_t *) area);
+	nic->rx_ring_area = area;
+
+	fid_t fid = fibril_create(ethip_nic_rx_fibril, nic);
+	if (fid == 0) {
+		/*
+		 * The driver already delivers frames into the ring and
+		 * there is no way to take it back. Keep the area, the
+		 * ring will fill up and further frames will be dropped.
+		 */
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed creating receive "
+		    "fibril for '%s'.", nic->svc_name);
+		return;
+	}
+
+	fibril_add_ready(fid);
+}
+
 static errno_t ethip_nic_open(service_id_t sid)
 {
 	bool in_list = false;
@@ -208,6 +292,8 @@ static errno_t ethip_nic_open(service_id_t sid)
 		goto error;
 	}
 
+	ethip_nic_rx_ring_init(nic);
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "Initialized IP link service,");
 
 	return EOK;
@@ -282,6 +368,16 @@ static void ethip_nic_received(ethip_nic_t *nic, ipc_call_t *call)
 	async_answer_0(call, rc);
 }
 
+static void ethip_nic_rx_ring(ethip_nic_t *nic, ipc_call_t *call)
+{
+	fibril_mutex_lock(&nic->rx_lock);
+	nic->rx_signaled = true;
+	fibril_condvar_broadcast(&nic->rx_cv);
+	fibril_mutex_unlock(&nic->rx_lock);
+
+	async_answer_0(call, EOK);
+}
+
 static void ethip_nic_device_state(ethip_nic_t *nic, ipc_call_t *call)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_device_state()");
@@ -310,6 +406,9 @@ static void ethip_nic_cb_conn(ipc_call_t *icall, void *arg)
 		case NIC_EV_RECEIVED:
 			ethip_nic_received(nic, &call);
 			break;
+		case NIC_EV_RX_RING:
+			ethip_nic_rx_ring(nic, &call);
+			break;
 		case NIC_EV_DEVICE_STATE:
 			ethip_nic_device_state(nic, &call);
 			break;
@@ -87,8 +87,12 @@ static errno_t inet_init(void)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_init()");
 
+	errno_t rc = inet_reass_init();
+	if (rc != EOK)
+		return rc;
+
 	port_id_t port;
-	errno_t rc = async_create_port(INTERFACE_INET,
+	rc = async_create_port(INTERFACE_INET,
 	    inet_default_conn, NULL, &port);
 	if (rc != EOK)
 		return rc;
@@ -134,7 +138,7 @@ static void inet_callback_create_srv(inet_client_t *client, ipc_call_t *call)
 }
 
 static errno_t inet_find_dir(inet_addr_t *src, inet_addr_t *dest, uint8_t tos,
-    inet_dir_t *dir)
+    inet_sroute_cache_t *cache, inet_dir_t *dir)
 {
 	inet_sroute_t *sr;
 
@@ -147,7 +151,10 @@ static errno_t inet_find_dir(inet_addr_t *src, inet_addr_t *dest, uint8_t tos,
 		dir->dtype = dt_direct;
 	} else {
 		/* No direct path, try using a static route */
-		sr = inet_sroute_find(dest);
+		if (cache != NULL)
+			sr = inet_sroute_find_cached(cache, dest);
+		else
+			sr = inet_sroute_find(dest);
 		if (sr != NULL) {
 			dir->aobj = inet_addrobj_find(&sr->router, iaf_net);
 			dir->ldest = sr->router;
@@ -163,8 +170,17 @@ static errno_t inet_find_dir(inet_addr_t *src, inet_addr_t *dest, uint8_t tos,
 	return EOK;
 }
 
-errno_t inet_route_packet(inet_dgram_t *dgram, uint8_t proto, uint8_t ttl,
-    int df)
+/** Route packet, optionally using a route lookup cache.
+ *
+ * @param dgram	Datagram
+ * @param proto	Protocol
+ * @param ttl	Time to live
+ * @param df	Don't fragment flag
+ * @param cache	Route lookup cache or @c NULL
+ * @return	EOK on success or an error code
+ */
+static errno_t inet_route_packet_cached(inet_dgram_t *dgram, uint8_t proto,
+    uint8_t ttl, int df, inet_sroute_cache_t *cache)
 {
 	inet_dir_t dir;
 	inet_link_t *ilink;
@@ -191,7 +207,7 @@ errno_t inet_route_packet(inet_dgram_t *dgram, uint8_t proto, uint8_t ttl,
 
 	/* Route packet using source/destination addresses */
 
-	rc = inet_find_dir(&dgram->src, &dgram->dest, dgram->tos, &dir);
+	rc = inet_find_dir(&dgram->src, &dgram->dest, dgram->tos, cache, &dir);
 	if (rc != EOK)
 		return rc;
 
@@ -199,10 +215,17 @@ errno_t inet_route_packet(inet_dgram_t *dgram, uint8_t proto, uint8_t ttl,
 	    proto, ttl, df);
 }
 
+errno_t inet_route_packet(inet_dgram_t *dgram, uint8_t proto, uint8_t ttl,
+    int df)
+{
+	return inet_route_packet_cached(dgram, proto, ttl, df, NULL);
+}
+
 static errno_t inet_send(inet_client_t *client, inet_dgram_t *dgram,
     uint8_t proto, uint8_t ttl, int df)
 {
-	return inet_route_packet(dgram, proto, ttl, df);
+	return inet_route_packet_cached(dgram, proto, ttl, df,
+	    &client->sroute_cache);
 }
 
 errno_t inet_get_srcaddr(inet_addr_t *remote, uint8_t tos, inet_addr_t *local)
@@ -210,7 +233,7 @@ errno_t inet_get_srcaddr(inet_addr_t *remote, uint8_t tos, inet_addr_t *local)
 	inet_dir_t dir;
 	errno_t rc;
 
-	rc = inet_find_dir(NULL, remote, tos, &dir);
+	rc = inet_find_dir(NULL, remote, tos, NULL, &dir);
 	if (rc != EOK)
 		return rc;
 
@@ -366,6 +389,8 @@ static void inet_set_proto_srv(inet_client_t *client, ipc_call_t *call)
 static void inet_client_init(inet_client_t *client)
 {
 	client->sess = NULL;
+	client->sroute_cache.gen = 0;
+	client->sroute_cache.sroute = NULL;
 
 	fibril_mutex_lock(&client_list_lock);
 	list_append(&client->client_list, &client_list);
@@ -47,11 +47,23 @@
 #include <types/inet.h>
 #include <async.h>
 
+/** Cached result of static route lookup */
+typedef struct {
+	/** Routing table generation the entry is valid for, zero if none */
+	unsigned gen;
+	/** Destination address */
+	inet_addr_t dest;
+	/** Route to the destination or @c NULL if there is none */
+	struct inet_sroute *sroute;
+} inet_sroute_cache_t;
+
 /** Inet Client */
 typedef struct {
 	async_sess_t *sess;
 	uint8_t protocol;
 	link_t client_list;
+	/** Last route used by this client */
+	inet_sroute_cache_t sroute_cache;
 } inet_client_t;
 
 /** Inetping Client */
@@ -121,8 +133,10 @@ typedef struct {
 } inet_addrobj_t;
 
 /** Static route configuration */
-typedef struct {
+typedef struct inet_sroute {
 	link_t sroute_list;
+	/** Link to routing trie node entries */
+	link_t rtrie_link;
 	sysarg_t id;
 	/** Destination network */
 	inet_naddr_t dest;
@@ -131,6 +145,26 @@ typedef struct {
 	char *name;
 } inet_sroute_t;
 
+/** Routing trie node */
+typedef struct inet_rtrie_node {
+	/** Subtrees, indexed by the first bit following the prefix */
+	struct inet_rtrie_node *child[2];
+	/** Prefix, bits beyond @c plen are zero */
+	uint8_t prefix[16];
+	/** Prefix length in bits */
+	uint8_t plen;
+	/** Entries with exactly this prefix, empty for branch nodes */
+	list_t entries;
+} inet_rtrie_node_t;
+
+/** Longest-prefix-match routing trie */
+typedef struct {
+	/** Root node or @c NULL if the trie is empty */
+	inet_rtrie_node_t *root;
+	/** Key length in bytes */
+	size_t klen;
+} inet_rtrie_t;
+
 typedef enum {
 	/** Destination is on this network node */
 	dt_local,
@@ -34,26 +34,75 @@
  * @brief Datagram reassembly.
  */
 
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <assert.h>
 #include <errno.h>
 #include <fibril_synch.h>
 #include <io/log.h>
 #include <macros.h>
 #include <mem.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <str_error.h>
+#include <time.h>
 
 #include "inetsrv.h"
 #include "inet_std.h"
 #include "reass.h"
 
-/** Datagram being reassembled.
+/** Reassembly timeout in seconds (RFC 1122 sec. 3.3.2, RFC 8200 sec. 4.5) */
+#define REASS_TIMEOUT 60
+
+/** Maximum number of bytes held in fragments awaiting reassembly */
+#define REASS_MEM_MAX (1024 * 1024)
+
+/** Datagram reassembly key.
+ *
+ * Datagram is uniquely identified by (source address, destination address,
+ * protocol, identification) per RFC 791 sec. 2.3 / Fragmentation.
+ */
+typedef struct {
+	inet_addr_t src;
+	inet_addr_t dest;
+	uint8_t proto;
+	uint32_t ident;
+} reass_key_t;
+
+/** Range of datagram data that has not been received yet.
  *
- * Uniquely identified by (source address, destination address, protocol,
- * identification) per RFC 791 sec. 2.3 / Fragmentation.
+ * Hole descriptor as per RFC 815.
  */
 typedef struct {
-	link_t map_link;
-	/** List of fragments, @c reass_frag_t */
+	link_t dgram_link;
+	/** Offset of the first missing byte */
+	size_t first;
+	/** Offset following the last missing byte, @c SIZE_MAX if unknown */
+	size_t last;
+} reass_hole_t;
+
+/** Datagram being reassembled. */
+typedef struct {
+	/** Link to @c reass_dgram_map */
+	ht_link_t map_link;
+	/** Link to @c reass_dgram_age */
+	link_t age_link;
+	/** Key */
+	reass_key_t key;
+	/** Time when the datagram expires */
+	struct timespec deadline;
+	/** List of fragments in order of arrival, @c reass_frag_t */
 	list_t frags;
+	/** List of holes sorted by offset, @c reass_hole_t */
+	list_t holes;
+	/** @c true if the last fragment has been received */
+	bool have_last;
+	/** Total datagram size, valid if @c have_last is @c true */
+	size_t size;
+	/** Offset following the end of the highest fragment received */
+	size_t data_end;
+	/** Number of bytes accounted to this datagram in @c reass_mem */
+	size_t mem;
 } reass_dgram_t;
 
 /** One datagram fragment */
@@ -62,33 +111,127 @@ typedef struct {
 	inet_packet_t packet;
 } reass_frag_t;
 
-/** Datagram map, list of reass_dgram_t */
-static LIST_INITIALIZE(reass_dgram_map);
-/** Protects access to @c reass_dgram_map */
+/** Datagram map, hash table of reass_dgram_t */
+static hash_table_t reass_dgram_map;
+/** Datagrams in order of arrival (and thus expiration), oldest first */
+static LIST_INITIALIZE(reass_dgram_age);
+/** Protects access to @c reass_dgram_map and @c reass_dgram_age */
 static FIBRIL_MUTEX_INITIALIZE(reass_dgram_map_lock);
+/** Number of bytes held by all datagrams being reassembled */
+static size_t reass_mem;
+/** Reassembly timeout in nanoseconds (tests shorten it) */
+nsec_t inet_reass_timeout = SEC2NSEC(REASS_TIMEOUT);
+/** Expiration timer */
+static fibril_timer_t *reass_timer;
+/** @c true if @c reass_timer is set */
+static bool reass_timer_armed;
 
-static reass_dgram_t *reass_dgram_new(void);
 static reass_dgram_t *reass_dgram_get(inet_packet_t *);
 static errno_t reass_dgram_insert_frag(reass_dgram_t *, inet_packet_t *);
 static bool reass_dgram_complete(reass_dgram_t *);
 static void reass_dgram_remove(reass_dgram_t *);
 static errno_t reass_dgram_deliver(reass_dgram_t *);
 static void reass_dgram_destroy(reass_dgram_t *);
+static void reass_expire(void);
+static void reass_timer_update(void);
+
+static size_t reass_addr_hash(inet_addr_t *addr)
+{
+	size_t hash = addr->version;
+
+	switch (addr->version) {
+	case ip_v4:
+		hash = hash_combine(hash, addr->addr);
+		break;
+	case ip_v6:
+		for (size_t i = 0; i < sizeof(addr128_t); i += 4) {
+			hash = hash_combine(hash, (addr->addr6[i] << 24) |
+			    (addr->addr6[i + 1] << 16) |
+			    (addr->addr6[i + 2] << 8) | addr->addr6[i + 3]);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return hash;
+}
+
+static size_t reass_dgram_key_hash(void *key)
+{
+	reass_key_t *rkey = (reass_key_t *) key;
+	size_t hash;
+
+	hash = hash_combine(reass_addr_hash(&rkey->src),
+	    reass_addr_hash(&rkey->dest));
+	hash = hash_combine(hash, rkey->proto);
+	return hash_combine(hash, rkey->ident);
+}
+
+static size_t reass_dgram_hash(const ht_link_t *item)
+{
+	reass_dgram_t *rdg = hash_table_get_inst(item, reass_dgram_t,
+	    map_link);
+
+	return reass_dgram_key_hash(&rdg->key);
+}
+
+static bool reass_dgram_key_equal(void *key, const ht_link_t *item)
+{
+	reass_key_t *rkey = (reass_key_t *) key;
+	reass_dgram_t *rdg = hash_table_get_inst(item, reass_dgram_t,
+	    map_link);
+
+	return inet_addr_compare(&rdg->key.src, &rkey->src) &&
+	    inet_addr_compare(&rdg->key.dest, &rkey->dest) &&
+	    rdg->key.proto == rkey->proto &&
+	    rdg->key.ident == rkey->ident;
+}
+
+/** Datagram map operations */
+static hash_table_ops_t reass_dgram_map_ops = {
+	.hash = reass_dgram_hash,
+	.key_hash = reass_dgram_key_hash,
+	.key_equal = reass_dgram_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Initialize datagram reassembly.
+ *
+ * @return EOK on success or ENOMEM.
+ */
+errno_t inet_reass_init(void)
+{
+	if (!hash_table_create(&reass_dgram_map, 0, 0, &reass_dgram_map_ops))
+		return ENOMEM;
+
+	reass_timer = fibril_timer_create(&reass_dgram_map_lock);
+	if (reass_timer == NULL) {
+		hash_table_destroy(&reass_dgram_map);
+		return ENOMEM;
+	}
+
+	return EOK;
+}
 
 /** Queue packet for datagram reassembly.
  *
  * @param packet	Packet
- * @return		EOK on success or ENOMEM.
+ * @return		EOK on success or an error code.
  */
 errno_t inet_reass_queue_packet(inet_packet_t *packet)
 {
 	reass_dgram_t *rdg;
 	errno_t rc;
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_reass_queue_packet()");
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "inet_reass_queue_packet()");
 
 	fibril_mutex_lock(&reass_dgram_map_lock);
 
+	/* Drop datagrams that timed out */
+	reass_expire();
+
 	/* Get existing or new datagram */
 	rdg = reass_dgram_get(packet);
 	if (rdg == NULL) {
@@ -100,13 +243,26 @@ errno_t inet_reass_queue_packet(inet_packet_t *packet)
 
 	/* Insert fragment into the datagram */
 	rc = reass_dgram_insert_frag(rdg, packet);
-	if (rc != EOK)
-		return ENOMEM;
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Fragment dropped (%s).",
+		    str_error_name(rc));
+
+		/* Do not keep around a datagram we have no fragment of */
+		if (list_empty(&rdg->frags)) {
+			reass_dgram_remove(rdg);
+			reass_dgram_destroy(rdg);
+		}
+
+		reass_timer_update();
+		fibril_mutex_unlock(&reass_dgram_map_lock);
+		return rc;
+	}
 
 	/* Check if datagram is complete */
 	if (reass_dgram_complete(rdg)) {
 		/* Remove it from the map */
 		reass_dgram_remove(rdg);
+		reass_timer_update();
 		fibril_mutex_unlock(&reass_dgram_map_lock);
 
 		/* Deliver complete datagram */
@@ -115,117 +271,320 @@ errno_t inet_reass_queue_packet(inet_packet_t *packet)
 		return rc;
 	}
 
+	reass_timer_update();
 	fibril_mutex_unlock(&reass_dgram_map_lock);
 	return EOK;
 }
 
+/** Create new datagram reassembly structure.
+ *
+ * @param key	Datagram key
+ * @return	New datagram reassembly structure or @c NULL if out of memory
+ */
+static reass_dgram_t *reass_dgram_new(reass_key_t *key)
+{
+	reass_dgram_t *rdg;
+	reass_hole_t *hole;
+
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+
+	rdg = calloc(1, sizeof(reass_dgram_t));
+	if (rdg == NULL)
+		return NULL;
+
+	hole = calloc(1, sizeof(reass_hole_t));
+	if (hole == NULL) {
+		free(rdg);
+		return NULL;
+	}
+
+	rdg->key = *key;
+	list_initialize(&rdg->frags);
+	list_initialize(&rdg->holes);
+
+	/* Initially the entire datagram is missing */
+	hole->first = 0;
+	hole->last = SIZE_MAX;
+	list_append(&hole->dgram_link, &rdg->holes);
+
+	getuptime(&rdg->deadline);
+	ts_add_diff(&rdg->deadline, inet_reass_timeout);
+
+	hash_table_insert(&reass_dgram_map, &rdg->map_link);
+	list_append(&rdg->age_link, &reass_dgram_age);
+
+	return rdg;
+}
+
 /** Get datagram reassembly structure for packet.
  *
  * @param packet	Packet
  * @return		Datagram reassembly structure matching @a packet
+ *			or @c NULL if out of memory
  */
 static reass_dgram_t *reass_dgram_get(inet_packet_t *packet)
 {
+	reass_key_t key;
+	ht_link_t *link;
+
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-	list_foreach(reass_dgram_map, map_link, reass_dgram_t, rdg) {
-		link_t *f1_link = list_first(&rdg->frags);
-		assert(f1_link != NULL);
+	key.src = packet->src;
+	key.dest = packet->dest;
+	key.proto = packet->proto;
+	key.ident = packet->ident;
+
+	link = hash_table_find(&reass_dgram_map, &key);
+	if (link != NULL)
+		return hash_table_get_inst(link, reass_dgram_t, map_link);
+
+	/* No existing reassembly structure. Create a new one. */
+	return reass_dgram_new(&key);
+}
+
+/** Determine if fragment carries data we do not have yet.
+ *
+ * @param rdg	Datagram reassembly structure
+ * @param first	Offset of the first byte of fragment
+ * @param last	Offset following the last byte of fragment
+ * @return	@c true if fragment overlaps any hole
+ */
+static bool reass_dgram_fills_hole(reass_dgram_t *rdg, size_t first,
+    size_t last)
+{
+	list_foreach(rdg->holes, dgram_link, reass_hole_t, hole) {
+		if (hole->first >= last)
+			break;
+		if (hole->last > first)
+			return true;
+	}
+
+	return false;
+}
+
+/** Set datagram size once the last fragment has been received.
+ *
+ * Holes past the end of the datagram are removed.
+ *
+ * @param rdg	Datagram reassembly structure
+ * @param size	Datagram size
+ */
+static void reass_dgram_set_size(reass_dgram_t *rdg, size_t size)
+{
+	link_t *link;
+	link_t *prev;
+
+	rdg->have_last = true;
+	rdg->size = size;
 
-		reass_frag_t *f1 = list_get_instance(f1_link, reass_frag_t,
+	link = list_last(&rdg->holes);
+	while (link != NULL) {
+		reass_hole_t *hole = list_get_instance(link, reass_hole_t,
 		    dgram_link);
+		prev = list_prev(link, &rdg->holes);
+
+		if (hole->last <= size)
+			break;
 
-		if ((inet_addr_compare(&f1->packet.src, &packet->src)) &&
-		    (inet_addr_compare(&f1->packet.dest, &packet->dest)) &&
-		    (f1->packet.proto == packet->proto) &&
-		    (f1->packet.ident == packet->ident)) {
-			/* Match */
-			return rdg;
+		if (hole->first >= size) {
+			list_remove(&hole->dgram_link);
+			free(hole);
+		} else {
+			hole->last = size;
 		}
-	}
 
-	/* No existing reassembly structure. Create a new one. */
-	return reass_dgram_new();
+		link = prev;
+	}
 }
 
-/** Create new datagram reassembly structure.
+/** Update holes after receiving fragment.
+ *
+ * At most one hole is split in two by a single fragment.
  *
- * @return New datagram reassembly structure.
+ * @param rdg	Datagram reassembly structure
+ * @param first	Offset of the first byte of fragment
+ * @param last	Offset following the last byte of fragment
+ * @param spare	Hole descriptor for use if a hole needs to be split
+ * @return	@c true if @a spare was used, @c false otherwise
  */
-static reass_dgram_t *reass_dgram_new(void)
+static bool reass_dgram_fill_holes(reass_dgram_t *rdg, size_t first,
+    size_t last, reass_hole_t *spare)
 {
-	reass_dgram_t *rdg;
+	link_t *link;
+	link_t *next;
 
-	rdg = calloc(1, sizeof(reass_dgram_t));
-	if (rdg == NULL)
-		return NULL;
+	link = list_first(&rdg->holes);
+	while (link != NULL) {
+		reass_hole_t *hole = list_get_instance(link, reass_hole_t,
+		    dgram_link);
+		next = list_next(link, &rdg->holes);
 
-	list_append(&rdg->map_link, &reass_dgram_map);
-	list_initialize(&rdg->frags);
+		if (hole->first >= last)
+			break;
 
-	return rdg;
+		if (hole->last > first) {
+			if (hole->first < first && hole->last > last) {
+				/* Fragment is inside the hole, split it */
+				spare->first = last;
+				spare->last = hole->last;
+				hole->last = first;
+				list_insert_after(&spare->dgram_link,
+				    &hole->dgram_link);
+				return true;
+			} else if (hole->first < first) {
+				hole->last = first;
+			} else if (hole->last > last) {
+				hole->first = last;
+			} else {
+				list_remove(&hole->dgram_link);
+				free(hole);
+			}
+		}
+
+		link = next;
+	}
+
+	return false;
 }
 
-static reass_frag_t *reass_frag_new(void)
+/** Make room for @a size bytes of fragment data.
+ *
+ * Drops the oldest datagrams (other than @a rdg) until the memory budget
+ * allows for @a size more bytes.
+ *
+ * @param rdg	Datagram the data is for
+ * @param size	Number of bytes needed
+ * @return	@c true if there is enough room, @c false otherwise
+ */
+static bool reass_reserve(reass_dgram_t *rdg, size_t size)
 {
-	reass_frag_t *frag;
+	link_t *link;
 
-	frag = calloc(1, sizeof(reass_frag_t));
-	if (frag == NULL)
-		return NULL;
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-	link_initialize(&frag->dgram_link);
+	if (size > REASS_MEM_MAX)
+		return false;
+
+	while (reass_mem + size > REASS_MEM_MAX) {
+		link = list_first(&reass_dgram_age);
+		if (link == NULL)
+			break;
+
+		reass_dgram_t *old = list_get_instance(link, reass_dgram_t,
+		    age_link);
+		if (old == rdg) {
+			/* rdg is the oldest one, try the next one */
+			link = list_next(link, &reass_dgram_age);
+			if (link == NULL)
+				break;
+
+			old = list_get_instance(link, reass_dgram_t,
+			    age_link);
+		}
+
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Reassembly memory exhausted, "
+		    "dropping datagram %p.", old);
+		reass_dgram_remove(old);
+		reass_dgram_destroy(old);
+	}
 
-	return frag;
+	return reass_mem + size <= REASS_MEM_MAX;
 }
 
+/** Insert fragment into datagram reassembly structure.
+ *
+ * Fragments that do not carry any new data are dropped.
+ *
+ * @param rdg		Datagram reassembly structure
+ * @param packet	Fragment
+ * @return		EOK on success (including when a duplicate fragment
+ *			is dropped), EINVAL if fragment is not consistent
+ *			with the datagram, ELIMIT if the datagram would be
+ *			too large, ENOMEM if out of memory
+ */
 static errno_t reass_dgram_insert_frag(reass_dgram_t *rdg, inet_packet_t *packet)
 {
 	reass_frag_t *frag;
+	reass_hole_t *spare;
 	void *data_copy;
-	link_t *link;
+	size_t fragoff_limit;
+	size_t first;
+	size_t last;
+	size_t mem;
 
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-	frag = reass_frag_new();
+	first = packet->offs;
+	last = packet->offs + packet->size;
+
+	/* Upper bound for fragment offset field */
+	fragoff_limit = 1 << (FF_FRAGOFF_h - FF_FRAGOFF_l + 1);
+
+	/* Verify that total size of datagram is within reasonable bounds */
+	if (last > FRAG_OFFS_UNIT * fragoff_limit)
+		return ELIMIT;
+
+	/* An empty fragment carries no data */
+	if (first == last)
+		return EINVAL;
+
+	if (rdg->have_last) {
+		/* No fragment may extend beyond the end of the datagram */
+		if (last > rdg->size)
+			return EINVAL;
+
+		/* Last fragments must agree on the datagram size */
+		if (!packet->mf && last != rdg->size)
+			return EINVAL;
+	} else if (!packet->mf && rdg->data_end > last) {
+		/* We have data beyond the end of the datagram */
+		return EINVAL;
+	}
+
+	/* Drop duplicate data right away */
+	if (!reass_dgram_fills_hole(rdg, first, last) &&
+	    (packet->mf || rdg->have_last))
+		return EOK;
+
+	mem = sizeof(reass_frag_t) + packet->size;
+	if (!reass_reserve(rdg, mem))
+		return ENOMEM;
+
+	frag = calloc(1, sizeof(reass_frag_t));
+	if (frag == NULL)
+		return ENOMEM;
+
+	spare = calloc(1, sizeof(reass_hole_t));
+	if (spare == NULL) {
+		free(frag);
+		return ENOMEM;
+	}
 
 	/* Clone the packet */
 
 	data_copy = malloc(packet->size);
 	if (data_copy == NULL) {
+		free(spare);
 		free(frag);
 		return ENOMEM;
 	}
 
 	memcpy(data_copy, packet->data, packet->size);
 
+	link_initialize(&frag->dgram_link);
 	frag->packet = *packet;
 	frag->packet.data = data_copy;
+	list_append(&frag->dgram_link, &rdg->frags);
 
-	/*
-	 * XXX Make resource-consuming attacks harder, eliminate any duplicate
-	 * data immediately. Possibly eliminate redundant packet headers.
-	 */
-
-	/*
-	 * Insert into the list, which is sorted by offs member ascending.
-	 */
-
-	link = list_first(&rdg->frags);
-	while (link != NULL) {
-		reass_frag_t *qf = list_get_instance(link, reass_frag_t,
-		    dgram_link);
-
-		if (qf->packet.offs >= packet->offs)
-			break;
+	rdg->mem += mem;
+	reass_mem += mem;
+	rdg->data_end = max(rdg->data_end, last);
 
-		link = list_next(link, &rdg->frags);
-	}
+	if (!packet->mf && !rdg->have_last)
+		reass_dgram_set_size(rdg, last);
 
-	if (link != NULL)
-		list_insert_after(&frag->dgram_link, link);
-	else
-		list_append(&frag->dgram_link, &rdg->frags);
+	if (!reass_dgram_fill_holes(rdg, first, last, spare))
+		free(spare);
 
 	return EOK;
 }
@@ -237,42 +596,13 @@ static errno_t reass_dgram_insert_frag(reass_dgram_t *rdg, inet_packet_t *packet
  */
 static bool reass_dgram_complete(reass_dgram_t *rdg)
 {
-	reass_frag_t *frag, *prev;
-	link_t *link;
-
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
-	assert(!list_empty(&rdg->frags));
 
-	link = list_first(&rdg->frags);
-	assert(link != NULL);
-
-	frag = list_get_instance(link, reass_frag_t,
-	    dgram_link);
-
-	/* First fragment must be at offset zero */
-	if (frag->packet.offs != 0)
-		return false;
-
-	prev = frag;
-
-	while (true) {
-		link = list_next(link, &rdg->frags);
-		if (link == NULL)
-			break;
-
-		/* Each next fragment must follow immediately or overlap */
-		frag = list_get_instance(link, reass_frag_t, dgram_link);
-		if (frag->packet.offs > prev->packet.offs + prev->packet.size)
-			return false;
-
-		/* No more fragments - datagram is complete */
-		if (!frag->packet.mf)
-			return true;
-
-		prev = frag;
-	}
-
-	return false;
+	/*
+	 * Until the last fragment is received there is always a hole
+	 * at the end of the datagram.
+	 */
+	return list_empty(&rdg->holes);
 }
 
 /** Remove datagram from reassembly map.
@@ -282,7 +612,9 @@ static bool reass_dgram_complete(reass_dgram_t *rdg)
 static void reass_dgram_remove(reass_dgram_t *rdg)
 {
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
-	list_remove(&rdg->map_link);
+	hash_table_remove_item(&reass_dgram_map, &rdg->map_link);
+	list_remove(&rdg->age_link);
+	reass_mem -= rdg->mem;
 }
 
 /** Deliver complete datagram.
@@ -292,35 +624,18 @@ static void reass_dgram_remove(reass_dgram_t *rdg)
 static errno_t reass_dgram_deliver(reass_dgram_t *rdg)
 {
 	size_t dgram_size;
-	size_t fragoff_limit;
 	inet_dgram_t dgram;
 	uint8_t proto;
 	reass_frag_t *frag;
 	errno_t rc;
 
-	/*
-	 * Potentially there could be something beyond the first packet
-	 * that has !MF. Make sure we ignore that.
-	 */
-	frag = NULL;
-	list_foreach(rdg->frags, dgram_link, reass_frag_t, cfrag) {
-		if (!cfrag->packet.mf) {
-			frag = cfrag;
-			break;
-		}
-	}
-
-	assert(frag != NULL);
-	assert(!frag->packet.mf);
-
-	dgram_size = frag->packet.offs + frag->packet.size;
+	assert(rdg->have_last);
+	assert(!list_empty(&rdg->frags));
 
-	/* Upper bound for fragment offset field */
-	fragoff_limit = 1 << (FF_FRAGOFF_h - FF_FRAGOFF_l + 1);
+	frag = list_get_instance(list_first(&rdg->frags), reass_frag_t,
+	    dgram_link);
 
-	/* Verify that total size of datagram is within reasonable bounds */
-	if (dgram_size > FRAG_OFFS_UNIT * fragoff_limit)
-		return ELIMIT;
+	dgram_size = rdg->size;
 
 	dgram.data = calloc(dgram_size, 1);
 	if (dgram.data == NULL)
@@ -329,29 +644,20 @@ static errno_t reass_dgram_deliver(reass_dgram_t *rdg)
 	/* XXX What if different fragments came from different link? */
 	dgram.iplink = frag->packet.link_id;
 	dgram.size = dgram_size;
-	dgram.src = frag->packet.src;
-	dgram.dest = frag->packet.dest;
+	dgram.src = rdg->key.src;
+	dgram.dest = rdg->key.dest;
 	dgram.tos = frag->packet.tos;
-	proto = frag->packet.proto;
-
-	/* Pull together data from individual fragments */
+	proto = rdg->key.proto;
 
-	size_t doffs = 0;
-
-	list_foreach(rdg->frags, dgram_link, reass_frag_t, cfrag) {
-		size_t cb, ce;
-
-		cb = max(doffs, cfrag->packet.offs);
-		ce = min(dgram_size, cfrag->packet.offs + cfrag->packet.size);
-
-		if (ce > cb) {
-			memcpy(dgram.data + cb,
-			    cfrag->packet.data + cb - cfrag->packet.offs,
-			    ce - cb);
-		}
-
-		if (!cfrag->packet.mf)
-			break;
+	/*
+	 * Pull together data from individual fragments. Go in reverse
+	 * order of arrival so that, where fragments overlap, the data
+	 * received first prevails.
+	 */
+	list_foreach_rev(rdg->frags, dgram_link, reass_frag_t, cfrag) {
+		assert(cfrag->packet.offs + cfrag->packet.size <= dgram_size);
+		memcpy(dgram.data + cfrag->packet.offs, cfrag->packet.data,
+		    cfrag->packet.size);
 	}
 
 	rc = inet_recv_dgram_local(&dgram, proto);
@@ -375,8 +681,88 @@ static void reass_dgram_destroy(reass_dgram_t *rdg)
 		free(frag);
 	}
 
+	while (!list_empty(&rdg->holes)) {
+		link_t *hlink = list_first(&rdg->holes);
+		reass_hole_t *hole = list_get_instance(hlink, reass_hole_t,
+		    dgram_link);
+
+		list_remove(&hole->dgram_link);
+		free(hole);
+	}
+
 	free(rdg);
 }
 
+/** Drop datagrams whose reassembly timed out. */
+static void reass_expire(void)
+{
+	struct timespec now;
+	link_t *link;
+
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+
+	getuptime(&now);
+
+	while ((link = list_first(&reass_dgram_age)) != NULL) {
+		reass_dgram_t *rdg = list_get_instance(link, reass_dgram_t,
+		    age_link);
+
+		if (ts_sub_diff(&rdg->deadline, &now) > 0)
+			break;
+
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Reassembly of datagram %p "
+		    "timed out.", rdg);
+		reass_dgram_remove(rdg);
+		reass_dgram_destroy(rdg);
+	}
+}
+
+/** Reassembly timer handler.
+ *
+ * @param arg	Not used
+ */
+static void reass_timeout(void *arg)
+{
+	(void) arg;
+
+	fibril_mutex_lock(&reass_dgram_map_lock);
+	reass_timer_armed = false;
+	reass_expire();
+	reass_timer_update();
+	fibril_mutex_unlock(&reass_dgram_map_lock);
+}
+
+/** Set reassembly timer to expire the oldest datagram, if needed. */
+static void reass_timer_update(void)
+{
+	struct timespec now;
+	link_t *link;
+	nsec_t delay;
+
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+
+	/*
+	 * Datagrams expire in order of arrival. If the timer is set,
+	 * it will take care of the oldest one and then re-arm itself.
+	 */
+	if (reass_timer_armed)
+		return;
+
+	link = list_first(&reass_dgram_age);
+	if (link == NULL)
+		return;
+
+	reass_dgram_t *rdg = list_get_instance(link, reass_dgram_t, age_link);
+
+	getuptime(&now);
+	delay = ts_sub_diff(&rdg->deadline, &now);
+	if (delay < 0)
+		delay = 0;
+
+	fibril_timer_set_locked(reass_timer, NSEC2USEC(delay), reass_timeout,
+	    NULL);
+	reass_timer_armed = true;
+}
+
 /** @}
  */
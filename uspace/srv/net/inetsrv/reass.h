@@ -37,8 +37,12 @@
 #ifndef INET_REASS_H_
 #define INET_REASS_H_
 
+#include <time.h>
 #include "inetsrv.h"
 
+extern nsec_t inet_reass_timeout;
+
+extern errno_t inet_reass_init(void);
 extern errno_t inet_reass_queue_packet(inet_packet_t *);
 
 #endif
@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup inet
+ * @{
+ */
+/**
+ * @file
+ * @brief Longest-prefix-match routing trie
+ *
+ * Compressed binary radix (PATRICIA) trie keyed by address prefixes.
+ * Each node holds a prefix and the entries (e.g. static routes) with
+ * exactly that prefix. A node only exists where it carries entries or
+ * where two subtrees branch off, so a lookup visits at most as many
+ * nodes as there are bits in the address.
+ *
+ * Keys are addresses in network byte order. The trie does not do any
+ * locking of its own.
+ */
+
+#include <adt/list.h>
+#include <assert.h>
+#include <errno.h>
+#include <mem.h>
+#include <stdlib.h>
+#include "inetsrv.h"
+#include "rtrie.h"
+
+/** Get bit @a i of key (counting from the most significant bit). */
+static unsigned inet_rtrie_bit(const uint8_t *key, unsigned i)
+{
+	return (key[i / 8] >> (7 - i % 8)) & 0x1;
+}
+
+/** Determine length of common prefix of two keys.
+ *
+ * @param a	First key
+ * @param b	Second key
+ * @param max	Maximum number of bits to compare
+ * @return	Number of leading bits in which @a a and @a b agree,
+ *		at most @a max
+ */
+static unsigned inet_rtrie_common(const uint8_t *a, const uint8_t *b,
+    unsigned max)
+{
+	unsigned bits;
+	uint8_t diff;
+	unsigned i;
+
+	bits = 0;
+	for (i = 0; bits < max; i++) {
+		diff = a[i] ^ b[i];
+		if (diff != 0) {
+			while ((diff & 0x80) == 0) {
+				diff <<= 1;
+				++bits;
+			}
+			break;
+		}
+
+		bits += 8;
+	}
+
+	return bits < max ? bits : max;
+}
+
+/** Create trie node.
+ *
+ * @param key	Key, only the first @a plen bits are used
+ * @param plen	Prefix length
+ * @return	New node or @c NULL if out of memory
+ */
+static inet_rtrie_node_t *inet_rtrie_node_create(const uint8_t *key,
+    uint8_t plen)
+{
+	inet_rtrie_node_t *node;
+	unsigned nbytes;
+
+	node = calloc(1, sizeof(inet_rtrie_node_t));
+	if (node == NULL)
+		return NULL;
+
+	/* Copy the prefix, leaving the remaining bits zero */
+	nbytes = (plen + 7) / 8;
+	memcpy(node->prefix, key, nbytes);
+	if (plen % 8 != 0)
+		node->prefix[nbytes - 1] &= 0xff << (8 - plen % 8);
+
+	node->plen = plen;
+	list_initialize(&node->entries);
+	return node;
+}
+
+/** Initialize routing trie.
+ *
+ * @param trie	Trie
+ * @param klen	Key length in bytes (at most 16)
+ */
+void inet_rtrie_init(inet_rtrie_t *trie, size_t klen)
+{
+	assert(klen <= sizeof(((inet_rtrie_node_t *) NULL)->prefix));
+
+	trie->root = NULL;
+	trie->klen = klen;
+}
+
+/** Destroy subtree.
+ *
+ * @param node	Root of the subtree or @c NULL
+ */
+static void inet_rtrie_destroy(inet_rtrie_node_t *node)
+{
+	if (node == NULL)
+		return;
+
+	inet_rtrie_destroy(node->child[0]);
+	inet_rtrie_destroy(node->child[1]);
+	free(node);
+}
+
+/** Finalize routing trie.
+ *
+ * Frees all nodes. The entries are not owned by the trie.
+ *
+ * @param trie	Trie
+ */
+void inet_rtrie_fini(inet_rtrie_t *trie)
+{
+	inet_rtrie_destroy(trie->root);
+	trie->root = NULL;
+}
+
+/** Insert entry into routing trie.
+ *
+ * Entries with the same prefix are kept in order of insertion.
+ *
+ * @param trie	Trie
+ * @param key	Prefix, bits beyond @a plen are ignored
+ * @param plen	Prefix length in bits
+ * @param entry	Entry link
+ * @return	EOK on success, ENOMEM if out of memory
+ */
+errno_t inet_rtrie_insert(inet_rtrie_t *trie, const uint8_t *key,
+    uint8_t plen, link_t *entry)
+{
+	inet_rtrie_node_t **pnode;
+	inet_rtrie_node_t *node;
+	inet_rtrie_node_t *nnode;
+	inet_rtrie_node_t *branch;
+	unsigned common;
+
+	assert(plen <= trie->klen * 8);
+
+	pnode = &trie->root;
+	while (*pnode != NULL) {
+		node = *pnode;
+		common = inet_rtrie_common(node->prefix, key,
+		    plen < node->plen ? plen : node->plen);
+
+		if (common == node->plen) {
+			if (node->plen == plen) {
+				/* Node for this prefix exists */
+				list_append(entry, &node->entries);
+				return EOK;
+			}
+
+			/* Node prefix covers key, descend */
+			pnode = &node->child[inet_rtrie_bit(key, node->plen)];
+			continue;
+		}
+
+		nnode = inet_rtrie_node_create(key, plen);
+		if (nnode == NULL)
+			return ENOMEM;
+
+		if (common == plen) {
+			/* New prefix covers the node, insert above it */
+			nnode->child[inet_rtrie_bit(node->prefix, plen)] = node;
+			list_append(entry, &nnode->entries);
+			*pnode = nnode;
+			return EOK;
+		}
+
+		/* Prefixes diverge, add branch node with the common part */
+		branch = inet_rtrie_node_create(key, common);
+		if (branch == NULL) {
+			free(nnode);
+			return ENOMEM;
+		}
+
+		branch->child[inet_rtrie_bit(node->prefix, common)] = node;
+		branch->child[inet_rtrie_bit(key, common)] = nnode;
+		list_append(entry, &nnode->entries);
+		*pnode = branch;
+		return EOK;
+	}
+
+	nnode = inet_rtrie_node_create(key, plen);
+	if (nnode == NULL)
+		return ENOMEM;
+
+	list_append(entry, &nnode->entries);
+	*pnode = nnode;
+	return EOK;
+}
+
+/** Remove node if it is no longer needed.
+ *
+ * A node without entries is only needed if it has two children.
+ *
+ * @param pnode	Pointer to the link to the node
+ */
+static void inet_rtrie_prune(inet_rtrie_node_t **pnode)
+{
+	inet_rtrie_node_t *node = *pnode;
+
+	if (!list_empty(&node->entries))
+		return;
+
+	if (node->child[0] != NULL && node->child[1] != NULL)
+		return;
+
+	*pnode = node->child[0] != NULL ? node->child[0] : node->child[1];
+	free(node);
+}
+
+/** Remove entry from routing trie.
+ *
+ * @param trie	Trie
+ * @param key	Prefix the entry was inserted with
+ * @param plen	Prefix length the entry was inserted with
+ * @param entry	Entry link
+ */
+void inet_rtrie_remove(inet_rtrie_t *trie, const uint8_t *key, uint8_t plen,
+    link_t *entry)
+{
+	inet_rtrie_node_t **pnode;
+	inet_rtrie_node_t **pparent;
+
+	pparent = NULL;
+	pnode = &trie->root;
+	while (*pnode != NULL && (*pnode)->plen < plen) {
+		pparent = pnode;
+		pnode = &(*pnode)->child[inet_rtrie_bit(key, (*pnode)->plen)];
+	}
+
+	assert(*pnode != NULL);
+	assert((*pnode)->plen == plen);
+
+	list_remove(entry);
+
+	/* Removing a leaf may leave its parent with a single child */
+	inet_rtrie_prune(pnode);
+	if (pparent != NULL)
+		inet_rtrie_prune(pparent);
+}
+
+/** Find entry with the longest prefix matching an address.
+ *
+ * @param trie	Trie
+ * @param key	Address
+ * @return	First entry with the longest matching prefix or @c NULL
+ */
+link_t *inet_rtrie_lookup(inet_rtrie_t *trie, const uint8_t *key)
+{
+	inet_rtrie_node_t *node;
+	link_t *best;
+
+	best = NULL;
+	node = trie->root;
+
+	while (node != NULL) {
+		if (inet_rtrie_common(node->prefix, key, node->plen) <
+		    node->plen)
+			break;
+
+		if (!list_empty(&node->entries))
+			best = list_first(&node->entries);
+
+		if (node->plen == trie->klen * 8)
+			break;
+
+		node = node->child[inet_rtrie_bit(key, node->plen)];
+	}
+
+	return best;
+}
+
+/** @}
+ */
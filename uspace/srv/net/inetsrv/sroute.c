@@ -34,21 +34,89 @@
  * @brief
  */
 
+#include <assert.h>
 #include <bitops.h>
 #include <errno.h>
 #include <fibril_synch.h>
 #include <io/log.h>
 #include <ipc/loc.h>
+#include <mem.h>
 #include <stdlib.h>
 #include <str.h>
 #include "sroute.h"
 #include "inetsrv.h"
 #include "inet_link.h"
+#include "rtrie.h"
 
-static FIBRIL_MUTEX_INITIALIZE(sroute_list_lock);
+/** Protects the list and routing tries, lookups only take it for reading */
+static FIBRIL_RWLOCK_INITIALIZE(sroute_lock);
 static LIST_INITIALIZE(sroute_list);
 static sysarg_t sroute_id = 0;
 
+/** Routing tries for IPv4 and IPv6 routes */
+static inet_rtrie_t sroute_trie4 = {
+	.root = NULL,
+	.klen = sizeof(addr32_t)
+};
+static inet_rtrie_t sroute_trie6 = {
+	.root = NULL,
+	.klen = sizeof(addr128_t)
+};
+
+/** Routing table generation, changes whenever a route is added or removed */
+static unsigned sroute_gen = 1;
+
+/** Get routing trie and trie key for an address.
+ *
+ * @param addr	Address
+ * @param key	Place to store key (at least 16 bytes)
+ * @return	Routing trie or @c NULL if address family is not supported
+ */
+static inet_rtrie_t *inet_sroute_trie_key(const inet_addr_t *addr,
+    uint8_t *key)
+{
+	addr32_t v4;
+	addr128_t v6;
+
+	switch (inet_addr_get(addr, &v4, &v6)) {
+	case ip_v4:
+		key[0] = (v4 >> 24) & 0xff;
+		key[1] = (v4 >> 16) & 0xff;
+		key[2] = (v4 >> 8) & 0xff;
+		key[3] = v4 & 0xff;
+		return &sroute_trie4;
+	case ip_v6:
+		memcpy(key, v6, sizeof(addr128_t));
+		return &sroute_trie6;
+	default:
+		return NULL;
+	}
+}
+
+/** Get routing trie, key and prefix length for route destination.
+ *
+ * @param sroute	Static route
+ * @param key		Place to store key (at least 16 bytes)
+ * @param plen		Place to store prefix length
+ * @return		Routing trie or @c NULL if the destination is not
+ *			valid
+ */
+static inet_rtrie_t *inet_sroute_dest_key(inet_sroute_t *sroute,
+    uint8_t *key, uint8_t *plen)
+{
+	inet_addr_t dest;
+	inet_rtrie_t *trie;
+
+	inet_naddr_addr(&sroute->dest, &dest);
+	(void) inet_naddr_get(&sroute->dest, NULL, NULL, plen);
+
+	trie = inet_sroute_trie_key(&dest, key);
+	if (trie == NULL || *plen > trie->klen * 8)
+		return NULL;
+
+	return trie;
+}
+
 inet_sroute_t *inet_sroute_new(void)
 {
 	inet_sroute_t *sroute = calloc(1, sizeof(inet_sroute_t));
@@ -60,9 +128,10 @@ inet_sroute_t *inet_sroute_new(void)
 	}
 
 	link_initialize(&sroute->sroute_list);
-	fibril_mutex_lock(&sroute_list_lock);
+	link_initialize(&sroute->rtrie_link);
+	fibril_rwlock_write_lock(&sroute_lock);
 	sroute->id = ++sroute_id;
-	fibril_mutex_unlock(&sroute_list_lock);
+	fibril_rwlock_write_unlock(&sroute_lock);
 
 	return sroute;
 }
@@ -74,61 +143,124 @@ void inet_sroute_delete(inet_sroute_t *sroute)
 	free(sroute);
 }
 
-void inet_sroute_add(inet_sroute_t *sroute)
+/** Add static route.
+ *
+ * @param sroute	Static route
+ * @return		EOK on success, EINVAL if destination is not valid,
+ *			ENOMEM if out of memory
+ */
+errno_t inet_sroute_add(inet_sroute_t *sroute)
 {
-	fibril_mutex_lock(&sroute_list_lock);
+	inet_rtrie_t *trie;
+	uint8_t key[16];
+	uint8_t plen;
+	errno_t rc;
+
+	trie = inet_sroute_dest_key(sroute, key, &plen);
+	if (trie == NULL)
+		return EINVAL;
+
+	fibril_rwlock_write_lock(&sroute_lock);
+
+	rc = inet_rtrie_insert(trie, key, plen, &sroute->rtrie_link);
+	if (rc != EOK) {
+		fibril_rwlock_write_unlock(&sroute_lock);
+		return rc;
+	}
+
 	list_append(&sroute->sroute_list, &sroute_list);
-	fibril_mutex_unlock(&sroute_list_lock);
+	++sroute_gen;
+	fibril_rwlock_write_unlock(&sroute_lock);
+
+	return EOK;
 }
 
 void inet_sroute_remove(inet_sroute_t *sroute)
 {
-	fibril_mutex_lock(&sroute_list_lock);
+	inet_rtrie_t *trie;
+	uint8_t key[16];
+	uint8_t plen;
+
+	trie = inet_sroute_dest_key(sroute, key, &plen);
+	assert(trie != NULL);
+
+	fibril_rwlock_write_lock(&sroute_lock);
+	inet_rtrie_remove(trie, key, plen, &sroute->rtrie_link);
 	list_remove(&sroute->sroute_list);
-	fibril_mutex_unlock(&sroute_list_lock);
+	++sroute_gen;
+	fibril_rwlock_write_unlock(&sroute_lock);
 }
 
-/** Find static route object matching address @a addr.
+/** Find static route matching address, with the route table locked.
  *
  * @param addr	Address
+ * @return	Most specific matching route or @c NULL
  */
-inet_sroute_t *inet_sroute_find(inet_addr_t *addr)
+static inet_sroute_t *inet_sroute_find_locked(inet_addr_t *addr)
 {
-	ip_ver_t addr_ver = inet_addr_get(addr, NULL, NULL);
+	inet_rtrie_t *trie;
+	uint8_t key[16];
+	link_t *link;
 
-	inet_sroute_t *best = NULL;
-	uint8_t best_bits = 0;
+	assert(fibril_rwlock_is_locked(&sroute_lock));
 
-	fibril_mutex_lock(&sroute_list_lock);
+	trie = inet_sroute_trie_key(addr, key);
+	if (trie == NULL)
+		return NULL;
 
-	list_foreach(sroute_list, sroute_list, inet_sroute_t, sroute) {
-		uint8_t dest_bits;
-		ip_ver_t dest_ver = inet_naddr_get(&sroute->dest, NULL, NULL,
-		    &dest_bits);
+	link = inet_rtrie_lookup(trie, key);
+	if (link == NULL)
+		return NULL;
+
+	return list_get_instance(link, inet_sroute_t, rtrie_link);
+}
+
+/** Find static route object matching address @a addr.
+ *
+ * @param addr	Address
+ * @return	Most specific matching route or @c NULL
+ */
+inet_sroute_t *inet_sroute_find(inet_addr_t *addr)
+{
+	inet_sroute_t *sroute;
 
-		/* Skip comparison with different address family */
-		if (addr_ver != dest_ver)
-			continue;
+	fibril_rwlock_read_lock(&sroute_lock);
+	sroute = inet_sroute_find_locked(addr);
+	fibril_rwlock_read_unlock(&sroute_lock);
 
-		/* Look for the most specific route */
-		if ((best != NULL) && (best_bits >= dest_bits))
-			continue;
+	if (sroute == NULL)
+		log_msg(LOG_DEFAULT, LVL_DEBUG2, "inet_sroute_find: Not found");
 
-		if (inet_naddr_compare_mask(&sroute->dest, addr)) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find: found candidate %p",
-			    sroute);
+	return sroute;
+}
 
-			best = sroute;
-			best_bits = dest_bits;
-		}
-	}
+/** Find static route matching address, using a lookup cache.
+ *
+ * If @a addr is the destination looked up last time and the routing
+ * table has not changed since, the cached result is returned.
+ *
+ * @param cache	Route cache
+ * @param addr	Address
+ * @return	Most specific matching route or @c NULL
+ */
+inet_sroute_t *inet_sroute_find_cached(inet_sroute_cache_t *cache,
+    inet_addr_t *addr)
+{
+	inet_sroute_t *sroute;
 
-	if (best == NULL)
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find: Not found");
+	fibril_rwlock_read_lock(&sroute_lock);
 
-	fibril_mutex_unlock(&sroute_list_lock);
+	if (cache->gen == sroute_gen && inet_addr_compare(&cache->dest, addr)) {
+		sroute = cache->sroute;
+	} else {
+		sroute = inet_sroute_find_locked(addr);
+		cache->gen = sroute_gen;
+		cache->dest = *addr;
+		cache->sroute = sroute;
+	}
 
-	return best;
+	fibril_rwlock_read_unlock(&sroute_lock);
+	return sroute;
 }
 
 /** Find static route with a specific name.
@@ -141,11 +273,11 @@ inet_sroute_t *inet_sroute_find_by_name(const char *name)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find_by_name('%s')",
 	    name);
 
-	fibril_mutex_lock(&sroute_list_lock);
+	fibril_rwlock_read_lock(&sroute_lock);
 
 	list_foreach(sroute_list, sroute_list, inet_sroute_t, sroute) {
 		if (str_cmp(sroute->name, name) == 0) {
-			fibril_mutex_unlock(&sroute_list_lock);
+			fibril_rwlock_read_unlock(&sroute_lock);
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find_by_name: found %p",
 			    sroute);
 			return sroute;
@@ -153,7 +285,7 @@ inet_sroute_t *inet_sroute_find_by_name(const char *name)
 	}
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_find_by_name: Not found");
-	fibril_mutex_unlock(&sroute_list_lock);
+	fibril_rwlock_read_unlock(&sroute_lock);
 
 	return NULL;
 }
@@ -167,16 +299,16 @@ inet_sroute_t *inet_sroute_get_by_id(sysarg_t id)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_sroute_get_by_id(%zu)", (size_t)id);
 
-	fibril_mutex_lock(&sroute_list_lock);
+	fibril_rwlock_read_lock(&sroute_lock);
 
 	list_foreach(sroute_list, sroute_list, inet_sroute_t, sroute) {
 		if (sroute->id == id) {
-			fibril_mutex_unlock(&sroute_list_lock);
+			fibril_rwlock_read_unlock(&sroute_lock);
 			return sroute;
 		}
 	}
 
-	fibril_mutex_unlock(&sroute_list_lock);
+	fibril_rwlock_read_unlock(&sroute_lock);
 
 	return NULL;
 }
@@ -187,12 +319,12 @@ errno_t inet_sroute_get_id_list(sysarg_t **rid_list, size_t *rcount)
 	sysarg_t *id_list;
 	size_t count, i;
 
-	fibril_mutex_lock(&sroute_list_lock);
+	fibril_rwlock_read_lock(&sroute_lock);
 	count = list_count(&sroute_list);
 
 	id_list = calloc(count, sizeof(sysarg_t));
 	if (id_list == NULL) {
-		fibril_mutex_unlock(&sroute_list_lock);
+		fibril_rwlock_read_unlock(&sroute_lock);
 		return ENOMEM;
 	}
 
@@ -201,7 +333,7 @@ errno_t inet_sroute_get_id_list(sysarg_t **rid_list, size_t *rcount)
 		id_list[i++] = sroute->id;
 	}
 
-	fibril_mutex_unlock(&sroute_list_lock);
+	fibril_rwlock_read_unlock(&sroute_lock);
 
 	*rid_list = id_list;
 	*rcount = count;
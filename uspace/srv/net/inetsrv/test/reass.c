@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fibril.h>
+#include <io/log.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "../inetsrv.h"
+#include "../reass.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(reass);
+
+/** Size of the largest test datagram */
+#define TEST_DGRAM_MAX 65528
+/** Size of the fragments used to fill the reassembly memory */
+#define TEST_FILL_SIZE 60000
+/** Number of datagrams that do not fit in the reassembly memory together */
+#define TEST_FILL_DGRAMS 20
+
+/** Contents of test datagrams */
+static uint8_t dgram_data[TEST_DGRAM_MAX];
+
+/** Number of datagrams delivered */
+static unsigned dlv_cnt;
+/** Protocol of the last datagram delivered */
+static uint8_t dlv_proto;
+/** Size of the last datagram delivered */
+static size_t dlv_size;
+/** Contents of the last datagram delivered */
+static uint8_t *dlv_data;
+
+/** Deliver datagram, replaces the inetsrv implementation. */
+errno_t inet_recv_dgram_local(inet_dgram_t *dgram, uint8_t proto)
+{
+	free(dlv_data);
+	dlv_data = malloc(dgram->size);
+	PCUT_ASSERT_NOT_NULL(dlv_data);
+	memcpy(dlv_data, dgram->data, dgram->size);
+
+	dlv_proto = proto;
+	dlv_size = dgram->size;
+	++dlv_cnt;
+	return EOK;
+}
+
+/** Queue fragment @a offs to @a offs + @a size of datagram @a ident. */
+static errno_t frag_queue(uint32_t ident, size_t offs, size_t size, bool mf)
+{
+	inet_packet_t packet;
+
+	memset(&packet, 0, sizeof(packet));
+	inet_addr(&packet.src, 192, 168, 0, 1);
+	inet_addr(&packet.dest, 192, 168, 0, 2);
+	packet.proto = 17;
+	packet.ttl = 64;
+	packet.ident = ident;
+	packet.mf = mf;
+	packet.offs = offs;
+	packet.data = dgram_data + offs;
+	packet.size = size;
+
+	return inet_reass_queue_packet(&packet);
+}
+
+/** Verify that the last datagram delivered has the first @a size bytes. */
+static void dlv_check(size_t size)
+{
+	PCUT_ASSERT_INT_EQUALS(17, dlv_proto);
+	PCUT_ASSERT_INT_EQUALS(size, dlv_size);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(dlv_data, dgram_data, size));
+}
+
+PCUT_TEST_BEFORE
+{
+	errno_t rc;
+
+	/* We will be calling functions that perform logging */
+	rc = log_init("test-inetsrv");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = inet_reass_init();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	for (size_t i = 0; i < TEST_DGRAM_MAX; i++)
+		dgram_data[i] = (uint8_t) (i * 7 + i / 256);
+
+	dlv_cnt = 0;
+	dlv_data = NULL;
+}
+
+PCUT_TEST_AFTER
+{
+	free(dlv_data);
+	dlv_data = NULL;
+}
+
+/** Fragments received in order are delivered as one datagram */
+PCUT_TEST(in_order)
+{
+	errno_t rc;
+
+	rc = frag_queue(1, 0, 400, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = frag_queue(1, 400, 400, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, dlv_cnt);
+
+	rc = frag_queue(1, 800, 123, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, dlv_cnt);
+	dlv_check(923);
+}
+
+/** Fragments received out of order are delivered once all holes are filled */
+PCUT_TEST(out_of_order)
+{
+	errno_t rc;
+
+	/* Last fragment first */
+	rc = frag_queue(2, 1200, 100, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	/* Leaves holes at both ends */
+	rc = frag_queue(2, 400, 400, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = frag_queue(2, 0, 400, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, dlv_cnt);
+
+	rc = frag_queue(2, 800, 400, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, dlv_cnt);
+	dlv_check(1300);
+}
+
+/** Overlapping and duplicate fragments */
+PCUT_TEST(overlap)
+{
+	errno_t rc;
+
+	rc = frag_queue(3, 0, 400, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Duplicate is dropped */
+	rc = frag_queue(3, 0, 400, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Fragment inside a hole splits it */
+	rc = frag_queue(3, 800, 200, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Covered by the fragments we have */
+	rc = frag_queue(3, 200, 200, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = frag_queue(3, 1600, 8, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, dlv_cnt);
+
+	/* Overlaps both neighbors of the hole between them */
+	rc = frag_queue(3, 200, 800, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, dlv_cnt);
+
+	/* Fills the last hole and overlaps the last fragment */
+	rc = frag_queue(3, 600, 1008, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, dlv_cnt);
+	dlv_check(1608);
+
+	/* A late duplicate starts a new datagram, which is not complete */
+	rc = frag_queue(3, 0, 400, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, dlv_cnt);
+}
+
+/** Fragments inconsistent with the datagram size are rejected */
+PCUT_TEST(bad_size)
+{
+	errno_t rc;
+
+	rc = frag_queue(4, 400, 400, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Beyond the end of the datagram */
+	rc = frag_queue(4, 400, 800, true);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	/* Another last fragment with a different end */
+	rc = frag_queue(4, 0, 600, false);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	/* Empty fragment */
+	rc = frag_queue(4, 0, 0, true);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	/* Too large datagram */
+	rc = frag_queue(5, TEST_DGRAM_MAX, 16, false);
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, rc);
+
+	rc = frag_queue(4, 0, 400, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, dlv_cnt);
+	dlv_check(800);
+}
+
+/** Oldest datagrams are dropped when the memory limit is reached */
+PCUT_TEST(evict)
+{
+	uint32_t ident;
+	errno_t rc;
+
+	/* Oldest datagram, will be evicted */
+	rc = frag_queue(6, 0, 400, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Fill the reassembly memory with incomplete datagrams */
+	for (ident = 7; ident < 7 + TEST_FILL_DGRAMS; ident++) {
+		rc = frag_queue(ident, 0, TEST_FILL_SIZE, true);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	}
+
+	/* First fragment has been dropped */
+	rc = frag_queue(6, 400, 400, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, dlv_cnt);
+
+	/* Newest datagram has been kept */
+	rc = frag_queue(ident - 1, TEST_FILL_SIZE, 400, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, dlv_cnt);
+	dlv_check(TEST_FILL_SIZE + 400);
+}
+
+/** Datagrams are dropped when reassembly times out */
+PCUT_TEST(expire)
+{
+	nsec_t timeout;
+	errno_t rc;
+
+	timeout = inet_reass_timeout;
+	inet_reass_timeout = MSEC2NSEC(10);
+
+	rc = frag_queue(8, 0, 400, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	fibril_usleep(MSEC2USEC(50));
+
+	/* First fragment has been dropped */
+	rc = frag_queue(8, 400, 400, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, dlv_cnt);
+
+	inet_reass_timeout = timeout;
+
+	/* Datagram is reassembled within the timeout */
+	rc = frag_queue(9, 0, 400, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = frag_queue(9, 400, 400, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, dlv_cnt);
+	dlv_check(800);
+}
+
+PCUT_EXPORT(reass);
@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <adt/list.h>
+#include <errno.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+
+#include "../inetsrv.h"
+#include "../rtrie.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(rtrie);
+
+/** Number of routes in the test comparing against linear search */
+#define TEST_ROUTES 64
+/** Number of addresses looked up by the test comparing against linear search */
+#define TEST_LOOKUPS 1024
+
+/** Test route */
+typedef struct {
+	/** Link to routing trie node entries */
+	link_t link;
+	/** Prefix */
+	uint8_t key[16];
+	/** Prefix length */
+	uint8_t plen;
+} test_route_t;
+
+/** Initialize route with IPv4 prefix @a a.b.c.d/plen. */
+static void route_init4(test_route_t *route, uint8_t a, uint8_t b,
+    uint8_t c, uint8_t d, uint8_t plen)
+{
+	memset(route, 0, sizeof(test_route_t));
+	link_initialize(&route->link);
+	route->key[0] = a;
+	route->key[1] = b;
+	route->key[2] = c;
+	route->key[3] = d;
+	route->plen = plen;
+}
+
+/** Insert route into trie. */
+static void route_insert(inet_rtrie_t *trie, test_route_t *route)
+{
+	errno_t rc;
+
+	rc = inet_rtrie_insert(trie, route->key, route->plen, &route->link);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+/** Remove route from trie. */
+static void route_remove(inet_rtrie_t *trie, test_route_t *route)
+{
+	inet_rtrie_remove(trie, route->key, route->plen, &route->link);
+}
+
+/** Look up IPv4 address a.b.c.d in trie. */
+static test_route_t *route_lookup4(inet_rtrie_t *trie, uint8_t a, uint8_t b,
+    uint8_t c, uint8_t d)
+{
+	uint8_t key[4] = { a, b, c, d };
+	link_t *link;
+
+	link = inet_rtrie_lookup(trie, key);
+	if (link == NULL)
+		return NULL;
+
+	return list_get_instance(link, test_route_t, link);
+}
+
+/** Determine whether @a key matches the prefix of @a route. */
+static bool route_match(test_route_t *route, const uint8_t *key)
+{
+	unsigned i;
+
+	for (i = 0; i < route->plen; i++) {
+		if (((route->key[i / 8] ^ key[i / 8]) & (0x80 >> (i % 8))) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+/** Empty trie does not match anything */
+PCUT_TEST(empty)
+{
+	inet_rtrie_t trie;
+
+	inet_rtrie_init(&trie, 4);
+	PCUT_ASSERT_NULL(route_lookup4(&trie, 10, 0, 0, 1));
+	PCUT_ASSERT_NULL(route_lookup4(&trie, 0, 0, 0, 0));
+	inet_rtrie_fini(&trie);
+}
+
+/** Lookup returns the route with the longest matching prefix */
+PCUT_TEST(longest_prefix)
+{
+	inet_rtrie_t trie;
+	test_route_t r8, r16, r24;
+
+	inet_rtrie_init(&trie, 4);
+
+	route_init4(&r16, 10, 1, 0, 0, 16);
+	route_init4(&r8, 10, 0, 0, 0, 8);
+	route_init4(&r24, 10, 1, 2, 0, 24);
+	route_insert(&trie, &r16);
+	route_insert(&trie, &r8);
+	route_insert(&trie, &r24);
+
+	PCUT_ASSERT_EQUALS(&r24, route_lookup4(&trie, 10, 1, 2, 3));
+	PCUT_ASSERT_EQUALS(&r16, route_lookup4(&trie, 10, 1, 3, 1));
+	PCUT_ASSERT_EQUALS(&r8, route_lookup4(&trie, 10, 2, 0, 1));
+	PCUT_ASSERT_EQUALS(&r8, route_lookup4(&trie, 10, 255, 255, 255));
+	PCUT_ASSERT_NULL(route_lookup4(&trie, 11, 1, 2, 3));
+	PCUT_ASSERT_NULL(route_lookup4(&trie, 9, 1, 2, 3));
+
+	inet_rtrie_fini(&trie);
+}
+
+/** Sibling and nested prefixes inserted in any order */
+PCUT_TEST(overlapping)
+{
+	inet_rtrie_t trie;
+	test_route_t ra, rb, rc, rd, re;
+
+	inet_rtrie_init(&trie, 4);
+
+	/* Siblings differing in the last bit of the prefix */
+	route_init4(&ra, 192, 168, 0, 0, 24);
+	route_init4(&rb, 192, 168, 1, 0, 24);
+	/* Prefix covering both, inserted after them */
+	route_init4(&rc, 192, 168, 0, 0, 16);
+	/* Prefix between the siblings and the covering one */
+	route_init4(&rd, 192, 168, 0, 0, 23);
+	/* Prefix not aligned to a byte */
+	route_init4(&re, 192, 168, 128, 0, 17);
+
+	route_insert(&trie, &ra);
+	route_insert(&trie, &rb);
+	route_insert(&trie, &rc);
+	route_insert(&trie, &rd);
+	route_insert(&trie, &re);
+
+	PCUT_ASSERT_EQUALS(&ra, route_lookup4(&trie, 192, 168, 0, 1));
+	PCUT_ASSERT_EQUALS(&rb, route_lookup4(&trie, 192, 168, 1, 1));
+	PCUT_ASSERT_EQUALS(&rc, route_lookup4(&trie, 192, 168, 2, 1));
+	PCUT_ASSERT_EQUALS(&re, route_lookup4(&trie, 192, 168, 128, 1));
+	PCUT_ASSERT_EQUALS(&re, route_lookup4(&trie, 192, 168, 255, 1));
+	PCUT_ASSERT_EQUALS(&rc, route_lookup4(&trie, 192, 168, 127, 1));
+	PCUT_ASSERT_NULL(route_lookup4(&trie, 192, 169, 0, 1));
+
+	/* Removing the siblings uncovers the prefix between */
+	route_remove(&trie, &ra);
+	PCUT_ASSERT_EQUALS(&rd, route_lookup4(&trie, 192, 168, 0, 1));
+	route_remove(&trie, &rb);
+	PCUT_ASSERT_EQUALS(&rd, route_lookup4(&trie, 192, 168, 1, 1));
+
+	inet_rtrie_fini(&trie);
+}
+
+/** Routes with the same prefix are returned in order of insertion */
+PCUT_TEST(same_prefix)
+{
+	inet_rtrie_t trie;
+	test_route_t r1, r2;
+
+	inet_rtrie_init(&trie, 4);
+
+	route_init4(&r1, 10, 0, 0, 0, 8);
+	/* Bits beyond the prefix length are ignored */
+	route_init4(&r2, 10, 1, 2, 3, 8);
+	route_insert(&trie, &r1);
+	route_insert(&trie, &r2);
+
+	PCUT_ASSERT_EQUALS(&r1, route_lookup4(&trie, 10, 9, 9, 9));
+
+	route_remove(&trie, &r1);
+	PCUT_ASSERT_EQUALS(&r2, route_lookup4(&trie, 10, 9, 9, 9));
+
+	route_remove(&trie, &r2);
+	PCUT_ASSERT_NULL(route_lookup4(&trie, 10, 9, 9, 9));
+	PCUT_ASSERT_NULL(trie.root);
+
+	inet_rtrie_fini(&trie);
+}
+
+/** Default route matches any address not matched by a longer prefix */
+PCUT_TEST(default_route)
+{
+	inet_rtrie_t trie;
+	test_route_t rdef, r8;
+
+	inet_rtrie_init(&trie, 4);
+
+	route_init4(&rdef, 0, 0, 0, 0, 0);
+	route_init4(&r8, 10, 0, 0, 0, 8);
+	route_insert(&trie, &rdef);
+	route_insert(&trie, &r8);
+
+	PCUT_ASSERT_EQUALS(&rdef, route_lookup4(&trie, 0, 0, 0, 0));
+	PCUT_ASSERT_EQUALS(&rdef, route_lookup4(&trie, 255, 255, 255, 255));
+	PCUT_ASSERT_EQUALS(&rdef, route_lookup4(&trie, 11, 0, 0, 1));
+	PCUT_ASSERT_EQUALS(&r8, route_lookup4(&trie, 10, 0, 0, 1));
+
+	route_remove(&trie, &rdef);
+	PCUT_ASSERT_NULL(route_lookup4(&trie, 11, 0, 0, 1));
+	PCUT_ASSERT_EQUALS(&r8, route_lookup4(&trie, 10, 0, 0, 1));
+
+	inet_rtrie_fini(&trie);
+}
+
+/** Host route matches only its own address */
+PCUT_TEST(host_route)
+{
+	inet_rtrie_t trie;
+	test_route_t r32a, r32b, r24;
+
+	inet_rtrie_init(&trie, 4);
+
+	route_init4(&r32a, 10, 0, 0, 1, 32);
+	route_init4(&r32b, 10, 0, 0, 0, 32);
+	route_init4(&r24, 10, 0, 0, 0, 24);
+	route_insert(&trie, &r32a);
+	route_insert(&trie, &r32b);
+
+	PCUT_ASSERT_EQUALS(&r32a, route_lookup4(&trie, 10, 0, 0, 1));
+	PCUT_ASSERT_EQUALS(&r32b, route_lookup4(&trie, 10, 0, 0, 0));
+	PCUT_ASSERT_NULL(route_lookup4(&trie, 10, 0, 0, 2));
+	PCUT_ASSERT_NULL(route_lookup4(&trie, 10, 0, 0, 3));
+
+	route_insert(&trie, &r24);
+	PCUT_ASSERT_EQUALS(&r32a, route_lookup4(&trie, 10, 0, 0, 1));
+	PCUT_ASSERT_EQUALS(&r24, route_lookup4(&trie, 10, 0, 0, 2));
+
+	route_remove(&trie, &r32a);
+	PCUT_ASSERT_EQUALS(&r24, route_lookup4(&trie, 10, 0, 0, 1));
+	PCUT_ASSERT_EQUALS(&r32b, route_lookup4(&trie, 10, 0, 0, 0));
+
+	inet_rtrie_fini(&trie);
+}
+
+/** Removing all routes in any order leaves the trie empty */
+PCUT_TEST(remove)
+{
+	inet_rtrie_t trie;
+	test_route_t r[6];
+	unsigned i;
+
+	inet_rtrie_init(&trie, 4);
+
+	route_init4(&r[0], 10, 0, 0, 0, 8);
+	route_init4(&r[1], 10, 1, 0, 0, 16);
+	route_init4(&r[2], 10, 2, 0, 0, 16);
+	route_init4(&r[3], 10, 1, 2, 3, 32);
+	route_init4(&r[4], 0, 0, 0, 0, 0);
+	route_init4(&r[5], 172, 16, 0, 0, 12);
+
+	for (i = 0; i < 6; i++)
+		route_insert(&trie, &r[i]);
+
+	/* Remove a branch node's child, the branch must go too */
+	route_remove(&trie, &r[2]);
+	PCUT_ASSERT_EQUALS(&r[0], route_lookup4(&trie, 10, 2, 0, 1));
+	PCUT_ASSERT_EQUALS(&r[1], route_lookup4(&trie, 10, 1, 0, 1));
+
+	/* Remove an inner node with a single child */
+	route_remove(&trie, &r[1]);
+	PCUT_ASSERT_EQUALS(&r[3], route_lookup4(&trie, 10, 1, 2, 3));
+	PCUT_ASSERT_EQUALS(&r[0], route_lookup4(&trie, 10, 1, 2, 4));
+
+	route_remove(&trie, &r[4]);
+	PCUT_ASSERT_NULL(route_lookup4(&trie, 11, 0, 0, 1));
+	PCUT_ASSERT_EQUALS(&r[5], route_lookup4(&trie, 172, 20, 0, 1));
+
+	route_remove(&trie, &r[0]);
+	route_remove(&trie, &r[5]);
+	PCUT_ASSERT_EQUALS(&r[3], route_lookup4(&trie, 10, 1, 2, 3));
+	PCUT_ASSERT_NULL(route_lookup4(&trie, 10, 1, 2, 4));
+
+	route_remove(&trie, &r[3]);
+	PCUT_ASSERT_NULL(trie.root);
+
+	inet_rtrie_fini(&trie);
+}
+
+/** IPv6 prefixes, including /0 and /128 */
+PCUT_TEST(ipv6)
+{
+	inet_rtrie_t trie;
+	test_route_t rdef, r64, r128;
+	uint8_t key[16];
+	link_t *link;
+
+	inet_rtrie_init(&trie, 16);
+
+	memset(&rdef, 0, sizeof(rdef));
+	memset(&r64, 0, sizeof(r64));
+	memset(&r128, 0, sizeof(r128));
+	link_initialize(&rdef.link);
+	link_initialize(&r64.link);
+	link_initialize(&r128.link);
+
+	r64.key[0] = 0x20;
+	r64.key[1] = 0x01;
+	r64.key[2] = 0x0d;
+	r64.key[3] = 0xb8;
+	r64.plen = 64;
+
+	memcpy(r128.key, r64.key, 16);
+	r128.key[15] = 0x01;
+	r128.plen = 128;
+
+	route_insert(&trie, &r128);
+	route_insert(&trie, &r64);
+	route_insert(&trie, &rdef);
+
+	memcpy(key, r128.key, 16);
+	link = inet_rtrie_lookup(&trie, key);
+	PCUT_ASSERT_EQUALS(&r128.link, link);
+
+	key[15] = 0x02;
+	link = inet_rtrie_lookup(&trie, key);
+	PCUT_ASSERT_EQUALS(&r64.link, link);
+
+	key[8] = 0x80;
+	link = inet_rtrie_lookup(&trie, key);
+	PCUT_ASSERT_EQUALS(&r64.link, link);
+
+	key[3] = 0xb9;
+	link = inet_rtrie_lookup(&trie, key);
+	PCUT_ASSERT_EQUALS(&rdef.link, link);
+
+	route_remove(&trie, &r64);
+	route_remove(&trie, &rdef);
+
+	link = inet_rtrie_lookup(&trie, key);
+	PCUT_ASSERT_NULL(link);
+	link = inet_rtrie_lookup(&trie, r128.key);
+	PCUT_ASSERT_EQUALS(&r128.link, link);
+
+	inet_rtrie_fini(&trie);
+}
+
+/** Compare lookups of pseudo-random addresses with linear search.
+ *
+ * @param trie   Trie containing the routes of @a r which are in use
+ * @param r      Array of TEST_ROUTES routes
+ * @param seed   Pseudo-random number generator state
+ */
+static void route_check_lookups(inet_rtrie_t *trie, test_route_t *r,
+    uint32_t *seed)
+{
+	test_route_t *best;
+	test_route_t *found;
+	uint8_t key[4];
+	link_t *link;
+	unsigned i, k;
+
+	for (i = 0; i < TEST_LOOKUPS; i++) {
+		*seed = *seed * 1103515245 + 12345;
+		key[0] = 10;
+		key[1] = (*seed >> 16) & 0x3;
+		key[2] = *seed >> 24;
+		key[3] = *seed >> 8;
+
+		best = NULL;
+		for (k = 0; k < TEST_ROUTES; k++) {
+			if (!link_in_use(&r[k].link))
+				continue;
+			if (!route_match(&r[k], key))
+				continue;
+			if (best == NULL || r[k].plen > best->plen)
+				best = &r[k];
+		}
+
+		link = inet_rtrie_lookup(trie, key);
+		if (best == NULL) {
+			PCUT_ASSERT_NULL(link);
+			continue;
+		}
+
+		PCUT_ASSERT_NOT_NULL(link);
+		found = list_get_instance(link, test_route_t, link);
+		PCUT_ASSERT_INT_EQUALS(best->plen, found->plen);
+		PCUT_ASSERT_TRUE(route_match(found, key));
+	}
+}
+
+/** Lookup agrees with linear search through many routes */
+PCUT_TEST(linear_search)
+{
+	inet_rtrie_t trie;
+	test_route_t r[TEST_ROUTES];
+	uint32_t seed = 1;
+	unsigned i;
+
+	inet_rtrie_init(&trie, 4);
+
+	for (i = 0; i < TEST_ROUTES; i++) {
+		seed = seed * 1103515245 + 12345;
+		/* Keep prefixes in a small space so that they overlap */
+		route_init4(&r[i], 10, (seed >> 16) & 0x3, seed >> 24,
+		    seed >> 8, 8 + (seed >> 10) % 25);
+		route_insert(&trie, &r[i]);
+	}
+
+	route_check_lookups(&trie, r, &seed);
+
+	/* Repeat with every other route removed */
+	for (i = 0; i < TEST_ROUTES; i += 2)
+		route_remove(&trie, &r[i]);
+
+	route_check_lookups(&trie, r, &seed);
+
+	for (i = 1; i < TEST_ROUTES; i += 2)
+		route_remove(&trie, &r[i]);
+
+	PCUT_ASSERT_NULL(trie.root);
+
+	inet_rtrie_fini(&trie);
+}
+
+PCUT_EXPORT(rtrie);
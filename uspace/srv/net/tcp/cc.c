@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup tcp
+ * @{
+ */
+
+/**
+ * @file TCP congestion control
+ *
+ * Round-trip time estimation and retransmission timer computation follow
+ * RFC 6298, congestion control follows RFC 5681 (slow start, congestion
+ * avoidance, fast retransmit) and RFC 6582 (NewReno fast recovery).
+ *
+ * The window growth and loss response are delegated to a congestion
+ * control algorithm (tcp_cc_ops_t) so that other algorithms can be
+ * plugged in. Loss detection and recovery are common to all algorithms.
+ */
+
+#include <io/log.h>
+#include <macros.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "cc.h"
+#include "tcp_type.h"
+
+/** Initial retransmission timeout */
+#define TCP_RTO_INITIAL	SEC2USEC(1)
+/** Minimum retransmission timeout */
+#define TCP_RTO_MIN	SEC2USEC(1)
+/** Maximum retransmission timeout */
+#define TCP_RTO_MAX	SEC2USEC(60)
+/** Clock granularity used in RTO computation */
+#define TCP_RTO_GRANULARITY	MSEC2USEC(10)
+
+/** Maximum congestion window (keeps the arithmetic well within 32 bits) */
+#define TCP_CWND_MAX	(1 << 30)
+
+/** Number of duplicate ACKs that trigger fast retransmit */
+#define TCP_DUPACK_THRESH	3
+
+static void tcp_cc_newreno_cong_avoid(tcp_conn_t *, uint32_t);
+static uint32_t tcp_cc_newreno_ssthresh(tcp_conn_t *);
+
+/** NewReno congestion control */
+tcp_cc_ops_t tcp_cc_newreno = {
+	.name = "newreno",
+	.cong_avoid = tcp_cc_newreno_cong_avoid,
+	.ssthresh = tcp_cc_newreno_ssthresh
+};
+
+/** Congestion control algorithm used for new connections */
+static tcp_cc_ops_t *tcp_cc_default = &tcp_cc_newreno;
+
+/** Return number of bytes sent, but not acknowledged yet. */
+static uint32_t tcp_cc_flight_size(tcp_conn_t *conn)
+{
+	return conn->snd_nxt - conn->snd_una;
+}
+
+/** Initialize congestion control state of a new connection.
+ *
+ * @param conn Connection
+ */
+void tcp_cc_init(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	cc->ops = tcp_cc_default;
+	cc->smss = TCP_SMSS;
+
+	/* Initial window, RFC 5681 section 3.1 */
+	cc->cwnd = min(4 * cc->smss, max(2 * cc->smss, 4380));
+	cc->ssthresh = UINT32_MAX;
+	cc->ca_acked = 0;
+	cc->dupacks = 0;
+	cc->in_recovery = false;
+	cc->fast_recovery = false;
+
+	cc->rtt_valid = false;
+	cc->srtt = 0;
+	cc->rttvar = 0;
+	cc->rto = TCP_RTO_INITIAL;
+
+	if (cc->ops->init != NULL)
+		cc->ops->init(conn);
+}
+
+/** Return number of bytes that can be sent now.
+ *
+ * This is the usable part of the smaller of the peer's receive window
+ * and the congestion window.
+ *
+ * @param conn Connection
+ * @return Number of bytes
+ */
+uint32_t tcp_cc_avail_wnd(tcp_conn_t *conn)
+{
+	uint32_t wnd;
+	uint32_t flight;
+
+	wnd = min(conn->snd_wnd, conn->cc.cwnd);
+	flight = tcp_cc_flight_size(conn);
+
+	return flight < wnd ? wnd - flight : 0;
+}
+
+/** Update RTT estimate with a new measurement.
+ *
+ * The caller must not pass measurements of retransmitted segments.
+ *
+ * @param conn Connection
+ * @param rtt  Measured round-trip time
+ */
+void tcp_cc_rtt_sample(tcp_conn_t *conn, usec_t rtt)
+{
+	tcp_cc_t *cc = &conn->cc;
+	usec_t delta;
+
+	if (!cc->rtt_valid) {
+		cc->srtt = rtt;
+		cc->rttvar = rtt / 2;
+		cc->rtt_valid = true;
+	} else {
+		delta = cc->srtt > rtt ? cc->srtt - rtt : rtt - cc->srtt;
+		cc->rttvar = (3 * cc->rttvar + delta) / 4;
+		cc->srtt = (7 * cc->srtt + rtt) / 8;
+	}
+
+	cc->rto = cc->srtt + max(TCP_RTO_GRANULARITY, 4 * cc->rttvar);
+	if (cc->rto < TCP_RTO_MIN)
+		cc->rto = TCP_RTO_MIN;
+	if (cc->rto > TCP_RTO_MAX)
+		cc->rto = TCP_RTO_MAX;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "%s: RTT=%lld SRTT=%lld RTTVAR=%lld "
+	    "RTO=%lld", conn->name, (long long) rtt, (long long) cc->srtt,
+	    (long long) cc->rttvar, (long long) cc->rto);
+}
+
+/** New data has been acknowledged.
+ *
+ * Should be called after SND.UNA has been advanced.
+ *
+ * @param conn  Connection
+ * @param acked Number of newly acknowledged bytes
+ * @return @c true if this was a partial acknowledgement during loss
+ *         recovery and the first unacknowledged segment should be
+ *         retransmitted
+ */
+bool tcp_cc_ack(tcp_conn_t *conn, uint32_t acked)
+{
+	tcp_cc_t *cc = &conn->cc;
+	uint32_t flight;
+
+	cc->dupacks = 0;
+
+	if (!cc->in_recovery) {
+		cc->ops->cong_avoid(conn, acked);
+		return false;
+	}
+
+	/* SND.UNA < recover means not all data outstanding at loss was acked */
+	if (((conn->snd_una - cc->recover) & (0x1 << 31)) != 0) {
+		if (cc->fast_recovery) {
+			/* Partial window deflation, RFC 6582 section 3.2 */
+			cc->cwnd = cc->cwnd > acked ? cc->cwnd - acked : 0;
+			if (acked >= cc->smss)
+				cc->cwnd += cc->smss;
+			cc->cwnd = max(cc->cwnd, cc->smss);
+		} else {
+			/* Recovering from timeout, keep slow starting */
+			cc->ops->cong_avoid(conn, acked);
+		}
+
+		return true;
+	}
+
+	/* Full acknowledgement, exit loss recovery */
+	if (cc->fast_recovery) {
+		flight = tcp_cc_flight_size(conn);
+		cc->cwnd = min(cc->ssthresh, max(flight, cc->smss) + cc->smss);
+	}
+
+	cc->in_recovery = false;
+	cc->fast_recovery = false;
+	cc->ca_acked = 0;
+	return false;
+}
+
+/** Duplicate acknowledgement received.
+ *
+ * @param conn Connection
+ * @return @c true if the first unacknowledged segment should be
+ *         retransmitted (fast retransmit)
+ */
+bool tcp_cc_dup_ack(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	++cc->dupacks;
+
+	if (cc->in_recovery) {
+		/* Each duplicate ACK means a segment has left the network */
+		if (cc->fast_recovery && cc->cwnd < TCP_CWND_MAX)
+			cc->cwnd += cc->smss;
+		return false;
+	}
+
+	if (cc->dupacks < TCP_DUPACK_THRESH)
+		return false;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Fast retransmit, entering fast "
+	    "recovery.", conn->name);
+
+	cc->ssthresh = cc->ops->ssthresh(conn);
+	cc->cwnd = cc->ssthresh + TCP_DUPACK_THRESH * cc->smss;
+	cc->recover = conn->snd_nxt;
+	cc->in_recovery = true;
+	cc->fast_recovery = true;
+	++cc->fast_retransmits;
+
+	return true;
+}
+
+/** Retransmission timer expired.
+ *
+ * Reduce the congestion window to one segment, back off the retransmission
+ * timer and enter loss recovery. The caller retransmits the first
+ * unacknowledged segment.
+ *
+ * @param conn Connection
+ */
+void tcp_cc_timeout(tcp_conn_t *conn)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	/* Do not reduce ssthresh again if the retransmission is lost, too */
+	if (!cc->in_recovery || cc->fast_recovery)
+		cc->ssthresh = cc->ops->ssthresh(conn);
+
+	cc->cwnd = cc->smss;
+	cc->ca_acked = 0;
+	cc->dupacks = 0;
+	cc->recover = conn->snd_nxt;
+	cc->in_recovery = true;
+	cc->fast_recovery = false;
+
+	cc->rto = min(2 * cc->rto, TCP_RTO_MAX);
+	++cc->timeouts;
+}
+
+/** Get connection statistics.
+ *
+ * @param conn  Connection
+ * @param stats Place to store statistics
+ */
+void tcp_cc_get_stats(tcp_conn_t *conn, tcp_conn_stats_t *stats)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	stats->cwnd = cc->cwnd;
+	stats->ssthresh = cc->ssthresh;
+	stats->snd_wnd = conn->snd_wnd;
+	stats->flight = tcp_cc_flight_size(conn);
+	stats->srtt = cc->rtt_valid ? cc->srtt : 0;
+	stats->rttvar = cc->rttvar;
+	stats->rto = cc->rto;
+	stats->retransmits = cc->retransmits;
+	stats->fast_retransmits = cc->fast_retransmits;
+	stats->timeouts = cc->timeouts;
+}
+
+/** NewReno window growth.
+ *
+ * Slow start below ssthresh, one segment per window above it
+ * (appropriate byte counting).
+ */
+static void tcp_cc_newreno_cong_avoid(tcp_conn_t *conn, uint32_t acked)
+{
+	tcp_cc_t *cc = &conn->cc;
+
+	if (cc->cwnd >= TCP_CWND_MAX)
+		return;
+
+	if (cc->cwnd < cc->ssthresh) {
+		cc->cwnd += min(acked, cc->smss);
+		return;
+	}
+
+	cc->ca_acked += acked;
+	if (cc->ca_acked >= cc->cwnd) {
+		cc->ca_acked -= cc->cwnd;
+		cc->cwnd += cc->smss;
+	}
+}
+
+/** NewReno slow start threshold after loss, RFC 5681 equation (4). */
+static uint32_t tcp_cc_newreno_ssthresh(tcp_conn_t *conn)
+{
+	return max(tcp_cc_flight_size(conn) / 2, 2 * conn->cc.smss);
+}
+
+/**
+ * @}
+ */
@@ -42,10 +42,12 @@
 #include <nettl/amap.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
 #include "iqueue.h"
 #include "pdu.h"
+#include "ring.h"
 #include "rqueue.h"
 #include "segment.h"
 #include "seq_no.h"
@@ -53,8 +55,10 @@
 #include "tqueue.h"
 #include "ucall.h"
 
-#define RCV_BUF_SIZE 4096/*2*/
-#define SND_BUF_SIZE 4096
+#define RCV_BUF_SIZE (64 * 1024)
+#define SND_BUF_SIZE (64 * 1024)
+/** Maximum size of send or receive buffer set by the user */
+#define BUF_SIZE_MAX (4 * 1024 * 1024)
 
 #define MAX_SEGMENT_LIFETIME	(15*1000*1000) //(2*60*1000*1000)
 #define TIME_WAIT_TIMEOUT	(2*MAX_SEGMENT_LIFETIME)
@@ -77,6 +81,7 @@ static void tcp_conn_tw_timer_clear(tcp_conn_t *);
 static void tcp_transmit_segment(inet_ep2_t *, tcp_segment_t *);
 static void tcp_conn_trim_seg_to_wnd(tcp_conn_t *, tcp_segment_t *);
 static void tcp_reply_rst(inet_ep2_t *, tcp_segment_t *);
+static void tcp_conn_syn_opts(tcp_conn_t *, tcp_segment_t *);
 
 static tcp_tqueue_cb_t tcp_conn_tqueue_cb = {
 	.transmit_seg = tcp_transmit_segment
@@ -152,6 +157,14 @@ tcp_conn_t *tcp_conn_new(inet_ep2_t *epp)
 	/* Set up receive window. */
 	conn->rcv_wnd = conn->rcv_buf_size;
 
+	/*
+	 * Window scale we offer, large enough for the biggest receive
+	 * buffer the user can set later.
+	 */
+	conn->rcv_wscale = 0;
+	while ((BUF_SIZE_MAX >> conn->rcv_wscale) > UINT16_MAX)
+		++conn->rcv_wscale;
+
 	/* Initialize incoming segment queue */
 	tcp_iqueue_init(&conn->incoming, conn);
 
@@ -163,6 +176,9 @@ tcp_conn_t *tcp_conn_new(inet_ep2_t *epp)
 
 	tqueue_inited = true;
 
+	/* Initialize congestion control */
+	tcp_cc_init(conn);
+
 	/* Connection state change signalling */
 	fibril_condvar_initialize(&conn->cstate_cv);
 
@@ -415,6 +431,61 @@ void tcp_conn_fin_sent(tcp_conn_t *conn)
 	conn->fin_is_acked = false;
 }
 
+/** Set send and receive buffer size.
+ *
+ * The receive buffer cannot be shrunk once a window might have been
+ * advertised to the peer.
+ *
+ * @param conn		Connection
+ * @param snd_size	Send buffer size in bytes or zero to leave unchanged
+ * @param rcv_size	Receive buffer size in bytes or zero to leave unchanged
+ * @return		EOK on success, EINVAL if size is not valid,
+ *			ENOMEM if out of memory
+ */
+errno_t tcp_conn_set_buf_size(tcp_conn_t *conn, size_t snd_size,
+    size_t rcv_size)
+{
+	size_t old_size;
+	errno_t rc;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	if (snd_size > BUF_SIZE_MAX || rcv_size > BUF_SIZE_MAX)
+		return EINVAL;
+
+	if (snd_size != 0 && snd_size < conn->snd_buf_used)
+		return EINVAL;
+
+	if (rcv_size != 0 && rcv_size < conn->rcv_buf_size &&
+	    conn->cstate != st_listen)
+		return EINVAL;
+
+	if (snd_size != 0 && snd_size != conn->snd_buf_size) {
+		rc = tcp_ring_resize(&conn->snd_buf, &conn->snd_buf_size,
+		    &conn->snd_buf_start, conn->snd_buf_used, snd_size);
+		if (rc != EOK)
+			return rc;
+
+		fibril_condvar_broadcast(&conn->snd_buf_cv);
+	}
+
+	if (rcv_size != 0 && rcv_size != conn->rcv_buf_size) {
+		old_size = conn->rcv_buf_size;
+		rc = tcp_ring_resize(&conn->rcv_buf, &conn->rcv_buf_size,
+		    &conn->rcv_buf_start, conn->rcv_buf_used, rcv_size);
+		if (rc != EOK)
+			return rc;
+
+		conn->rcv_wnd += rcv_size - old_size;
+
+		/* Let the peer know about the larger window */
+		if (conn->cstate == st_established)
+			tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	}
+
+	return EOK;
+}
+
 /** Find connection structure for specified endpoint pair.
  *
  * A connection is uniquely identified by a endpoint pair. Look up our
@@ -546,6 +617,8 @@ static void tcp_conn_sa_listen(tcp_conn_t *conn, tcp_segment_t *seg)
 	if (seg->len > 1)
 		log_msg(LOG_DEFAULT, LVL_WARN, "SYN combined with data, ignoring data.");
 
+	tcp_conn_syn_opts(conn, seg);
+
 	/* XXX select ISS */
 	conn->iss = 1;
 	conn->snd_nxt = conn->iss;
@@ -615,6 +688,8 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 	conn->rcv_nxt = seg->seq + 1;
 	conn->irs = seg->seq;
 
+	tcp_conn_syn_opts(conn, seg);
+
 	if ((seg->ctrl & CTL_ACK) != 0) {
 		conn->snd_una = seg->ack;
 
@@ -652,6 +727,40 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 	tcp_segment_delete(seg);
 }
 
+/** Negotiate options based on SYN received from peer.
+ *
+ * Each option is used only if both sides included it in their SYN.
+ * We always offer all options in our SYN and only confirm options
+ * offered by the peer in SYN-ACK, so it suffices to look at the
+ * peer's SYN.
+ *
+ * @param conn		Connection
+ * @param seg		SYN segment
+ */
+static void tcp_conn_syn_opts(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	tcp_seg_opts_t *opts = &seg->opts;
+
+	conn->ws_ok = opts->wscale_present;
+	if (conn->ws_ok) {
+		conn->snd_wscale = opts->wscale;
+	} else {
+		conn->snd_wscale = 0;
+		conn->rcv_wscale = 0;
+	}
+
+	conn->sack_ok = opts->sack_perm;
+
+	conn->ts_ok = opts->ts_present;
+	if (conn->ts_ok)
+		conn->ts_recent = opts->ts_val;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: wscale=%s(%u/%u) sack=%s ts=%s",
+	    conn->name, conn->ws_ok ? "yes" : "no", conn->snd_wscale,
+	    conn->rcv_wscale, conn->sack_ok ? "yes" : "no",
+	    conn->ts_ok ? "yes" : "no");
+}
+
 /** Segment arrived in state where segments are processed in sequence order.
  *
  * Queue segment in incoming segments queue for processing.
@@ -662,9 +771,15 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	tcp_segment_t *pseg;
+	uint32_t diff;
+	bool out_of_order;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_sa_seq(%p, %p)", conn, seg);
 
+	/* Window field is scaled in all segments except SYN */
+	if ((seg->ctrl & CTL_SYN) == 0)
+		seg->wnd <<= conn->snd_wscale;
+
 	/* Discard unacceptable segments ("old duplicates") */
 	if (!seq_no_segment_acceptable(conn, seg)) {
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "Replying ACK to unacceptable segment.");
@@ -673,6 +788,17 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 		return;
 	}
 
+	/*
+	 * Remember timestamp to echo if SEG.SEQ <= RCV.NXT
+	 * (RFC 7323 section 4.3, we acknowledge every segment)
+	 */
+	diff = seg->seq - conn->rcv_nxt;
+	if (conn->ts_ok && seg->opts.ts_present &&
+	    (diff == 0 || (diff & (0x1 << 31)) != 0))
+		conn->ts_recent = seg->opts.ts_val;
+
+	out_of_order = seg->len > 0 && !seq_no_segment_ready(conn, seg);
+
 	/* Queue for processing */
 	tcp_iqueue_insert_seg(&conn->incoming, seg);
 
@@ -684,6 +810,13 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 	 */
 	while (tcp_iqueue_get_ready_seg(&conn->incoming, &pseg) == EOK)
 		tcp_conn_seg_process(conn, pseg);
+
+	/*
+	 * Acknowledge out-of-order segment immediately so that the peer
+	 * can detect the loss (and learn about it from SACK blocks)
+	 */
+	if (out_of_order)
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
 }
 
 /** Process segment RST field.
@@ -811,6 +944,8 @@ static cproc_t tcp_conn_seg_proc_ack_sr(tcp_conn_t *conn, tcp_segment_t *seg)
  */
 static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 {
+	bool dup_ack = false;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_seg_proc_ack_est(%p, %p)", conn, seg);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "SEG.ACK=%u, SND.UNA=%u, SND.NXT=%u",
@@ -827,13 +962,30 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 			tcp_segment_delete(seg);
 			return cp_done;
 		} else {
-			log_msg(LOG_DEFAULT, LVL_DEBUG, "Ignoring duplicate ACK.");
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Duplicate ACK.");
+
+			/*
+			 * Count as duplicate ACK for fast retransmit only
+			 * if it could have been caused by a lost segment
+			 * (RFC 5681 section 2).
+			 */
+			dup_ack = seg->ack == conn->snd_una && seg->len == 0 &&
+			    seg->wnd == conn->snd_wnd &&
+			    !list_empty(&conn->retransmit.list);
 		}
 	} else {
 		/* Update SND.UNA */
 		conn->snd_una = seg->ack;
+
+		/* Measure RTT using timestamps */
+		if (conn->ts_ok && seg->opts.ts_present && seg->opts.ts_ecr != 0)
+			tcp_tqueue_ts_echo(conn, seg->opts.ts_ecr);
 	}
 
+	/* Note segments the peer received out of order */
+	if (conn->sack_ok && seg->opts.sack_cnt > 0)
+		tcp_tqueue_sack_received(conn, &seg->opts);
+
 	if (seq_no_new_wnd_update(conn, seg)) {
 		conn->snd_wnd = seg->wnd;
 		conn->snd_wl1 = seg->seq;
@@ -848,7 +1000,10 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 	 * Prune acked segments from retransmission queue and
 	 * possibly transmit more data.
 	 */
-	tcp_tqueue_ack_received(conn);
+	if (dup_ack)
+		tcp_tqueue_dup_ack(conn);
+	else
+		tcp_tqueue_ack_received(conn);
 
 	return cp_continue;
 }
@@ -1060,8 +1215,8 @@ static cproc_t tcp_conn_seg_proc_text(tcp_conn_t *conn, tcp_segment_t *seg)
 	xfer_size = min(text_size, conn->rcv_buf_size - conn->rcv_buf_used);
 
 	/* Copy data to receive buffer */
-	tcp_segment_text_copy(seg, conn->rcv_buf + conn->rcv_buf_used,
-	    xfer_size);
+	tcp_ring_write(conn->rcv_buf, conn->rcv_buf_size,
+	    conn->rcv_buf_start + conn->rcv_buf_used, seg->data, xfer_size);
 	conn->rcv_buf_used += xfer_size;
 
 	/* Signal to the receive function that new data has arrived */
@@ -1079,9 +1234,16 @@ static cproc_t tcp_conn_seg_proc_text(tcp_conn_t *conn, tcp_segment_t *seg)
 	/* Update receive window. XXX Not an efficient strategy. */
 	conn->rcv_wnd -= xfer_size;
 
-	/* Send ACK */
-	if (xfer_size > 0)
-		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	/*
+	 * Acknowledge. Do not delay the ACK while there is out-of-order
+	 * data queued, the peer needs to learn about the hole.
+	 */
+	if (xfer_size > 0) {
+		if (list_empty(&conn->incoming.list))
+			tcp_tqueue_ack_delayed(conn);
+		else
+			tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	}
 
 	if (xfer_size < seg->len) {
 		/* Trim part of segment which we just received */
@@ -186,6 +186,58 @@ errno_t tcp_iqueue_get_ready_seg(tcp_iqueue_t *iqueue, tcp_segment_t **seg)
 	return EOK;
 }
 
+/** Compute SACK blocks describing out-of-order data in incoming queue.
+ *
+ * Adjacent and overlapping segments are merged into a single block.
+ * Blocks are returned in sequence number order.
+ *
+ * @param iqueue	Incoming queue
+ * @param blocks	Array to fill in
+ * @param max		Maximum number of blocks to return
+ * @return		Number of blocks returned
+ */
+unsigned tcp_iqueue_sack_blocks(tcp_iqueue_t *iqueue, tcp_sack_block_t *blocks,
+    unsigned max)
+{
+	uint32_t rcv_nxt = iqueue->conn->rcv_nxt;
+	uint32_t start, end, bend;
+	unsigned cnt;
+
+	cnt = 0;
+
+	list_foreach(iqueue->list, link, tcp_iqueue_entry_t, iqe) {
+		if (iqe->seg->len == 0)
+			continue;
+
+		/* Work with offsets relative to RCV.NXT */
+		start = iqe->seg->seq - rcv_nxt;
+		end = start + iqe->seg->len;
+
+		/* Only report data beyond RCV.NXT */
+		if (start == 0 || (start & (0x1 << 31)) != 0)
+			continue;
+
+		/* Merge with the previous block if adjacent or overlapping */
+		if (cnt > 0) {
+			bend = blocks[cnt - 1].right - rcv_nxt;
+			if (start <= bend) {
+				if (end > bend)
+					blocks[cnt - 1].right = rcv_nxt + end;
+				continue;
+			}
+		}
+
+		if (cnt == max)
+			break;
+
+		blocks[cnt].left = rcv_nxt + start;
+		blocks[cnt].right = rcv_nxt + end;
+		++cnt;
+	}
+
+	return cnt;
+}
+
 /**
  * @}
  */
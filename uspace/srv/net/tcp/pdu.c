@@ -37,7 +37,9 @@
 #include <bitops.h>
 #include <byteorder.h>
 #include <errno.h>
+#include <inet/checksum.h>
 #include <inet/endpoint.h>
+#include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
 #include "pdu.h"
@@ -46,44 +48,6 @@
 #include "std.h"
 #include "tcp_type.h"
 
-#define TCP_CHECKSUM_INIT 0xffff
-
-/** One's complement addition.
- *
- * Result is a + b + carry.
- */
-static uint16_t tcp_ocadd16(uint16_t a, uint16_t b)
-{
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
-
-static uint16_t tcp_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2 * i] << 8) | bdata[2 * i + 1];
-		sum = tcp_ocadd16(sum, w);
-	}
-
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2 * words] << 8);
-		sum = tcp_ocadd16(sum, w);
-	}
-
-	return ~sum;
-}
-
 static void tcp_header_decode_flags(uint16_t doff_flags, tcp_control_t *rctl)
 {
 	tcp_control_t ctl;
@@ -125,7 +89,8 @@ static void tcp_header_encode_flags(tcp_control_t ctl, uint16_t doff_flags0,
 	*rdoff_flags = doff_flags;
 }
 
-static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *hdr)
+static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg,
+    tcp_header_t *hdr, size_t hdr_size)
 {
 	uint16_t doff_flags;
 	uint16_t doff;
@@ -135,7 +100,7 @@ static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *
 	hdr->seq = host2uint32_t_be(seg->seq);
 	hdr->ack = host2uint32_t_be(seg->ack);
 
-	doff = (sizeof(tcp_header_t) / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
+	doff = (hdr_size / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
 	tcp_header_encode_flags(seg->ctrl, doff, &doff_flags);
 
 	hdr->doff_flags = host2uint16_t_be(doff_flags);
@@ -144,43 +109,6 @@ static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *
 	hdr->urg_ptr = host2uint16_t_be(seg->up);
 }
 
-static ip_ver_t tcp_phdr_setup(tcp_pdu_t *pdu, tcp_phdr_t *phdr,
-    tcp_phdr6_t *phdr6)
-{
-	addr32_t src_v4;
-	addr128_t src_v6;
-	uint16_t src_ver = inet_addr_get(&pdu->src, &src_v4, &src_v6);
-
-	addr32_t dest_v4;
-	addr128_t dest_v6;
-	uint16_t dest_ver = inet_addr_get(&pdu->dest, &dest_v4, &dest_v6);
-
-	assert(src_ver == dest_ver);
-
-	switch (src_ver) {
-	case ip_v4:
-		phdr->src = host2uint32_t_be(src_v4);
-		phdr->dest = host2uint32_t_be(dest_v4);
-		phdr->zero = 0;
-		phdr->protocol = IP_PROTO_TCP;
-		phdr->tcp_length =
-		    host2uint16_t_be(pdu->header_size + pdu->text_size);
-		break;
-	case ip_v6:
-		host2addr128_t_be(src_v6, phdr6->src);
-		host2addr128_t_be(dest_v6, phdr6->dest);
-		phdr6->tcp_length =
-		    host2uint32_t_be(pdu->header_size + pdu->text_size);
-		memset(phdr6->zeroes, 0, 3);
-		phdr6->next = IP_PROTO_TCP;
-		break;
-	default:
-		assert(false);
-	}
-
-	return src_ver;
-}
-
 static void tcp_header_decode(tcp_header_t *hdr, tcp_segment_t *seg)
 {
 	tcp_header_decode_flags(uint16_t_be2host(hdr->doff_flags), &seg->ctrl);
@@ -190,18 +118,178 @@ static void tcp_header_decode(tcp_header_t *hdr, tcp_segment_t *seg)
 	seg->up = uint16_t_be2host(hdr->urg_ptr);
 }
 
+/** Store 32-bit value in network byte order at unaligned address. */
+static void tcp_opt_put32(uint8_t *buf, uint32_t val)
+{
+	uint32_t nval = host2uint32_t_be(val);
+
+	memcpy(buf, &nval, sizeof(uint32_t));
+}
+
+/** Load 32-bit value in network byte order from unaligned address. */
+static uint32_t tcp_opt_get32(const uint8_t *buf)
+{
+	uint32_t nval;
+
+	memcpy(&nval, buf, sizeof(uint32_t));
+	return uint32_t_be2host(nval);
+}
+
+/** Encode TCP options.
+ *
+ * Options are padded with NOPs so that each starts at the same offset
+ * modulo four as recommended by RFC 7323 appendix A. SACK blocks that
+ * do not fit into the option space are omitted.
+ *
+ * @param opts	Segment options
+ * @param buf	Buffer of at least TCP_OPTIONS_MAX_SIZE bytes
+ * @return	Size of encoded options in bytes (multiple of four)
+ */
+static size_t tcp_options_encode(tcp_seg_opts_t *opts, uint8_t *buf)
+{
+	size_t i;
+	unsigned cnt;
+	unsigned j;
+
+	i = 0;
+
+	if (opts->ts_present) {
+		buf[i++] = OPT_NOP;
+		buf[i++] = OPT_NOP;
+		buf[i++] = OPT_TIMESTAMP;
+		buf[i++] = OPT_TIMESTAMP_LEN;
+		tcp_opt_put32(buf + i, opts->ts_val);
+		tcp_opt_put32(buf + i + 4, opts->ts_ecr);
+		i += 8;
+	}
+
+	if (opts->wscale_present) {
+		buf[i++] = OPT_NOP;
+		buf[i++] = OPT_WINDOW_SCALE;
+		buf[i++] = OPT_WINDOW_SCALE_LEN;
+		buf[i++] = opts->wscale;
+	}
+
+	if (opts->sack_perm) {
+		buf[i++] = OPT_NOP;
+		buf[i++] = OPT_NOP;
+		buf[i++] = OPT_SACK_PERMITTED;
+		buf[i++] = OPT_SACK_PERMITTED_LEN;
+	}
+
+	cnt = min(opts->sack_cnt, (TCP_OPTIONS_MAX_SIZE - i - 2 -
+	    OPT_SACK_LEN) / OPT_SACK_BLOCK_LEN);
+	if (cnt > 0) {
+		buf[i++] = OPT_NOP;
+		buf[i++] = OPT_NOP;
+		buf[i++] = OPT_SACK;
+		buf[i++] = OPT_SACK_LEN + cnt * OPT_SACK_BLOCK_LEN;
+		for (j = 0; j < cnt; j++) {
+			tcp_opt_put32(buf + i, opts->sack[j].left);
+			tcp_opt_put32(buf + i + 4, opts->sack[j].right);
+			i += OPT_SACK_BLOCK_LEN;
+		}
+	}
+
+	assert(i <= TCP_OPTIONS_MAX_SIZE);
+	assert(i % sizeof(uint32_t) == 0);
+	return i;
+}
+
+/** Decode TCP options.
+ *
+ * Unknown options are skipped, malformed options terminate decoding.
+ *
+ * @param buf	Encoded options
+ * @param size	Size of encoded options in bytes
+ * @param opts	Place to store decoded options
+ */
+static void tcp_options_decode(const uint8_t *buf, size_t size,
+    tcp_seg_opts_t *opts)
+{
+	size_t i;
+	uint8_t kind;
+	uint8_t len;
+	unsigned j;
+
+	memset(opts, 0, sizeof(tcp_seg_opts_t));
+
+	i = 0;
+	while (i < size) {
+		kind = buf[i];
+		if (kind == OPT_END_LIST)
+			break;
+
+		if (kind == OPT_NOP) {
+			++i;
+			continue;
+		}
+
+		if (i + 1 >= size)
+			break;
+
+		len = buf[i + 1];
+		if (len < 2 || i + len > size)
+			break;
+
+		switch (kind) {
+		case OPT_WINDOW_SCALE:
+			if (len != OPT_WINDOW_SCALE_LEN)
+				break;
+			opts->wscale_present = true;
+			opts->wscale = min(buf[i + 2], TCP_WSCALE_MAX);
+			break;
+		case OPT_SACK_PERMITTED:
+			if (len != OPT_SACK_PERMITTED_LEN)
+				break;
+			opts->sack_perm = true;
+			break;
+		case OPT_TIMESTAMP:
+			if (len != OPT_TIMESTAMP_LEN)
+				break;
+			opts->ts_present = true;
+			opts->ts_val = tcp_opt_get32(buf + i + 2);
+			opts->ts_ecr = tcp_opt_get32(buf + i + 6);
+			break;
+		case OPT_SACK:
+			if ((len - OPT_SACK_LEN) % OPT_SACK_BLOCK_LEN != 0)
+				break;
+			opts->sack_cnt = min((len - OPT_SACK_LEN) /
+			    OPT_SACK_BLOCK_LEN, TCP_SACK_BLOCKS_MAX);
+			for (j = 0; j < opts->sack_cnt; j++) {
+				opts->sack[j].left = tcp_opt_get32(buf + i +
+				    OPT_SACK_LEN + j * OPT_SACK_BLOCK_LEN);
+				opts->sack[j].right = tcp_opt_get32(buf + i +
+				    OPT_SACK_LEN + j * OPT_SACK_BLOCK_LEN + 4);
+			}
+			break;
+		default:
+			break;
+		}
+
+		i += len;
+	}
+}
+
 static errno_t tcp_header_encode(inet_ep2_t *epp, tcp_segment_t *seg,
     void **header, size_t *size)
 {
 	tcp_header_t *hdr;
+	uint8_t opts[TCP_OPTIONS_MAX_SIZE];
+	size_t opts_size;
+	size_t hdr_size;
+
+	opts_size = tcp_options_encode(&seg->opts, opts);
+	hdr_size = sizeof(tcp_header_t) + opts_size;
 
-	hdr = calloc(1, sizeof(tcp_header_t));
+	hdr = calloc(1, hdr_size);
 	if (hdr == NULL)
 		return ENOMEM;
 
-	tcp_header_setup(epp, seg, hdr);
+	tcp_header_setup(epp, seg, hdr, hdr_size);
+	memcpy(hdr + 1, opts, opts_size);
 	*header = hdr;
-	*size = sizeof(tcp_header_t);
+	*size = hdr_size;
 
 	return EOK;
 }
@@ -264,25 +352,11 @@ static uint16_t tcp_pdu_checksum_calc(tcp_pdu_t *pdu)
 {
 	uint16_t cs_phdr;
 	uint16_t cs_headers;
-	tcp_phdr_t phdr;
-	tcp_phdr6_t phdr6;
-
-	ip_ver_t ver = tcp_phdr_setup(pdu, &phdr, &phdr6);
-	switch (ver) {
-	case ip_v4:
-		cs_phdr = tcp_checksum_calc(TCP_CHECKSUM_INIT, (void *) &phdr,
-		    sizeof(tcp_phdr_t));
-		break;
-	case ip_v6:
-		cs_phdr = tcp_checksum_calc(TCP_CHECKSUM_INIT, (void *) &phdr6,
-		    sizeof(tcp_phdr6_t));
-		break;
-	default:
-		assert(false);
-	}
 
-	cs_headers = tcp_checksum_calc(cs_phdr, pdu->header, pdu->header_size);
-	return tcp_checksum_calc(cs_headers, pdu->text, pdu->text_size);
+	cs_phdr = inet_checksum_phdr(INET_CHECKSUM_INIT, &pdu->src, &pdu->dest,
+	    IP_PROTO_TCP, pdu->header_size + pdu->text_size);
+	cs_headers = inet_checksum_calc(cs_phdr, pdu->header, pdu->header_size);
+	return inet_checksum_calc(cs_headers, pdu->text, pdu->text_size);
 }
 
 static void tcp_pdu_set_checksum(tcp_pdu_t *pdu, uint16_t checksum)
@@ -308,6 +382,11 @@ errno_t tcp_pdu_decode(tcp_pdu_t *pdu, inet_ep2_t *epp, tcp_segment_t **seg)
 
 	hdr = (tcp_header_t *)pdu->header;
 
+	if (pdu->header_size > sizeof(tcp_header_t)) {
+		tcp_options_decode((uint8_t *)(hdr + 1),
+		    pdu->header_size - sizeof(tcp_header_t), &nseg->opts);
+	}
+
 	epp->local.port = uint16_t_be2host(hdr->dest_port);
 	epp->local.addr = pdu->dest;
 	epp->remote.port = uint16_t_be2host(hdr->src_port);
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/** @addtogroup tcp
+ * @{
+ */
+
+/**
+ * @file Ring buffer helpers
+ *
+ * Send and receive buffers are ring buffers described by a data array,
+ * its size, the offset of the first used byte and the number of used
+ * bytes. Data is appended at the end and consumed from the start
+ * without moving the rest of the buffer.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdlib.h>
+#include "ring.h"
+
+/** Copy data into ring buffer.
+ *
+ * @param buf  Ring buffer data
+ * @param size Ring buffer size
+ * @param pos  Position of first byte to write (may exceed @a size)
+ * @param data Source data
+ * @param n    Number of bytes to write, at most @a size
+ */
+void tcp_ring_write(uint8_t *buf, size_t size, size_t pos, const void *data,
+    size_t n)
+{
+	size_t n1;
+
+	assert(n <= size);
+	if (n == 0)
+		return;
+
+	pos = pos % size;
+	n1 = min(n, size - pos);
+
+	memcpy(buf + pos, data, n1);
+	memcpy(buf, (const uint8_t *) data + n1, n - n1);
+}
+
+/** Copy data out of ring buffer.
+ *
+ * @param buf  Ring buffer data
+ * @param size Ring buffer size
+ * @param pos  Position of first byte to read (may exceed @a size)
+ * @param data Destination buffer
+ * @param n    Number of bytes to read, at most @a size
+ */
+void tcp_ring_read(uint8_t *buf, size_t size, size_t pos, void *data,
+    size_t n)
+{
+	size_t n1;
+
+	assert(n <= size);
+	if (n == 0)
+		return;
+
+	pos = pos % size;
+	n1 = min(n, size - pos);
+
+	memcpy(data, buf + pos, n1);
+	memcpy((uint8_t *) data + n1, buf, n - n1);
+}
+
+/** Resize ring buffer.
+ *
+ * The contents are preserved and moved to the beginning of the new buffer.
+ *
+ * @param buf   Ring buffer data, updated on success
+ * @param size  Ring buffer size, updated on success
+ * @param start Offset of first used byte, updated on success
+ * @param used  Number of used bytes
+ * @param nsize New size, must be at least @a used
+ * @return EOK on success, ENOMEM if out of memory
+ */
+errno_t tcp_ring_resize(uint8_t **buf, size_t *size, size_t *start,
+    size_t used, size_t nsize)
+{
+	uint8_t *nbuf;
+
+	assert(used <= nsize);
+
+	nbuf = calloc(1, nsize);
+	if (nbuf == NULL)
+		return ENOMEM;
+
+	tcp_ring_read(*buf, *size, *start, nbuf, used);
+	free(*buf);
+
+	*buf = nbuf;
+	*size = nsize;
+	*start = 0;
+	return EOK;
+}
+
+/**
+ * @}
+ */
@@ -32,9 +32,14 @@
 
 /**
  * @file Global segment receive queue
+ *
+ * Incoming segments are handed to a set of worker fibrils. Segments are
+ * assigned to workers by hashing their endpoint pair, so segments of one
+ * connection are processed in order while a slow connection does not hold
+ * up segments of the others.
  */
 
-#include <adt/prodcons.h>
+#include <adt/hash.h>
 #include <errno.h>
 #include <io/log.h>
 #include <stdbool.h>
@@ -47,109 +52,216 @@
 #include "tcp_type.h"
 #include "ucall.h"
 
-static prodcons_t rqueue;
-static bool fibril_active;
-static fibril_mutex_t lock;
-static fibril_condvar_t cv;
+/** Number of receive queue workers */
+#define RQUEUE_WORKERS 4
+
+static tcp_rqueue_worker_t workers[RQUEUE_WORKERS];
 static tcp_rqueue_cb_t *rqueue_cb;
 
 /** Initialize segment receive queue. */
 void tcp_rqueue_init(tcp_rqueue_cb_t *rcb)
 {
-	prodcons_initialize(&rqueue);
-	fibril_mutex_initialize(&lock);
-	fibril_condvar_initialize(&cv);
-	fibril_active = false;
+	tcp_rqueue_worker_t *worker;
+	unsigned i;
+
+	for (i = 0; i < RQUEUE_WORKERS; i++) {
+		worker = &workers[i];
+		fibril_mutex_initialize(&worker->lock);
+		fibril_condvar_initialize(&worker->cv);
+		list_initialize(&worker->list);
+		worker->active = false;
+		worker->stop = false;
+	}
+
 	rqueue_cb = rcb;
 }
 
-/** Finalize segment receive queue. */
+/** Stop receive queue workers.
+ *
+ * Waits until the segments queued to the first @a n workers are processed
+ * and their fibrils have exited.
+ *
+ * @param n	Number of workers to stop
+ */
+static void tcp_rqueue_workers_stop(unsigned n)
+{
+	tcp_rqueue_worker_t *worker;
+	unsigned i;
+
+	for (i = 0; i < n; i++) {
+		worker = &workers[i];
+
+		fibril_mutex_lock(&worker->lock);
+		worker->stop = true;
+		fibril_condvar_broadcast(&worker->cv);
+
+		while (worker->active)
+			fibril_condvar_wait(&worker->cv, &worker->lock);
+		fibril_mutex_unlock(&worker->lock);
+	}
+}
+
+/** Finalize segment receive queue.
+ *
+ * Waits until all queued segments are processed and the worker fibrils
+ * have exited.
+ */
 void tcp_rqueue_fini(void)
 {
-	inet_ep2_t epp;
+	tcp_rqueue_workers_stop(RQUEUE_WORKERS);
+}
+
+/** Compute hash of an Internet address.
+ *
+ * @param addr	Address
+ * @return	Hash value
+ */
+static size_t tcp_rqueue_addr_hash(inet_addr_t *addr)
+{
+	size_t hash = addr->version;
+	unsigned i;
+
+	switch (addr->version) {
+	case ip_v4:
+		hash = hash_combine(hash, addr->addr);
+		break;
+	case ip_v6:
+		for (i = 0; i < 16; i += 4) {
+			hash = hash_combine(hash, (addr->addr6[i] << 24) |
+			    (addr->addr6[i + 1] << 16) |
+			    (addr->addr6[i + 2] << 8) | addr->addr6[i + 3]);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return hash;
+}
 
-	inet_ep2_init(&epp);
-	tcp_rqueue_insert_seg(&epp, NULL);
+/** Select worker for processing segments with the given endpoint pair.
+ *
+ * @param epp	Endpoint pair, oriented for reception
+ * @return	Worker
+ */
+static tcp_rqueue_worker_t *tcp_rqueue_worker_get(inet_ep2_t *epp)
+{
+	size_t hash;
 
-	fibril_mutex_lock(&lock);
-	while (fibril_active)
-		fibril_condvar_wait(&cv, &lock);
-	fibril_mutex_unlock(&lock);
+	hash = tcp_rqueue_addr_hash(&epp->remote.addr);
+	hash = hash_combine(hash, epp->remote.port);
+	hash = hash_combine(hash, tcp_rqueue_addr_hash(&epp->local.addr));
+	hash = hash_combine(hash, epp->local.port);
+
+	return &workers[hash_mix(hash) % RQUEUE_WORKERS];
 }
 
 /** Insert segment into receive queue.
+ *
+ * The queue entry is embedded in the segment, no allocation is needed.
  *
  * @param epp	Endpoint pair, oriented for reception
  * @param seg	Segment (ownership transferred to rqueue)
  */
 void tcp_rqueue_insert_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
-	tcp_rqueue_entry_t *rqe;
+	tcp_rqueue_worker_t *worker;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "tcp_rqueue_insert_seg()");
 
-	if (seg != NULL)
-		tcp_segment_dump(seg);
-
-	rqe = calloc(1, sizeof(tcp_rqueue_entry_t));
-	if (rqe == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed allocating RQE.");
-		return;
-	}
+	tcp_segment_dump(seg);
 
-	rqe->epp = *epp;
-	rqe->seg = seg;
+	seg->rqe.epp = *epp;
+	worker = tcp_rqueue_worker_get(epp);
 
-	prodcons_produce(&rqueue, &rqe->link);
+	fibril_mutex_lock(&worker->lock);
+	list_append(&seg->rqe.link, &worker->list);
+	fibril_condvar_signal(&worker->cv);
+	fibril_mutex_unlock(&worker->lock);
 }
 
-/** Receive queue handler fibril. */
+/** Receive queue worker fibril.
+ *
+ * @param arg	Worker (tcp_rqueue_worker_t *)
+ */
 static errno_t tcp_rqueue_fibril(void *arg)
 {
+	tcp_rqueue_worker_t *worker = (tcp_rqueue_worker_t *) arg;
+	list_t batch;
 	link_t *link;
-	tcp_rqueue_entry_t *rqe;
+	tcp_segment_t *seg;
+	inet_ep2_t epp;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_rqueue_fibril()");
 
+	list_initialize(&batch);
+
+	fibril_mutex_lock(&worker->lock);
+
 	while (true) {
-		link = prodcons_consume(&rqueue);
-		rqe = list_get_instance(link, tcp_rqueue_entry_t, link);
+		while (list_empty(&worker->list) && !worker->stop)
+			fibril_condvar_wait(&worker->cv, &worker->lock);
 
-		if (rqe->seg == NULL) {
-			free(rqe);
+		if (list_empty(&worker->list))
 			break;
+
+		/* Take all queued segments at once */
+		list_concat(&batch, &worker->list);
+		fibril_mutex_unlock(&worker->lock);
+
+		while ((link = list_first(&batch)) != NULL) {
+			list_remove(link);
+			seg = list_get_instance(link, tcp_segment_t, rqe.link);
+
+			/* Segment may be freed by the callback */
+			epp = seg->rqe.epp;
+			rqueue_cb->seg_received(&epp, seg);
 		}
 
-		rqueue_cb->seg_received(&rqe->epp, rqe->seg);
-		free(rqe);
+		fibril_mutex_lock(&worker->lock);
 	}
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "tcp_rqueue_fibril() exiting");
 
 	/* Finished */
-	fibril_mutex_lock(&lock);
-	fibril_active = false;
-	fibril_mutex_unlock(&lock);
-	fibril_condvar_broadcast(&cv);
+	worker->active = false;
+	fibril_condvar_broadcast(&worker->cv);
+	fibril_mutex_unlock(&worker->lock);
 
 	return 0;
 }
 
-/** Start receive queue handler fibril. */
-void tcp_rqueue_fibril_start(void)
+/** Start receive queue worker fibrils.
+ *
+ * Segments are hashed over all workers, so either all of them are started
+ * or none is left running.
+ *
+ * @return EOK on success, ENOMEM if out of memory
+ */
+errno_t tcp_rqueue_fibril_start(void)
 {
+	tcp_rqueue_worker_t *worker;
 	fid_t fid;
+	unsigned i;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_rqueue_fibril_start()");
 
-	fid = fibril_create(tcp_rqueue_fibril, NULL);
-	if (fid == 0) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed creating rqueue fibril.");
-		return;
+	for (i = 0; i < RQUEUE_WORKERS; i++) {
+		worker = &workers[i];
+
+		fid = fibril_create(tcp_rqueue_fibril, worker);
+		if (fid == 0) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Failed creating "
+			    "rqueue fibril.");
+			tcp_rqueue_workers_stop(i);
+			return ENOMEM;
+		}
+
+		worker->active = true;
+		fibril_add_ready(fid);
 	}
 
-	fibril_add_ready(fid);
-	fibril_active = true;
+	return EOK;
 }
 
 /**
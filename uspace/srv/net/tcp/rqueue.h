@@ -39,7 +39,7 @@
 #include "tcp_type.h"
 
 extern void tcp_rqueue_init(tcp_rqueue_cb_t *);
-extern void tcp_rqueue_fibril_start(void);
+extern errno_t tcp_rqueue_fibril_start(void);
 extern void tcp_rqueue_fini(void);
 extern void tcp_rqueue_insert_seg(inet_ep2_t *, tcp_segment_t *);
 
@@ -74,6 +74,7 @@ tcp_segment_t *tcp_segment_dup(tcp_segment_t *seg)
 	scopy->len = seg->len;
 	scopy->wnd = seg->wnd;
 	scopy->up = seg->up;
+	scopy->opts = seg->opts;
 
 	tsize = tcp_segment_text_size(seg);
 	scopy->data = calloc(tsize, 1);
@@ -131,8 +132,11 @@ tcp_segment_t *tcp_segment_make_rst(tcp_segment_t *seg)
 	return rseg;
 }
 
-/** Create a control segment.
+/** Create a data segment.
  *
+ * @param ctrl	Control flags
+ * @param data	Segment text or @c NULL to leave text uninitialized
+ * @param size	Text size in bytes
  * @return	Segment
  */
 tcp_segment_t *tcp_segment_make_data(tcp_control_t ctrl, void *data,
@@ -153,7 +157,8 @@ tcp_segment_t *tcp_segment_make_data(tcp_control_t ctrl, void *data,
 		return NULL;
 	}
 
-	memcpy(seg->data, data, size);
+	if (data != NULL)
+		memcpy(seg->data, data, size);
 
 	return seg;
 }
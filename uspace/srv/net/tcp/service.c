@@ -142,7 +142,9 @@ static void tcp_service_lst_cstate_change(tcp_conn_t *conn, void *arg,
 	if ((old_state == st_syn_sent || old_state == st_syn_received) &&
 	    (nstate == st_established)) {
 		/* Connection established */
+		fibril_mutex_lock(&clst->client->lock);
 		clst->conn = NULL;
+		fibril_mutex_unlock(&clst->client->lock);
 
 		rc = tcp_cconn_create(clst->client, conn, &cconn);
 		if (rc != EOK) {
@@ -180,7 +182,10 @@ static void tcp_service_lst_cstate_change(tcp_conn_t *conn, void *arg,
 	}
 
 	conn->name = (char *) "s";
+
+	fibril_mutex_lock(&clst->client->lock);
 	clst->conn = conn;
+	fibril_mutex_unlock(&clst->client->lock);
 
 	/* XXX Is there a race here (i.e. the connection is already active)? */
 	tcp_uc_set_cb(conn, &tcp_service_lst_cb, clst);
@@ -308,6 +313,8 @@ static errno_t tcp_cconn_create(tcp_client_t *client, tcp_conn_t *conn,
 	if (cconn == NULL)
 		return ENOMEM;
 
+	fibril_mutex_lock(&client->lock);
+
 	/* Allocate new ID */
 	id = 0;
 	list_foreach (client->cconn, lclient, tcp_cconn_t, cconn) {
@@ -320,6 +327,8 @@ static errno_t tcp_cconn_create(tcp_client_t *client, tcp_conn_t *conn,
 	cconn->conn = conn;
 
 	list_append(&cconn->lclient, &client->cconn);
+	fibril_mutex_unlock(&client->lock);
+
 	*rcconn = cconn;
 	return EOK;
 }
@@ -330,7 +339,12 @@ static errno_t tcp_cconn_create(tcp_client_t *client, tcp_conn_t *conn,
  */
 static void tcp_cconn_destroy(tcp_cconn_t *cconn)
 {
+	tcp_client_t *client = cconn->client;
+
+	fibril_mutex_lock(&client->lock);
 	list_remove(&cconn->lclient);
+	fibril_mutex_unlock(&client->lock);
+
 	free(cconn);
 }
 
@@ -355,6 +369,8 @@ static errno_t tcp_clistener_create(tcp_client_t *client, tcp_conn_t *conn,
 	if (clst == NULL)
 		return ENOMEM;
 
+	fibril_mutex_lock(&client->lock);
+
 	/* Allocate new ID */
 	id = 0;
 	list_foreach (client->clst, lclient, tcp_clst_t, clst) {
@@ -367,6 +383,8 @@ static errno_t tcp_clistener_create(tcp_client_t *client, tcp_conn_t *conn,
 	clst->conn = conn;
 
 	list_append(&clst->lclient, &client->clst);
+	fibril_mutex_unlock(&client->lock);
+
 	*rclst = clst;
 	return EOK;
 }
@@ -377,7 +395,12 @@ static errno_t tcp_clistener_create(tcp_client_t *client, tcp_conn_t *conn,
  */
 static void tcp_clistener_destroy(tcp_clst_t *clst)
 {
+	tcp_client_t *client = clst->client;
+
+	fibril_mutex_lock(&client->lock);
 	list_remove(&clst->lclient);
+	fibril_mutex_unlock(&client->lock);
+
 	free(clst);
 }
 
@@ -393,13 +416,17 @@ static void tcp_clistener_destroy(tcp_clst_t *clst)
 static errno_t tcp_cconn_get(tcp_client_t *client, sysarg_t id,
     tcp_cconn_t **rcconn)
 {
+	fibril_mutex_lock(&client->lock);
+
 	list_foreach (client->cconn, lclient, tcp_cconn_t, cconn) {
 		if (cconn->id == id) {
 			*rcconn = cconn;
+			fibril_mutex_unlock(&client->lock);
 			return EOK;
 		}
 	}
 
+	fibril_mutex_unlock(&client->lock);
 	return ENOENT;
 }
 
@@ -415,13 +442,17 @@ static errno_t tcp_cconn_get(tcp_client_t *client, sysarg_t id,
 static errno_t tcp_clistener_get(tcp_client_t *client, sysarg_t id,
     tcp_clst_t **rclst)
 {
+	fibril_mutex_lock(&client->lock);
+
 	list_foreach (client->clst, lclient, tcp_clst_t, clst) {
 		if (clst->id == id) {
 			*rclst = clst;
+			fibril_mutex_unlock(&client->lock);
 			return EOK;
 		}
 	}
 
+	fibril_mutex_unlock(&client->lock);
 	return ENOENT;
 }
 
@@ -618,8 +649,7 @@ static errno_t tcp_conn_push_impl(tcp_client_t *client, sysarg_t conn_id)
 		return ENOENT;
 	}
 
-	(void) cconn;
-	/* XXX TODO */
+	tcp_uc_push(cconn->conn);
 	return EOK;
 }
 
@@ -722,6 +752,106 @@ static errno_t tcp_conn_recv_impl(tcp_client_t *client, sysarg_t conn_id,
 	return EOK;
 }
 
+/** Set connection buffer sizes.
+ *
+ * Handle client request to set connection buffer sizes (with parameters
+ * unmarshalled).
+ *
+ * @param client   TCP client
+ * @param conn_id  Connection ID
+ * @param snd_size Send buffer size or zero to leave unchanged
+ * @param rcv_size Receive buffer size or zero to leave unchanged
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t tcp_conn_set_buf_size_impl(tcp_client_t *client,
+    sysarg_t conn_id, size_t snd_size, size_t rcv_size)
+{
+	tcp_cconn_t *cconn;
+	errno_t rc;
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK)
+		return rc;
+
+	return tcp_uc_set_buf_size(cconn->conn, snd_size, rcv_size);
+}
+
+/** Enable or disable Nagle's algorithm.
+ *
+ * Handle client request to set connection no-delay option (with
+ * parameters unmarshalled).
+ *
+ * @param client  TCP client
+ * @param conn_id Connection ID
+ * @param nodelay @c true to send small segments without delay
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t tcp_conn_set_nodelay_impl(tcp_client_t *client,
+    sysarg_t conn_id, bool nodelay)
+{
+	tcp_cconn_t *cconn;
+	errno_t rc;
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK)
+		return rc;
+
+	tcp_uc_set_nodelay(cconn->conn, nodelay);
+	return EOK;
+}
+
+/** Cork or uncork connection.
+ *
+ * Handle client request to cork or uncork connection (with parameters
+ * unmarshalled).
+ *
+ * @param client  TCP client
+ * @param conn_id Connection ID
+ * @param cork    @c true to cork, @c false to uncork
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t tcp_conn_set_cork_impl(tcp_client_t *client, sysarg_t conn_id,
+    bool cork)
+{
+	tcp_cconn_t *cconn;
+	errno_t rc;
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK)
+		return rc;
+
+	tcp_uc_set_cork(cconn->conn, cork);
+	return EOK;
+}
+
+/** Get connection statistics.
+ *
+ * Handle client request to get connection statistics (with parameters
+ * unmarshalled).
+ *
+ * @param client  TCP client
+ * @param conn_id Connection ID
+ * @param stats   Place to store statistics
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t tcp_conn_get_stats_impl(tcp_client_t *client, sysarg_t conn_id,
+    tcp_conn_stats_t *stats)
+{
+	tcp_cconn_t *cconn;
+	errno_t rc;
+
+	rc = tcp_cconn_get(client, conn_id, &cconn);
+	if (rc != EOK)
+		return rc;
+
+	tcp_uc_get_stats(cconn->conn, stats);
+	return EOK;
+}
+
 /** Create client callback session.
  *
  * Handle client request to create callback session.
@@ -1111,6 +1241,127 @@ static void tcp_conn_recv_wait_srv(tcp_client_t *client, ipc_call_t *icall)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_recv_wait_srv(): OK");
 }
 
+/** Get connection statistics.
+ *
+ * Handle client request to get connection statistics.
+ *
+ * @param client TCP client
+ * @param icall  Async request data
+ *
+ */
+static void tcp_conn_get_stats_srv(tcp_client_t *client, ipc_call_t *icall)
+{
+	ipc_call_t call;
+	sysarg_t conn_id;
+	tcp_conn_stats_t stats;
+	size_t size;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_get_stats_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+
+	if (!async_data_read_receive(&call, &size)) {
+		async_answer_0(&call, EREFUSED);
+		async_answer_0(icall, EREFUSED);
+		return;
+	}
+
+	if (size != sizeof(tcp_conn_stats_t)) {
+		async_answer_0(&call, EINVAL);
+		async_answer_0(icall, EINVAL);
+		return;
+	}
+
+	rc = tcp_conn_get_stats_impl(client, conn_id, &stats);
+	if (rc != EOK) {
+		async_answer_0(&call, rc);
+		async_answer_0(icall, rc);
+		return;
+	}
+
+	rc = async_data_read_finalize(&call, &stats, size);
+	if (rc != EOK) {
+		async_answer_0(icall, rc);
+		return;
+	}
+
+	async_answer_0(icall, EOK);
+}
+
+/** Set connection buffer sizes.
+ *
+ * Handle client request to set connection buffer sizes.
+ *
+ * @param client TCP client
+ * @param icall  Async request data
+ *
+ */
+static void tcp_conn_set_buf_size_srv(tcp_client_t *client,
+    ipc_call_t *icall)
+{
+	sysarg_t conn_id;
+	size_t snd_size;
+	size_t rcv_size;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_set_buf_size_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+	snd_size = IPC_GET_ARG2(*icall);
+	rcv_size = IPC_GET_ARG3(*icall);
+
+	rc = tcp_conn_set_buf_size_impl(client, conn_id, snd_size, rcv_size);
+	async_answer_0(icall, rc);
+}
+
+/** Enable or disable Nagle's algorithm.
+ *
+ * Handle client request to set connection no-delay option.
+ *
+ * @param client TCP client
+ * @param icall  Async request data
+ *
+ */
+static void tcp_conn_set_nodelay_srv(tcp_client_t *client,
+    ipc_call_t *icall)
+{
+	sysarg_t conn_id;
+	bool nodelay;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_set_nodelay_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+	nodelay = IPC_GET_ARG2(*icall) != 0;
+
+	rc = tcp_conn_set_nodelay_impl(client, conn_id, nodelay);
+	async_answer_0(icall, rc);
+}
+
+/** Cork or uncork connection.
+ *
+ * Handle client request to cork or uncork connection.
+ *
+ * @param client TCP client
+ * @param icall  Async request data
+ *
+ */
+static void tcp_conn_set_cork_srv(tcp_client_t *client, ipc_call_t *icall)
+{
+	sysarg_t conn_id;
+	bool cork;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_set_cork_srv()");
+
+	conn_id = IPC_GET_ARG1(*icall);
+	cork = IPC_GET_ARG2(*icall) != 0;
+
+	rc = tcp_conn_set_cork_impl(client, conn_id, cork);
+	async_answer_0(icall, rc);
+}
+
 /** Initialize TCP client structure.
  *
  * @param client TCP client
@@ -1119,6 +1370,7 @@ static void tcp_client_init(tcp_client_t *client)
 {
 	memset(client, 0, sizeof(tcp_client_t));
 	client->sess = NULL;
+	fibril_mutex_initialize(&client->lock);
 	list_initialize(&client->cconn);
 	list_initialize(&client->clst);
 }
@@ -1132,6 +1384,8 @@ static void tcp_client_fini(tcp_client_t *client)
 	tcp_cconn_t *cconn;
 	unsigned long n;
 
+	fibril_mutex_lock(&client->lock);
+
 	n = list_count(&client->cconn);
 	if (n != 0) {
 		log_msg(LOG_DEFAULT, LVL_WARN, "Client with %lu active "
@@ -1140,13 +1394,19 @@ static void tcp_client_fini(tcp_client_t *client)
 		while (!list_empty(&client->cconn)) {
 			cconn = list_get_instance(list_first(&client->cconn),
 			    tcp_cconn_t, lclient);
+			fibril_mutex_unlock(&client->lock);
+
 			tcp_uc_close(cconn->conn);
 			tcp_uc_delete(cconn->conn);
 			tcp_cconn_destroy(cconn);
+
+			fibril_mutex_lock(&client->lock);
 		}
 	}
 
 	n = list_count(&client->clst);
+	fibril_mutex_unlock(&client->lock);
+
 	if (n != 0) {
 		log_msg(LOG_DEFAULT, LVL_WARN, "Client with %lu active "
 		    "listeners closed session", n);
@@ -1223,6 +1483,18 @@ static void tcp_client_conn(ipc_call_t *icall, void *arg)
 		case TCP_CONN_RECV_WAIT:
 			tcp_conn_recv_wait_srv(&client, &call);
 			break;
+		case TCP_CONN_GET_STATS:
+			tcp_conn_get_stats_srv(&client, &call);
+			break;
+		case TCP_CONN_SET_BUF_SIZE:
+			tcp_conn_set_buf_size_srv(&client, &call);
+			break;
+		case TCP_CONN_SET_NODELAY:
+			tcp_conn_set_nodelay_srv(&client, &call);
+			break;
+		case TCP_CONN_SET_CORK:
+			tcp_conn_set_cork_srv(&client, &call);
+			break;
 		default:
 			async_answer_0(&call, ENOTSUP);
 			break;
@@ -74,34 +74,6 @@ enum doff_flags_bits {
 	DF_FIN			= 0
 };
 
-/** TCP over IPv4 checksum pseudo header */
-typedef struct {
-	/** Source address */
-	uint32_t src;
-	/** Destination address */
-	uint32_t dest;
-	/** Zero */
-	uint8_t zero;
-	/** Protocol */
-	uint8_t protocol;
-	/** TCP length */
-	uint16_t tcp_length;
-} tcp_phdr_t;
-
-/** TCP over IPv6 checksum pseudo header */
-typedef struct {
-	/** Source address */
-	addr128_t src;
-	/** Destination address */
-	addr128_t dest;
-	/** TCP length */
-	uint32_t tcp_length;
-	/** Zeroes */
-	uint8_t zeroes[3];
-	/** Next header */
-	uint8_t next;
-} tcp_phdr6_t;
-
 /** Option kind */
 enum opt_kind {
 	/** End of option list */
@@ -109,9 +81,35 @@ enum opt_kind {
 	/** No-operation */
 	OPT_NOP			= 1,
 	/** Maximum segment size */
-	OPT_MAX_SEG_SIZE	= 2
+	OPT_MAX_SEG_SIZE	= 2,
+	/** Window scale (RFC 7323) */
+	OPT_WINDOW_SCALE	= 3,
+	/** SACK permitted (RFC 2018) */
+	OPT_SACK_PERMITTED	= 4,
+	/** SACK (RFC 2018) */
+	OPT_SACK		= 5,
+	/** Timestamps (RFC 7323) */
+	OPT_TIMESTAMP		= 8
 };
 
+/** Option length (including kind and length bytes) */
+enum opt_len {
+	OPT_MAX_SEG_SIZE_LEN	= 4,
+	OPT_WINDOW_SCALE_LEN	= 3,
+	OPT_SACK_PERMITTED_LEN	= 2,
+	OPT_TIMESTAMP_LEN	= 10,
+	/** SACK option length without blocks */
+	OPT_SACK_LEN		= 2,
+	/** Length of one SACK block */
+	OPT_SACK_BLOCK_LEN	= 8
+};
+
+/** Maximum size of TCP options */
+#define TCP_OPTIONS_MAX_SIZE	40
+
+/** Maximum window scale shift count (RFC 7323 section 2.3) */
+#define TCP_WSCALE_MAX	14
+
 #endif
 
 /** @}
@@ -36,6 +36,7 @@
 
 #include <async.h>
 #include <errno.h>
+#include <fibril.h>
 #include <io/log.h>
 #include <stdio.h>
 #include <task.h>
@@ -67,8 +68,15 @@ static errno_t tcp_init(void)
 		return ENOMEM;
 	}
 
+	/* Let receive queue workers run in parallel */
+	fibril_enable_multithreaded();
+
 	tcp_rqueue_init(&tcp_rqueue_cb);
-	tcp_rqueue_fibril_start();
+	rc = tcp_rqueue_fibril_start();
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed starting receive queue");
+		return ENOMEM;
+	}
 
 	tcp_ncsim_init();
 	tcp_ncsim_fibril_start();
@@ -43,6 +43,7 @@
 #include <refcount.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <time.h>
 #include <inet/addr.h>
 #include <inet/endpoint.h>
 
@@ -154,6 +155,43 @@ typedef struct {
 	tcp_cstate_t cstate;
 } tcp_conn_status_t;
 
+/** Maximum number of SACK blocks in a segment */
+#define TCP_SACK_BLOCKS_MAX	4
+
+/** SACK block */
+typedef struct {
+	/** Left edge (first sequence number of the block) */
+	uint32_t left;
+	/** Right edge (sequence number immediately following the block) */
+	uint32_t right;
+} tcp_sack_block_t;
+
+/** Segment options */
+typedef struct {
+	/** Window scale option is present */
+	bool wscale_present;
+	/** Window scale shift count */
+	uint8_t wscale;
+	/** SACK permitted option is present */
+	bool sack_perm;
+	/** Timestamps option is present */
+	bool ts_present;
+	/** Timestamp value */
+	uint32_t ts_val;
+	/** Timestamp echo reply */
+	uint32_t ts_ecr;
+	/** Number of SACK blocks */
+	unsigned sack_cnt;
+	/** SACK blocks */
+	tcp_sack_block_t sack[TCP_SACK_BLOCKS_MAX];
+} tcp_seg_opts_t;
+
+/** Receive queue entry, embedded in the segment */
+typedef struct {
+	link_t link;
+	inet_ep2_t epp;
+} tcp_rqueue_entry_t;
+
 typedef struct {
 	/** SYN, FIN */
 	tcp_control_t ctrl;
@@ -168,19 +206,18 @@ typedef struct {
 	uint32_t wnd;
 	/** Segment urgent pointer */
 	uint32_t up;
+	/** Segment options */
+	tcp_seg_opts_t opts;
 
 	/** Segment data, may be moved when trimming segment */
 	void *data;
 	/** Segment data, original pointer used to free data */
 	void *dfptr;
+
+	/** Receive queue entry */
+	tcp_rqueue_entry_t rqe;
 } tcp_segment_t;
 
-/** Receive queue entry */
-typedef struct {
-	link_t link;
-	inet_ep2_t epp;
-	tcp_segment_t *seg;
-} tcp_rqueue_entry_t;
 
 /** Receive queue callbacks */
 typedef struct {
@@ -188,6 +225,24 @@ typedef struct {
 	void (*seg_received)(inet_ep2_t *, tcp_segment_t *);
 } tcp_rqueue_cb_t;
 
+/** Receive queue worker.
+ *
+ * Segments are distributed among workers by their endpoint pair, so that
+ * all segments of a connection are processed by the same worker, in order.
+ */
+typedef struct {
+	/** Protects the worker */
+	fibril_mutex_t lock;
+	/** Signalled when a segment is queued or the worker should stop */
+	fibril_condvar_t cv;
+	/** Queued segments (of tcp_segment_t) */
+	list_t list;
+	/** Worker fibril is running */
+	bool active;
+	/** Worker fibril should exit once the queue is empty */
+	bool stop;
+} tcp_rqueue_worker_t;
+
 /** NCSim queue entry */
 typedef struct {
 	link_t link;
@@ -207,6 +262,12 @@ typedef struct {
 	link_t link;
 	tcp_conn_t *conn;
 	tcp_segment_t *seg;
+	/** Time when the segment was first transmitted */
+	struct timespec sent;
+	/** Segment has been retransmitted (Karn's algorithm) */
+	bool retransmitted;
+	/** Segment has been selectively acknowledged by peer */
+	bool sacked;
 } tcp_tqueue_entry_t;
 
 /** Retransmission queue callbacks */
@@ -223,10 +284,63 @@ typedef struct {
 	/** Retransmission timer */
 	fibril_timer_t *timer;
 
+	/** Delayed ACK timer */
+	fibril_timer_t *ack_timer;
+	/** Number of received segments not acknowledged yet */
+	unsigned ack_pending;
+
 	/** Callbacks */
 	tcp_tqueue_cb_t *cb;
 } tcp_tqueue_t;
 
+/** Congestion control algorithm */
+typedef struct tcp_cc_ops {
+	/** Algorithm name */
+	const char *name;
+	/** Initialize algorithm-specific state (optional) */
+	void (*init)(tcp_conn_t *);
+	/** Grow congestion window after @a acked bytes were acknowledged */
+	void (*cong_avoid)(tcp_conn_t *, uint32_t);
+	/** Compute new slow start threshold after loss was detected */
+	uint32_t (*ssthresh)(tcp_conn_t *);
+} tcp_cc_ops_t;
+
+/** Congestion control and retransmission timer state */
+typedef struct {
+	/** Congestion control algorithm */
+	tcp_cc_ops_t *ops;
+	/** Sender maximum segment size */
+	uint32_t smss;
+	/** Congestion window */
+	uint32_t cwnd;
+	/** Slow start threshold */
+	uint32_t ssthresh;
+	/** Bytes acknowledged since last congestion avoidance increase */
+	uint32_t ca_acked;
+	/** Number of consecutive duplicate ACKs */
+	unsigned dupacks;
+	/** Loss recovery is in progress */
+	bool in_recovery;
+	/** Loss recovery was entered via fast retransmit (not timeout) */
+	bool fast_recovery;
+	/** SND.NXT at the time loss recovery was entered */
+	uint32_t recover;
+	/** RTT has been measured, @c srtt and @c rttvar are valid */
+	bool rtt_valid;
+	/** Smoothed round-trip time */
+	usec_t srtt;
+	/** Round-trip time variation */
+	usec_t rttvar;
+	/** Retransmission timeout */
+	usec_t rto;
+	/** Number of retransmitted segments */
+	unsigned retransmits;
+	/** Number of fast retransmits */
+	unsigned fast_retransmits;
+	/** Number of retransmission timeouts */
+	unsigned timeouts;
+} tcp_cc_t;
+
 /** Connection */
 struct tcp_conn {
 	char *name;
@@ -267,6 +381,8 @@ struct tcp_conn {
 
 	/** Retransmission queue */
 	tcp_tqueue_t retransmit;
+	/** Congestion control */
+	tcp_cc_t cc;
 
 	/** Time-Wait timeout timer */
 	fibril_timer_t *tw_timer;
@@ -277,6 +393,8 @@ struct tcp_conn {
 	size_t rcv_buf_size;
 	/** Receive buffer number of bytes used */
 	size_t rcv_buf_used;
+	/** Offset of first used byte in receive ring buffer */
+	size_t rcv_buf_start;
 	/** Receive buffer contains FIN */
 	bool rcv_buf_fin;
 	/** Receive buffer CV. Broadcast when new data is inserted */
@@ -288,6 +406,8 @@ struct tcp_conn {
 	size_t snd_buf_size;
 	/** Send buffer number of bytes used */
 	size_t snd_buf_used;
+	/** Offset of first used byte in send ring buffer */
+	size_t snd_buf_start;
 	/** Send buffer contains FIN */
 	bool snd_buf_fin;
 	/** Send buffer CV. Broadcast when space is made available in buffer */
@@ -316,6 +436,27 @@ struct tcp_conn {
 	uint32_t rcv_up;
 	/** Initial receive sequence number */
 	uint32_t irs;
+
+	/** Window scaling was negotiated */
+	bool ws_ok;
+	/** Shift count applied to windows received from peer */
+	uint8_t snd_wscale;
+	/** Shift count applied to windows we advertise */
+	uint8_t rcv_wscale;
+	/** Timestamps option was negotiated */
+	bool ts_ok;
+	/** Most recent timestamp received from peer (TS.Recent) */
+	uint32_t ts_recent;
+	/** SACK was negotiated */
+	bool sack_ok;
+
+	/** Right edge of the receive window last advertised to peer */
+	uint32_t rcv_adv;
+
+	/** Disable Nagle's algorithm, send small segments immediately */
+	bool nodelay;
+	/** Corked, only send full-sized segments */
+	bool cork;
 };
 
 /** Continuation of processing.
@@ -373,6 +514,12 @@ typedef struct tcp_clst {
 typedef struct tcp_client {
 	/** Client callback session */
 	async_sess_t *sess;
+	/**
+	 * Protects @c cconn, @c clst and the connections of the listeners.
+	 * The connection callbacks run on the receive queue workers, in
+	 * parallel with the client's IPC fibril.
+	 */
+	fibril_mutex_t lock;
 	/** Client's connections */
 	list_t cconn; /* of tcp_cconn_t */
 	/** Client's listeners */
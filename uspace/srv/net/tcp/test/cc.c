@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <io/log.h>
+#include <pcut/pcut.h>
+#include <time.h>
+
+#include "../cc.h"
+#include "../conn.h"
+#include "../tqueue.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(cc);
+
+enum {
+	test_seg_max = 10
+};
+
+/** Transmitted segment (segments are not retained after transmission) */
+typedef struct {
+	tcp_control_t ctrl;
+	uint32_t seq;
+	uint32_t len;
+} test_seg_t;
+
+static int seg_cnt;
+static test_seg_t trans_seg[test_seg_max];
+
+static void cc_test_transmit_seg(inet_ep2_t *, tcp_segment_t *);
+
+static tcp_tqueue_cb_t cc_test_cb = {
+	.transmit_seg = cc_test_transmit_seg
+};
+
+PCUT_TEST_BEFORE
+{
+	errno_t rc;
+
+	/* We will be calling functions that perform logging */
+	rc = log_init("test-tcp");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = tcp_conns_init();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+PCUT_TEST_AFTER
+{
+	tcp_conns_fini();
+}
+
+/** Create established connection with @a size bytes in send buffer */
+static tcp_conn_t *cc_test_conn(size_t size)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	if (conn == NULL)
+		return NULL;
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 65535;
+	conn->snd_buf_used = size;
+	conn->snd_buf_fin = false;
+	/* Only test segmentation by cwnd, not Nagle's algorithm */
+	conn->nodelay = true;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &cc_test_cb;
+	seg_cnt = 0;
+
+	return conn;
+}
+
+/** Test initial state */
+PCUT_TEST(init)
+{
+	tcp_conn_t *conn;
+
+	conn = cc_test_conn(0);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	PCUT_ASSERT_INT_EQUALS(4380, conn->cc.cwnd);
+	PCUT_ASSERT_TRUE(conn->cc.rto == SEC2USEC(1));
+	PCUT_ASSERT_FALSE(conn->cc.rtt_valid);
+	PCUT_ASSERT_FALSE(conn->cc.in_recovery);
+
+	tcp_conn_lock(conn);
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+}
+
+/** Test RTT estimation and RTO computation */
+PCUT_TEST(rtt_sample)
+{
+	tcp_conn_t *conn;
+
+	conn = cc_test_conn(0);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	/* First measurement, RTO is clamped to minimum */
+	tcp_cc_rtt_sample(conn, MSEC2USEC(100));
+	PCUT_ASSERT_TRUE(conn->cc.rtt_valid);
+	PCUT_ASSERT_TRUE(conn->cc.srtt == MSEC2USEC(100));
+	PCUT_ASSERT_TRUE(conn->cc.rttvar == MSEC2USEC(50));
+	PCUT_ASSERT_TRUE(conn->cc.rto == SEC2USEC(1));
+
+	/* Large variation pushes RTO up */
+	tcp_cc_rtt_sample(conn, MSEC2USEC(900));
+	PCUT_ASSERT_TRUE(conn->cc.srtt == MSEC2USEC(200));
+	PCUT_ASSERT_TRUE(conn->cc.rttvar == MSEC2USEC(237) + 500);
+	PCUT_ASSERT_TRUE(conn->cc.rto == conn->cc.srtt + 4 * conn->cc.rttvar);
+
+	/* Timeout doubles RTO */
+	tcp_cc_timeout(conn);
+	PCUT_ASSERT_TRUE(conn->cc.rto == 2 * (conn->cc.srtt +
+	    4 * conn->cc.rttvar));
+	PCUT_ASSERT_INT_EQUALS(1, conn->cc.timeouts);
+
+	tcp_conn_lock(conn);
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+}
+
+/** Test window growth in slow start and congestion avoidance */
+PCUT_TEST(window_growth)
+{
+	tcp_conn_t *conn;
+
+	conn = cc_test_conn(0);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	/* Slow start, at most SMSS per ACK */
+	PCUT_ASSERT_FALSE(tcp_cc_ack(conn, 1000));
+	PCUT_ASSERT_INT_EQUALS(5380, conn->cc.cwnd);
+	PCUT_ASSERT_FALSE(tcp_cc_ack(conn, 3000));
+	PCUT_ASSERT_INT_EQUALS(5380 + TCP_SMSS, conn->cc.cwnd);
+
+	/* Congestion avoidance, one SMSS per window */
+	conn->cc.ssthresh = 4 * TCP_SMSS;
+	conn->cc.cwnd = 4 * TCP_SMSS;
+	PCUT_ASSERT_FALSE(tcp_cc_ack(conn, 3 * TCP_SMSS));
+	PCUT_ASSERT_INT_EQUALS(4 * TCP_SMSS, conn->cc.cwnd);
+	PCUT_ASSERT_FALSE(tcp_cc_ack(conn, TCP_SMSS));
+	PCUT_ASSERT_INT_EQUALS(5 * TCP_SMSS, conn->cc.cwnd);
+
+	tcp_conn_lock(conn);
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+}
+
+/** Test that new data is split into segments limited by cwnd */
+PCUT_TEST(new_data_cwnd)
+{
+	tcp_conn_t *conn;
+
+	conn = cc_test_conn(4000);
+	PCUT_ASSERT_NOT_NULL(conn);
+	conn->cc.cwnd = 2 * TCP_SMSS;
+
+	tcp_conn_lock(conn);
+	tcp_tqueue_new_data(conn);
+
+	PCUT_ASSERT_INT_EQUALS(2, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10, trans_seg[0].seq);
+	PCUT_ASSERT_INT_EQUALS(TCP_SMSS, trans_seg[0].len);
+	PCUT_ASSERT_INT_EQUALS(10 + TCP_SMSS, trans_seg[1].seq);
+	PCUT_ASSERT_INT_EQUALS(TCP_SMSS, trans_seg[1].len);
+	PCUT_ASSERT_INT_EQUALS(4000 - 2 * TCP_SMSS, conn->snd_buf_used);
+
+	/* ACK of first segment opens the window */
+	conn->snd_una += TCP_SMSS;
+	tcp_tqueue_ack_received(conn);
+
+	PCUT_ASSERT_INT_EQUALS(3, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10 + 2 * TCP_SMSS, trans_seg[2].seq);
+	PCUT_ASSERT_INT_EQUALS(4000 - 2 * TCP_SMSS, trans_seg[2].len);
+	PCUT_ASSERT_INT_EQUALS(0, conn->snd_buf_used);
+	PCUT_ASSERT_TRUE(conn->cc.rtt_valid);
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+}
+
+/** Test fast retransmit and NewReno fast recovery */
+PCUT_TEST(fast_retransmit)
+{
+	tcp_conn_t *conn;
+
+	conn = cc_test_conn(4000);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	tcp_conn_lock(conn);
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_INT_EQUALS(3, seg_cnt);
+
+	/* Two duplicate ACKs do not trigger retransmission */
+	tcp_tqueue_dup_ack(conn);
+	tcp_tqueue_dup_ack(conn);
+	PCUT_ASSERT_INT_EQUALS(3, seg_cnt);
+
+	/* Third duplicate ACK does */
+	tcp_tqueue_dup_ack(conn);
+	PCUT_ASSERT_INT_EQUALS(4, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10, trans_seg[3].seq);
+	PCUT_ASSERT_INT_EQUALS(TCP_SMSS, trans_seg[3].len);
+	PCUT_ASSERT_TRUE(conn->cc.in_recovery);
+	PCUT_ASSERT_INT_EQUALS(2 * TCP_SMSS, conn->cc.ssthresh);
+	PCUT_ASSERT_INT_EQUALS(5 * TCP_SMSS, conn->cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(1, conn->cc.fast_retransmits);
+
+	/* Partial ACK retransmits the next segment */
+	conn->snd_una += TCP_SMSS;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(5, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(10 + TCP_SMSS, trans_seg[4].seq);
+	PCUT_ASSERT_TRUE(conn->cc.in_recovery);
+
+	/* Full ACK ends recovery */
+	conn->snd_una = conn->snd_nxt;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(5, seg_cnt);
+	PCUT_ASSERT_FALSE(conn->cc.in_recovery);
+	PCUT_ASSERT_INT_EQUALS(2 * TCP_SMSS, conn->cc.cwnd);
+	PCUT_ASSERT_INT_EQUALS(2, conn->cc.retransmits);
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+}
+
+static void cc_test_transmit_seg(inet_ep2_t *epp, tcp_segment_t *seg)
+{
+	trans_seg[seg_cnt].ctrl = seg->ctrl;
+	trans_seg[seg_cnt].seq = seg->seq;
+	trans_seg[seg_cnt].len = seg->len;
+	++seg_cnt;
+}
+
+PCUT_EXPORT(cc);
@@ -27,6 +27,7 @@
  */
 
 #include <inet/endpoint.h>
+#include <mem.h>
 #include <pcut/pcut.h>
 
 #include "../conn.h"
@@ -175,4 +176,63 @@ PCUT_TEST(two_segments)
 	tcp_conn_delete(conn);
 }
 
+/** Test computing SACK blocks from out-of-order segments */
+PCUT_TEST(sack_blocks)
+{
+	tcp_conn_t *conn;
+	tcp_iqueue_t iqueue;
+	inet_ep2_t epp;
+	tcp_segment_t *seg[3];
+	tcp_sack_block_t blocks[TCP_SACK_BLOCKS_MAX];
+	uint8_t data[5];
+	unsigned cnt;
+	int i;
+
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->rcv_nxt = 10;
+	conn->rcv_wnd = 100;
+
+	tcp_iqueue_init(&iqueue, conn);
+
+	cnt = tcp_iqueue_sack_blocks(&iqueue, blocks, TCP_SACK_BLOCKS_MAX);
+	PCUT_ASSERT_INT_EQUALS(0, cnt);
+
+	memset(data, 0, sizeof(data));
+	for (i = 0; i < 3; i++) {
+		seg[i] = tcp_segment_make_data(0, data, sizeof(data));
+		PCUT_ASSERT_NOT_NULL(seg[i]);
+	}
+
+	/* Two adjacent segments and one after a gap */
+	seg[0]->seq = 40;
+	tcp_iqueue_insert_seg(&iqueue, seg[0]);
+	seg[1]->seq = 25;
+	tcp_iqueue_insert_seg(&iqueue, seg[1]);
+	seg[2]->seq = 20;
+	tcp_iqueue_insert_seg(&iqueue, seg[2]);
+
+	cnt = tcp_iqueue_sack_blocks(&iqueue, blocks, TCP_SACK_BLOCKS_MAX);
+	PCUT_ASSERT_INT_EQUALS(2, cnt);
+	PCUT_ASSERT_INT_EQUALS(20, blocks[0].left);
+	PCUT_ASSERT_INT_EQUALS(30, blocks[0].right);
+	PCUT_ASSERT_INT_EQUALS(40, blocks[1].left);
+	PCUT_ASSERT_INT_EQUALS(45, blocks[1].right);
+
+	/* Number of blocks is limited */
+	cnt = tcp_iqueue_sack_blocks(&iqueue, blocks, 1);
+	PCUT_ASSERT_INT_EQUALS(1, cnt);
+	PCUT_ASSERT_INT_EQUALS(20, blocks[0].left);
+	PCUT_ASSERT_INT_EQUALS(30, blocks[0].right);
+
+	for (i = 0; i < 3; i++) {
+		tcp_iqueue_remove_seg(&iqueue, seg[i]);
+		tcp_segment_delete(seg[i]);
+	}
+
+	tcp_conn_delete(conn);
+}
+
 PCUT_EXPORT(iqueue);
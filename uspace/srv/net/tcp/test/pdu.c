@@ -108,4 +108,60 @@ PCUT_TEST(encdec_data)
 	free(data);
 }
 
+/** Test encode/decode round trip for PDU with options */
+PCUT_TEST(encdec_opts)
+{
+	tcp_segment_t *seg, *dseg;
+	tcp_pdu_t *pdu;
+	inet_ep2_t epp, depp;
+	errno_t rc;
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 1, 2, 3, 4);
+	inet_addr(&epp.remote.addr, 5, 6, 7, 8);
+
+	seg = tcp_segment_make_ctrl(CTL_ACK);
+	PCUT_ASSERT_NOT_NULL(seg);
+
+	seg->seq = 20;
+	seg->ack = 19;
+	seg->wnd = 18;
+	seg->opts.wscale_present = true;
+	seg->opts.wscale = 7;
+	seg->opts.sack_perm = true;
+	seg->opts.ts_present = true;
+	seg->opts.ts_val = 0x12345678;
+	seg->opts.ts_ecr = 0x9abcdef0;
+	seg->opts.sack_cnt = 2;
+	seg->opts.sack[0].left = 100;
+	seg->opts.sack[0].right = 200;
+	seg->opts.sack[1].left = 300;
+	seg->opts.sack[1].right = 400;
+
+	rc = tcp_pdu_encode(&epp, seg, &pdu);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, pdu->header_size % 4);
+	PCUT_ASSERT_TRUE(pdu->header_size <= 60);
+
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_seg_same(seg, dseg);
+	PCUT_ASSERT_TRUE(dseg->opts.wscale_present);
+	PCUT_ASSERT_INT_EQUALS(7, dseg->opts.wscale);
+	PCUT_ASSERT_TRUE(dseg->opts.sack_perm);
+	PCUT_ASSERT_TRUE(dseg->opts.ts_present);
+	PCUT_ASSERT_INT_EQUALS(0x12345678, dseg->opts.ts_val);
+	PCUT_ASSERT_INT_EQUALS(0x9abcdef0, dseg->opts.ts_ecr);
+	PCUT_ASSERT_INT_EQUALS(2, dseg->opts.sack_cnt);
+	PCUT_ASSERT_INT_EQUALS(100, dseg->opts.sack[0].left);
+	PCUT_ASSERT_INT_EQUALS(200, dseg->opts.sack[0].right);
+	PCUT_ASSERT_INT_EQUALS(300, dseg->opts.sack[1].left);
+	PCUT_ASSERT_INT_EQUALS(400, dseg->opts.sack[1].right);
+
+	tcp_pdu_delete(pdu);
+	tcp_segment_delete(dseg);
+	tcp_segment_delete(seg);
+}
+
 PCUT_EXPORT(pdu);
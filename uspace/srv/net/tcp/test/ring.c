@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2026 HelenOS contributors
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+
+#include "../ring.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(ring);
+
+/** Test writing and reading data that wraps around the end of buffer */
+PCUT_TEST(write_read_wrap)
+{
+	uint8_t buf[8];
+	uint8_t data[6];
+	uint8_t rdata[6];
+	int i;
+
+	for (i = 0; i < 6; i++)
+		data[i] = i + 1;
+
+	tcp_ring_write(buf, sizeof(buf), 5, data, sizeof(data));
+	PCUT_ASSERT_INT_EQUALS(1, buf[5]);
+	PCUT_ASSERT_INT_EQUALS(3, buf[7]);
+	PCUT_ASSERT_INT_EQUALS(4, buf[0]);
+	PCUT_ASSERT_INT_EQUALS(6, buf[2]);
+
+	/* Position beyond buffer size is taken modulo size */
+	tcp_ring_read(buf, sizeof(buf), 13, rdata, sizeof(rdata));
+	for (i = 0; i < 6; i++)
+		PCUT_ASSERT_INT_EQUALS(i + 1, rdata[i]);
+}
+
+/** Test resizing ring buffer preserves contents */
+PCUT_TEST(resize)
+{
+	uint8_t *buf;
+	size_t size;
+	size_t start;
+	uint8_t data[6];
+	int i;
+	errno_t rc;
+
+	size = 8;
+	buf = calloc(1, size);
+	PCUT_ASSERT_NOT_NULL(buf);
+
+	for (i = 0; i < 6; i++)
+		data[i] = i + 1;
+
+	start = 5;
+	tcp_ring_write(buf, size, start, data, sizeof(data));
+
+	rc = tcp_ring_resize(&buf, &size, &start, sizeof(data), 16);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(16, size);
+	PCUT_ASSERT_INT_EQUALS(0, start);
+	for (i = 0; i < 6; i++)
+		PCUT_ASSERT_INT_EQUALS(i + 1, buf[i]);
+
+	free(buf);
+}
+
+PCUT_EXPORT(ring);
@@ -26,7 +26,6 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <adt/prodcons.h>
 #include <inet/endpoint.h>
 #include <io/log.h>
 #include <pcut/pcut.h>
@@ -68,8 +67,11 @@ PCUT_TEST_BEFORE
 /** Test empty queue */
 PCUT_TEST(init_fini)
 {
+	errno_t rc;
+
 	tcp_rqueue_init(&rcb);
-	tcp_rqueue_fibril_start();
+	rc = tcp_rqueue_fibril_start();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
 	tcp_rqueue_fini();
 }
 
@@ -78,6 +80,7 @@ PCUT_TEST(one_segment)
 {
 	tcp_segment_t *seg;
 	inet_ep2_t epp;
+	errno_t rc;
 
 	tcp_rqueue_init(&rcb);
 	seg_cnt = 0;
@@ -87,7 +90,8 @@ PCUT_TEST(one_segment)
 	inet_ep2_init(&epp);
 
 	tcp_rqueue_insert_seg(&epp, seg);
-	tcp_rqueue_fibril_start();
+	rc = tcp_rqueue_fibril_start();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
 	tcp_rqueue_fini();
 
 	PCUT_ASSERT_INT_EQUALS(1, seg_cnt);
@@ -102,13 +106,15 @@ PCUT_TEST(multiple_segments)
 	tcp_segment_t *seg[test_seg_max];
 	inet_ep2_t epp;
 	int i;
+	errno_t rc;
 
 	tcp_rqueue_init(&rcb);
 	seg_cnt = 0;
 
 	inet_ep2_init(&epp);
 
-	tcp_rqueue_fibril_start();
+	rc = tcp_rqueue_fibril_start();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
 
 	for (i = 0; i < test_seg_max; i++) {
 		seg[i] = tcp_segment_make_ctrl(CTL_ACK);
@@ -126,4 +132,49 @@ PCUT_TEST(multiple_segments)
 
 }
 
+/** Test segments of several connections keep their order */
+PCUT_TEST(multiple_connections)
+{
+	tcp_segment_t *seg[test_seg_max];
+	inet_ep2_t epp;
+	int i, j;
+	int last;
+	errno_t rc;
+
+	tcp_rqueue_init(&rcb);
+	seg_cnt = 0;
+
+	inet_ep2_init(&epp);
+	rc = tcp_rqueue_fibril_start();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Interleave segments of two connections */
+	for (i = 0; i < test_seg_max; i++) {
+		seg[i] = tcp_segment_make_ctrl(CTL_ACK);
+		PCUT_ASSERT_NOT_NULL(seg[i]);
+		seg[i]->seq = i;
+		epp.remote.port = 1024 + i % 2;
+		tcp_rqueue_insert_seg(&epp, seg[i]);
+	}
+
+	tcp_rqueue_fini();
+
+	PCUT_ASSERT_INT_EQUALS(test_seg_max, seg_cnt);
+
+	/* Check ordering within each connection */
+	for (j = 0; j < 2; j++) {
+		last = -1;
+		for (i = 0; i < test_seg_max; i++) {
+			if ((int) recv_seg[i]->seq % 2 != j)
+				continue;
+
+			PCUT_ASSERT_TRUE((int) recv_seg[i]->seq > last);
+			last = recv_seg[i]->seq;
+		}
+	}
+
+	for (i = 0; i < test_seg_max; i++)
+		tcp_segment_delete(seg[i]);
+}
+
 PCUT_EXPORT(rqueue);
@@ -190,8 +190,10 @@ PCUT_TEST(new_data_small_win)
 	PCUT_ASSERT_EQUALS(15, conn->snd_nxt);
 	PCUT_ASSERT_EQUALS(25, conn->snd_buf_used);
 	PCUT_ASSERT_FALSE(conn->snd_buf_fin);
-	for (i = 0; i < 25; i++)
-		PCUT_ASSERT_INT_EQUALS(5 + i, conn->snd_buf[i]);
+	for (i = 0; i < 25; i++) {
+		PCUT_ASSERT_INT_EQUALS(5 + i, conn->snd_buf[(conn->snd_buf_start +
+		    i) % conn->snd_buf_size]);
+	}
 
 	tcp_conn_delete(conn);
 	PCUT_ASSERT_EQUALS(1, seg_cnt);
@@ -215,6 +217,8 @@ PCUT_TEST(ack_received)
 	conn->snd_una = 10;
 	conn->snd_nxt = 10;
 	conn->snd_wnd = 1024;
+	/* Do not hold back the second segment */
+	conn->nodelay = true;
 
 	/* Redirect segment transmission */
 	conn->retransmit.cb = &tqueue_test_cb;
@@ -253,6 +257,131 @@ PCUT_TEST(ack_received)
 	tcp_conn_delete(conn);
 }
 
+/** Test Nagle's algorithm holding back a small segment */
+PCUT_TEST(new_data_nagle)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 1024;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	/* Nothing in flight, small segment is sent */
+	conn->snd_buf_used = 10;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_EQUALS(20, conn->snd_nxt);
+
+	/* Data in flight, small segment is held back */
+	conn->snd_buf_used = 10;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_EQUALS(20, conn->snd_nxt);
+	PCUT_ASSERT_EQUALS(10, conn->snd_buf_used);
+
+	/* ACK of outstanding data releases it */
+	conn->snd_una = 20;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_EQUALS(30, conn->snd_nxt);
+	PCUT_ASSERT_EQUALS(0, conn->snd_buf_used);
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+	PCUT_ASSERT_EQUALS(2, seg_cnt);
+}
+
+/** Test corking and pushing data */
+PCUT_TEST(new_data_cork)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 1024;
+	conn->cork = true;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	/* Partial segment is held back while corked */
+	conn->snd_buf_used = 10;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_EQUALS(10, conn->snd_nxt);
+	PCUT_ASSERT_EQUALS(0, seg_cnt);
+
+	/* Push sends it anyway */
+	tcp_tqueue_push(conn);
+	PCUT_ASSERT_EQUALS(20, conn->snd_nxt);
+	PCUT_ASSERT_EQUALS(0, conn->snd_buf_used);
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+	PCUT_ASSERT_EQUALS(1, seg_cnt);
+}
+
+/** Test acknowledging every second segment */
+PCUT_TEST(ack_delayed)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->rcv_nxt = 100;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	/* First segment, ACK is delayed */
+	tcp_tqueue_ack_delayed(conn);
+	PCUT_ASSERT_EQUALS(0, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(1, conn->retransmit.ack_pending);
+
+	/* Second segment is acknowledged immediately */
+	conn->rcv_nxt = 200;
+	tcp_tqueue_ack_delayed(conn);
+	PCUT_ASSERT_EQUALS(1, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(0, conn->retransmit.ack_pending);
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+	PCUT_ASSERT_EQUALS(CTL_ACK, trans_seg[0]->ctrl);
+	PCUT_ASSERT_EQUALS(200, trans_seg[0]->ack);
+}
+
 static void tqueue_test_transmit_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
 	trans_seg[seg_cnt++] = seg;
@@ -69,7 +69,8 @@ PCUT_TEST_BEFORE
 	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
 
 	tcp_rqueue_init(&test_rqueue_cb);
-	tcp_rqueue_fibril_start();
+	rc = tcp_rqueue_fibril_start();
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
 
 	/* Enable internal loopback */
 	tcp_conn_lb = tcp_lb_segment;
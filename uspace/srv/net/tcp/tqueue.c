@@ -42,25 +42,35 @@
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <time.h>
 
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
+#include "iqueue.h"
 #include "ncsim.h"
+#include "ring.h"
 #include "rqueue.h"
 #include "segment.h"
 #include "seq_no.h"
 #include "tqueue.h"
 #include "tcp_type.h"
 
-#define RETRANSMIT_TIMEOUT	(2*1000*1000)
+/** Delayed ACK timeout (RFC 1122 requires less than 0.5 s) */
+#define DELAYED_ACK_TIMEOUT (200 * 1000)
 
 static void retransmit_timeout_func(void *);
+static void ack_timeout_func(void *);
+static void tcp_tqueue_retransmit(tcp_conn_t *);
 static void tcp_tqueue_timer_set(tcp_conn_t *);
 static void tcp_tqueue_timer_clear(tcp_conn_t *);
+static void tcp_tqueue_ack_timer_clear(tcp_conn_t *);
+static void tcp_tqueue_send_data(tcp_conn_t *, bool);
 static void tcp_tqueue_seg(tcp_conn_t *, tcp_segment_t *);
 static void tcp_conn_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 static void tcp_prepare_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 static void tcp_tqueue_send_immed(tcp_conn_t *, tcp_segment_t *);
+static void tcp_tqueue_seg_opts(tcp_conn_t *, tcp_segment_t *);
 
 errno_t tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn,
     tcp_tqueue_cb_t *cb)
@@ -71,6 +81,14 @@ errno_t tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn,
 	if (tqueue->timer == NULL)
 		return ENOMEM;
 
+	tqueue->ack_timer = fibril_timer_create(&conn->lock);
+	if (tqueue->ack_timer == NULL) {
+		fibril_timer_destroy(tqueue->timer);
+		tqueue->timer = NULL;
+		return ENOMEM;
+	}
+
+	tqueue->ack_pending = 0;
 	list_initialize(&tqueue->list);
 
 	return EOK;
@@ -79,6 +97,7 @@ errno_t tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn,
 void tcp_tqueue_clear(tcp_tqueue_t *tqueue)
 {
 	tcp_tqueue_timer_clear(tqueue->conn);
+	tcp_tqueue_ack_timer_clear(tqueue->conn);
 }
 
 void tcp_tqueue_fini(tcp_tqueue_t *tqueue)
@@ -91,6 +110,11 @@ void tcp_tqueue_fini(tcp_tqueue_t *tqueue)
 		tqueue->timer = NULL;
 	}
 
+	if (tqueue->ack_timer != NULL) {
+		fibril_timer_destroy(tqueue->ack_timer);
+		tqueue->ack_timer = NULL;
+	}
+
 	while (!list_empty(&tqueue->list)) {
 		link = list_first(&tqueue->list);
 		tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
@@ -146,6 +170,7 @@ static void tcp_tqueue_seg(tcp_conn_t *conn, tcp_segment_t *seg)
 		tqe->conn = conn;
 		tqe->seg = rt_seg;
 		rt_seg->seq = conn->snd_nxt;
+		getuptime(&tqe->sent);
 
 		list_append(&tqe->link, &conn->retransmit.list);
 
@@ -172,11 +197,62 @@ static void tcp_prepare_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 	tcp_conn_transmit_segment(conn, seg);
 }
 
+/** Determine whether a partial segment should be held back.
+ *
+ * While corked only full-sized segments are sent. Otherwise Nagle's
+ * algorithm (RFC 896) allows at most one partial segment in flight,
+ * unless disabled for the connection.
+ *
+ * @param conn		Connection
+ * @param data_size	Size of the data that would be sent
+ * @return		@c true if sending should be postponed
+ */
+static bool tcp_tqueue_hold_partial(tcp_conn_t *conn, size_t data_size)
+{
+	if (data_size >= conn->cc.smss)
+		return false;
+
+	/* Wait until enough data is buffered to fill a segment */
+	if (conn->cork && conn->snd_buf_used < conn->cc.smss)
+		return true;
+
+	/* Wait until all outstanding data is acknowledged */
+	if (!conn->nodelay && conn->snd_nxt != conn->snd_una)
+		return true;
+
+	return false;
+}
+
 /** Transmit data from the send buffer.
+ *
+ * Data is sent in segments of at most SMSS bytes, limited by both
+ * the send window and the congestion window. Partial segments may be
+ * held back according to Nagle's algorithm and corking.
  *
  * @param conn	Connection
  */
 void tcp_tqueue_new_data(tcp_conn_t *conn)
+{
+	tcp_tqueue_send_data(conn, false);
+}
+
+/** Transmit all data from the send buffer allowed by the windows.
+ *
+ * Unlike tcp_tqueue_new_data() partial segments are never held back.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_push(tcp_conn_t *conn)
+{
+	tcp_tqueue_send_data(conn, true);
+}
+
+/** Transmit data from the send buffer.
+ *
+ * @param conn	Connection
+ * @param push	Send partial segments immediately
+ */
+static void tcp_tqueue_send_data(tcp_conn_t *conn, bool push)
 {
 	size_t avail_wnd;
 	size_t xfer_seqlen;
@@ -187,54 +263,71 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 
 	tcp_segment_t *seg;
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_new_data()", conn->name);
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_send_data(%d)",
+	    conn->name, (int) push);
 
-	/* Number of free sequence numbers in send window */
-	avail_wnd = (conn->snd_una + conn->snd_wnd) - conn->snd_nxt;
-	snd_buf_seqlen = conn->snd_buf_used + (conn->snd_buf_fin ? 1 : 0);
+	while (true) {
+		/* Number of sequence numbers we are allowed to send */
+		avail_wnd = tcp_cc_avail_wnd(conn);
+		snd_buf_seqlen = conn->snd_buf_used + (conn->snd_buf_fin ? 1 : 0);
 
-	xfer_seqlen = min(snd_buf_seqlen, avail_wnd);
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: snd_buf_seqlen = %zu, SND.WND = %" PRIu32 ", "
-	    "xfer_seqlen = %zu", conn->name, snd_buf_seqlen, conn->snd_wnd,
-	    xfer_seqlen);
+		xfer_seqlen = min(snd_buf_seqlen, avail_wnd);
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: snd_buf_seqlen = %zu, "
+		    "SND.WND = %" PRIu32 ", CWND = %" PRIu32 ", "
+		    "xfer_seqlen = %zu", conn->name, snd_buf_seqlen,
+		    conn->snd_wnd, conn->cc.cwnd, xfer_seqlen);
 
-	if (xfer_seqlen == 0)
-		return;
+		if (xfer_seqlen == 0)
+			return;
 
-	/* XXX Do not always send immediately */
+		send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
+		data_size = xfer_seqlen - (send_fin ? 1 : 0);
 
-	send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
-	data_size = xfer_seqlen - (send_fin ? 1 : 0);
+		if (data_size > conn->cc.smss) {
+			data_size = conn->cc.smss;
+			send_fin = false;
+		}
 
-	if (send_fin) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.", conn->name);
-		/* We are sending out FIN */
-		ctrl = CTL_FIN;
-	} else {
-		ctrl = 0;
-	}
+		/* FIN flushes whatever is left in the buffer */
+		if (!push && !send_fin && tcp_tqueue_hold_partial(conn, data_size)) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Holding back %zu "
+			    "bytes.", conn->name, data_size);
+			return;
+		}
 
-	seg = tcp_segment_make_data(ctrl, conn->snd_buf, data_size);
-	if (seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
-		return;
-	}
+		if (send_fin) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.",
+			    conn->name);
+			/* We are sending out FIN */
+			ctrl = CTL_FIN;
+		} else {
+			ctrl = 0;
+		}
 
-	/* Remove data from send buffer */
-	memmove(conn->snd_buf, conn->snd_buf + data_size,
-	    conn->snd_buf_used - data_size);
-	conn->snd_buf_used -= data_size;
+		seg = tcp_segment_make_data(ctrl, NULL, data_size);
+		if (seg == NULL) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
+			return;
+		}
 
-	if (send_fin)
-		conn->snd_buf_fin = false;
+		/* Remove data from send buffer */
+		tcp_ring_read(conn->snd_buf, conn->snd_buf_size,
+		    conn->snd_buf_start, seg->data, data_size);
+		conn->snd_buf_start = (conn->snd_buf_start + data_size) %
+		    conn->snd_buf_size;
+		conn->snd_buf_used -= data_size;
 
-	fibril_condvar_broadcast(&conn->snd_buf_cv);
+		if (send_fin)
+			conn->snd_buf_fin = false;
 
-	if (send_fin)
-		tcp_conn_fin_sent(conn);
+		fibril_condvar_broadcast(&conn->snd_buf_cv);
 
-	tcp_tqueue_seg(conn, seg);
-	tcp_segment_delete(seg);
+		if (send_fin)
+			tcp_conn_fin_sent(conn);
+
+		tcp_tqueue_seg(conn, seg);
+		tcp_segment_delete(seg);
+	}
 }
 
 /** Remove ACKed segments from retransmission queue and possibly transmit
@@ -245,10 +338,19 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 void tcp_tqueue_ack_received(tcp_conn_t *conn)
 {
 	link_t *cur, *next;
+	struct timespec now;
+	uint32_t acked;
+	usec_t rtt;
+	bool rtt_valid;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_ack_received(%p)", conn->name,
 	    conn);
 
+	acked = 0;
+	rtt = 0;
+	rtt_valid = false;
+	getuptime(&now);
+
 	cur = conn->retransmit.list.head.next;
 
 	while (cur != &conn->retransmit.list.head) {
@@ -270,6 +372,18 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 				conn->fin_is_acked = true;
 			}
 
+			/* Count only data, SYN and FIN do not open cwnd */
+			acked += tcp_segment_text_size(tqe->seg);
+
+			/*
+			 * Only time segments that were not retransmitted.
+			 * With timestamps, RTT is measured from the echo.
+			 */
+			if (!tqe->retransmitted && !conn->ts_ok) {
+				rtt = NSEC2USEC(ts_sub_diff(&now, &tqe->sent));
+				rtt_valid = true;
+			}
+
 			tcp_segment_delete(tqe->seg);
 			free(tqe);
 
@@ -280,6 +394,13 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 		cur = next;
 	}
 
+	if (rtt_valid)
+		tcp_cc_rtt_sample(conn, rtt);
+
+	/* Partial ACK during loss recovery: resend next missing segment */
+	if (acked > 0 && tcp_cc_ack(conn, acked))
+		tcp_tqueue_retransmit(conn);
+
 	/* Clear retransmission timer if the queue is empty. */
 	if (list_empty(&conn->retransmit.list))
 		tcp_tqueue_timer_clear(conn);
@@ -288,21 +409,256 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 	tcp_tqueue_new_data(conn);
 }
 
+/** Process duplicate ACK.
+ *
+ * This should be called when an ACK is received that does not advance
+ * SND.UNA, carries no data and does not change the send window while
+ * there is outstanding data.
+ */
+void tcp_tqueue_dup_ack(tcp_conn_t *conn)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_dup_ack(%p)", conn->name,
+	    conn);
+
+	/* Fast retransmit */
+	if (tcp_cc_dup_ack(conn)) {
+		tcp_tqueue_retransmit(conn);
+		tcp_tqueue_timer_set(conn);
+	}
+
+	/* Congestion window might have been inflated */
+	tcp_tqueue_new_data(conn);
+}
+
+/** Acknowledge in-sequence data received from peer.
+ *
+ * Following RFC 1122 section 4.2.3.2 every second segment is acknowledged
+ * immediately. Otherwise the ACK is delayed by up to DELAYED_ACK_TIMEOUT
+ * so that it can be piggybacked on data or a window update.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_ack_delayed(tcp_conn_t *conn)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	if (conn->retransmit.ack_pending > 0) {
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+		return;
+	}
+
+	conn->retransmit.ack_pending = 1;
+	tcp_conn_addref(conn);
+	fibril_timer_set_locked(conn->retransmit.ack_timer,
+	    DELAYED_ACK_TIMEOUT, ack_timeout_func, (void *) conn);
+}
+
+/** Send window update after data was removed from the receive buffer.
+ *
+ * To avoid silly window syndrome (RFC 1122 section 4.2.3.3) the update
+ * is only sent once the right window edge can be advanced by a full
+ * segment or half of the receive buffer, whichever is smaller.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_wnd_update(tcp_conn_t *conn)
+{
+	uint32_t advance;
+	uint32_t thresh;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	advance = conn->rcv_nxt + conn->rcv_wnd - conn->rcv_adv;
+	if ((advance & (0x1 << 31)) != 0)
+		return;
+
+	thresh = min(conn->cc.smss, conn->rcv_buf_size / 2);
+	if (advance >= thresh)
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+}
+
+/** Process SACK blocks received from peer.
+ *
+ * Mark segments in the retransmission queue that the peer has received
+ * so that they are skipped when retransmitting.
+ *
+ * @param conn	Connection
+ * @param opts	Options of the incoming segment
+ */
+void tcp_tqueue_sack_received(tcp_conn_t *conn, tcp_seg_opts_t *opts)
+{
+	uint32_t flight;
+	uint32_t start, end;
+	uint32_t left, right;
+	unsigned i;
+
+	flight = conn->snd_nxt - conn->snd_una;
+
+	list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t, tqe) {
+		if (tqe->sacked)
+			continue;
+
+		/* Work with offsets relative to SND.UNA */
+		start = tqe->seg->seq - conn->snd_una;
+		end = start + tqe->seg->len;
+
+		for (i = 0; i < opts->sack_cnt; i++) {
+			left = opts->sack[i].left - conn->snd_una;
+			right = opts->sack[i].right - conn->snd_una;
+
+			/* Ignore invalid blocks */
+			if (left >= right || right > flight)
+				continue;
+
+			if (left <= start && end <= right) {
+				tqe->sacked = true;
+				break;
+			}
+		}
+	}
+}
+
+/** Process timestamp echoed by peer in an ACK of new data.
+ *
+ * @param conn	Connection
+ * @param ecr	Timestamp echo reply
+ */
+void tcp_tqueue_ts_echo(tcp_conn_t *conn, uint32_t ecr)
+{
+	uint32_t rtt_ms;
+
+	rtt_ms = tcp_tqueue_ts_now() - ecr;
+
+	/* Ignore bogus echoes */
+	if ((rtt_ms & (0x1 << 31)) != 0)
+		return;
+
+	tcp_cc_rtt_sample(conn, MSEC2USEC((usec_t) rtt_ms));
+}
+
+/** Return current value of timestamp clock (milliseconds). */
+uint32_t tcp_tqueue_ts_now(void)
+{
+	struct timespec now;
+
+	getuptime(&now);
+	return (uint32_t) (now.tv_sec * 1000 + NSEC2MSEC(now.tv_nsec));
+}
+
+/** Retransmit the first segment in the retransmission queue.
+ *
+ * Segments selectively acknowledged by the peer are skipped.
+ */
+static void tcp_tqueue_retransmit(tcp_conn_t *conn)
+{
+	tcp_tqueue_entry_t *tqe;
+	tcp_segment_t *rt_seg;
+	link_t *link;
+
+	link = list_first(&conn->retransmit.list);
+	while (link != NULL) {
+		tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+		if (!tqe->sacked)
+			break;
+
+		link = list_next(link, &conn->retransmit.list);
+	}
+
+	if (link == NULL) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Nothing to retransmit");
+		return;
+	}
+
+	rt_seg = tcp_segment_dup(tqe->seg);
+	if (rt_seg == NULL) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
+		/* XXX Handle properly */
+		return;
+	}
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment", conn->name);
+	tqe->retransmitted = true;
+	++conn->cc.retransmits;
+	tcp_conn_transmit_segment(tqe->conn, rt_seg);
+	tcp_segment_delete(rt_seg);
+}
+
 static void tcp_conn_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 {
+	uint8_t wscale;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_conn_transmit_segment(%p, %p)",
 	    conn->name, conn, seg);
 
-	seg->wnd = conn->rcv_wnd;
+	/* Window in SYN segments is never scaled (RFC 7323 section 2.2) */
+	wscale = (seg->ctrl & CTL_SYN) != 0 ? 0 : conn->rcv_wscale;
+	seg->wnd = min(conn->rcv_wnd >> wscale, UINT16_MAX);
 
-	if ((seg->ctrl & CTL_ACK) != 0)
+	if ((seg->ctrl & CTL_ACK) != 0) {
 		seg->ack = conn->rcv_nxt;
-	else
+		conn->rcv_adv = conn->rcv_nxt + ((uint32_t) seg->wnd << wscale);
+
+		/* Pending delayed ACK is piggybacked on this segment */
+		if (conn->retransmit.ack_pending > 0)
+			tcp_tqueue_ack_timer_clear(conn);
+	} else {
 		seg->ack = 0;
+	}
+
+	tcp_tqueue_seg_opts(conn, seg);
 
 	tcp_tqueue_send_immed(conn, seg);
 }
 
+/** Fill in options of an outgoing segment.
+ *
+ * SYN segments offer window scaling, SACK and timestamps; SYN-ACK segments
+ * only confirm those offered by the peer. Other segments carry timestamps
+ * and SACK blocks if negotiated.
+ */
+static void tcp_tqueue_seg_opts(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	tcp_seg_opts_t *opts = &seg->opts;
+	bool offer;
+
+	memset(opts, 0, sizeof(tcp_seg_opts_t));
+
+	if ((seg->ctrl & CTL_RST) != 0)
+		return;
+
+	if ((seg->ctrl & CTL_SYN) != 0) {
+		/* Active open offers all options */
+		offer = (seg->ctrl & CTL_ACK) == 0;
+
+		if (offer || conn->ws_ok) {
+			opts->wscale_present = true;
+			opts->wscale = conn->rcv_wscale;
+		}
+
+		opts->sack_perm = offer || conn->sack_ok;
+
+		if (offer || conn->ts_ok) {
+			opts->ts_present = true;
+			opts->ts_val = tcp_tqueue_ts_now();
+			opts->ts_ecr = conn->ts_ok ? conn->ts_recent : 0;
+		}
+
+		return;
+	}
+
+	if (conn->ts_ok) {
+		opts->ts_present = true;
+		opts->ts_val = tcp_tqueue_ts_now();
+		opts->ts_ecr = conn->ts_recent;
+	}
+
+	if (conn->sack_ok) {
+		/* Only three blocks fit together with timestamps */
+		opts->sack_cnt = tcp_iqueue_sack_blocks(&conn->incoming,
+		    opts->sack, conn->ts_ok ? 3 : TCP_SACK_BLOCKS_MAX);
+	}
+}
+
 void tcp_tqueue_send_immed(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG,
@@ -320,8 +676,6 @@ void tcp_tqueue_send_immed(tcp_conn_t *conn, tcp_segment_t *seg)
 static void retransmit_timeout_func(void *arg)
 {
 	tcp_conn_t *conn = (tcp_conn_t *) arg;
-	tcp_tqueue_entry_t *tqe;
-	tcp_segment_t *rt_seg;
 	link_t *link;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p)", conn->name, conn);
@@ -343,22 +697,16 @@ static void retransmit_timeout_func(void *arg)
 		return;
 	}
 
-	tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
-
-	rt_seg = tcp_segment_dup(tqe->seg);
-	if (rt_seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
-		tcp_conn_unlock(conn);
-		tcp_conn_delref(conn);
-		/* XXX Handle properly */
-		return;
-	}
+	/* Peer may have discarded SACKed data (RFC 2018 section 8) */
+	list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t, tqe)
+		tqe->sacked = false;
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment", conn->name);
-	tcp_conn_transmit_segment(tqe->conn, rt_seg);
+	/* Back off timer and shrink congestion window */
+	tcp_cc_timeout(conn);
+	tcp_tqueue_retransmit(conn);
 
 	/* Reset retransmission timer */
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->cc.rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	tcp_conn_unlock(conn);
@@ -366,6 +714,45 @@ static void retransmit_timeout_func(void *arg)
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p) end", conn->name, conn);
 }
 
+/** Delayed ACK timeout.
+ *
+ * @param arg	Connection
+ */
+static void ack_timeout_func(void *arg)
+{
+	tcp_conn_t *conn = (tcp_conn_t *) arg;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: ack_timeout_func(%p)",
+	    conn->name, conn);
+
+	tcp_conn_lock(conn);
+
+	/*
+	 * Reset the count first, so that sending the ACK does not try
+	 * to clear the timer from inside its handler.
+	 */
+	if (conn->retransmit.ack_pending > 0) {
+		conn->retransmit.ack_pending = 0;
+		if (conn->cstate != st_closed)
+			tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	}
+
+	tcp_conn_unlock(conn);
+	tcp_conn_delref(conn);
+}
+
+/** Clear delayed ACK timer */
+static void tcp_tqueue_ack_timer_clear(tcp_conn_t *conn)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	if (fibril_timer_clear_locked(conn->retransmit.ack_timer) ==
+	    fts_active)
+		tcp_conn_delref(conn);
+
+	conn->retransmit.ack_pending = 0;
+}
+
 /** Set or re-set retransmission timer */
 static void tcp_tqueue_timer_set(tcp_conn_t *conn)
 {
@@ -377,7 +764,7 @@ static void tcp_tqueue_timer_set(tcp_conn_t *conn)
 	tcp_tqueue_timer_clear(conn);
 
 	tcp_conn_addref(conn);
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->cc.rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: tcp_tqueue_timer_set() end", conn->name);
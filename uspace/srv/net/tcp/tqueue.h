@@ -45,7 +45,14 @@ extern void tcp_tqueue_clear(tcp_tqueue_t *);
 extern void tcp_tqueue_fini(tcp_tqueue_t *);
 extern void tcp_tqueue_ctrl_seg(tcp_conn_t *, tcp_control_t);
 extern void tcp_tqueue_new_data(tcp_conn_t *);
+extern void tcp_tqueue_push(tcp_conn_t *);
 extern void tcp_tqueue_ack_received(tcp_conn_t *);
+extern void tcp_tqueue_dup_ack(tcp_conn_t *);
+extern void tcp_tqueue_ack_delayed(tcp_conn_t *);
+extern void tcp_tqueue_wnd_update(tcp_conn_t *);
+extern void tcp_tqueue_sack_received(tcp_conn_t *, tcp_seg_opts_t *);
+extern void tcp_tqueue_ts_echo(tcp_conn_t *, uint32_t);
+extern uint32_t tcp_tqueue_ts_now(void);
 
 #endif
 
@@ -39,7 +39,9 @@
 #include <io/log.h>
 #include <macros.h>
 #include <mem.h>
+#include "cc.h"
 #include "conn.h"
+#include "ring.h"
 #include "tcp_type.h"
 #include "tqueue.h"
 #include "ucall.h"
@@ -162,7 +164,8 @@ tcp_error_t tcp_uc_send(tcp_conn_t *conn, void *data, size_t size,
 		xfer_size = min(size, buf_free);
 
 		/* Copy data to buffer */
-		memcpy(conn->snd_buf + conn->snd_buf_used, data, xfer_size);
+		tcp_ring_write(conn->snd_buf, conn->snd_buf_size,
+		    conn->snd_buf_start + conn->snd_buf_used, data, xfer_size);
 		data += xfer_size;
 		conn->snd_buf_used += xfer_size;
 		size -= xfer_size;
@@ -170,7 +173,11 @@ tcp_error_t tcp_uc_send(tcp_conn_t *conn, void *data, size_t size,
 		tcp_tqueue_new_data(conn);
 	}
 
-	tcp_tqueue_new_data(conn);
+	if ((flags & XF_PUSH) != 0)
+		tcp_tqueue_push(conn);
+	else
+		tcp_tqueue_new_data(conn);
+
 	tcp_conn_unlock(conn);
 
 	return TCP_EOK;
@@ -217,20 +224,21 @@ tcp_error_t tcp_uc_receive(tcp_conn_t *conn, void *buf, size_t size,
 
 	/* Copy data from receive buffer to user buffer */
 	xfer_size = min(size, conn->rcv_buf_used);
-	memcpy(buf, conn->rcv_buf, xfer_size);
+	tcp_ring_read(conn->rcv_buf, conn->rcv_buf_size, conn->rcv_buf_start,
+	    buf, xfer_size);
 	*rcvd = xfer_size;
 
 	/* Remove data from receive buffer */
-	memmove(conn->rcv_buf, conn->rcv_buf + xfer_size, conn->rcv_buf_used -
-	    xfer_size);
+	conn->rcv_buf_start = (conn->rcv_buf_start + xfer_size) %
+	    conn->rcv_buf_size;
 	conn->rcv_buf_used -= xfer_size;
 	conn->rcv_wnd += xfer_size;
 
 	/* TODO */
 	*xflags = 0;
 
-	/* Send new size of receive window */
-	tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	/* Send new size of receive window if it opened enough */
+	tcp_tqueue_wnd_update(conn);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_uc_receive() - returning %zu bytes",
 	    conn->name, xfer_size);
@@ -292,6 +300,90 @@ void tcp_uc_status(tcp_conn_t *conn, tcp_conn_status_t *cstatus)
 	cstatus->cstate = conn->cstate;
 }
 
+/** Set connection buffer sizes (not a user call in the spec)
+ *
+ * @param conn     Connection
+ * @param snd_size Send buffer size in bytes or zero to leave unchanged
+ * @param rcv_size Receive buffer size in bytes or zero to leave unchanged
+ * @return EOK on success, EINVAL if size is not valid, ENOMEM if out
+ *         of memory
+ */
+errno_t tcp_uc_set_buf_size(tcp_conn_t *conn, size_t snd_size,
+    size_t rcv_size)
+{
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_uc_set_buf_size()");
+
+	tcp_conn_lock(conn);
+	rc = tcp_conn_set_buf_size(conn, snd_size, rcv_size);
+	tcp_conn_unlock(conn);
+
+	return rc;
+}
+
+/** Push user call (not a separate call in the spec)
+ *
+ * Send out all buffered data without waiting for a full segment.
+ *
+ * @param conn Connection
+ */
+void tcp_uc_push(tcp_conn_t *conn)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_uc_push()", conn->name);
+
+	tcp_conn_lock(conn);
+	tcp_tqueue_push(conn);
+	tcp_conn_unlock(conn);
+}
+
+/** Enable or disable Nagle's algorithm (not a user call in the spec)
+ *
+ * @param conn    Connection
+ * @param nodelay @c true to send small segments without delay
+ */
+void tcp_uc_set_nodelay(tcp_conn_t *conn, bool nodelay)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_uc_set_nodelay(%d)",
+	    conn->name, (int) nodelay);
+
+	tcp_conn_lock(conn);
+	conn->nodelay = nodelay;
+	if (nodelay)
+		tcp_tqueue_push(conn);
+	tcp_conn_unlock(conn);
+}
+
+/** Cork or uncork connection (not a user call in the spec)
+ *
+ * While corked, only full-sized segments are sent. Uncorking sends out
+ * all buffered data.
+ *
+ * @param conn Connection
+ * @param cork @c true to cork, @c false to uncork
+ */
+void tcp_uc_set_cork(tcp_conn_t *conn, bool cork)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_uc_set_cork(%d)",
+	    conn->name, (int) cork);
+
+	tcp_conn_lock(conn);
+	conn->cork = cork;
+	if (!cork)
+		tcp_tqueue_push(conn);
+	tcp_conn_unlock(conn);
+}
+
+/** Get connection statistics (not a user call in the spec) */
+void tcp_uc_get_stats(tcp_conn_t *conn, tcp_conn_stats_t *stats)
+{
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_uc_get_stats()");
+
+	tcp_conn_lock(conn);
+	tcp_cc_get_stats(conn, stats);
+	tcp_conn_unlock(conn);
+}
+
 /** Delete connection user call.
  *
  * (Not in spec.) Inform TCP that the user is done with this connection
@@ -36,6 +36,8 @@
 #define UCALL_H
 
 #include <inet/endpoint.h>
+#include <ipc/tcp.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include "tcp_type.h"
 
@@ -49,6 +51,11 @@ extern tcp_error_t tcp_uc_receive(tcp_conn_t *, void *, size_t, size_t *, xflags
 extern tcp_error_t tcp_uc_close(tcp_conn_t *);
 extern void tcp_uc_abort(tcp_conn_t *);
 extern void tcp_uc_status(tcp_conn_t *, tcp_conn_status_t *);
+extern errno_t tcp_uc_set_buf_size(tcp_conn_t *, size_t, size_t);
+extern void tcp_uc_push(tcp_conn_t *);
+extern void tcp_uc_set_nodelay(tcp_conn_t *, bool);
+extern void tcp_uc_set_cork(tcp_conn_t *, bool);
+extern void tcp_uc_get_stats(tcp_conn_t *, tcp_conn_stats_t *);
 extern void tcp_uc_delete(tcp_conn_t *);
 extern void tcp_uc_set_cb(tcp_conn_t *, tcp_cb_t *, void *);
 extern void *tcp_uc_get_userptr(tcp_conn_t *);
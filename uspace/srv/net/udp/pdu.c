@@ -40,84 +40,12 @@
 #include <mem.h>
 #include <stdlib.h>
 #include <inet/addr.h>
+#include <inet/checksum.h>
 #include "msg.h"
 #include "pdu.h"
 #include "std.h"
 #include "udp_type.h"
 
-#define UDP_CHECKSUM_INIT 0xffff
-
-/** One's complement addition.
- *
- * Result is a + b + carry.
- */
-static uint16_t udp_ocadd16(uint16_t a, uint16_t b)
-{
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
-
-static uint16_t udp_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2 * i] << 8) | bdata[2 * i + 1];
-		sum = udp_ocadd16(sum, w);
-	}
-
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2 * words] << 8);
-		sum = udp_ocadd16(sum, w);
-	}
-
-	return ~sum;
-}
-
-static ip_ver_t udp_phdr_setup(udp_pdu_t *pdu, udp_phdr_t *phdr,
-    udp_phdr6_t *phdr6)
-{
-	addr32_t src_v4;
-	addr128_t src_v6;
-	ip_ver_t src_ver = inet_addr_get(&pdu->src, &src_v4, &src_v6);
-
-	addr32_t dest_v4;
-	addr128_t dest_v6;
-	ip_ver_t dest_ver = inet_addr_get(&pdu->dest, &dest_v4, &dest_v6);
-
-	assert(src_ver == dest_ver);
-
-	switch (src_ver) {
-	case ip_v4:
-		phdr->src_addr = host2uint32_t_be(src_v4);
-		phdr->dest_addr = host2uint32_t_be(dest_v4);
-		phdr->zero = 0;
-		phdr->protocol = IP_PROTO_UDP;
-		phdr->udp_length = host2uint16_t_be(pdu->data_size);
-		break;
-	case ip_v6:
-		host2addr128_t_be(src_v6, phdr6->src_addr);
-		host2addr128_t_be(dest_v6, phdr6->dest_addr);
-		phdr6->udp_length = host2uint32_t_be(pdu->data_size);
-		memset(phdr6->zeroes, 0, 3);
-		phdr6->next = IP_PROTO_UDP;
-		break;
-	default:
-		assert(false);
-	}
-
-	return src_ver;
-}
-
 udp_pdu_t *udp_pdu_new(void)
 {
 	return calloc(1, sizeof(udp_pdu_t));
@@ -132,24 +60,10 @@ void udp_pdu_delete(udp_pdu_t *pdu)
 static uint16_t udp_pdu_checksum_calc(udp_pdu_t *pdu)
 {
 	uint16_t cs_phdr;
-	udp_phdr_t phdr;
-	udp_phdr6_t phdr6;
-
-	ip_ver_t ver = udp_phdr_setup(pdu, &phdr, &phdr6);
-	switch (ver) {
-	case ip_v4:
-		cs_phdr = udp_checksum_calc(UDP_CHECKSUM_INIT, (void *) &phdr,
-		    sizeof(udp_phdr_t));
-		break;
-	case ip_v6:
-		cs_phdr = udp_checksum_calc(UDP_CHECKSUM_INIT, (void *) &phdr6,
-		    sizeof(udp_phdr6_t));
-		break;
-	default:
-		assert(false);
-	}
 
-	return udp_checksum_calc(cs_phdr, pdu->data, pdu->data_size);
+	cs_phdr = inet_checksum_phdr(INET_CHECKSUM_INIT, &pdu->src, &pdu->dest,
+	    IP_PROTO_UDP, pdu->data_size);
+	return inet_checksum_calc(cs_phdr, pdu->data, pdu->data_size);
 }
 
 static void udp_pdu_set_checksum(udp_pdu_t *pdu, uint16_t checksum)
@@ -223,7 +223,10 @@ extern errno_t vfs_op_write(int fd, aoff64_t, size_t *out_bytes);
 
 extern void vfs_register(ipc_call_t *);
 
+extern bool vfs_pager_init(void);
 extern void vfs_page_in(ipc_call_t *);
+extern void vfs_pager_invalidate(vfs_triplet_t *, aoff64_t, aoff64_t);
+extern void vfs_pager_invalidate_fs(fs_handle_t, service_id_t);
 
 typedef struct {
 	void *buffer;
@@ -478,6 +478,17 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 
 	vfs_exchange_release(fs_exch);
 
+	if (!read && rc == EOK) {
+		/* Drop the cached pages the write has changed. */
+		vfs_triplet_t triplet = {
+			.fs_handle = file->node->fs_handle,
+			.service_id = file->node->service_id,
+			.index = file->node->index
+		};
+		vfs_pager_invalidate(&triplet, pos,
+		    pos + IPC_GET_ARG1(answer));
+	}
+
 	if (file->node->type == VFS_NODE_DIRECTORY)
 		fibril_rwlock_read_unlock(&namespace_rwlock);
 
@@ -597,6 +608,7 @@ errno_t vfs_op_rename(int basefd, char *old, char *new)
 
 	/* If the node is not held by anyone, try to destroy it. */
 	if (orig_unlinked) {
+		vfs_pager_invalidate(&new_lr_orig.triplet, 0, UINT64_MAX);
 		vfs_node_t *node = vfs_node_peek(&new_lr_orig);
 		if (!node)
 			out_destroy(&new_lr_orig.triplet);
@@ -619,8 +631,17 @@ errno_t vfs_op_resize(int fd, int64_t size)
 
 	errno_t rc = vfs_truncate_internal(file->node->fs_handle,
 	    file->node->service_id, file->node->index, size);
-	if (rc == EOK)
+	if (rc == EOK) {
+		vfs_triplet_t triplet = {
+			.fs_handle = file->node->fs_handle,
+			.service_id = file->node->service_id,
+			.index = file->node->index
+		};
+		vfs_pager_invalidate(&triplet,
+		    min((aoff64_t) size, file->node->size),
+		    max((aoff64_t) size, file->node->size));
 		file->node->size = size;
+	}
 
 	fibril_rwlock_write_unlock(&file->node->contents_rwlock);
 	vfs_file_put(file);
@@ -759,6 +780,12 @@ errno_t vfs_op_unlink(int parentfd, int expectfd, char *path)
 	if (rc != EOK)
 		goto exit;
 
+	/*
+	 * The file index may be reused once the file is destroyed, drop its
+	 * cached pages.
+	 */
+	vfs_pager_invalidate(&lr.triplet, 0, UINT64_MAX);
+
 	/* If the node is not held by anyone, try to destroy it. */
 	vfs_node_t *node = vfs_node_peek(&lr);
 	if (!node)
@@ -815,6 +842,8 @@ errno_t vfs_op_unmount(int mpfd)
 		return rc;
 	}
 
+	vfs_pager_invalidate_fs(mp->node->mount->fs_handle,
+	    mp->node->mount->service_id);
 	vfs_node_forget(mp->node->mount);
 	vfs_node_put(mp->node);
 	mp->node->mount = NULL;
@@ -33,19 +33,240 @@
 /**
  * @file vfs_pager.c
  * @brief VFS pager operations.
+ *
+ * Pages read on behalf of the pager are kept in a page cache so that repeated
+ * faults on the same file page are served from memory. The kernel maps the
+ * frame of a cached page into every task which faults on it, read-only areas
+ * thus share the cached frames. Cached pages are dropped when the file
+ * contents change, when the cache grows too big or when physical memory runs
+ * short.
  */
 
 #include "vfs.h"
+#include <adt/hash_table.h>
+#include <adt/hash.h>
+#include <adt/list.h>
 #include <async.h>
 #include <fibril_synch.h>
 #include <errno.h>
 #include <as.h>
+#include <align.h>
+#include <stats.h>
+#include <stdlib.h>
 
-void vfs_page_in(ipc_call_t *req)
+/** Maximum number of pages in the page cache. */
+#define PAGE_CACHE_MAX  4096
+
+/** Number of page-ins between checks of free physical memory. */
+#define PAGE_CACHE_CHECK  256
+
+/**
+ * The page cache is halved when less than 1/PAGE_CACHE_LOW_MEM of physical
+ * memory is free.
+ */
+#define PAGE_CACHE_LOW_MEM  16
+
+/** Identity of a cached page. */
+typedef struct {
+	fs_handle_t fs_handle;
+	service_id_t service_id;
+	fs_index_t index;
+	aoff64_t offset;
+} page_key_t;
+
+/** Cached page of a file. */
+typedef struct {
+	/** Link to the page cache hash table. */
+	ht_link_t link;
+	/** Link to the LRU list of unused pages. */
+	link_t lru_link;
+
+	page_key_t key;
+	/** Address of the area holding the page. */
+	void *page;
+
+	/** Number of page-in requests being answered with the page. */
+	unsigned refcnt;
+	/** The page is being read from the file system. */
+	bool loading;
+	/** The page was removed from the cache and must not be reused. */
+	bool stale;
+} cached_page_t;
+
+/** Mutex protecting the page cache. */
+static FIBRIL_MUTEX_INITIALIZE(page_cache_lock);
+/** Signalled when a page has been loaded. */
+static FIBRIL_CONDVAR_INITIALIZE(page_cache_cv);
+
+/** Cached pages by their identity. */
+static hash_table_t page_cache;
+/** Unused cached pages, least recently used first. */
+static LIST_INITIALIZE(page_cache_lru);
+/** Number of pages in the page cache. */
+static size_t page_cache_count;
+/** Maximum number of pages in the page cache. */
+static size_t page_cache_max = PAGE_CACHE_MAX;
+/** Size of cached pages. */
+static size_t page_cache_psize;
+/** Page-ins since the last check of free physical memory. */
+static unsigned page_cache_checkin;
+
+static size_t page_key_hash(const page_key_t *key)
+{
+	size_t hash = hash_combine(key->fs_handle, key->index);
+	hash = hash_combine(hash, key->service_id);
+	return hash_combine(hash, key->offset);
+}
+
+static size_t page_cache_key_hash(void *key)
+{
+	return page_key_hash((page_key_t *) key);
+}
+
+static size_t page_cache_hash(const ht_link_t *item)
+{
+	cached_page_t *cp = hash_table_get_inst(item, cached_page_t, link);
+	return page_key_hash(&cp->key);
+}
+
+static bool page_cache_key_equal(void *key, const ht_link_t *item)
+{
+	page_key_t *k = (page_key_t *) key;
+	cached_page_t *cp = hash_table_get_inst(item, cached_page_t, link);
+
+	return cp->key.fs_handle == k->fs_handle &&
+	    cp->key.service_id == k->service_id &&
+	    cp->key.index == k->index && cp->key.offset == k->offset;
+}
+
+/** Page cache hash table operations. */
+static hash_table_ops_t page_cache_ops = {
+	.hash = page_cache_hash,
+	.key_hash = page_cache_key_hash,
+	.key_equal = page_cache_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL,
+};
+
+/** Initialize the page cache.
+ *
+ * @return		Return true on success, false on failure.
+ */
+bool vfs_pager_init(void)
+{
+	return hash_table_create(&page_cache, 0, 0, &page_cache_ops);
+}
+
+static void cached_page_destroy(cached_page_t *cp)
+{
+	if (cp->page != AS_MAP_FAILED)
+		as_area_destroy(cp->page);
+	free(cp);
+}
+
+/** Remove a page from the page cache.
+ *
+ * The page is destroyed once it is no longer used.
+ *
+ * @param cp		Cached page.
+ * @return		Return true if the caller should destroy the page.
+ */
+static bool page_cache_remove(cached_page_t *cp)
+{
+	assert(fibril_mutex_is_locked(&page_cache_lock));
+	assert(!cp->stale);
+
+	hash_table_remove_item(&page_cache, &cp->link);
+	page_cache_count--;
+	cp->stale = true;
+
+	if (cp->refcnt > 0)
+		return false;
+
+	list_remove(&cp->lru_link);
+	return true;
+}
+
+/** Evict unused pages until the page cache holds at most @a count pages. */
+static void page_cache_shrink(size_t count)
+{
+	list_t victims;
+
+	list_initialize(&victims);
+
+	fibril_mutex_lock(&page_cache_lock);
+	while (page_cache_count > count && !list_empty(&page_cache_lru)) {
+		cached_page_t *cp = list_get_instance(
+		    list_first(&page_cache_lru), cached_page_t, lru_link);
+		(void) page_cache_remove(cp);
+		list_append(&cp->lru_link, &victims);
+	}
+	fibril_mutex_unlock(&page_cache_lock);
+
+	list_foreach_safe(victims, cur, next) {
+		cached_page_t *cp = list_get_instance(cur, cached_page_t,
+		    lru_link);
+		list_remove(cur);
+		cached_page_destroy(cp);
+	}
+}
+
+/** Shrink the page cache if physical memory runs short. */
+static void page_cache_check_memory(void)
+{
+	stats_physmem_t *stats = stats_get_physmem();
+	if (stats == NULL)
+		return;
+
+	if (stats->free < stats->total / PAGE_CACHE_LOW_MEM)
+		page_cache_shrink(page_cache_count / 2);
+
+	free(stats);
+}
+
+/** Drop a reference to a cached page.
+ *
+ * @param cp		Cached page.
+ */
+static void cached_page_put(cached_page_t *cp)
+{
+	bool destroy = false;
+	bool check = false;
+
+	fibril_mutex_lock(&page_cache_lock);
+	assert(cp->refcnt > 0);
+	if (--cp->refcnt == 0) {
+		if (cp->stale)
+			destroy = true;
+		else
+			list_append(&cp->lru_link, &page_cache_lru);
+	}
+	if (++page_cache_checkin >= PAGE_CACHE_CHECK) {
+		page_cache_checkin = 0;
+		check = true;
+	}
+	fibril_mutex_unlock(&page_cache_lock);
+
+	if (destroy)
+		cached_page_destroy(cp);
+
+	page_cache_shrink(page_cache_max);
+	if (check)
+		page_cache_check_memory();
+}
+
+/** Read a page of a file into a new area.
+ *
+ * @param fd		File descriptor of the file.
+ * @param offset	Offset of the page in the file.
+ * @param page_size	Size of the page.
+ * @param[out] rpage	Place to store the address of the area.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t page_read(int fd, aoff64_t offset, size_t page_size,
+    void **rpage)
 {
-	aoff64_t offset = IPC_GET_ARG1(*req);
-	size_t page_size = IPC_GET_ARG2(*req);
-	int fd = IPC_GET_ARG3(*req);
 	void *page;
 	errno_t rc;
 
@@ -53,10 +274,8 @@ void vfs_page_in(ipc_call_t *req)
 	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
 	    AS_AREA_UNPAGED);
 
-	if (page == AS_MAP_FAILED) {
-		async_answer_0(req, ENOMEM);
-		return;
-	}
+	if (page == AS_MAP_FAILED)
+		return ENOMEM;
 
 	rdwr_io_chunk_t chunk = {
 		.buffer = page,
@@ -77,15 +296,223 @@ void vfs_page_in(ipc_call_t *req)
 		chunk.size = page_size - total;
 	} while (total < page_size);
 
-	async_answer_1(req, rc, (sysarg_t) page);
+	if (rc != EOK) {
+		as_area_destroy(page);
+		return rc;
+	}
+
+	*rpage = page;
+	return EOK;
+}
+
+void vfs_page_in(ipc_call_t *req)
+{
+	aoff64_t offset = IPC_GET_ARG1(*req);
+	size_t page_size = IPC_GET_ARG2(*req);
+	int fd = IPC_GET_ARG3(*req);
+	cached_page_t *cp;
+	errno_t rc;
+
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file) {
+		async_answer_0(req, EBADF);
+		return;
+	}
+
+	page_key_t key = {
+		.fs_handle = file->node->fs_handle,
+		.service_id = file->node->service_id,
+		.index = file->node->index,
+		.offset = offset
+	};
+	vfs_file_put(file);
+
+	fibril_mutex_lock(&page_cache_lock);
+
+	if (page_cache_psize == 0)
+		page_cache_psize = page_size;
+
+	while (true) {
+		ht_link_t *link = hash_table_find(&page_cache, &key);
+		if (link == NULL)
+			break;
+
+		cp = hash_table_get_inst(link, cached_page_t, link);
+		if (!cp->loading) {
+			/* Serve the fault from the page cache. */
+			if (cp->refcnt++ == 0)
+				list_remove(&cp->lru_link);
+			fibril_mutex_unlock(&page_cache_lock);
+
+			async_answer_1(req, EOK, (sysarg_t) cp->page);
+			cached_page_put(cp);
+			return;
+		}
+
+		fibril_condvar_wait(&page_cache_cv, &page_cache_lock);
+	}
+
+	cp = malloc(sizeof(cached_page_t));
+	if (cp == NULL || page_cache_psize != page_size) {
+		/*
+		 * Read the page without caching it. It is not kept around,
+		 * so private mappings of the page are not coherent.
+		 */
+		fibril_mutex_unlock(&page_cache_lock);
+		free(cp);
+
+		void *page;
+		rc = page_read(fd, offset, page_size, &page);
+		if (rc != EOK) {
+			async_answer_0(req, rc);
+			return;
+		}
+		async_answer_1(req, EOK, (sysarg_t) page);
+		as_area_destroy(page);
+		return;
+	}
+
+	link_initialize(&cp->lru_link);
+	cp->key = key;
+	cp->page = AS_MAP_FAILED;
+	cp->refcnt = 1;
+	cp->loading = true;
+	cp->stale = false;
+	hash_table_insert(&page_cache, &cp->link);
+	page_cache_count++;
+
+	fibril_mutex_unlock(&page_cache_lock);
+
+	rc = page_read(fd, offset, page_size, &cp->page);
+
+	fibril_mutex_lock(&page_cache_lock);
+	cp->loading = false;
+	if (rc != EOK && !cp->stale)
+		(void) page_cache_remove(cp);
+	fibril_condvar_broadcast(&page_cache_cv);
+	fibril_mutex_unlock(&page_cache_lock);
+
+	if (rc != EOK)
+		async_answer_0(req, rc);
+	else
+		async_answer_1(req, EOK, (sysarg_t) cp->page);
+
+	cached_page_put(cp);
+}
+
+typedef struct {
+	page_key_t key;
+	aoff64_t end;
+	bool node;
+	list_t *victims;
+} page_cache_invalidate_t;
+
+static bool page_cache_invalidate_visitor(ht_link_t *item, void *arg)
+{
+	page_cache_invalidate_t *inv = (page_cache_invalidate_t *) arg;
+	cached_page_t *cp = hash_table_get_inst(item, cached_page_t, link);
+
+	if (cp->key.fs_handle != inv->key.fs_handle ||
+	    cp->key.service_id != inv->key.service_id)
+		return true;
+
+	if (inv->node && (cp->key.index != inv->key.index ||
+	    cp->key.offset + page_cache_psize <= inv->key.offset ||
+	    cp->key.offset >= inv->end))
+		return true;
+
+	if (page_cache_remove(cp))
+		list_append(&cp->lru_link, inv->victims);
+
+	return true;
+}
+
+static void page_cache_invalidate(page_cache_invalidate_t *inv)
+{
+	list_t victims;
+
+	list_initialize(&victims);
+	inv->victims = &victims;
+
+	fibril_mutex_lock(&page_cache_lock);
+
+	size_t psize = page_cache_psize;
+	if (page_cache_count == 0 || psize == 0) {
+		fibril_mutex_unlock(&page_cache_lock);
+		return;
+	}
+
+	aoff64_t first = ALIGN_DOWN(inv->key.offset, psize);
+	if (inv->node && inv->end > first &&
+	    (inv->end - first) / psize < page_cache_count) {
+		/* Look up the pages of a short range one by one. */
+		page_key_t key = inv->key;
+
+		for (key.offset = first; key.offset < inv->end;
+		    key.offset += psize) {
+			ht_link_t *link = hash_table_find(&page_cache, &key);
+			if (link != NULL) {
+				(void) page_cache_invalidate_visitor(link,
+				    inv);
+			}
+		}
+	} else {
+		hash_table_apply(&page_cache, page_cache_invalidate_visitor,
+		    inv);
+	}
+
+	fibril_mutex_unlock(&page_cache_lock);
+
+	list_foreach_safe(victims, cur, next) {
+		cached_page_t *cp = list_get_instance(cur, cached_page_t,
+		    lru_link);
+		list_remove(cur);
+		cached_page_destroy(cp);
+	}
+}
+
+/** Drop cached pages of a file range.
+ *
+ * Pages of the range which are being read from the file system are not
+ * reused once read.
+ *
+ * @param triplet	File whose contents changed.
+ * @param start		Start of the range.
+ * @param end		End of the range (exclusive).
+ */
+void vfs_pager_invalidate(vfs_triplet_t *triplet, aoff64_t start,
+    aoff64_t end)
+{
+	page_cache_invalidate_t inv = {
+		.key = {
+			.fs_handle = triplet->fs_handle,
+			.service_id = triplet->service_id,
+			.index = triplet->index,
+			.offset = start
+		},
+		.end = end,
+		.node = true
+	};
+
+	page_cache_invalidate(&inv);
+}
+
+/** Drop cached pages of all files of a file system instance.
+ *
+ * @param fs_handle	File system handle.
+ * @param service_id	Service ID of the file system instance.
+ */
+void vfs_pager_invalidate_fs(fs_handle_t fs_handle, service_id_t service_id)
+{
+	page_cache_invalidate_t inv = {
+		.key = {
+			.fs_handle = fs_handle,
+			.service_id = service_id
+		},
+		.node = false
+	};
 
-	/*
-	 * FIXME:
-	 * This is just for now until we implement proper page cache
-	 * management.  Not keeping the pages around in a cache results in
-	 * inherently non-coherent private mappings.
-	 */
-	as_area_destroy(page);
+	page_cache_invalidate(&inv);
 }
 
 /**